@@ -0,0 +1,157 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/utils/stopwatch.c"
+#include "../src/utils/sleep.c"
+#include "../src/utils/err.c"
+
+/*  Simulates a re-connection storm. Opens the specified number of plain TCP
+    connections to a bound nanomsg socket all at once, sends SP protocol
+    header of a PUSH socket on each of them and measures how long it takes
+    till all of them are accepted. */
+
+static const char sphdr [8] = {0, 'S', 'P', 0, 0, NN_PUSH, 0, 0};
+
+int main (int argc, char *argv [])
+{
+    int port;
+    int count;
+    int backlog;
+    char addr [64];
+    struct sockaddr_in sin;
+    struct pollfd *pfds;
+    int *fds;
+    int pending;
+    int failed;
+    int s;
+    int rc;
+    int i;
+    int flags;
+    uint64_t accepted;
+    struct nn_stopwatch sw;
+    uint64_t total;
+    uint64_t thr;
+
+    if (argc != 3 && argc != 4) {
+        printf ("usage: accept_thr <port> <connection-count> [backlog]\n");
+        return 1;
+    }
+    port = atoi (argv [1]);
+    count = atoi (argv [2]);
+    backlog = argc == 4 ? atoi (argv [3]) : 0;
+
+    s = nn_socket (AF_SP, NN_PULL);
+    nn_assert (s != -1);
+    if (backlog > 0) {
+        rc = nn_setsockopt (s, NN_TCP, NN_TCP_BACKLOG, &backlog,
+            sizeof (backlog));
+        nn_assert (rc == 0);
+    }
+    sprintf (addr, "tcp://127.0.0.1:%d", port);
+    rc = nn_bind (s, addr);
+    nn_assert (rc >= 0);
+
+    fds = malloc (sizeof (int) * count);
+    nn_assert (fds);
+    pfds = malloc (sizeof (struct pollfd) * count);
+    nn_assert (pfds);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    nn_stopwatch_init (&sw);
+
+    /*  Fire all the connection attempts without waiting for any of them. */
+    for (i = 0; i != count; i++) {
+        fds [i] = socket (AF_INET, SOCK_STREAM, 0);
+        errno_assert (fds [i] >= 0);
+        flags = fcntl (fds [i], F_GETFL, 0);
+        rc = fcntl (fds [i], F_SETFL, flags | O_NONBLOCK);
+        errno_assert (rc == 0);
+        rc = connect (fds [i], (struct sockaddr*) &sin, sizeof (sin));
+        errno_assert (rc == 0 || errno == EINPROGRESS);
+        pfds [i].fd = fds [i];
+        pfds [i].events = POLLOUT;
+    }
+
+    /*  Send the protocol header as soon as each connection is established,
+        the same way a reconnecting peer would do. */
+    pending = count;
+    failed = 0;
+    while (pending) {
+        rc = poll (pfds, count, 100);
+        errno_assert (rc >= 0);
+        for (i = 0; i != count; i++) {
+            if (pfds [i].fd < 0 || !pfds [i].revents)
+                continue;
+            rc = send (pfds [i].fd, sphdr, sizeof (sphdr), 0);
+            if (rc != (int) sizeof (sphdr))
+                ++failed;
+            pfds [i].fd = -1;
+            --pending;
+        }
+    }
+
+    /*  Wait till all the connections are accepted. */
+    while (1) {
+        accepted = nn_get_statistic (s, NN_STAT_ACCEPTED_CONNECTIONS);
+        if (accepted >= (uint64_t) (count - failed))
+            break;
+        nn_sleep (1);
+    }
+
+    total = nn_stopwatch_term (&sw);
+    if (total == 0)
+        total = 1;
+    thr = (uint64_t) ((double) count / (double) total * 1000000);
+
+    printf ("connection count: %d\n", count);
+    printf ("failed connections: %d\n", failed);
+    printf ("elapsed time: %.3f [ms]\n", (double) total / 1000);
+    printf ("throughput: %d [accepts/s]\n", (int) thr);
+
+    for (i = 0; i != count; i++)
+        close (fds [i]);
+    free (pfds);
+    free (fds);
+
+    rc = nn_close (s);
+    nn_assert (rc == 0);
+
+    return 0;
+}
@@ -23,6 +23,7 @@
 
 #include "../src/nn.h"
 #include "../src/pair.h"
+#include "../src/inproc.h"
 
 #include "../src/utils/attr.h"
 
@@ -72,22 +73,29 @@ int main (int argc, char *argv [])
     struct nn_stopwatch stopwatch;
     uint64_t elapsed;
     double latency;
+    int ring;
 
-    if (argc != 3) {
-        printf ("usage: inproc_lat <message-size> <roundtrip-count>\n");
+    if (argc != 3 && argc != 4) {
+        printf ("usage: inproc_lat <message-size> <roundtrip-count> "
+            "[<ring-size>]\n");
         return 1;
     }
 
     message_size = atoi (argv [1]);
     roundtrip_count = atoi (argv [2]);
+    ring = argc == 4 ? atoi (argv [3]) : 0;
 
     s = nn_socket (AF_SP, NN_PAIR);
     assert (s != -1);
+    rc = nn_setsockopt (s, NN_INPROC, NN_INPROC_RING, &ring, sizeof (ring));
+    assert (rc == 0);
     rc = nn_bind (s, "inproc://inproc_lat");
     assert (rc >= 0);
 
     w = nn_socket (AF_SP, NN_PAIR);
     assert (w != -1);
+    rc = nn_setsockopt (w, NN_INPROC, NN_INPROC_RING, &ring, sizeof (ring));
+    assert (rc == 0);
     rc = nn_connect (w, "inproc://inproc_lat");
     assert (rc >= 0);
 
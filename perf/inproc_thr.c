@@ -23,6 +23,7 @@
 
 #include "../src/nn.h"
 #include "../src/pair.h"
+#include "../src/inproc.h"
 
 #include "../src/utils/attr.h"
 
@@ -74,17 +75,23 @@ int main (int argc, char *argv [])
     uint64_t elapsed;
     unsigned long throughput;
     double megabits;
+    int ring;
+    uint64_t syscalls;
 
-    if (argc != 3) {
-        printf ("usage: thread_thr <message-size> <message-count>\n");
+    if (argc != 3 && argc != 4) {
+        printf ("usage: thread_thr <message-size> <message-count> "
+            "[<ring-size>]\n");
         return 1;
     }
 
     message_size = atoi (argv [1]);
     message_count = atoi (argv [2]);
+    ring = argc == 4 ? atoi (argv [3]) : 0;
 
     s = nn_socket (AF_SP, NN_PAIR);
     assert (s != -1);
+    rc = nn_setsockopt (s, NN_INPROC, NN_INPROC_RING, &ring, sizeof (ring));
+    assert (rc == 0);
     rc = nn_bind (s, "inproc://inproc_thr");
     assert (rc >= 0);
 
@@ -112,6 +119,11 @@ int main (int argc, char *argv [])
     elapsed = nn_stopwatch_term (&stopwatch);
 
     nn_thread_term (&thread);
+
+    /*  System calls made to wake up the threads and to put them to sleep. */
+    syscalls = nn_get_statistic (s, NN_STAT_FD_SYSCALLS) +
+        nn_get_statistic (w, NN_STAT_FD_SYSCALLS);
+
     free (buf);
     rc = nn_close (s);
     assert (rc == 0);
@@ -128,6 +140,8 @@ int main (int argc, char *argv [])
     printf ("message count: %d\n", (int) message_count);
     printf ("mean throughput: %d [msg/s]\n", (int) throughput);
     printf ("mean throughput: %.3f [Mb/s]\n", (double) megabits);
+    printf ("fd syscalls: %lu (%.3f per message)\n", (unsigned long) syscalls,
+        (double) syscalls / message_count);
 
     return 0;
 }
@@ -0,0 +1,145 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/ipc.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  Compares throughput of the IPC transport over SOCK_STREAM and
+    SOCK_SEQPACKET UNIX sockets (NN_IPC_SEQPACKET). For each message size
+    from 64B to 64kB a PAIR socket in a separate thread sends the specified
+    number of messages to a PAIR socket in the main thread. */
+
+static size_t message_size;
+static int message_count;
+
+static void sender (void *arg)
+{
+    int rc;
+    int s;
+    int i;
+    char *buf;
+
+    s = *(int*) arg;
+
+    buf = malloc (message_size);
+    nn_assert (buf);
+    memset (buf, 111, message_size);
+
+    rc = nn_send (s, NULL, 0, 0);
+    errno_assert (rc == 0);
+    for (i = 0; i != message_count; i++) {
+        rc = nn_send (s, buf, message_size, 0);
+        errno_assert (rc == (int) message_size);
+    }
+
+    free (buf);
+}
+
+static uint64_t measure (const char *addr, int seqpacket)
+{
+    int rc;
+    int s;
+    int w;
+    int i;
+    char *buf;
+    struct nn_thread thread;
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+
+    s = nn_socket (AF_SP, NN_PAIR);
+    errno_assert (s != -1);
+    rc = nn_setsockopt (s, NN_IPC, NN_IPC_SEQPACKET, &seqpacket,
+        sizeof (seqpacket));
+    errno_assert (rc == 0);
+    rc = nn_bind (s, addr);
+    errno_assert (rc >= 0);
+    w = nn_socket (AF_SP, NN_PAIR);
+    errno_assert (w != -1);
+    rc = nn_setsockopt (w, NN_IPC, NN_IPC_SEQPACKET, &seqpacket,
+        sizeof (seqpacket));
+    errno_assert (rc == 0);
+    rc = nn_connect (w, addr);
+    errno_assert (rc >= 0);
+
+    buf = malloc (message_size);
+    nn_assert (buf);
+
+    nn_thread_init (&thread, sender, &w);
+
+    /*  First message is used to start the stopwatch. */
+    rc = nn_recv (s, buf, message_size, 0);
+    errno_assert (rc == 0);
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != message_count; i++) {
+        rc = nn_recv (s, buf, message_size, 0);
+        errno_assert (rc == (int) message_size);
+    }
+    elapsed = nn_stopwatch_term (&stopwatch);
+
+    nn_thread_term (&thread);
+    free (buf);
+    rc = nn_close (w);
+    errno_assert (rc == 0);
+    rc = nn_close (s);
+    errno_assert (rc == 0);
+
+    return elapsed ? elapsed : 1;
+}
+
+int main (int argc, char *argv [])
+{
+    const char *addr;
+    uint64_t stream;
+    uint64_t seqpacket;
+    double mbs;
+    double mbq;
+
+    if (argc != 2 && argc != 3) {
+        printf ("usage: ipc_thr <message-count> [ipc-address]\n");
+        return 1;
+    }
+    message_count = atoi (argv [1]);
+    addr = argc == 3 ? argv [2] : "ipc://ipc_thr.ipc";
+
+    printf ("%8s %14s %14s %14s %14s\n", "size [B]", "stream [msg/s]",
+        "stream [Mb/s]", "seqpkt [msg/s]", "seqpkt [Mb/s]");
+    for (message_size = 64; message_size <= 65536; message_size *= 4) {
+        stream = measure (addr, 0);
+        seqpacket = measure (addr, 1);
+        mbs = (double) message_count * message_size * 8 / stream;
+        mbq = (double) message_count * message_size * 8 / seqpacket;
+        printf ("%8d %14d %14.3f %14d %14.3f\n", (int) message_size,
+            (int) ((double) message_count / stream * 1000000), mbs,
+            (int) ((double) message_count / seqpacket * 1000000), mbq);
+    }
+
+    return 0;
+}
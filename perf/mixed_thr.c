@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/sleep.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  Measures how small messages fare when they are mixed with large ones.
+    A PUSH socket sends a stream of small messages, with a large message
+    every now and then, to a PULL socket in the same process. The PUSH side
+    opens the specified number of TCP connections (NN_TCP_CONNECTIONS).
+    Each message carries the time it was sent at, so the receiver can tell
+    how much the small messages were delayed by the large ones. */
+
+static struct nn_stopwatch epoch;
+static int message_count;
+static size_t small_size;
+static size_t large_size;
+static int large_every;
+
+static void sender (void *arg)
+{
+    int rc;
+    int s;
+    int i;
+    char *buf;
+    size_t sz;
+    uint64_t now;
+
+    s = *(int*) arg;
+
+    buf = malloc (large_size);
+    nn_assert (buf);
+    memset (buf, 111, large_size);
+
+    for (i = 0; i != message_count; i++) {
+        sz = i % large_every == large_every - 1 ? large_size : small_size;
+        now = nn_stopwatch_term (&epoch);
+        memcpy (buf, &now, sizeof (now));
+        rc = nn_send (s, buf, sz, 0);
+        nn_assert (rc == (int) sz);
+    }
+
+    free (buf);
+}
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int port;
+    int connections;
+    int push;
+    int pull;
+    int i;
+    char addr [64];
+    void *msg;
+    struct nn_thread thread;
+    struct nn_stopwatch stopwatch;
+    uint64_t sent;
+    uint64_t delay;
+    uint64_t delay_total;
+    uint64_t delay_max;
+    uint64_t bytes;
+    uint64_t elapsed;
+    int small_count;
+
+    if (argc != 4 && argc != 7) {
+        printf ("usage: mixed_thr <port> <connections> <message-count> "
+            "[<small-size> <large-size> <large-every>]\n");
+        return 1;
+    }
+    port = atoi (argv [1]);
+    connections = atoi (argv [2]);
+    message_count = atoi (argv [3]);
+    small_size = 64;
+    large_size = 1024 * 1024;
+    large_every = 100;
+    if (argc == 7) {
+        small_size = (size_t) atoi (argv [4]);
+        large_size = (size_t) atoi (argv [5]);
+        large_every = atoi (argv [6]);
+    }
+    if (small_size < sizeof (uint64_t) || large_size <= small_size ||
+          large_every < 1) {
+        printf ("small-size must be at least 8 bytes, large-size must be "
+            "bigger than small-size and large-every must be positive\n");
+        return 1;
+    }
+
+    snprintf (addr, sizeof (addr), "tcp://127.0.0.1:%d", port);
+
+    pull = nn_socket (AF_SP, NN_PULL);
+    nn_assert (pull != -1);
+    rc = nn_bind (pull, addr);
+    nn_assert (rc >= 0);
+
+    push = nn_socket (AF_SP, NN_PUSH);
+    nn_assert (push != -1);
+    rc = nn_setsockopt (push, NN_TCP, NN_TCP_CONNECTIONS, &connections,
+        sizeof (connections));
+    nn_assert (rc == 0);
+    rc = nn_connect (push, addr);
+    nn_assert (rc >= 0);
+
+    /*  Wait till all the connections are established. */
+    for (i = 0; i != 500; i++) {
+        if (nn_get_statistic (push, NN_STAT_CURRENT_CONNECTIONS) ==
+              (uint64_t) connections)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (i != 500);
+
+    nn_stopwatch_init (&epoch);
+    nn_stopwatch_init (&stopwatch);
+    nn_thread_init (&thread, sender, &push);
+
+    delay_total = 0;
+    delay_max = 0;
+    bytes = 0;
+    small_count = 0;
+    for (i = 0; i != message_count; i++) {
+        rc = nn_recv (pull, &msg, NN_MSG, 0);
+        nn_assert (rc >= 0);
+        bytes += rc;
+        if ((size_t) rc == small_size) {
+            memcpy (&sent, msg, sizeof (sent));
+            delay = nn_stopwatch_term (&epoch) - sent;
+            delay_total += delay;
+            if (delay > delay_max)
+                delay_max = delay;
+            ++small_count;
+        }
+        nn_freemsg (msg);
+    }
+
+    elapsed = nn_stopwatch_term (&stopwatch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    nn_thread_term (&thread);
+
+    printf ("connections: %d\n", connections);
+    printf ("message count: %d\n", message_count);
+    printf ("message size: %d [B], one in %d messages is %d [B]\n",
+        (int) small_size, large_every, (int) large_size);
+    printf ("throughput: %d [msg/s]\n",
+        (int) ((uint64_t) message_count * 1000000 / elapsed));
+    printf ("throughput: %.3f [Mb/s]\n",
+        (double) bytes * 8 / elapsed);
+    if (small_count > 0) {
+        printf ("small message delay: %.3f [us] average, %d [us] max\n",
+            (double) delay_total / small_count, (int) delay_max);
+    }
+
+    rc = nn_close (push);
+    nn_assert (rc == 0);
+    rc = nn_close (pull);
+    nn_assert (rc == 0);
+
+    return 0;
+}
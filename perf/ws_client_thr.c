@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+
+#include "../src/utils/attr.h"
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/stopwatch.c"
+#include "../src/utils/sleep.c"
+#include "../src/utils/random.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  Measures the cost of generating masks of WebSocket frames with the global
+    pseudorandom number generator and with the per-connection one, and the
+    throughput of small messages sent by a WebSocket client, which have to
+    be masked each. Optional fourth argument sets NN_SNDHWM on the client.
+    The receiver then stalls for a while after the first message, so that
+    the messages pile up in the send queue, and the throughput is that of
+    the client catching up. */
+
+#define MASK_COUNT 100000000
+
+static char addr [64];
+static size_t msg_size;
+static int msg_count;
+static int sndhwm;
+static uint64_t total;
+
+static void receiver (NN_UNUSED void *arg)
+{
+    struct nn_stopwatch sw;
+    int s;
+    int rc;
+    int i;
+    char *buf;
+
+    s = nn_socket (AF_SP, NN_PAIR);
+    nn_assert (s != -1);
+    rc = nn_bind (s, addr);
+    nn_assert (rc >= 0);
+
+    buf = malloc (msg_size);
+    nn_assert (buf);
+
+    /*  The first message is sent once the connection is established. */
+    rc = nn_recv (s, buf, msg_size, 0);
+    nn_assert (rc >= 0);
+    if (sndhwm)
+        nn_sleep (100);
+
+    nn_stopwatch_init (&sw);
+    for (i = 0; i != msg_count; i++) {
+        rc = nn_recv (s, buf, msg_size, 0);
+        nn_assert (rc >= 0);
+    }
+    total = nn_stopwatch_term (&sw);
+
+    free (buf);
+    rc = nn_close (s);
+    nn_assert (rc == 0);
+}
+
+int main (int argc, char *argv [])
+{
+    struct nn_thread thread;
+    struct nn_stopwatch sw;
+    struct nn_random rng;
+    uint8_t mask [4];
+    uint64_t rnd;
+    char *buf;
+    int s;
+    int rc;
+    int i;
+    int sndbuf;
+
+    if (argc != 4 && argc != 5) {
+        printf ("usage: ws_client_thr <bind-to> <msg-size> <msg-count> "
+            "[sndhwm]\n");
+        return 1;
+    }
+    sprintf (addr, "ws://%s", argv [1]);
+    msg_size = atoi (argv [2]);
+    msg_count = atoi (argv [3]);
+    sndhwm = argc == 5 ? atoi (argv [4]) : 0;
+
+    /*  Generating the masks alone. */
+    nn_random_seed ();
+    nn_stopwatch_init (&sw);
+    for (i = 0; i != MASK_COUNT; i++)
+        nn_random_generate (mask, sizeof (mask));
+    total = nn_stopwatch_term (&sw);
+    printf ("global generator: %.2f [ns/mask]\n",
+        (double) total * 1000 / MASK_COUNT);
+
+    nn_random_init (&rng);
+    nn_stopwatch_init (&sw);
+    for (i = 0; i != MASK_COUNT; i++) {
+        rnd = nn_random_next (&rng);
+        memcpy (mask, &rnd, sizeof (mask));
+    }
+    total = nn_stopwatch_term (&sw);
+    printf ("per-connection generator: %.2f [ns/mask]\n",
+        (double) total * 1000 / MASK_COUNT);
+
+    /*  Messages sent by a WebSocket client. */
+    nn_thread_init (&thread, receiver, NULL);
+
+    s = nn_socket (AF_SP, NN_PAIR);
+    nn_assert (s != -1);
+    rc = nn_setsockopt (s, NN_SOL_SOCKET, NN_SNDHWM, &sndhwm,
+        sizeof (sndhwm));
+    nn_assert (rc == 0);
+    if (sndhwm) {
+        sndbuf = sndhwm * (int) (msg_size + 64);
+        rc = nn_setsockopt (s, NN_SOL_SOCKET, NN_SNDBUF, &sndbuf,
+            sizeof (sndbuf));
+        nn_assert (rc == 0);
+    }
+    rc = nn_connect (s, addr);
+    nn_assert (rc >= 0);
+
+    buf = malloc (msg_size);
+    nn_assert (buf);
+    memset (buf, 111, msg_size);
+
+    /*  The first message is sent once the connection is established. */
+    rc = nn_send (s, buf, msg_size, 0);
+    nn_assert (rc == (int) msg_size);
+
+    for (i = 0; i != msg_count; i++) {
+        rc = nn_send (s, buf, msg_size, 0);
+        nn_assert (rc == (int) msg_size);
+    }
+    nn_thread_term (&thread);
+    if (total == 0)
+        total = 1;
+
+    printf ("message size: %d [B]\n", (int) msg_size);
+    printf ("message count: %d\n", msg_count);
+    printf ("send queue: %d [msgs]\n", sndhwm);
+    printf ("throughput: %d [frames/s]\n",
+        (int) ((double) msg_count / (double) total * 1000000));
+
+    free (buf);
+    rc = nn_close (s);
+    nn_assert (rc == 0);
+
+    return 0;
+}
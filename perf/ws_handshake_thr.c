@@ -0,0 +1,195 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/ws.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/utils/stopwatch.c"
+#include "../src/utils/err.c"
+
+/*  Simulates browsers re-connecting after a server restart. Opens the
+    specified number of TCP connections to a bound nanomsg socket, keeping
+    the given number of them in progress at any time, sends an opening
+    handshake like the one of a web browser on each of them and measures how
+    long it takes till all of them are answered. The default concurrency
+    stays below the listen backlog of the WebSocket transport, so that
+    the result isn't distorted by retransmitted SYN packets. */
+
+static const char request [] =
+    "GET /chat HTTP/1.1\r\n"
+    "Host: 127.0.0.1\r\n"
+    "Connection: Upgrade\r\n"
+    "Pragma: no-cache\r\n"
+    "Cache-Control: no-cache\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+        "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Upgrade: websocket\r\n"
+    "Origin: http://127.0.0.1\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n"
+    "Sec-WebSocket-Protocol: pull.sp.nanomsg.org\r\n"
+    "\r\n";
+
+#define RESPONSE_MAX 512
+
+int main (int argc, char *argv [])
+{
+    int port;
+    int count;
+    int concurrency;
+    int started;
+    char addr [64];
+    struct sockaddr_in sin;
+    struct pollfd *pfds;
+    char *responses;
+    size_t *lens;
+    char *response;
+    int pending;
+    int failed;
+    int s;
+    int rc;
+    int i;
+    int flags;
+    ssize_t nbytes;
+    struct nn_stopwatch sw;
+    uint64_t total;
+    uint64_t thr;
+
+    if (argc != 3 && argc != 4) {
+        printf ("usage: ws_handshake_thr <port> <connection-count> "
+            "[concurrency]\n");
+        return 1;
+    }
+    port = atoi (argv [1]);
+    count = atoi (argv [2]);
+    concurrency = argc == 4 ? atoi (argv [3]) : 64;
+
+    s = nn_socket (AF_SP, NN_PULL);
+    nn_assert (s != -1);
+    sprintf (addr, "ws://127.0.0.1:%d", port);
+    rc = nn_bind (s, addr);
+    nn_assert (rc >= 0);
+
+    pfds = malloc (sizeof (struct pollfd) * count);
+    nn_assert (pfds);
+    responses = malloc ((size_t) count * RESPONSE_MAX);
+    nn_assert (responses);
+    lens = calloc (count, sizeof (size_t));
+    nn_assert (lens);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    nn_stopwatch_init (&sw);
+
+    pending = count;
+    started = 0;
+    failed = 0;
+    while (pending) {
+
+        /*  Start new connection attempts in place of the finished ones. */
+        while (started != count && started - (count - pending) <
+              concurrency) {
+            i = started++;
+            pfds [i].fd = socket (AF_INET, SOCK_STREAM, 0);
+            errno_assert (pfds [i].fd >= 0);
+            flags = fcntl (pfds [i].fd, F_GETFL, 0);
+            rc = fcntl (pfds [i].fd, F_SETFL, flags | O_NONBLOCK);
+            errno_assert (rc == 0);
+            rc = connect (pfds [i].fd, (struct sockaddr*) &sin, sizeof (sin));
+            errno_assert (rc == 0 || errno == EINPROGRESS);
+            pfds [i].events = POLLOUT;
+        }
+
+        /*  Send the opening handshake as soon as the connection is
+            established and wait for the whole response from the server. */
+        rc = poll (pfds, started, 100);
+        errno_assert (rc >= 0);
+        for (i = 0; i != started; i++) {
+            if (pfds [i].fd < 0 || !pfds [i].revents)
+                continue;
+            response = responses + (size_t) i * RESPONSE_MAX;
+            if (pfds [i].events == POLLOUT) {
+                nbytes = send (pfds [i].fd, request, sizeof (request) - 1, 0);
+                if (nbytes != (ssize_t) sizeof (request) - 1)
+                    ++failed;
+                else {
+                    pfds [i].events = POLLIN;
+                    continue;
+                }
+            }
+            else {
+                nbytes = recv (pfds [i].fd, response + lens [i],
+                    RESPONSE_MAX - 1 - lens [i], 0);
+                if (nbytes <= 0)
+                    ++failed;
+                else {
+                    lens [i] += nbytes;
+                    response [lens [i]] = 0;
+                    if (!strstr (response, "\r\n\r\n") &&
+                          lens [i] != RESPONSE_MAX - 1)
+                        continue;
+                    if (memcmp (response, "HTTP/1.1 101", 12) != 0)
+                        ++failed;
+                }
+            }
+            close (pfds [i].fd);
+            pfds [i].fd = -1;
+            --pending;
+        }
+    }
+
+    total = nn_stopwatch_term (&sw);
+    if (total == 0)
+        total = 1;
+    thr = (uint64_t) ((double) count / (double) total * 1000000);
+
+    printf ("connection count: %d\n", count);
+    printf ("failed handshakes: %d\n", failed);
+    printf ("elapsed time: %.3f [ms]\n", (double) total / 1000);
+    printf ("throughput: %d [handshakes/s]\n", (int) thr);
+
+    free (lens);
+    free (responses);
+    free (pfds);
+
+    rc = nn_close (s);
+    nn_assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+
+#include "../src/utils/attr.h"
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  Measures the throughput of messages received by a WebSocket client from
+    the server, both into the buffer passed to nn_recv() and as messages
+    allocated by the library (NN_MSG). */
+
+static char addr [64];
+static size_t msg_size;
+static int msg_count;
+
+static void sender (NN_UNUSED void *arg)
+{
+    int s;
+    int rc;
+    int i;
+    char *buf;
+
+    s = nn_socket (AF_SP, NN_PAIR);
+    nn_assert (s != -1);
+    rc = nn_bind (s, addr);
+    nn_assert (rc >= 0);
+
+    buf = malloc (msg_size);
+    nn_assert (buf);
+    memset (buf, 111, msg_size);
+
+    for (i = 0; i != 2 * (msg_count + 1); i++) {
+        rc = nn_send (s, buf, msg_size, 0);
+        nn_assert (rc == (int) msg_size);
+    }
+
+    /*  Wait for the client to receive all the messages. */
+    rc = nn_recv (s, buf, msg_size, 0);
+    nn_assert (rc >= 0);
+
+    free (buf);
+    rc = nn_close (s);
+    nn_assert (rc == 0);
+}
+
+static void receive (int s, int zerocopy)
+{
+    struct nn_stopwatch sw;
+    uint64_t total;
+    char *buf;
+    void *msg;
+    int rc;
+    int i;
+
+    buf = malloc (msg_size);
+    nn_assert (buf);
+
+    /*  The first message is sent once the connection is established. */
+    rc = nn_recv (s, buf, msg_size, 0);
+    nn_assert (rc == (int) msg_size);
+
+    nn_stopwatch_init (&sw);
+    for (i = 0; i != msg_count; i++) {
+        if (zerocopy) {
+            rc = nn_recv (s, &msg, NN_MSG, 0);
+            nn_assert (rc == (int) msg_size);
+            nn_freemsg (msg);
+        }
+        else {
+            rc = nn_recv (s, buf, msg_size, 0);
+            nn_assert (rc == (int) msg_size);
+        }
+    }
+    total = nn_stopwatch_term (&sw);
+    if (total == 0)
+        total = 1;
+
+    printf ("%s: %d [msg/s], %.3f [Mb/s]\n",
+        zerocopy ? "NN_MSG" : "user buffer",
+        (int) ((double) msg_count / (double) total * 1000000),
+        (double) msg_count * msg_size * 8 / (double) total);
+
+    free (buf);
+}
+
+int main (int argc, char *argv [])
+{
+    struct nn_thread thread;
+    int s;
+    int rc;
+    int opt;
+
+    if (argc != 4) {
+        printf ("usage: ws_recv_thr <bind-to> <msg-size> <msg-count>\n");
+        return 1;
+    }
+    sprintf (addr, "ws://%s", argv [1]);
+    msg_size = atoi (argv [2]);
+    msg_count = atoi (argv [3]);
+
+    nn_thread_init (&thread, sender, NULL);
+
+    s = nn_socket (AF_SP, NN_PAIR);
+    nn_assert (s != -1);
+    opt = -1;
+    rc = nn_setsockopt (s, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    nn_assert (rc == 0);
+    rc = nn_connect (s, addr);
+    nn_assert (rc >= 0);
+
+    printf ("message size: %d [B]\n", (int) msg_size);
+    printf ("message count: %d\n", msg_count);
+    receive (s, 0);
+    receive (s, 1);
+
+    rc = nn_send (s, "", 0, 0);
+    nn_assert (rc == 0);
+    nn_thread_term (&thread);
+
+    rc = nn_close (s);
+    nn_assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+#include "../src/transports/ws/ws_utf8.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  Measures the throughput of UTF-8 validation of WebSocket text frames for
+    the code point by code point reference loop and each of the faster
+    implementations available on this CPU. The payloads are JSON documents
+    of the requested size, one made of ASCII only and one where part of the
+    strings are in other scripts. */
+
+static const char *ascii_words [] = {
+    "status", "ok", "message", "delivered", "account", "balance",
+    "timestamp", "user", "session", "expired", "price", "quantity"
+};
+
+static const char *intl_words [] = {
+    "caf\xC3\xA9", "\xC3\xBC" "ber", "\xD0\xBC\xD0\xB8\xD1\x80",
+    "\xE6\x9D\xB1\xE4\xBA\xAC", "\xE3\x81\x82\xE3\x82\x8A\xE3\x81\x8C"
+        "\xE3\x81\xA8\xE3\x81\x86",
+    "\xF0\x9F\x98\x80", "status", "message", "user", "delivered", "price",
+    "session"
+};
+
+/*  Fills the buffer with a sequence of JSON objects built from the words. */
+static void fill_json (char *buf, size_t size, const char **words,
+    size_t nwords)
+{
+    char obj [256];
+    size_t pos;
+    size_t len;
+    unsigned i;
+
+    pos = 0;
+    for (i = 0; ; ++i) {
+        len = (size_t) sprintf (obj,
+            "{\"id\":%u,\"%s\":\"%s %s\",\"%s\":%u,\"tags\":[\"%s\",\"%s\"]},",
+            i, words [i % nwords], words [(i * 7 + 1) % nwords],
+            words [(i * 5 + 2) % nwords], words [(i * 3 + 3) % nwords],
+            i * 31 % 1000, words [(i + 4) % nwords],
+            words [(i * 11 + 5) % nwords]);
+        if (pos + len > size)
+            break;
+        memcpy (buf + pos, obj, len);
+        pos += len;
+    }
+
+    /*  Pad to the requested size with spaces. */
+    memset (buf + pos, ' ', size - pos);
+}
+
+/*  The loop previously used by the WebSocket transport, one code point at
+    a time. */
+static size_t valid_bytes (const uint8_t *buf, size_t len)
+{
+    size_t i;
+    int rc;
+
+    for (i = 0; i != len; i += rc) {
+        rc = nn_ws_utf8_code_point (buf + i, len - i);
+        if (rc < 0)
+            break;
+    }
+    return i;
+}
+
+static void measure (const char *name, nn_ws_utf8_fn fn, const uint8_t *buf,
+    size_t size, int count)
+{
+    struct nn_stopwatch sw;
+    uint64_t total;
+    double mbs;
+    int i;
+
+    nn_stopwatch_init (&sw);
+    for (i = 0; i != count; i++)
+        nn_assert (fn (buf, size) == size);
+    total = nn_stopwatch_term (&sw);
+    if (total == 0)
+        total = 1;
+
+    mbs = (double) size * count / total;
+    printf ("%-6s %8.0f [MB/s]\n", name, mbs);
+}
+
+static void run (const char *title, const uint8_t *buf, size_t size,
+    int count)
+{
+    printf ("%s\n", title);
+    measure ("byte", valid_bytes, buf, size, count);
+    measure ("word", nn_ws_utf8_valid_word, buf, size, count);
+#if defined NN_WS_UTF8_SIMD
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("ssse3"))
+        measure ("ssse3", nn_ws_utf8_valid_ssse3, buf, size, count);
+    if (__builtin_cpu_supports ("avx2"))
+        measure ("avx2", nn_ws_utf8_valid_avx2, buf, size, count);
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+    size_t size;
+    int count;
+    char *buf;
+
+    if (argc != 3) {
+        printf ("usage: ws_utf8_thr <msg-size> <msg-count>\n");
+        return 1;
+    }
+    size = atoi (argv [1]);
+    count = atoi (argv [2]);
+
+    buf = malloc (size);
+    nn_assert (buf);
+
+    printf ("message size: %d [B]\n", (int) size);
+    printf ("message count: %d\n", count);
+
+    fill_json (buf, size, ascii_words,
+        sizeof (ascii_words) / sizeof (ascii_words [0]));
+    run ("ASCII JSON", (const uint8_t*) buf, size, count);
+
+    fill_json (buf, size, intl_words,
+        sizeof (intl_words) / sizeof (intl_words [0]));
+    run ("international JSON", (const uint8_t*) buf, size, count);
+
+    free (buf);
+    return 0;
+}
@@ -22,20 +22,75 @@
 
 #include "pool.h"
 
-/*  TODO: The dummy implementation of a thread pool. As for now there's only
-    one worker thread created. */
+#include "../utils/alloc.h"
+#include "../utils/err.h"
+
+#include <stdlib.h>
 
 int nn_pool_init (struct nn_pool *self)
 {
-    return nn_worker_init (&self->worker);
+    int rc;
+    int i;
+    char *envvar;
+
+    /*  Number of worker threads can be overridden by the user. */
+    self->nworkers = 1;
+    envvar = getenv ("NN_WORKERS");
+    if (envvar && *envvar) {
+        self->nworkers = atoi (envvar);
+        if (self->nworkers < 1)
+            self->nworkers = 1;
+        if (self->nworkers > NN_POOL_MAX_WORKERS)
+            self->nworkers = NN_POOL_MAX_WORKERS;
+    }
+
+    self->workers = nn_alloc (sizeof (struct nn_worker) * self->nworkers,
+        "worker pool");
+    alloc_assert (self->workers);
+    for (i = 0; i != self->nworkers; ++i) {
+        rc = nn_worker_init (&self->workers [i]);
+        if (nn_slow (rc < 0)) {
+            while (i > 0)
+                nn_worker_term (&self->workers [--i]);
+            nn_free (self->workers);
+            self->workers = NULL;
+            return rc;
+        }
+    }
+    nn_atomic_init (&self->next, 0);
+
+    return 0;
 }
 
 void nn_pool_term (struct nn_pool *self)
 {
-    nn_worker_term (&self->worker);
+    int i;
+
+    nn_atomic_term (&self->next);
+    for (i = 0; i != self->nworkers; ++i)
+        nn_worker_term (&self->workers [i]);
+    nn_free (self->workers);
 }
 
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self)
 {
-    return &self->worker;
+    uint32_t n;
+
+    /*  Fast path for the default single-worker configuration. */
+    if (self->nworkers == 1)
+        return &self->workers [0];
+
+    n = nn_atomic_inc (&self->next, 1);
+    return &self->workers [n % self->nworkers];
+}
+
+int nn_pool_size (struct nn_pool *self)
+{
+    return self->nworkers;
+}
+
+struct nn_worker *nn_pool_worker (struct nn_pool *self, int index)
+{
+    nn_assert (index >= 0 && index < self->nworkers);
+    return &self->workers [index];
 }
@@ -25,15 +25,34 @@
 
 #include "worker.h"
 
-/*  Worker thread pool. */
+#include "../utils/atomic.h"
+
+/*  Upper limit on the number of worker threads in the pool. */
+#define NN_POOL_MAX_WORKERS 64
+
+/*  Worker thread pool. There's a single worker thread by default. The number
+    of worker threads can be changed using NN_WORKERS environment variable. */
 
 struct nn_pool {
-    struct nn_worker worker;
+
+    /*  Array of worker threads. */
+    struct nn_worker *workers;
+    int nworkers;
+
+    /*  Round-robin counter used to spread new objects among the workers. */
+    struct nn_atomic next;
 };
 
 int nn_pool_init (struct nn_pool *self);
 void nn_pool_term (struct nn_pool *self);
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self);
 
+/*  Returns number of worker threads in the pool. */
+int nn_pool_size (struct nn_pool *self);
+
+/*  Returns worker thread with the specified index. This allows to pin
+    an object to a particular worker thread. */
+struct nn_worker *nn_pool_worker (struct nn_pool *self, int index);
+
 #endif
 
@@ -45,6 +45,11 @@
     performance optimal make sure that this value is larger than network MTU. */
 #define NN_USOCK_BATCH_SIZE 2048
 
+/*  Maximum number of connections a listening socket accepts from the kernel
+    at once. Draining the accept queue in batches keeps it from overflowing
+    during re-connection storms. */
+#define NN_USOCK_ACCEPT_BATCH 32
+
 #if defined NN_HAVE_WINDOWS
 #include "usock_win.h"
 #else
@@ -62,9 +67,20 @@ void nn_usock_stop (struct nn_usock *self);
 
 void nn_usock_swap_owner (struct nn_usock *self, struct nn_fsm_owner *owner);
 
+#if !defined NN_HAVE_WINDOWS
+/*  Binds the socket to a specific worker thread. Can be called only before
+    the socket is started or accepted. */
+void nn_usock_set_worker (struct nn_usock *self, struct nn_worker *worker);
+#endif
+
 int nn_usock_setsockopt (struct nn_usock *self, int level, int optname,
     const void *optval, size_t optlen);
 
+#if !defined NN_HAVE_WINDOWS
+int nn_usock_getsockopt (struct nn_usock *self, int level, int optname,
+    void *optval, size_t *optlen);
+#endif
+
 int nn_usock_bind (struct nn_usock *self, const struct sockaddr *addr,
     size_t addrlen);
 int nn_usock_listen (struct nn_usock *self, int backlog);
@@ -89,6 +105,33 @@ void nn_usock_send (struct nn_usock *self, const struct nn_iovec *iov,
     int iovcnt);
 void nn_usock_recv (struct nn_usock *self, void *buf, size_t len, int *fd);
 
+#if !defined NN_HAVE_WINDOWS
+/*  Moves receive operation in progress from buffer 'oldbuf' passed to
+    nn_usock_recv to 'newbuf'. Data received so far are not copied. */
+void nn_usock_recv_rebase (struct nn_usock *self, void *oldbuf, void *newbuf);
+
+/*  Returns number of bytes already read from the socket, but not yet passed
+    to the user by nn_usock_recv, and points 'data' to them. Receiving them
+    doesn't require a system call. */
+size_t nn_usock_peek (struct nn_usock *self, const void **data);
+#endif
+
+#if !defined NN_HAVE_WINDOWS
+/*  Same as nn_usock_send, but file descriptor 'fd' is passed to the peer
+    along with the data. Works only with UNIX domain sockets. */
+void nn_usock_send_fd (struct nn_usock *self, const struct nn_iovec *iov,
+    int iovcnt, int fd);
+#endif
+
+/*  Turns on kernel receive timestamps. Returns -ENOTSUP if the platform
+    doesn't provide them. */
+int nn_usock_tstamp (struct nn_usock *self);
+
+/*  Returns the time the kernel received the first byte of data delivered
+    by the last nn_usock_recv, in nanoseconds since the epoch, or zero if it
+    is not known. */
+uint64_t nn_usock_rcvtstamp (struct nn_usock *self);
+
 int nn_usock_geterrno (struct nn_usock *self);
 
 #endif
@@ -60,6 +60,16 @@ struct nn_usock {
 
         /*  File descriptor received via SCM_RIGHTS, if any. */
         int *pfd;
+
+        /*  File descriptor received while the user didn't ask for one.
+            It's handed to the next receive operation that does. */
+        int fd;
+
+        /*  Kernel receive timestamp of the data in the batch buffer and
+            of the first byte of the current receive operation, in
+            nanoseconds since the epoch. Zero if not known. */
+        uint64_t batch_tstamp;
+        uint64_t tstamp;
     } in;
 
     /*  Members related to sending data. */
@@ -70,6 +80,17 @@ struct nn_usock {
 
         /*  List of buffers being sent at the moment. Referenced from 'hdr'. */
         struct iovec iov [NN_USOCK_MAX_IOVCNT];
+
+        /*  File descriptor being passed along with the data, if any.
+            Referenced from 'hdr' until the first byte is sent. */
+#if defined NN_HAVE_MSG_CONTROL
+        union {
+            struct cmsghdr align;
+            uint8_t buf [CMSG_SPACE (sizeof (int))];
+        } ctrl;
+#else
+        int fd;
+#endif
     } out;
 
     /*  Asynchronous tasks for the worker. */
@@ -90,6 +111,15 @@ struct nn_usock {
         In BEING_ACCEPTED state points to the listener socket. */
     struct nn_usock *asock;
 
+    /*  Connections already accepted by the listening socket but not yet
+        handed to the user. The buffer is allocated on first use so that
+        non-listening sockets do without it. */
+    struct {
+        int *fds;
+        int pos;
+        int len;
+    } accepted;
+
     /*  Errno remembered in NN_USOCK_ERROR state  */
     int errnum;
 };
@@ -234,6 +234,11 @@ int nn_ep_ispeer_ep (struct nn_ep *self, struct nn_ep *other)
     return nn_ep_ispeer (self, other->sock->socktype->protocol);
 }
 
+int nn_ep_isexclusive (struct nn_ep *self)
+{
+    return self->sock->socktype->flags & NN_SOCKTYPE_FLAG_EXCLUSIVE ? 1 : 0;
+}
+
 /*  Set up an ep for use by a transport.  Note that the core will already have
     done most of the initialization steps.  The tran is passed as the argument
     to the ops. */
@@ -57,6 +57,7 @@
 #include "../utils/win.h"
 #else
 #include <unistd.h>
+#include <sys/stat.h>
 #endif
 
 /*  Max number of concurrent SP sockets. Configureable at build time */
@@ -884,8 +885,13 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
         goto fail;
     }
 
-    /*  Get a message. */
-    rc = nn_sock_recv (sock, &msg, flags);
+    /*  Get a message. A single buffer supplied by the user may be filled
+        in by the transport directly. */
+    if (msghdr->msg_iovlen == 1 && msghdr->msg_iov [0].iov_len != NN_MSG)
+        rc = nn_sock_recv (sock, &msg, msghdr->msg_iov [0].iov_base,
+            msghdr->msg_iov [0].iov_len, flags);
+    else
+        rc = nn_sock_recv (sock, &msg, NULL, 0, flags);
     if (nn_slow (rc < 0)) {
         goto fail;
     }
@@ -895,6 +901,15 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
         *(void**) (msghdr->msg_iov [0].iov_base) = chunk;
         sz = nn_chunk_size (chunk);
     }
+    else if (nn_chunkref_isborrowed (&msg.body)) {
+
+        /*  The body was received directly into the user's buffer. The
+            protocol may have trimmed its header from the beginning though. */
+        data = nn_chunkref_data (&msg.body);
+        sz = nn_chunkref_size (&msg.body);
+        if (data != msghdr->msg_iov [0].iov_base)
+            memmove (msghdr->msg_iov [0].iov_base, data, sz);
+    }
     else {
 
         /*  Copy the message content into the supplied gather array. */
@@ -1018,6 +1033,12 @@ uint64_t nn_get_statistic (int s, int statistic)
     case NN_STAT_ACCEPT_ERRORS:
         val = sock->statistics.bind_errors;
         break;
+    case NN_STAT_DNS_CACHE_HITS:
+        val = sock->statistics.dns_cache_hits;
+        break;
+    case NN_STAT_DNS_CACHE_MISSES:
+        val = sock->statistics.dns_cache_misses;
+        break;
     case NN_STAT_MESSAGES_SENT:
         val = sock->statistics.messages_sent;
         break;
@@ -1030,6 +1051,27 @@ uint64_t nn_get_statistic (int s, int statistic)
     case NN_STAT_BYTES_RECEIVED:
         val = sock->statistics.bytes_received;
         break;
+    case NN_STAT_COMPRESSION_BYTES_IN:
+        val = sock->statistics.compression_bytes_in;
+        break;
+    case NN_STAT_COMPRESSION_BYTES_OUT:
+        val = sock->statistics.compression_bytes_out;
+        break;
+    case NN_STAT_COMPRESSION_TIME:
+        val = sock->statistics.compression_time;
+        break;
+    case NN_STAT_DECOMPRESSION_TIME:
+        val = sock->statistics.decompression_time;
+        break;
+    case NN_STAT_COMPRESSION_MESSAGES:
+        val = sock->statistics.compression_messages;
+        break;
+    case NN_STAT_DECOMPRESSION_MESSAGES:
+        val = sock->statistics.decompression_messages;
+        break;
+    case NN_STAT_FD_SYSCALLS:
+        val = sock->statistics.fd_syscalls;
+        break;
     case NN_STAT_CURRENT_CONNECTIONS:
         val = sock->statistics.current_connections;
         break;
@@ -1042,6 +1084,12 @@ uint64_t nn_get_statistic (int s, int statistic)
     case NN_STAT_CURRENT_EP_ERRORS:
         val = sock->statistics.current_ep_errors;
         break;
+    case NN_STAT_CURRENT_SND_QUEUE_MESSAGES:
+        val = sock->statistics.current_snd_queue_messages;
+        break;
+    case NN_STAT_CURRENT_SND_QUEUE_BYTES:
+        val = sock->statistics.current_snd_queue_bytes;
+        break;
     default:
         val = (uint64_t)-1;
         errno = EINVAL;
@@ -1052,6 +1100,153 @@ uint64_t nn_get_statistic (int s, int statistic)
     return val;
 }
 
+int nn_sendstream (int s, size_t len, nn_stream_fn fn, void *arg, int flags)
+{
+    int rc;
+    struct nn_msg msg;
+    struct nn_sock *sock;
+
+    rc = nn_global_hold_socket (&sock, s);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+
+    if (nn_slow (!fn)) {
+        rc = -EINVAL;
+        goto fail;
+    }
+
+    /*  The body is produced by the user as it is being sent. */
+    nn_msg_init (&msg, 0);
+    nn_chunkref_term (&msg.body);
+    nn_chunkref_init_stream (&msg.body, len, fn, arg);
+
+    rc = nn_sock_send (sock, &msg, flags);
+    if (nn_slow (rc < 0)) {
+
+        /*  The stream was not used, detach it from the message object. */
+        nn_chunkref_init (&msg.body, 0);
+        nn_msg_term (&msg);
+        goto fail;
+    }
+
+    /*  Adjust the statistics. */
+    nn_sock_stat_increment (sock, NN_STAT_MESSAGES_SENT, 1);
+    nn_sock_stat_increment (sock, NN_STAT_BYTES_SENT, len);
+
+    nn_global_rele_socket (sock);
+
+    return 0;
+
+fail:
+    nn_global_rele_socket (sock);
+
+    errno = -rc;
+    return -1;
+}
+
+#if !defined NN_HAVE_WINDOWS
+/*  Produces body of the message sent by nn_sendfd(). */
+static int nn_global_readfd (void *arg, void *buf, size_t len)
+{
+    int fd;
+    ssize_t nbytes;
+
+    fd = (int) (intptr_t) arg;
+    if (!buf) {
+        close (fd);
+        return 0;
+    }
+
+    while (len) {
+        nbytes = read (fd, buf, len);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes <= 0)
+            return -1;
+        buf = ((uint8_t*) buf) + nbytes;
+        len -= nbytes;
+    }
+    return 0;
+}
+#endif
+
+int nn_sendfd (int s, int fd, size_t len, int flags)
+{
+#if defined NN_HAVE_WINDOWS
+    errno = ENOTSUP;
+    return -1;
+#else
+    int rc;
+    int errnum;
+    struct stat st;
+
+    /*  The file is read from a worker thread of the library, which must not
+        be blocked for long. Unlike pipes or sockets, regular files never
+        make read() wait for someone else. */
+    rc = fstat (fd, &st);
+    if (nn_slow (rc < 0))
+        return -1;
+    if (nn_slow (!S_ISREG (st.st_mode))) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /*  The file is read from after the function returns, so the user is
+        free to close the descriptor. */
+    fd = dup (fd);
+    if (nn_slow (fd < 0))
+        return -1;
+    rc = nn_sendstream (s, len, nn_global_readfd, (void*) (intptr_t) fd,
+        flags);
+    if (nn_slow (rc < 0)) {
+        errnum = errno;
+        close (fd);
+        errno = errnum;
+    }
+    return rc;
+#endif
+}
+
+int nn_recvstream (int s, nn_stream_fn fn, void *arg, size_t *len, int flags)
+{
+    int rc;
+    size_t sz;
+    struct nn_sock *sock;
+
+    rc = nn_global_hold_socket (&sock, s);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+
+    if (nn_slow (!fn)) {
+        rc = -EINVAL;
+        goto fail;
+    }
+
+    rc = nn_sock_recvstream (sock, fn, arg, flags, &sz);
+    if (nn_slow (rc < 0))
+        goto fail;
+
+    /*  Adjust the statistics. */
+    nn_sock_stat_increment (sock, NN_STAT_MESSAGES_RECEIVED, 1);
+    nn_sock_stat_increment (sock, NN_STAT_BYTES_RECEIVED, sz);
+
+    nn_global_rele_socket (sock);
+
+    if (len)
+        *len = sz;
+    return 0;
+
+fail:
+    nn_global_rele_socket (sock);
+
+    errno = -rc;
+    return -1;
+}
+
 static int nn_global_create_ep (struct nn_sock *sock, const char *addr,
     int bind)
 {
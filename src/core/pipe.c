@@ -46,6 +46,10 @@
 #define NN_PIPEBASE_OUTSTATE_SENDING 2
 #define NN_PIPEBASE_OUTSTATE_SENT 3
 #define NN_PIPEBASE_OUTSTATE_ASYNC 4
+#define NN_PIPEBASE_OUTSTATE_QUEUEING 5
+
+static int nn_pipebase_full (struct nn_pipebase *self);
+static void nn_pipebase_drop (struct nn_pipebase *self);
 
 void nn_pipebase_init (struct nn_pipebase *self,
     const struct nn_pipebase_vfptr *vfptr, struct nn_ep *ep)
@@ -61,12 +65,22 @@ void nn_pipebase_init (struct nn_pipebase *self,
     memcpy (&self->options, &ep->options, sizeof (struct nn_ep_options));
     nn_fsm_event_init (&self->in);
     nn_fsm_event_init (&self->out);
+
+    /*  Messages sent while the transport is busy are queued, up to NN_SNDHWM
+        messages and NN_SNDBUF bytes. With NN_SNDHWM of zero there's no queue
+        and the pipe holds just the message being sent. */
+    if (self->options.sndhwm) {
+        nn_msgqueue_init (&self->outqueue, (size_t) -1);
+        self->outqueue_maxmem = (size_t) ep->sock->sndbuf;
+    }
 }
 
 void nn_pipebase_term (struct nn_pipebase *self)
 {
     nn_assert_state (self, NN_PIPEBASE_STATE_IDLE);
 
+    if (self->options.sndhwm)
+        nn_msgqueue_term (&self->outqueue);
     nn_fsm_event_term (&self->out);
     nn_fsm_event_term (&self->in);
     nn_fsm_term (&self->fsm);
@@ -96,6 +110,31 @@ void nn_pipebase_stop (struct nn_pipebase *self)
     if (self->state == NN_PIPEBASE_STATE_ACTIVE)
         nn_sock_rm (self->sock, (struct nn_pipe*) self);
     self->state = NN_PIPEBASE_STATE_IDLE;
+
+    /*  Messages that haven't made it to the transport are lost along with
+        the connection. */
+    if (self->options.sndhwm)
+        nn_pipebase_drop (self);
+}
+
+void *nn_pipebase_rcvbuf (struct nn_pipebase *self, size_t size)
+{
+    if (self->state != NN_PIPEBASE_STATE_ACTIVE)
+        return NULL;
+    return nn_sock_rcvbuf (self->sock, self, size);
+}
+
+int nn_pipebase_rcvsink (struct nn_pipebase *self)
+{
+    if (self->state != NN_PIPEBASE_STATE_ACTIVE)
+        return 0;
+    return nn_sock_rcvsink (self->sock);
+}
+
+void nn_pipebase_rcvhead (struct nn_pipebase *self, void *head, size_t size)
+{
+    nn_assert (self->instate == NN_PIPEBASE_INSTATE_RECEIVING);
+    nn_sock_rcvhead (self->sock, self, head, size);
 }
 
 void nn_pipebase_received (struct nn_pipebase *self)
@@ -111,13 +150,53 @@ void nn_pipebase_received (struct nn_pipebase *self)
 
 void nn_pipebase_sent (struct nn_pipebase *self)
 {
+    int rc;
+    int released;
+    size_t sz;
+    struct nn_msg msg;
+
     if (nn_fast (self->outstate == NN_PIPEBASE_OUTSTATE_SENDING)) {
         self->outstate = NN_PIPEBASE_OUTSTATE_SENT;
         return;
     }
-    nn_assert (self->outstate == NN_PIPEBASE_OUTSTATE_ASYNC);
+    nn_assert (self->outstate == NN_PIPEBASE_OUTSTATE_ASYNC ||
+        self->outstate == NN_PIPEBASE_OUTSTATE_QUEUEING);
+
+    /*  If the pipe was reported as not writable, the protocol has to be
+        notified once it becomes writable again. */
+    released = self->outstate == NN_PIPEBASE_OUTSTATE_ASYNC;
+
+    /*  Pass the queued messages to the transport until it gets busy. */
+    while (self->options.sndhwm) {
+        rc = nn_msgqueue_recv (&self->outqueue, &msg);
+        if (rc == -EAGAIN)
+            break;
+        errnum_assert (rc == 0, -rc);
+        sz = nn_chunkref_size (&msg.sphdr) + nn_chunkref_size (&msg.body);
+        nn_pipebase_stat_increment (self,
+            NN_STAT_CURRENT_SND_QUEUE_MESSAGES, -1);
+        nn_pipebase_stat_increment (self,
+            NN_STAT_CURRENT_SND_QUEUE_BYTES, -(int64_t) sz);
+
+        self->outstate = NN_PIPEBASE_OUTSTATE_SENDING;
+        rc = self->vfptr->send (self, &msg);
+        errnum_assert (rc >= 0, -rc);
+        if (self->outstate == NN_PIPEBASE_OUTSTATE_SENT)
+            continue;
+        nn_assert (self->outstate == NN_PIPEBASE_OUTSTATE_SENDING);
+        if (released && nn_pipebase_full (self)) {
+            self->outstate = NN_PIPEBASE_OUTSTATE_ASYNC;
+            return;
+        }
+        self->outstate = NN_PIPEBASE_OUTSTATE_QUEUEING;
+        if (released)
+            nn_fsm_raise (&self->fsm, &self->out, NN_PIPE_OUT);
+        return;
+    }
+
     self->outstate = NN_PIPEBASE_OUTSTATE_IDLE;
-    nn_fsm_raise (&self->fsm, &self->out, NN_PIPE_OUT);
+    if (released)
+        nn_fsm_raise (&self->fsm, &self->out, NN_PIPE_OUT);
 }
 
 void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
@@ -139,6 +218,21 @@ void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
         case NN_IPV4ONLY:
             intval = self->options.ipv4only;
             break;
+        case NN_COMPRESSION:
+            intval = self->options.compression;
+            break;
+        case NN_COMPRESSION_THRESHOLD:
+            intval = self->options.compression_threshold;
+            break;
+        case NN_PIPELINED_HANDSHAKE:
+            intval = self->options.pipelined_handshake;
+            break;
+        case NN_RCVTIMESTAMP:
+            intval = self->options.rcvtimestamp;
+            break;
+        case NN_SNDHWM:
+            intval = self->options.sndhwm;
+            break;
 
         /*  Fallback to socket options  */
         default:
@@ -164,6 +258,12 @@ int nn_pipebase_ispeer (struct nn_pipebase *self, int socktype)
     return nn_sock_ispeer (self->sock, socktype);
 }
 
+void nn_pipebase_stat_increment (struct nn_pipebase *self, int name,
+    int64_t increment)
+{
+    nn_sock_stat_increment (self->sock, name, increment);
+}
+
 void nn_pipe_setdata (struct nn_pipe *self, void *data)
 {
     ((struct nn_pipebase*) self)->data = data;
@@ -177,9 +277,38 @@ void *nn_pipe_getdata (struct nn_pipe *self)
 int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg)
 {
     int rc;
+    size_t sz;
     struct nn_pipebase *pipebase;
 
     pipebase = (struct nn_pipebase*) self;
+
+    /*  Transports that can't send the body piece by piece as it is produced
+        get it as a whole. If it can't be produced, the message is lost. */
+    if (nn_slow (nn_chunkref_isstream (&msg->body)) &&
+          !pipebase->vfptr->stream) {
+        rc = nn_chunkref_load (&msg->body);
+        if (nn_slow (rc < 0)) {
+            nn_msg_term (msg);
+            return 0;
+        }
+    }
+
+    /*  The transport is busy, but there's still room in the queue. */
+    if (pipebase->outstate == NN_PIPEBASE_OUTSTATE_QUEUEING) {
+        sz = nn_chunkref_size (&msg->sphdr) + nn_chunkref_size (&msg->body);
+        rc = nn_msgqueue_send (&pipebase->outqueue, msg);
+        errnum_assert (rc == 0, -rc);
+        nn_pipebase_stat_increment (pipebase,
+            NN_STAT_CURRENT_SND_QUEUE_MESSAGES, 1);
+        nn_pipebase_stat_increment (pipebase,
+            NN_STAT_CURRENT_SND_QUEUE_BYTES, (int64_t) sz);
+        if (nn_slow (nn_pipebase_full (pipebase))) {
+            pipebase->outstate = NN_PIPEBASE_OUTSTATE_ASYNC;
+            return NN_PIPEBASE_RELEASE;
+        }
+        return 0;
+    }
+
     nn_assert (pipebase->outstate == NN_PIPEBASE_OUTSTATE_IDLE);
     pipebase->outstate = NN_PIPEBASE_OUTSTATE_SENDING;
     rc = pipebase->vfptr->send (pipebase, msg);
@@ -189,6 +318,10 @@ int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg)
         return rc;
     }
     nn_assert (pipebase->outstate == NN_PIPEBASE_OUTSTATE_SENDING);
+    if (pipebase->options.sndhwm) {
+        pipebase->outstate = NN_PIPEBASE_OUTSTATE_QUEUEING;
+        return rc;
+    }
     pipebase->outstate = NN_PIPEBASE_OUTSTATE_ASYNC;
     return rc | NN_PIPEBASE_RELEASE;
 }
@@ -204,6 +337,14 @@ int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg)
     rc = pipebase->vfptr->recv (pipebase, msg);
     errnum_assert (rc >= 0, -rc);
 
+    /*  A body received into the user's buffer may only go straight back to
+        the user blocked in nn_recv(). If the protocol picks it up at any
+        other time, e.g. REQ storing a reply as soon as it arrives, it would
+        keep it past the point where the user gets the buffer back. */
+    if (nn_slow (nn_chunkref_isborrowed (&msg->body)) &&
+          !nn_sock_receiving (pipebase->sock))
+        nn_chunkref_own (&msg->body);
+
     if (nn_fast (pipebase->instate == NN_PIPEBASE_INSTATE_RECEIVED)) {
         pipebase->instate = NN_PIPEBASE_INSTATE_IDLE;
         return rc;
@@ -222,3 +363,27 @@ void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     pipebase = (struct nn_pipebase*) self;
     nn_pipebase_getopt (pipebase, level, option, optval, optvallen);
 }
+
+static int nn_pipebase_full (struct nn_pipebase *self)
+{
+    return self->outqueue.count >= (size_t) self->options.sndhwm ||
+        self->outqueue.mem >= self->outqueue_maxmem;
+}
+
+static void nn_pipebase_drop (struct nn_pipebase *self)
+{
+    int rc;
+    struct nn_msg msg;
+
+    nn_pipebase_stat_increment (self, NN_STAT_CURRENT_SND_QUEUE_MESSAGES,
+        -(int64_t) self->outqueue.count);
+    nn_pipebase_stat_increment (self, NN_STAT_CURRENT_SND_QUEUE_BYTES,
+        -(int64_t) self->outqueue.mem);
+    while (1) {
+        rc = nn_msgqueue_recv (&self->outqueue, &msg);
+        if (rc == -EAGAIN)
+            break;
+        errnum_assert (rc == 0, -rc);
+        nn_msg_term (&msg);
+    }
+}
@@ -30,6 +30,8 @@
 #include "global.h"
 #include "ep.h"
 
+#include "../transports/utils/compress.h"
+
 #include "../utils/err.h"
 #include "../utils/cont.h"
 #include "../utils/clock.h"
@@ -38,6 +40,7 @@
 #include "../utils/msg.h"
 
 #include <limits.h>
+#include <string.h>
 
 /*  These bits specify whether individual efds are signalled or not at
     the moment. Storing this information allows us to avoid redundant signalling
@@ -45,6 +48,11 @@
 #define NN_SOCK_FLAG_IN 1
 #define NN_SOCK_FLAG_OUT 2
 
+/*  Set once the user have retrieved NN_SNDFD or NN_RCVFD. Until then, the
+    efds are only waited for by nn_send() and nn_recv() and need not be
+    unsignalled as soon as the socket stops being writable or readable. */
+#define NN_SOCK_FLAG_POLLED 4
+
 /*  Possible states of the socket. */
 #define NN_SOCK_STATE_INIT 1
 #define NN_SOCK_STATE_ACTIVE 2
@@ -63,6 +71,15 @@ static struct nn_optset *nn_sock_optset (struct nn_sock *self, int id);
 static int nn_sock_setopt_inner (struct nn_sock *self, int level,
     int option, const void *optval, size_t optvallen);
 static void nn_sock_onleave (struct nn_ctx *self);
+static void nn_sock_unsignal (struct nn_sock *self, int flag);
+static void nn_sock_polled (struct nn_sock *self);
+static void nn_sock_unpost (struct nn_sock *self);
+static int nn_sock_recv_inner (struct nn_sock *self, struct nn_msg *msg,
+    void *buf, size_t len, nn_stream_fn fn, void *arg, size_t *size,
+    int flags);
+static int nn_sock_recvrest (struct nn_sock *self, struct nn_msg *msg,
+    int rc, nn_stream_fn fn, void *arg, size_t *size);
+static int nn_sock_rest (void *arg, void *buf, size_t len);
 static void nn_sock_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_sock_shutdown (struct nn_fsm *self, int src, int type,
@@ -135,6 +152,11 @@ int nn_sock_init (struct nn_sock *self, const struct nn_socktype *socktype,
     self->ep_template.sndprio = 8;
     self->ep_template.rcvprio = 8;
     self->ep_template.ipv4only = 1;
+    self->ep_template.compression = 0;
+    self->ep_template.compression_threshold = 512;
+    self->ep_template.pipelined_handshake = 0;
+    self->ep_template.rcvtimestamp = 0;
+    self->ep_template.sndhwm = 0;
 
     /* Clear statistic entries */
     memset(&self->statistics, 0, sizeof (self->statistics));
@@ -145,6 +167,16 @@ int nn_sock_init (struct nn_sock *self, const struct nn_socktype *socktype,
     /* Security attribute */
     self->sec_attr = NULL;
     self->sec_attr_size = 0;
+    self->userbuf.data = NULL;
+    self->userbuf.size = 0;
+    self->userbuf.pipe = NULL;
+    self->userbuf.receiving = 0;
+    self->userbuf.sink = NULL;
+    self->userbuf.arg = NULL;
+    self->head.pipe = NULL;
+    self->head.data = NULL;
+    self->head.size = 0;
+    self->head.rest = 0;
     self->inbuffersz = 4096;
     self->outbuffersz = 4096;
 
@@ -366,6 +398,31 @@ static int nn_sock_setopt_inner (struct nn_sock *self, int level,
             return -EINVAL;
         self->ep_template.ipv4only = val;
         return 0;
+    case NN_COMPRESSION:
+        if (val & ~nn_compress_codecs ())
+            return -EINVAL;
+        self->ep_template.compression = val;
+        return 0;
+    case NN_COMPRESSION_THRESHOLD:
+        if (val < 0)
+            return -EINVAL;
+        self->ep_template.compression_threshold = val;
+        return 0;
+    case NN_PIPELINED_HANDSHAKE:
+        if (val != 0 && val != 1)
+            return -EINVAL;
+        self->ep_template.pipelined_handshake = val;
+        return 0;
+    case NN_RCVTIMESTAMP:
+        if (val != 0 && val != 1)
+            return -EINVAL;
+        self->ep_template.rcvtimestamp = val;
+        return 0;
+    case NN_SNDHWM:
+        if (val < 0)
+            return -EINVAL;
+        self->ep_template.sndhwm = val;
+        return 0;
     case NN_MAXTTL:
         if (val < 1 || val > 255)
             return -EINVAL;
@@ -458,12 +515,28 @@ int nn_sock_getopt_inner (struct nn_sock *self, int level,
     case NN_IPV4ONLY:
         intval = self->ep_template.ipv4only;
         break;
+    case NN_COMPRESSION:
+        intval = self->ep_template.compression;
+        break;
+    case NN_COMPRESSION_THRESHOLD:
+        intval = self->ep_template.compression_threshold;
+        break;
+    case NN_PIPELINED_HANDSHAKE:
+        intval = self->ep_template.pipelined_handshake;
+        break;
+    case NN_RCVTIMESTAMP:
+        intval = self->ep_template.rcvtimestamp;
+        break;
+    case NN_SNDHWM:
+        intval = self->ep_template.sndhwm;
+        break;
     case NN_MAXTTL:
         intval = self->maxttl;
         break;
     case NN_SNDFD:
         if (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND)
             return -ENOPROTOOPT;
+        nn_sock_polled (self);
         fd = nn_efd_getfd (&self->sndfd);
         memcpy (optval, &fd,
             *optvallen < sizeof (nn_fd) ? *optvallen : sizeof (nn_fd));
@@ -472,6 +545,7 @@ int nn_sock_getopt_inner (struct nn_sock *self, int level,
     case NN_RCVFD:
         if (self->socktype->flags & NN_SOCKTYPE_FLAG_NORECV)
             return -ENOPROTOOPT;
+        nn_sock_polled (self);
         fd = nn_efd_getfd (&self->rcvfd);
         memcpy (optval, &fd,
             *optvallen < sizeof (nn_fd) ? *optvallen : sizeof (nn_fd));
@@ -576,6 +650,11 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
     if (nn_slow (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND))
         return -ENOTSUP;
 
+    /*  Some can't send messages produced on the fly. */
+    if (nn_slow (nn_chunkref_isstream (&msg->body) &&
+          (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSTREAM)))
+        return -ENOTSUP;
+
     nn_ctx_enter (&self->ctx);
 
     /*  Compute the deadline for SNDTIMEO timer. */
@@ -622,6 +701,10 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
             return rc;
         }
 
+        /*  The efd may have been left signalled after the socket stopped
+            being writable. Now that it matters, unsignal it. */
+        nn_sock_unsignal (self, NN_SOCK_FLAG_OUT);
+
         /*  If the message cannot be sent at the moment and the send call
             is non-blocking, return immediately. */
         if (nn_fast (flags & NN_DONTWAIT)) {
@@ -631,6 +714,7 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
 
         /*  With blocking send, wait while there are new pipes available
             for sending. */
+        nn_sock_stat_increment (self, NN_STAT_FD_SYSCALLS, 1);
         nn_ctx_leave (&self->ctx);
         rc = nn_efd_wait (&self->sndfd, timeout);
         if (nn_slow (rc == -ETIMEDOUT))
@@ -641,12 +725,6 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
             return -EBADF;
         errnum_assert (rc == 0, rc);
         nn_ctx_enter (&self->ctx);
-        /*
-         *  Double check if pipes are still available for sending
-         */
-        if (!nn_efd_wait (&self->sndfd, 0)) {
-            self->flags |= NN_SOCK_FLAG_OUT;
-        }
 
         /*  If needed, re-compute the timeout to reflect the time that have
             already elapsed. */
@@ -657,12 +735,43 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
     }
 }
 
-int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
+int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, void *buf,
+    size_t len, int flags)
+{
+    return nn_sock_recv_inner (self, msg, buf, len, NULL, NULL, NULL, flags);
+}
+
+int nn_sock_recvstream (struct nn_sock *self, nn_stream_fn fn, void *arg,
+    int flags, size_t *size)
+{
+    int rc;
+    struct nn_msg msg;
+
+    rc = nn_sock_recv_inner (self, &msg, NULL, 0, fn, arg, size, flags);
+    if (rc != 0)
+        return rc < 0 ? rc : 0;
+
+    /*  The message arrived as a whole. */
+    *size = nn_chunkref_size (&msg.body);
+    if (*size && fn (arg, nn_chunkref_data (&msg.body), *size) < 0)
+        rc = -ECONNABORTED;
+    nn_msg_term (&msg);
+    return rc;
+}
+
+/*  If 'fn' is supplied, large messages may be passed to it instead of being
+    stored in 'msg'. In such case 1 is returned and 'size' is set to the size
+    of the message body. */
+static int nn_sock_recv_inner (struct nn_sock *self, struct nn_msg *msg,
+    void *buf, size_t len, nn_stream_fn fn, void *arg, size_t *size,
+    int flags)
 {
     int rc;
     uint64_t deadline;
     uint64_t now;
     int timeout;
+    int posted;
+    uint8_t *data;
 
     /*  Some sockets types cannot be used for receiving messages. */
     if (nn_slow (self->socktype->flags & NN_SOCKTYPE_FLAG_NORECV))
@@ -680,6 +789,15 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
         timeout = self->rcvtimeo;
     }
 
+    /*  Pipes may start passing large messages to the sink as soon as their
+        headers arrive. Only one sink is offered at a time. */
+    posted = 0;
+    if (fn && !self->userbuf.data && !self->userbuf.sink) {
+        self->userbuf.sink = fn;
+        self->userbuf.arg = arg;
+        posted = 1;
+    }
+
     while (1) {
 
         switch (self->state) {
@@ -696,13 +814,39 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
                 descriptors is further problematic, as an FD can be reused
                 leading to situations where technically the outstanding
                 operation should refer to some other socket entirely.  */
+            if (posted)
+                nn_sock_unpost (self);
             nn_ctx_leave (&self->ctx);
             return -EBADF;
         }
 
         /*  Try to receive the message in a non-blocking way. */
+        self->userbuf.receiving = 1;
         rc = self->sockbase->vfptr->recv (self->sockbase, msg);
+        self->userbuf.receiving = 0;
+        if (nn_slow (self->head.pipe != NULL)) {
+            rc = nn_sock_recvrest (self, msg, rc, posted ? fn : NULL, arg,
+                size);
+            if (rc == 1) {
+                if (posted)
+                    nn_sock_unpost (self);
+                nn_ctx_leave (&self->ctx);
+                return 1;
+            }
+        }
         if (nn_fast (rc == 0)) {
+
+            /*  Body received into a buffer other than ours belongs to
+                another thread blocked in nn_recv(). It has to be copied
+                before that thread returns. */
+            if (nn_slow (nn_chunkref_isborrowed (&msg->body))) {
+                data = nn_chunkref_data (&msg->body);
+                if (!posted || data < (uint8_t*) buf ||
+                      data > (uint8_t*) buf + len)
+                    nn_chunkref_own (&msg->body);
+            }
+            if (posted)
+                nn_sock_unpost (self);
             nn_ctx_leave (&self->ctx);
             return 0;
         }
@@ -710,35 +854,48 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
 
         /*  Any unexpected error is forwarded to the caller. */
         if (nn_slow (rc != -EAGAIN)) {
+            if (posted)
+                nn_sock_unpost (self);
             nn_ctx_leave (&self->ctx);
             return rc;
         }
 
+        /*  The efd may have been left signalled after the socket stopped
+            being readable. Now that it matters, unsignal it. */
+        nn_sock_unsignal (self, NN_SOCK_FLAG_IN);
+
         /*  If the message cannot be received at the moment and the recv call
             is non-blocking, return immediately. */
         if (nn_fast (flags & NN_DONTWAIT)) {
+            if (posted)
+                nn_sock_unpost (self);
             nn_ctx_leave (&self->ctx);
             return -EAGAIN;
         }
 
+        /*  While waiting, let the pipes receive the message body straight
+            into the user's buffer. Only one buffer is offered at a time. */
+        if (buf && !posted && !self->userbuf.data && !self->userbuf.sink) {
+            self->userbuf.data = buf;
+            self->userbuf.size = len;
+            posted = 1;
+        }
+
         /*  With blocking recv, wait while there are new pipes available
             for receiving. */
+        nn_sock_stat_increment (self, NN_STAT_FD_SYSCALLS, 1);
         nn_ctx_leave (&self->ctx);
         rc = nn_efd_wait (&self->rcvfd, timeout);
-        if (nn_slow (rc == -ETIMEDOUT))
-            return -ETIMEDOUT;
-        if (nn_slow (rc == -EINTR))
-            return -EINTR;
-        if (nn_slow (rc == -EBADF))
-            return -EBADF;
+        if (nn_slow (rc == -ETIMEDOUT || rc == -EINTR || rc == -EBADF)) {
+            if (posted) {
+                nn_ctx_enter (&self->ctx);
+                nn_sock_unpost (self);
+                nn_ctx_leave (&self->ctx);
+            }
+            return rc;
+        }
         errnum_assert (rc == 0, rc);
         nn_ctx_enter (&self->ctx);
-        /*
-         *  Double check if pipes are still available for receiving
-         */
-        if (!nn_efd_wait (&self->rcvfd, 0)) {
-            self->flags |= NN_SOCK_FLAG_IN;
-        }
 
         /*  If needed, re-compute the timeout to reflect the time that have
             already elapsed. */
@@ -749,6 +906,189 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
     }
 }
 
+static void nn_sock_unpost (struct nn_sock *self)
+{
+    struct nn_pipebase *pipe;
+
+    /*  If the buffer is lent to a pipe that still uses it, make the pipe
+        stop doing so before the user gets the buffer back. */
+    pipe = self->userbuf.pipe;
+    self->userbuf.data = NULL;
+    self->userbuf.size = 0;
+    self->userbuf.pipe = NULL;
+    self->userbuf.sink = NULL;
+    self->userbuf.arg = NULL;
+    if (pipe)
+        pipe->vfptr->release (pipe);
+}
+
+/*  State of the thread waiting for the rest of a large message. */
+struct nn_sock_rest {
+    nn_stream_fn fn;
+    void *arg;
+    uint8_t *data;
+    size_t size;
+    int rc;
+    struct nn_sem done;
+};
+
+/*  Called by the pipe, from a worker thread, with pieces of the rest of
+    a large message. Passes them to the user's sink, if any, or stores them
+    in memory. */
+static int nn_sock_rest (void *arg, void *buf, size_t len)
+{
+    struct nn_sock_rest *rest;
+
+    rest = (struct nn_sock_rest*) arg;
+
+    /*  The pipe is done. If it was stopped before passing the whole
+        message, the connection was broken. */
+    if (!buf) {
+        if (rest->size && !rest->rc)
+            rest->rc = -ECONNRESET;
+        nn_sem_post (&rest->done);
+        return 0;
+    }
+
+    nn_assert (len <= rest->size);
+    if (rest->fn) {
+        if (rest->fn (rest->arg, buf, len) < 0) {
+            rest->rc = -ECONNABORTED;
+            return -1;
+        }
+    }
+    else {
+        memcpy (rest->data, buf, len);
+        rest->data += len;
+    }
+    rest->size -= len;
+    return 0;
+}
+
+/*  Called after the protocol was asked for a message and a pipe passed it
+    the head of a large message. If the protocol dropped the head, drop the
+    rest of the message as well. Otherwise, receive the rest of the message
+    into the user's sink, if any, or into memory. Returns updated result of
+    the protocol's recv function, 1 if the message was passed to the sink. */
+static int nn_sock_recvrest (struct nn_sock *self, struct nn_msg *msg,
+    int rc, nn_stream_fn fn, void *arg, size_t *size)
+{
+    struct nn_pipebase *pipe;
+    struct nn_sock_rest rest;
+    struct nn_chunkref body;
+    uint8_t *head;
+    uint8_t *data;
+    size_t headsz;
+    size_t sz;
+
+    pipe = self->head.pipe;
+    head = self->head.data;
+    headsz = self->head.size;
+    rest.size = self->head.rest;
+    self->head.pipe = NULL;
+    self->head.data = NULL;
+
+    /*  The protocol may have trimmed its header from the head. */
+    if (rc == 0) {
+        data = nn_chunkref_data (&msg->body);
+        if (data < head || data > head + headsz)
+            rc = 1;
+    }
+    if (rc != 0) {
+        pipe->vfptr->stream (pipe, NULL, NULL);
+        return rc == 1 ? 0 : rc;
+    }
+    sz = nn_chunkref_size (&msg->body);
+
+    if (fn) {
+
+        /*  Pass the head to the sink right away. */
+        if (sz && fn (arg, data, sz) < 0) {
+            pipe->vfptr->stream (pipe, NULL, NULL);
+            nn_msg_term (msg);
+            return -ECONNABORTED;
+        }
+        *size = sz + rest.size;
+        rest.data = NULL;
+    }
+    else {
+
+        /*  The message must fit into NN_RCVMAXSIZE. If it does not, it is
+            dropped. */
+        if (self->rcvmaxsize >= 0 &&
+              sz + rest.size > (size_t) self->rcvmaxsize) {
+            pipe->vfptr->stream (pipe, NULL, NULL);
+            nn_msg_term (msg);
+            return -EAGAIN;
+        }
+        nn_chunkref_init (&body, sz + rest.size);
+        memcpy (nn_chunkref_data (&body), data, sz);
+        nn_chunkref_term (&msg->body);
+        nn_chunkref_mv (&msg->body, &body);
+        rest.data = ((uint8_t*) nn_chunkref_data (&msg->body)) + sz;
+    }
+
+    /*  Wait till the pipe passes the rest of the message. The user's sink
+        is called from a worker thread meanwhile. */
+    rest.fn = fn;
+    rest.arg = arg;
+    rest.rc = 0;
+    nn_sem_init (&rest.done);
+    pipe->vfptr->stream (pipe, nn_sock_rest, &rest);
+    nn_ctx_leave (&self->ctx);
+    while (nn_sem_wait (&rest.done) == -EINTR)
+        ;
+    nn_ctx_enter (&self->ctx);
+    nn_sem_term (&rest.done);
+
+    /*  Message that can't be received as a whole is lost. */
+    if (fn) {
+        nn_msg_term (msg);
+        return rest.rc < 0 ? rest.rc : 1;
+    }
+    if (nn_slow (rest.rc < 0)) {
+        nn_msg_term (msg);
+        return -EAGAIN;
+    }
+    return 0;
+}
+
+int nn_sock_rcvsink (struct nn_sock *self)
+{
+    return self->userbuf.sink != NULL;
+}
+
+int nn_sock_receiving (struct nn_sock *self)
+{
+    return self->userbuf.receiving;
+}
+
+void nn_sock_rcvhead (struct nn_sock *self, struct nn_pipebase *pipe,
+    void *head, size_t rest)
+{
+    /*  The protocol dropped the head passed to it previously. */
+    if (self->head.pipe)
+        self->head.pipe->vfptr->stream (self->head.pipe, NULL, NULL);
+
+    /*  Remember where the head is so that it can be recognised once the
+        protocol is done with it. It's never accessed through this pointer;
+        the protocol may trim or free it meanwhile. */
+    self->head.pipe = pipe;
+    self->head.data = head;
+    self->head.size = nn_chunk_size (head);
+    self->head.rest = rest;
+}
+
+void *nn_sock_rcvbuf (struct nn_sock *self, struct nn_pipebase *pipe,
+    size_t size)
+{
+    if (!self->userbuf.data || self->userbuf.pipe ||
+          size > self->userbuf.size)
+        return NULL;
+    self->userbuf.pipe = pipe;
+    return self->userbuf.data;
+}
+
 int nn_sock_add (struct nn_sock *self, struct nn_pipe *pipe)
 {
     int rc;
@@ -762,10 +1102,50 @@ int nn_sock_add (struct nn_sock *self, struct nn_pipe *pipe)
 
 void nn_sock_rm (struct nn_sock *self, struct nn_pipe *pipe)
 {
+    if (self->userbuf.pipe == (struct nn_pipebase*) pipe) {
+        self->userbuf.pipe = NULL;
+        ((struct nn_pipebase*) pipe)->vfptr->release (
+            (struct nn_pipebase*) pipe);
+    }
+    if (self->head.pipe == (struct nn_pipebase*) pipe) {
+        self->head.pipe = NULL;
+        self->head.data = NULL;
+    }
     self->sockbase->vfptr->rm (self->sockbase, pipe);
     nn_sock_stat_increment (self, NN_STAT_CURRENT_CONNECTIONS, -1);
 }
 
+/*  Unsignals the efd corresponding to the flag, if signalled. */
+static void nn_sock_unsignal (struct nn_sock *self, int flag)
+{
+    if (!(self->flags & flag))
+        return;
+    self->flags &= ~flag;
+    nn_efd_unsignal (flag == NN_SOCK_FLAG_IN ? &self->rcvfd : &self->sndfd);
+    nn_sock_stat_increment (self, NN_STAT_FD_SYSCALLS, 1);
+}
+
+/*  Called when the user retrieves NN_SNDFD or NN_RCVFD. Efds that were
+    left signalled lazily are unsignalled right away, so that the user
+    doesn't get spurious events when polling them. */
+static void nn_sock_polled (struct nn_sock *self)
+{
+    int events;
+
+    if (self->flags & NN_SOCK_FLAG_POLLED)
+        return;
+    self->flags |= NN_SOCK_FLAG_POLLED;
+    if (nn_slow (self->state != NN_SOCK_STATE_ACTIVE))
+        return;
+
+    events = self->sockbase->vfptr->events (self->sockbase);
+    errnum_assert (events >= 0, -events);
+    if (!(events & NN_SOCKBASE_EVENT_IN))
+        nn_sock_unsignal (self, NN_SOCK_FLAG_IN);
+    if (!(events & NN_SOCKBASE_EVENT_OUT))
+        nn_sock_unsignal (self, NN_SOCK_FLAG_OUT);
+}
+
 static void nn_sock_onleave (struct nn_ctx *self)
 {
     struct nn_sock *sock;
@@ -782,36 +1162,33 @@ static void nn_sock_onleave (struct nn_ctx *self)
     events = sock->sockbase->vfptr->events (sock->sockbase);
     errnum_assert (events >= 0, -events);
 
-    /*  Signal/unsignal IN as needed. */
+    /*  Signal/unsignal IN as needed. Unless the user polls the efd, it's
+        left signalled until nn_recv() finds there's nothing to receive.
+        That way a burst of messages is drained without touching the efd and
+        new messages arriving meanwhile don't signal it again. */
     if (!(sock->socktype->flags & NN_SOCKTYPE_FLAG_NORECV)) {
         if (events & NN_SOCKBASE_EVENT_IN) {
             if (!(sock->flags & NN_SOCK_FLAG_IN)) {
                 sock->flags |= NN_SOCK_FLAG_IN;
                 nn_efd_signal (&sock->rcvfd);
+                nn_sock_stat_increment (sock, NN_STAT_FD_SYSCALLS, 1);
             }
         }
-        else {
-            if (sock->flags & NN_SOCK_FLAG_IN) {
-                sock->flags &= ~NN_SOCK_FLAG_IN;
-                nn_efd_unsignal (&sock->rcvfd);
-            }
-        }
+        else if (sock->flags & NN_SOCK_FLAG_POLLED)
+            nn_sock_unsignal (sock, NN_SOCK_FLAG_IN);
     }
 
-    /*  Signal/unsignal OUT as needed. */
+    /*  Signal/unsignal OUT as needed. Same as above applies. */
     if (!(sock->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND)) {
         if (events & NN_SOCKBASE_EVENT_OUT) {
             if (!(sock->flags & NN_SOCK_FLAG_OUT)) {
                 sock->flags |= NN_SOCK_FLAG_OUT;
                 nn_efd_signal (&sock->sndfd);
+                nn_sock_stat_increment (sock, NN_STAT_FD_SYSCALLS, 1);
             }
         }
-        else {
-            if (sock->flags & NN_SOCK_FLAG_OUT) {
-                sock->flags &= ~NN_SOCK_FLAG_OUT;
-                nn_efd_unsignal (&sock->sndfd);
-            }
-        }
+        else if (sock->flags & NN_SOCK_FLAG_POLLED)
+            nn_sock_unsignal (sock, NN_SOCK_FLAG_OUT);
     }
 }
 
@@ -1061,6 +1438,14 @@ void nn_sock_stat_increment (struct nn_sock *self, int name, int64_t increment)
             nn_assert (increment > 0);
             self->statistics.accept_errors += increment;
             break;
+        case NN_STAT_DNS_CACHE_HITS:
+            nn_assert (increment > 0);
+            self->statistics.dns_cache_hits += increment;
+            break;
+        case NN_STAT_DNS_CACHE_MISSES:
+            nn_assert (increment > 0);
+            self->statistics.dns_cache_misses += increment;
+            break;
         case NN_STAT_MESSAGES_SENT:
             nn_assert (increment > 0);
             self->statistics.messages_sent += increment;
@@ -1077,6 +1462,34 @@ void nn_sock_stat_increment (struct nn_sock *self, int name, int64_t increment)
             nn_assert (increment >= 0);
             self->statistics.bytes_received += increment;
             break;
+        case NN_STAT_COMPRESSION_BYTES_IN:
+            nn_assert (increment >= 0);
+            self->statistics.compression_bytes_in += increment;
+            break;
+        case NN_STAT_COMPRESSION_BYTES_OUT:
+            nn_assert (increment >= 0);
+            self->statistics.compression_bytes_out += increment;
+            break;
+        case NN_STAT_COMPRESSION_TIME:
+            nn_assert (increment >= 0);
+            self->statistics.compression_time += increment;
+            break;
+        case NN_STAT_DECOMPRESSION_TIME:
+            nn_assert (increment >= 0);
+            self->statistics.decompression_time += increment;
+            break;
+        case NN_STAT_COMPRESSION_MESSAGES:
+            nn_assert (increment > 0);
+            self->statistics.compression_messages += increment;
+            break;
+        case NN_STAT_DECOMPRESSION_MESSAGES:
+            nn_assert (increment > 0);
+            self->statistics.decompression_messages += increment;
+            break;
+        case NN_STAT_FD_SYSCALLS:
+            nn_assert (increment > 0);
+            self->statistics.fd_syscalls += increment;
+            break;
 
         case NN_STAT_CURRENT_CONNECTIONS:
             nn_assert (increment > 0 ||
@@ -1101,6 +1514,17 @@ void nn_sock_stat_increment (struct nn_sock *self, int name, int64_t increment)
             nn_assert(increment < INT_MAX && increment > -INT_MAX);
             self->statistics.current_ep_errors += (int) increment;
             break;
+        case NN_STAT_CURRENT_SND_QUEUE_MESSAGES:
+            nn_assert (increment > 0 ||
+                self->statistics.current_snd_queue_messages >= -increment);
+            nn_assert(increment < INT_MAX && increment > -INT_MAX);
+            self->statistics.current_snd_queue_messages += (int) increment;
+            break;
+        case NN_STAT_CURRENT_SND_QUEUE_BYTES:
+            nn_assert (increment > 0 ||
+                self->statistics.current_snd_queue_bytes >= -increment);
+            self->statistics.current_snd_queue_bytes += increment;
+            break;
     }
 }
 
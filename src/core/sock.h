@@ -87,6 +87,29 @@ struct nn_sock
     /*  Transport-specific socket options. */
     struct nn_optset *optsets [NN_MAX_TRANSPORT];
 
+    /*  Buffer of the user blocked in nn_recv(), if any, and the pipe it is
+        lent to at the moment, if any. Alternatively, sink of the user
+        blocked in nn_recvstream(). 'receiving' is set while the protocol
+        is asked for a message on behalf of that user. */
+    struct {
+        void *data;
+        size_t size;
+        struct nn_pipebase *pipe;
+        int receiving;
+        nn_stream_fn sink;
+        void *arg;
+    } userbuf;
+
+    /*  Head of a large message passed up by a pipe during the current call
+        to the protocol, the number of bytes it can hold and the number of
+        bytes of the message still waiting in the pipe. */
+    struct {
+        struct nn_pipebase *pipe;
+        void *data;
+        size_t size;
+        size_t rest;
+    } head;
+
     struct {
 
         /*****  The ever-incrementing counters  *****/
@@ -105,6 +128,10 @@ struct nn_sock
         uint64_t bind_errors;
         /*  Errors accepting connections at nn_bind()'ed endpoint  */
         uint64_t accept_errors;
+        /*  Name lookups served from the DNS cache  */
+        uint64_t dns_cache_hits;
+        /*  Name lookups that had to query the resolver  */
+        uint64_t dns_cache_misses;
 
         /*  Messages sent  */
         uint64_t messages_sent;
@@ -114,6 +141,20 @@ struct nn_sock
         uint64_t bytes_sent;
         /*  Bytes recevied (sum length of data in messages received)  */
         uint64_t bytes_received;
+        /*  Bytes of messages passed to the compressor  */
+        uint64_t compression_bytes_in;
+        /*  Bytes those messages took on the wire  */
+        uint64_t compression_bytes_out;
+        /*  Microseconds spent compressing messages  */
+        uint64_t compression_time;
+        /*  Microseconds spent decompressing messages  */
+        uint64_t decompression_time;
+        /*  Messages passed to the compressor  */
+        uint64_t compression_messages;
+        /*  Compressed messages received  */
+        uint64_t decompression_messages;
+        /*  System calls made to signal, unsignal and wait for the efds  */
+        uint64_t fd_syscalls;
 
         /*****  Level-style values *****/
 
@@ -125,6 +166,10 @@ struct nn_sock
         int current_snd_priority;
         /*  Number of endpoints having last_errno set to non-zero value  */
         int current_ep_errors;
+        /*  Number of messages waiting in the send queues of the pipes  */
+        int current_snd_queue_messages;
+        /*  Bytes of messages waiting in the send queues of the pipes  */
+        int64_t current_snd_queue_bytes;
 
     } statistics;
 
@@ -170,8 +215,18 @@ int nn_sock_rm_ep (struct nn_sock *self, int eid);
 /*  Send a message to the socket. */
 int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags);
 
-/*  Receive a message from the socket. */
-int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags);
+/*  Receive a message from the socket. If the call blocks, 'buf' of 'len'
+    bytes (may be NULL) is offered to the pipes to receive the message body
+    directly into it. In such case message body refers to the buffer on
+    return; it may have been trimmed from the beginning by the protocol. */
+int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, void *buf,
+    size_t len, int flags);
+
+/*  Receive a message from the socket passing its body to 'fn'. Large
+    messages are passed piece by piece as they arrive. The size of the body
+    is stored in 'size'. */
+int nn_sock_recvstream (struct nn_sock *self, nn_stream_fn fn, void *arg,
+    int flags, size_t *size);
 
 /*  Set a socket option. */
 int nn_sock_setopt (struct nn_sock *self, int level, int option,
@@ -189,6 +244,12 @@ int nn_sock_getopt_inner (struct nn_sock *self, int level, int option,
 /*  Used by pipes. */
 int nn_sock_add (struct nn_sock *self, struct nn_pipe *pipe);
 void nn_sock_rm (struct nn_sock *self, struct nn_pipe *pipe);
+void *nn_sock_rcvbuf (struct nn_sock *self, struct nn_pipebase *pipe,
+    size_t size);
+int nn_sock_rcvsink (struct nn_sock *self);
+int nn_sock_receiving (struct nn_sock *self);
+void nn_sock_rcvhead (struct nn_sock *self, struct nn_pipebase *pipe,
+    void *head, size_t rest);
 
 /*  Monitoring callbacks  */
 void nn_sock_report_error(struct nn_sock *self, struct nn_ep *ep,  int errnum);
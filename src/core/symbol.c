@@ -70,6 +70,7 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_UNIT_BOOLEAN, OPTION_UNIT, NONE, NONE),
     NN_SYM(NN_UNIT_COUNTER, OPTION_UNIT, NONE, NONE),
     NN_SYM(NN_UNIT_MESSAGES, OPTION_UNIT, NONE, NONE),
+    NN_SYM(NN_UNIT_MICROSECONDS, OPTION_UNIT, NONE, NONE),
 
     NN_SYM(NN_VERSION_CURRENT, VERSION, NONE, NONE),
     NN_SYM(NN_VERSION_REVISION, VERSION, NONE, NONE),
@@ -115,13 +116,29 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_IPV4ONLY, SOCKET_OPTION, INT, BOOLEAN),
     NN_SYM(NN_SOCKET_NAME, SOCKET_OPTION, STR, NONE),
     NN_SYM(NN_MAXTTL, SOCKET_OPTION, INT, NONE),
+    NN_SYM(NN_COMPRESSION, SOCKET_OPTION, INT, NONE),
+    NN_SYM(NN_COMPRESSION_THRESHOLD, SOCKET_OPTION, INT, BYTES),
+    NN_SYM(NN_PIPELINED_HANDSHAKE, SOCKET_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_RCVTIMESTAMP, SOCKET_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_SNDHWM, SOCKET_OPTION, INT, MESSAGES),
 
     NN_SYM(NN_SUB_SUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
     NN_SYM(NN_SUB_UNSUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
     NN_SYM(NN_REQ_RESEND_IVL, TRANSPORT_OPTION, INT, MILLISECONDS),
     NN_SYM(NN_SURVEYOR_DEADLINE, TRANSPORT_OPTION, INT, MILLISECONDS),
     NN_SYM(NN_TCP_NODELAY, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_REUSEPORT, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_BACKLOG, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_TCP_CONNECTIONS, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_TCP_LOCAL, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_FRAGMENT, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_INPROC_RING, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_IPC_SEQPACKET, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_IPC_SHMEM_THRESHOLD, TRANSPORT_OPTION, INT, BYTES),
     NN_SYM(NN_WS_MSG_TYPE, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_WS_DEFLATE, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_WS_DEFLATE_TAKEOVER, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_WS_DEFLATE_WINDOW_BITS, TRANSPORT_OPTION, INT, NONE),
 
     NN_SYM(NN_DONTWAIT, FLAG, NONE, NONE),
     NN_SYM(NN_WS_MSG_TYPE_TEXT, FLAG, NONE, NONE),
@@ -170,10 +187,21 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_STAT_CONNECT_ERRORS, STATISTIC, INT, COUNTER),
     NN_SYM(NN_STAT_BIND_ERRORS, STATISTIC, INT, COUNTER),
     NN_SYM(NN_STAT_ACCEPT_ERRORS, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_DNS_CACHE_HITS, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_DNS_CACHE_MISSES, STATISTIC, INT, COUNTER),
     NN_SYM(NN_STAT_MESSAGES_SENT, STATISTIC, INT, MESSAGES),
     NN_SYM(NN_STAT_MESSAGES_RECEIVED, STATISTIC, INT, MESSAGES),
     NN_SYM(NN_STAT_BYTES_SENT, STATISTIC, INT, BYTES),
     NN_SYM(NN_STAT_BYTES_RECEIVED, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_COMPRESSION_BYTES_IN, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_COMPRESSION_BYTES_OUT, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_COMPRESSION_TIME, STATISTIC, INT, MICROSECONDS),
+    NN_SYM(NN_STAT_DECOMPRESSION_TIME, STATISTIC, INT, MICROSECONDS),
+    NN_SYM(NN_STAT_COMPRESSION_MESSAGES, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_DECOMPRESSION_MESSAGES, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_CURRENT_SND_QUEUE_MESSAGES, STATISTIC, INT, MESSAGES),
+    NN_SYM(NN_STAT_CURRENT_SND_QUEUE_BYTES, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_FD_SYSCALLS, STATISTIC, INT, COUNTER),
     NN_SYM(NN_STAT_CURRENT_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_INPROGRESS_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_CURRENT_SND_PRIORITY, STATISTIC, INT, PRIORITY),
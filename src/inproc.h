@@ -29,6 +29,8 @@ extern "C" {
 
 #define NN_INPROC -1
 
+#define NN_INPROC_RING 1
+
 #ifdef __cplusplus
 }
 #endif
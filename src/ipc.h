@@ -33,6 +33,12 @@ extern "C" {
 #define NN_IPC_SEC_ATTR 1
 #define NN_IPC_OUTBUFSZ 2
 #define NN_IPC_INBUFSZ 3
+#define NN_IPC_SEQPACKET 4
+#define NN_IPC_SHMEM_THRESHOLD 5
+
+/*  Allocation type for nn_allocmsg. Such messages live in shared memory and
+    are passed to local peers without copying the data. */
+#define NN_IPC_ALLOC_SHMEM 1
 
 #ifdef __cplusplus
 }
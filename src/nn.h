@@ -216,6 +216,7 @@ NN_EXPORT const char *nn_symbol (int i, int *value);
 #define NN_UNIT_BOOLEAN 4
 #define NN_UNIT_MESSAGES 5
 #define NN_UNIT_COUNTER 6
+#define NN_UNIT_MICROSECONDS 7
 
 /*  Structure that is returned from nn_symbol  */
 struct nn_symbol_properties {
@@ -335,6 +336,16 @@ NN_EXPORT  struct nn_cmsghdr *nn_cmsg_nxthdr_ (
 #define NN_SOCKET_NAME 15
 #define NN_RCVMAXSIZE 16
 #define NN_MAXTTL 17
+#define NN_COMPRESSION 18
+#define NN_COMPRESSION_THRESHOLD 19
+#define NN_PIPELINED_HANDSHAKE 20
+#define NN_RCVTIMESTAMP 21
+#define NN_SNDHWM 22
+
+/*  Message compression codecs, values of NN_COMPRESSION option.              */
+#define NN_COMPRESSION_LZ 1
+#define NN_COMPRESSION_LZ4 2
+#define NN_COMPRESSION_ZSTD 4
 
 /*  Send/recv options.                                                        */
 #define NN_DONTWAIT 1
@@ -357,6 +368,26 @@ NN_EXPORT int nn_recv (int s, void *buf, size_t len, int flags);
 NN_EXPORT int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags);
 NN_EXPORT int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags);
 
+/******************************************************************************/
+/*  Streaming of large messages.                                              */
+/******************************************************************************/
+
+/*  Produces (when sending) or consumes (when receiving) next 'len' bytes of
+    the message body. Returns 0 on success, -1 on failure. When sending, the
+    function is called with 'buf' set to NULL once the message is done with.
+    The function may run on a worker thread of the library, holding up the
+    socket meanwhile, so it must not block.  */
+typedef int (*nn_stream_fn) (void *arg, void *buf, size_t len);
+
+/*  Streamed messages may be larger than what an int can hold. Therefore,
+    these functions return 0 on success rather than the size of the message.
+    nn_recvstream() stores the size in 'len' unless it is NULL. */
+NN_EXPORT int nn_sendstream (int s, size_t len, nn_stream_fn fn, void *arg,
+    int flags);
+NN_EXPORT int nn_sendfd (int s, int fd, size_t len, int flags);
+NN_EXPORT int nn_recvstream (int s, nn_stream_fn fn, void *arg, size_t *len,
+    int flags);
+
 /******************************************************************************/
 /*  Socket mutliplexing support.                                              */
 /******************************************************************************/
@@ -390,6 +421,8 @@ NN_EXPORT int nn_device (int s1, int s2);
 #define NN_STAT_CONNECT_ERRORS          105
 #define NN_STAT_BIND_ERRORS             106
 #define NN_STAT_ACCEPT_ERRORS           107
+#define NN_STAT_DNS_CACHE_HITS          108
+#define NN_STAT_DNS_CACHE_MISSES        109
 
 #define NN_STAT_CURRENT_CONNECTIONS     201
 #define NN_STAT_INPROGRESS_CONNECTIONS  202
@@ -400,6 +433,15 @@ NN_EXPORT int nn_device (int s1, int s2);
 #define NN_STAT_MESSAGES_RECEIVED       302
 #define NN_STAT_BYTES_SENT              303
 #define NN_STAT_BYTES_RECEIVED          304
+#define NN_STAT_COMPRESSION_BYTES_IN    305
+#define NN_STAT_COMPRESSION_BYTES_OUT   306
+#define NN_STAT_COMPRESSION_TIME        307
+#define NN_STAT_DECOMPRESSION_TIME      308
+#define NN_STAT_CURRENT_SND_QUEUE_MESSAGES 309
+#define NN_STAT_CURRENT_SND_QUEUE_BYTES 310
+#define NN_STAT_FD_SYSCALLS             311
+#define NN_STAT_COMPRESSION_MESSAGES    312
+#define NN_STAT_DECOMPRESSION_MESSAGES  313
 /*  Protocol statistics  */
 #define	NN_STAT_CURRENT_SND_PRIORITY    401
 
@@ -167,6 +167,15 @@ void nn_sockbase_stat_increment (struct nn_sockbase *self, int name,
 /*  Specifies that the socket type can be never used to send messages. */
 #define NN_SOCKTYPE_FLAG_NOSEND 2
 
+/*  Specifies that the socket type may send a message more than once or to
+    more than one peer, thus message bodies produced on the fly by the user
+    can't be sent. */
+#define NN_SOCKTYPE_FLAG_NOSTREAM 4
+
+/*  Specifies that the socket type talks to a single peer at a time and
+    refuses any additional pipes. */
+#define NN_SOCKTYPE_FLAG_EXCLUSIVE 8
+
 struct nn_socktype {
 
     /*  Domain and protocol IDs as specified in nn_socket() function. */
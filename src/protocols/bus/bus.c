@@ -132,7 +132,7 @@ static int nn_bus_create (void *hint, struct nn_sockbase **sockbase)
 struct nn_socktype nn_bus_socktype = {
     AF_SP,
     NN_BUS,
-    0,
+    NN_SOCKTYPE_FLAG_NOSTREAM,
     nn_bus_create,
     nn_xbus_ispeer,
 };
@@ -216,7 +216,7 @@ int nn_xbus_ispeer (int socktype)
 struct nn_socktype nn_xbus_socktype = {
     AF_SP_RAW,
     NN_BUS,
-    0,
+    NN_SOCKTYPE_FLAG_NOSTREAM,
     nn_xbus_create,
     nn_xbus_ispeer,
 };
@@ -161,7 +161,7 @@ int nn_xpair_ispeer (int socktype)
 struct nn_socktype nn_xpair_socktype = {
     AF_SP_RAW,
     NN_PAIR,
-    0,
+    NN_SOCKTYPE_FLAG_EXCLUSIVE,
     nn_xpair_create,
     nn_xpair_ispeer,
 };
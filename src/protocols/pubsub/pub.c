@@ -28,7 +28,7 @@
 struct nn_socktype nn_pub_socktype = {
     AF_SP,
     NN_PUB,
-    NN_SOCKTYPE_FLAG_NORECV,
+    NN_SOCKTYPE_FLAG_NORECV | NN_SOCKTYPE_FLAG_NOSTREAM,
     nn_xpub_create,
     nn_xpub_ispeer,
 };
@@ -176,7 +176,7 @@ int nn_xpub_ispeer (int socktype)
 struct nn_socktype nn_xpub_socktype = {
     AF_SP_RAW,
     NN_PUB,
-    NN_SOCKTYPE_FLAG_NORECV,
+    NN_SOCKTYPE_FLAG_NORECV | NN_SOCKTYPE_FLAG_NOSTREAM,
     nn_xpub_create,
     nn_xpub_ispeer,
 };
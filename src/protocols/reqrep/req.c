@@ -660,7 +660,7 @@ void nn_req_rm (struct nn_sockbase *self, struct nn_pipe *pipe) {
 struct nn_socktype nn_req_socktype = {
     AF_SP,
     NN_REQ,
-    0,
+    NN_SOCKTYPE_FLAG_NOSTREAM,
     nn_req_create,
     nn_xreq_ispeer,
 };
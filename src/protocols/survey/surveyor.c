@@ -513,7 +513,7 @@ static int nn_surveyor_create (void *hint, struct nn_sockbase **sockbase)
 struct nn_socktype nn_surveyor_socktype = {
     AF_SP,
     NN_SURVEYOR,
-    0,
+    NN_SOCKTYPE_FLAG_NOSTREAM,
     nn_surveyor_create,
     nn_xsurveyor_ispeer,
 };
@@ -205,7 +205,7 @@ int nn_xsurveyor_ispeer (int socktype)
 struct nn_socktype nn_xsurveyor_socktype = {
     AF_SP_RAW,
     NN_SURVEYOR,
-    0,
+    NN_SOCKTYPE_FLAG_NOSTREAM,
     nn_xsurveyor_create,
     nn_xsurveyor_ispeer,
 };
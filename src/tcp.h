@@ -30,6 +30,11 @@ extern "C" {
 #define NN_TCP -3
 
 #define NN_TCP_NODELAY 1
+#define NN_TCP_REUSEPORT 2
+#define NN_TCP_BACKLOG 3
+#define NN_TCP_CONNECTIONS 4
+#define NN_TCP_LOCAL 5
+#define NN_TCP_FRAGMENT 6
 
 #ifdef __cplusplus
 }
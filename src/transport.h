@@ -31,6 +31,7 @@
 
 #include "utils/list.h"
 #include "utils/msg.h"
+#include "utils/msgqueue.h"
 
 #include <stddef.h>
 
@@ -101,6 +102,10 @@ int nn_ep_ispeer (struct nn_ep *, int socktype);
 /*  Returns 1 if the ep's are valid peers for each other, 0 otherwise. */
 int nn_ep_ispeer_ep (struct nn_ep *, struct nn_ep *);
 
+/*  Returns 1 if the socket accepts only a single pipe at a time, 0
+    otherwise. */
+int nn_ep_isexclusive (struct nn_ep *);
+
 /*  Notifies a monitoring system the error on this endpoint  */
 void nn_ep_set_error(struct nn_ep*, int errnum);
 
@@ -143,6 +148,20 @@ struct nn_pipebase_vfptr {
     /*  Receive a message from the network. The function can return either error
         (negative number) or any combination of the flags defined above. */
     int (*recv) (struct nn_pipebase *self, struct nn_msg *msg);
+
+    /*  Stop using the buffer obtained from nn_pipebase_rcvbuf. Data received
+        so far have to be copied to the transport's own memory and the rest of
+        the message received there. Needed only by transports that use
+        nn_pipebase_rcvbuf, NULL otherwise. */
+    void (*release) (struct nn_pipebase *self);
+
+    /*  Pass the rest of the message whose head was passed to the core using
+        nn_pipebase_rcvhead to 'fn' piece by piece and then call 'fn' with
+        NULL buffer, even if the pipe is stopped in the meantime. If 'fn' is
+        NULL, drop the rest of the message instead. Transports that implement
+        this function also accept messages whose bodies are streams (see
+        nn_chunkref_init_stream). NULL for the other transports. */
+    void (*stream) (struct nn_pipebase *self, nn_stream_fn fn, void *arg);
 };
 
 /*  Endpoint specific options. Same restrictions as for nn_pipebase apply  */
@@ -151,6 +170,11 @@ struct nn_ep_options
     int sndprio;
     int rcvprio;
     int ipv4only;
+    int compression;
+    int compression_threshold;
+    int pipelined_handshake;
+    int rcvtimestamp;
+    int sndhwm;
 };
 
 /*  The member of this structure are used internally by the core. Never use
@@ -166,6 +190,8 @@ struct nn_pipebase {
     struct nn_fsm_event in;
     struct nn_fsm_event out;
     struct nn_ep_options options;
+    struct nn_msgqueue outqueue;
+    size_t outqueue_maxmem;
 };
 
 /*  Initialise the pipe.  */
@@ -184,6 +210,26 @@ void nn_pipebase_stop (struct nn_pipebase *self);
 /*  Call this function when new message was fully received. */
 void nn_pipebase_received (struct nn_pipebase *self);
 
+/*  If the user is blocked in nn_recv() with a buffer large enough to hold
+    'size' bytes and the buffer is not used by any other pipe, lends the
+    buffer to the pipe and returns it. The message body can be then received
+    into the buffer directly, using nn_chunkref_init_borrowed, saving a copy.
+    The pipe may use the buffer until the message is received by the user or
+    until the release virtual function is called. Returns NULL otherwise. */
+void *nn_pipebase_rcvbuf (struct nn_pipebase *self, size_t size);
+
+/*  Returns 1 if the user is blocked in nn_recvstream(). In such case the pipe
+    may pass only a head of a large message to the core and leave the rest
+    of it in the connection till the stream virtual function is called. */
+int nn_pipebase_rcvsink (struct nn_pipebase *self);
+
+/*  Call this function from the recv virtual function when passing the head
+    of a large message. 'head' is the chunk holding it and 'size' is the
+    number of bytes of the message that remain in the connection. The pipe
+    must not receive any other message until the stream virtual function is
+    called. */
+void nn_pipebase_rcvhead (struct nn_pipebase *self, void *head, size_t size);
+
 /*  Call this function when current outgoing message was fully sent. */
 void nn_pipebase_sent (struct nn_pipebase *self);
 
@@ -195,6 +241,10 @@ void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
     or 0 otherwise. */
 int nn_pipebase_ispeer (struct nn_pipebase *self, int socktype);
 
+/*  Increments statistics counter of the socket the pipe belongs to. */
+void nn_pipebase_stat_increment (struct nn_pipebase *self, int name,
+    int64_t increment);
+
 /******************************************************************************/
 /*  The transport class.                                                      */
 /******************************************************************************/
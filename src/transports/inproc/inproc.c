@@ -28,13 +28,40 @@
 
 #include "../../inproc.h"
 
+#include "../../utils/err.h"
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
+#include "../../utils/cont.h"
+
 #include <string.h>
 
+/*  Upper limit for NN_INPROC_RING option. */
+#define NN_INPROC_MAX_RING 65536
+
+/*  Inproc-specific socket options. */
+
+struct nn_inproc_optset {
+    struct nn_optset base;
+    int ring;
+};
+
+static void nn_inproc_optset_destroy (struct nn_optset *self);
+static int nn_inproc_optset_setopt (struct nn_optset *self, int option,
+    const void *optval, size_t optvallen);
+static int nn_inproc_optset_getopt (struct nn_optset *self, int option,
+    void *optval, size_t *optvallen);
+static const struct nn_optset_vfptr nn_inproc_optset_vfptr = {
+    nn_inproc_optset_destroy,
+    nn_inproc_optset_setopt,
+    nn_inproc_optset_getopt
+};
+
 /*  nn_transport interface. */
 static void nn_inproc_init (void);
 static void nn_inproc_term (void);
 static int nn_inproc_bind (struct nn_ep *);
 static int nn_inproc_connect (struct nn_ep *);
+static struct nn_optset *nn_inproc_optset (void);
 
 struct nn_transport nn_inproc = {
     "inproc",
@@ -43,7 +70,7 @@ struct nn_transport nn_inproc = {
     nn_inproc_term,
     nn_inproc_bind,
     nn_inproc_connect,
-    NULL,
+    nn_inproc_optset,
 };
 
 static void nn_inproc_init (void)
@@ -65,3 +92,70 @@ static int nn_inproc_connect (struct nn_ep *ep)
 {
     return nn_cinproc_create (ep);
 }
+
+static struct nn_optset *nn_inproc_optset (void)
+{
+    struct nn_inproc_optset *optset;
+
+    optset = nn_alloc (sizeof (struct nn_inproc_optset), "optset (inproc)");
+    alloc_assert (optset);
+    optset->base.vfptr = &nn_inproc_optset_vfptr;
+
+    /*  Default values for inproc socket options. */
+    optset->ring = 0;
+
+    return &optset->base;
+}
+
+static void nn_inproc_optset_destroy (struct nn_optset *self)
+{
+    struct nn_inproc_optset *optset;
+
+    optset = nn_cont (self, struct nn_inproc_optset, base);
+    nn_free (optset);
+}
+
+static int nn_inproc_optset_setopt (struct nn_optset *self, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_inproc_optset *optset;
+    int val;
+
+    optset = nn_cont (self, struct nn_inproc_optset, base);
+
+    /*  At this point we assume that all options are of type int. */
+    if (optvallen != sizeof (int))
+        return -EINVAL;
+    val = *(int*) optval;
+
+    switch (option) {
+    case NN_INPROC_RING:
+        if (nn_slow (val < 0 || val > NN_INPROC_MAX_RING))
+            return -EINVAL;
+        optset->ring = val;
+        return 0;
+    default:
+        return -ENOPROTOOPT;
+    }
+}
+
+static int nn_inproc_optset_getopt (struct nn_optset *self, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_inproc_optset *optset;
+    int intval;
+
+    optset = nn_cont (self, struct nn_inproc_optset, base);
+
+    switch (option) {
+    case NN_INPROC_RING:
+        intval = optset->ring;
+        break;
+    default:
+        return -ENOPROTOOPT;
+    }
+    memcpy (optval, &intval,
+        *optvallen < sizeof (int) ? *optvallen : sizeof (int));
+    *optvallen = sizeof (int);
+    return 0;
+}
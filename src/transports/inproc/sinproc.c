@@ -23,9 +23,13 @@
 
 #include "sinproc.h"
 
+#include "../../inproc.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/attr.h"
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
 
 #include <stddef.h>
 
@@ -57,16 +61,22 @@ static void nn_sinproc_shutdown (struct nn_fsm *self, int src, int type,
 
 static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg);
+static void nn_sinproc_push (struct nn_sinproc *self, struct nn_msg *msg);
+static void nn_sinproc_pop (struct nn_sinproc *self, struct nn_msg *msg);
 const struct nn_pipebase_vfptr nn_sinproc_pipebase_vfptr = {
     nn_sinproc_send,
-    nn_sinproc_recv
+    nn_sinproc_recv,
+    NULL,
+    NULL
 };
 
 void nn_sinproc_init (struct nn_sinproc *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner)
 {
     int rcvbuf;
+    int ring;
     size_t sz;
+    size_t i;
 
     nn_fsm_init (&self->fsm, nn_sinproc_handler, nn_sinproc_shutdown,
         src, self, owner);
@@ -78,6 +88,20 @@ void nn_sinproc_init (struct nn_sinproc *self, int src,
     nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RCVBUF, &rcvbuf, &sz);
     nn_assert (sz == sizeof (rcvbuf));
     nn_msgqueue_init (&self->msgqueue, rcvbuf);
+    sz = sizeof (ring);
+    nn_ep_getopt (ep, NN_INPROC, NN_INPROC_RING, &ring, &sz);
+    nn_assert (sz == sizeof (ring));
+    self->ring = NULL;
+    self->ringsize = (size_t) ring;
+    if (ring) {
+        self->ring = nn_alloc (ring * sizeof (struct nn_msg), "inproc ring");
+        alloc_assert (self->ring);
+        for (i = 0; i != self->ringsize; ++i)
+            nn_msg_init (&self->ring [i], 0);
+    }
+    self->ringpos = 0;
+    nn_atomic_init (&self->ringcount, 0);
+    self->peerpos = 0;
     nn_msg_init (&self->msg, 0);
     nn_fsm_event_init (&self->event_connect);
     nn_fsm_event_init (&self->event_sent);
@@ -88,12 +112,20 @@ void nn_sinproc_init (struct nn_sinproc *self, int src,
 
 void nn_sinproc_term (struct nn_sinproc *self)
 {
+    size_t i;
+
     nn_list_item_term (&self->item);
     nn_fsm_event_term (&self->event_disconnect);
     nn_fsm_event_term (&self->event_received);
     nn_fsm_event_term (&self->event_sent);
     nn_fsm_event_term (&self->event_connect);
     nn_msg_term (&self->msg);
+    nn_atomic_term (&self->ringcount);
+    if (self->ring) {
+        for (i = 0; i != self->ringsize; ++i)
+            nn_msg_term (&self->ring [i]);
+        nn_free (self->ring);
+    }
     nn_msgqueue_term (&self->msgqueue);
     nn_pipebase_term (&self->pipebase);
     nn_fsm_term (&self->fsm);
@@ -162,6 +194,12 @@ static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg)
         nn_chunkref_size (&msg->body));
     nn_msg_term (msg);
 
+    /*  If the peer has a ring, put the message straight into it. */
+    if (sinproc->peer->ring) {
+        nn_sinproc_push (sinproc, &nmsg);
+        return 0;
+    }
+
     /*  Expose the message to the peer. */
     nn_msg_term (&sinproc->msg);
     nn_msg_mv (&sinproc->msg, &nmsg);
@@ -186,6 +224,11 @@ static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg)
     nn_assert (sinproc->state == NN_SINPROC_STATE_ACTIVE ||
         sinproc->state == NN_SINPROC_STATE_DISCONNECTED);
 
+    if (sinproc->ring) {
+        nn_sinproc_pop (sinproc, msg);
+        return 0;
+    }
+
     /*  Move the message to the caller. */
     rc = nn_msgqueue_recv (&sinproc->msgqueue, msg);
     errnum_assert (rc == 0, -rc);
@@ -213,6 +256,58 @@ static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg)
     return 0;
 }
 
+/*  Puts the message into the peer's ring. The message can be written into
+    the slot without locking as the peer won't read it until ringcount says
+    so, and won't touch it again once it says otherwise. */
+static void nn_sinproc_push (struct nn_sinproc *self, struct nn_msg *msg)
+{
+    struct nn_sinproc *peer;
+    uint32_t count;
+
+    peer = self->peer;
+    nn_msg_mv (&peer->ring [self->peerpos], msg);
+    if (++self->peerpos == peer->ringsize)
+        self->peerpos = 0;
+    count = nn_atomic_inc (&peer->ringcount, 1);
+
+    /*  The ring was empty. Wake the peer up. */
+    if (count == 0)
+        nn_fsm_raiseto (&self->fsm, &peer->fsm, &peer->event_sent,
+            NN_SINPROC_SRC_PEER, NN_SINPROC_SENT, self);
+
+    /*  If the ring is full, wait till the peer takes a message from it.
+        Otherwise, another message can be sent straight away. */
+    if (nn_slow (count + 1 == peer->ringsize)) {
+        self->flags |= NN_SINPROC_FLAG_SENDING;
+        return;
+    }
+    nn_pipebase_sent (&self->pipebase);
+}
+
+/*  Takes the message from the ring. */
+static void nn_sinproc_pop (struct nn_sinproc *self, struct nn_msg *msg)
+{
+    uint32_t count;
+
+    nn_msg_mv (msg, &self->ring [self->ringpos]);
+    nn_msg_init (&self->ring [self->ringpos], 0);
+    if (++self->ringpos == self->ringsize)
+        self->ringpos = 0;
+    count = nn_atomic_dec (&self->ringcount, 1);
+
+    /*  The ring was full. Let the peer send again. */
+    if (nn_slow (count == self->ringsize) &&
+          self->state != NN_SINPROC_STATE_DISCONNECTED)
+        nn_fsm_raiseto (&self->fsm, &self->peer->fsm,
+            &self->peer->event_received, NN_SINPROC_SRC_PEER,
+            NN_SINPROC_RECEIVED, self);
+
+    /*  If the ring became empty, the peer will wake us up once there's
+        a new message in it. */
+    if (count > 1)
+        nn_pipebase_received (&self->pipebase);
+}
+
 static void nn_sinproc_shutdown_events (struct nn_sinproc *self, int src,
     int type, NN_UNUSED void *srcptr)
 {
@@ -425,6 +520,12 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_SINPROC_SENT:
 
+                /*  The ring is not empty anymore. */
+                if (sinproc->ring) {
+                    nn_pipebase_received (&sinproc->pipebase);
+                    return;
+                }
+
                 empty = nn_msgqueue_empty (&sinproc->msgqueue);
 
                 /*  Push the message to the inbound message queue. */
@@ -450,8 +551,8 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
 
             case NN_SINPROC_RECEIVED:
                 nn_assert (sinproc->flags & NN_SINPROC_FLAG_SENDING);
-                nn_pipebase_sent (&sinproc->pipebase);
                 sinproc->flags &= ~NN_SINPROC_FLAG_SENDING;
+                nn_pipebase_sent (&sinproc->pipebase);
                 return;
 
             case NN_SINPROC_DISCONNECT:
@@ -24,14 +24,14 @@
 #ifndef NN_SINPROC_INCLUDED
 #define NN_SINPROC_INCLUDED
 
-#include "msgqueue.h"
-
 #include "../../transport.h"
 
 #include "../../aio/fsm.h"
 
 #include "../../utils/msg.h"
+#include "../../utils/msgqueue.h"
 #include "../../utils/list.h"
+#include "../../utils/atomic.h"
 
 #define NN_SINPROC_CONNECT 1
 #define NN_SINPROC_READY 2
@@ -64,6 +64,19 @@ struct nn_sinproc {
         by the user later on. */
     struct nn_msgqueue msgqueue;
 
+    /*  If NN_INPROC_RING is set, the peer puts messages straight into this
+        ring instead of the queue above. The peer writes the slots, this
+        object reads them, neither of them locks; 'ringcount' is the number
+        of messages in the ring. The peer is notified only when the ring
+        stops being full and this object only when it stops being empty. */
+    struct nn_msg *ring;
+    size_t ringsize;
+    size_t ringpos;
+    struct nn_atomic ringcount;
+
+    /*  Position of the next slot to write to in the peer's ring. */
+    size_t peerpos;
+
     /*  This message is the one being sent from this session to the peer
         session. It holds the data only temporarily, until the peer moves
         it to its msgqueue. */
@@ -57,6 +57,7 @@ void nn_aipc_init (struct nn_aipc *self, int src,
     self->listener = NULL;
     self->listener_owner.src = -1;
     self->listener_owner.fsm = NULL;
+    self->seqpacket = 0;
     nn_sipc_init (&self->sipc, NN_AIPC_SRC_SIPC, ep, &self->fsm);
     nn_fsm_event_init (&self->accepted);
     nn_fsm_event_init (&self->done);
@@ -80,13 +81,17 @@ int nn_aipc_isidle (struct nn_aipc *self)
     return nn_fsm_isidle (&self->fsm);
 }
 
-void nn_aipc_start (struct nn_aipc *self, struct nn_usock *listener)
+void nn_aipc_start (struct nn_aipc *self, struct nn_usock *listener,
+    int seqpacket)
 {
 #if defined NN_HAVE_WINDOWS
     size_t sz;
 #endif
     nn_assert_state (self, NN_AIPC_STATE_IDLE);
 
+    /*  Accepted connections inherit the type of the listener socket. */
+    self->seqpacket = seqpacket;
+
     /*  Take ownership of the listener socket. */
     self->listener = listener;
     self->listener_owner.src = NN_AIPC_SRC_LISTENER;
@@ -212,7 +217,7 @@ static void nn_aipc_handler (struct nn_fsm *self, int src, int type,
 
                 /*  Start the sipc state machine. */
                 nn_usock_activate (&aipc->usock);
-                nn_sipc_start (&aipc->sipc, &aipc->usock);
+                nn_sipc_start (&aipc->sipc, &aipc->usock, aipc->seqpacket);
                 aipc->state = NN_AIPC_STATE_ACTIVE;
 
                 nn_ep_stat_increment (aipc->ep,
@@ -59,6 +59,9 @@ struct nn_aipc {
     struct nn_usock *listener;
     struct nn_fsm_owner listener_owner;
 
+    /*  1 if the listening socket is of SOCK_SEQPACKET type. */
+    int seqpacket;
+
     /*  State machine that takes care of the connection in the active state. */
     struct nn_sipc sipc;
 
@@ -75,7 +78,8 @@ void nn_aipc_init (struct nn_aipc *self, int src,
 void nn_aipc_term (struct nn_aipc *self);
 
 int nn_aipc_isidle (struct nn_aipc *self);
-void nn_aipc_start (struct nn_aipc *self, struct nn_usock *listener);
+void nn_aipc_start (struct nn_aipc *self, struct nn_usock *listener,
+    int seqpacket);
 void nn_aipc_stop (struct nn_aipc *self);
 
 #endif
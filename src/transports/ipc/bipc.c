@@ -65,6 +65,9 @@ struct nn_bipc {
     /*  The underlying listening IPC socket. */
     struct nn_usock usock;
 
+    /*  1 if the listening socket is of SOCK_SEQPACKET type. */
+    int seqpacket;
+
     /*  The connection being accepted at the moment. */
     struct nn_aipc *aipc;
 
@@ -104,6 +107,7 @@ int nn_bipc_create (struct nn_ep *ep)
     nn_fsm_init_root (&self->fsm, nn_bipc_handler, nn_bipc_shutdown,
         nn_ep_getctx (ep));
     self->state = NN_BIPC_STATE_IDLE;
+    self->seqpacket = 0;
     self->aipc = NULL;
     nn_list_init (&self->aipcs);
 
@@ -284,6 +288,10 @@ static int nn_bipc_listen (struct nn_bipc *self)
 #if defined NN_HAVE_UNIX_SOCKETS
     int fd;
 #endif
+#if defined NN_SIPC_HAVE_SEQPACKET
+    int val;
+    size_t sz;
+#endif
 
     /*  First, create the AF_UNIX address. */
     addr = nn_ep_getaddr (self->ep);
@@ -313,8 +321,18 @@ static int nn_bipc_listen (struct nn_bipc *self)
     }
 #endif
 
-    /*  Start listening for incoming connections. */
+    /*  Start listening for incoming connections. The type of the listening
+        socket is decided here; connecting peers adapt to it. */
+#if defined NN_SIPC_HAVE_SEQPACKET
+    sz = sizeof (val);
+    nn_ep_getopt (self->ep, NN_IPC, NN_IPC_SEQPACKET, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    self->seqpacket = val;
+    rc = nn_usock_start (&self->usock, AF_UNIX,
+        self->seqpacket ? SOCK_SEQPACKET : SOCK_STREAM, 0);
+#else
     rc = nn_usock_start (&self->usock, AF_UNIX, SOCK_STREAM, 0);
+#endif
     if (rc < 0) {
         return rc;
     }
@@ -350,5 +368,5 @@ static void nn_bipc_start_accepting (struct nn_bipc *self)
     nn_aipc_init (self->aipc, NN_BIPC_SRC_AIPC, self->ep, &self->fsm);
 
     /*  Start waiting for a new incoming connection. */
-    nn_aipc_start (self->aipc, &self->usock);
+    nn_aipc_start (self->aipc, &self->usock, self->seqpacket);
 }
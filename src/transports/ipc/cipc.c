@@ -71,6 +71,15 @@ struct nn_cipc {
     /*  Used to wait before retrying to connect. */
     struct nn_backoff retry;
 
+    /*  1 if the next connection attempt is made with a SOCK_SEQPACKET
+        socket. It starts as requested by NN_IPC_SEQPACKET and then follows
+        the type of the listener. */
+    int seqpacket;
+
+    /*  1 if the current attempt is an immediate retry after the listener
+        turned out to be of the other socket type. */
+    int retype;
+
     /*  State machine that handles the active part of the connection
         lifetime. */
     struct nn_sipc sipc;
@@ -96,6 +105,7 @@ int nn_cipc_create (struct nn_ep *ep)
     struct nn_cipc *self;
     int reconnect_ivl;
     int reconnect_ivl_max;
+    int val;
     size_t sz;
 
     /*  Allocate the new endpoint object. */
@@ -120,6 +130,15 @@ int nn_cipc_create (struct nn_ep *ep)
         reconnect_ivl_max = reconnect_ivl;
     nn_backoff_init (&self->retry, NN_CIPC_SRC_RECONNECT_TIMER,
         reconnect_ivl, reconnect_ivl_max, &self->fsm);
+    sz = sizeof (val);
+    nn_ep_getopt (ep, NN_IPC, NN_IPC_SEQPACKET, &val, &sz);
+    nn_assert (sz == sizeof (val));
+#if defined NN_SIPC_HAVE_SEQPACKET
+    self->seqpacket = val;
+#else
+    self->seqpacket = 0;
+#endif
+    self->retype = 0;
     nn_sipc_init (&self->sipc, NN_CIPC_SRC_SIPC, ep, &self->fsm);
 
     /*  Start the state machine. */
@@ -220,7 +239,8 @@ static void nn_cipc_handler (struct nn_fsm *self, int src, int type,
         case NN_CIPC_SRC_USOCK:
             switch (type) {
             case NN_USOCK_CONNECTED:
-                nn_sipc_start (&cipc->sipc, &cipc->usock);
+                cipc->retype = 0;
+                nn_sipc_start (&cipc->sipc, &cipc->usock, cipc->seqpacket);
                 cipc->state = NN_CIPC_STATE_ACTIVE;
                 nn_ep_stat_increment (cipc->ep,
                     NN_STAT_INPROGRESS_CONNECTIONS, -1);
@@ -229,6 +249,22 @@ static void nn_cipc_handler (struct nn_fsm *self, int src, int type,
                 nn_ep_clear_error (cipc->ep);
                 return;
             case NN_USOCK_ERROR:
+#if defined NN_SIPC_HAVE_SEQPACKET
+
+                /*  The listener is of the other socket type. Switch to
+                    that type and try again without waiting. */
+                if (nn_usock_geterrno (&cipc->usock) == EPROTOTYPE &&
+                      !cipc->retype) {
+                    cipc->seqpacket = !cipc->seqpacket;
+                    cipc->retype = 1;
+                    nn_usock_stop (&cipc->usock);
+                    cipc->state = NN_CIPC_STATE_STOPPING_USOCK;
+                    nn_ep_stat_increment (cipc->ep,
+                        NN_STAT_INPROGRESS_CONNECTIONS, -1);
+                    return;
+                }
+#endif
+                cipc->retype = 0;
                 nn_ep_set_error (cipc->ep, nn_usock_geterrno (&cipc->usock));
                 nn_usock_stop (&cipc->usock);
                 cipc->state = NN_CIPC_STATE_STOPPING_USOCK;
@@ -301,6 +337,10 @@ static void nn_cipc_handler (struct nn_fsm *self, int src, int type,
             case NN_USOCK_SHUTDOWN:
                 return;
             case NN_USOCK_STOPPED:
+                if (cipc->retype) {
+                    nn_cipc_start_connecting (cipc);
+                    return;
+                }
                 nn_backoff_start (&cipc->retry);
                 cipc->state = NN_CIPC_STATE_WAITING;
                 return;
@@ -376,7 +416,12 @@ static void nn_cipc_start_connecting (struct nn_cipc *self)
     size_t sz;
 
     /*  Try to start the underlying socket. */
+#if defined NN_SIPC_HAVE_SEQPACKET
+    rc = nn_usock_start (&self->usock, AF_UNIX,
+        self->seqpacket ? SOCK_SEQPACKET : SOCK_STREAM, 0);
+#else
     rc = nn_usock_start (&self->usock, AF_UNIX, SOCK_STREAM, 0);
+#endif
     if (nn_slow (rc < 0)) {
         nn_backoff_start (&self->retry);
         self->state = NN_CIPC_STATE_WAITING;
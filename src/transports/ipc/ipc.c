@@ -50,6 +50,8 @@ struct nn_ipc_optset {
 
     int outbuffersz;
     int inbuffersz;
+    int seqpacket;
+    int shmem_threshold;
 };
 
 static void nn_ipc_optset_destroy (struct nn_optset *self);
@@ -100,6 +102,8 @@ static struct nn_optset *nn_ipc_optset ()
     optset->sec_attr = NULL;
     optset->outbuffersz = 4096;
     optset->inbuffersz = 4096;
+    optset->seqpacket = 0;
+    optset->shmem_threshold = -1;
 
     return &optset->base;   
 }
@@ -132,6 +136,14 @@ static int nn_ipc_optset_setopt (struct nn_optset *self, int option,
     case NN_IPC_INBUFSZ:
         optset->inbuffersz = *(int *)optval;
         return 0;
+    case NN_IPC_SEQPACKET:
+        if (nn_slow (*(int *)optval != 0 && *(int *)optval != 1))
+            return -EINVAL;
+        optset->seqpacket = *(int *)optval;
+        return 0;
+    case NN_IPC_SHMEM_THRESHOLD:
+        optset->shmem_threshold = *(int *)optval < 0 ? -1 : *(int *)optval;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -157,6 +169,14 @@ static int nn_ipc_optset_getopt (struct nn_optset *self, int option,
         *(int *)optval = optset->inbuffersz;
         *optvallen = sizeof (int);
         return 0;
+    case NN_IPC_SEQPACKET:
+        *(int *)optval = optset->seqpacket;
+        *optvallen = sizeof (int);
+        return 0;
+    case NN_IPC_SHMEM_THRESHOLD:
+        *(int *)optval = optset->shmem_threshold;
+        *optvallen = sizeof (int);
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -23,15 +23,25 @@
 
 #include "sipc.h"
 
+#include "../../ipc.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/chunk.h"
+
+#if defined NN_CHUNK_HAVE_SHMEM
+#include "../../utils/closefd.h"
+#endif
+
+#include <string.h>
 
 /*  Types of messages passed via IPC transport. */
 #define NN_SIPC_MSG_NORMAL 1
 #define NN_SIPC_MSG_SHMEM 2
+#define NN_SIPC_MSG_COMPRESSED 3
 
 /*  States of the object as a whole. */
 #define NN_SIPC_STATE_IDLE 1
@@ -50,17 +60,26 @@
 #define NN_SIPC_INSTATE_HDR 1
 #define NN_SIPC_INSTATE_BODY 2
 #define NN_SIPC_INSTATE_HASMSG 3
+#define NN_SIPC_INSTATE_SHMEM 4
+#define NN_SIPC_INSTATE_PROTOHDR 5
 
 /*  Possible states of the outbound part of the object. */
 #define NN_SIPC_OUTSTATE_IDLE 1
 #define NN_SIPC_OUTSTATE_SENDING 2
 
+/*  Upper limit for the size of a single SOCK_SEQPACKET record. The kernel
+    refuses records that don't fit into the send buffer at once. */
+#define NN_SIPC_RECMAX (128 * 1024)
+
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sipc_recv (struct nn_pipebase *self, struct nn_msg *msg);
+static void nn_sipc_release (struct nn_pipebase *self);
 const struct nn_pipebase_vfptr nn_sipc_pipebase_vfptr = {
     nn_sipc_send,
-    nn_sipc_recv
+    nn_sipc_recv,
+    nn_sipc_release,
+    NULL
 };
 
 /*  Private functions. */
@@ -68,6 +87,11 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static int nn_sipc_send_record (struct nn_sipc *self);
+#if defined NN_CHUNK_HAVE_SHMEM
+static int nn_sipc_send_shmem (struct nn_sipc *self, size_t size);
+static int nn_sipc_recv_shmem (struct nn_sipc *self);
+#endif
 
 void nn_sipc_init (struct nn_sipc *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner)
@@ -77,13 +101,20 @@ void nn_sipc_init (struct nn_sipc *self, int src,
     self->state = NN_SIPC_STATE_IDLE;
     nn_streamhdr_init (&self->streamhdr, NN_SIPC_SRC_STREAMHDR, &self->fsm);
     self->usock = NULL;
+    self->seqpacket = 0;
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     nn_pipebase_init (&self->pipebase, &nn_sipc_pipebase_vfptr, ep);
+    nn_compress_init (&self->compress, &self->pipebase);
+    self->shmem = -1;
     self->instate = -1;
+    self->infd = -1;
+    self->intstamp = 0;
     nn_msg_init (&self->inmsg, 0);
     self->outstate = -1;
     nn_msg_init (&self->outmsg, 0);
+    self->recmax = NN_SIPC_RECMAX;
+    self->outpos = 0;
     nn_fsm_event_init (&self->done);
 }
 
@@ -94,6 +125,7 @@ void nn_sipc_term (struct nn_sipc *self)
     nn_fsm_event_term (&self->done);
     nn_msg_term (&self->outmsg);
     nn_msg_term (&self->inmsg);
+    nn_compress_term (&self->compress);
     nn_pipebase_term (&self->pipebase);
     nn_streamhdr_term (&self->streamhdr);
     nn_fsm_term (&self->fsm);
@@ -104,7 +136,8 @@ int nn_sipc_isidle (struct nn_sipc *self)
     return nn_fsm_isidle (&self->fsm);
 }
 
-void nn_sipc_start (struct nn_sipc *self, struct nn_usock *usock)
+void nn_sipc_start (struct nn_sipc *self, struct nn_usock *usock,
+    int seqpacket)
 {
     /*  Take ownership of the underlying socket. */
     nn_assert (self->usock == NULL && self->usock_owner.fsm == NULL);
@@ -112,6 +145,7 @@ void nn_sipc_start (struct nn_sipc *self, struct nn_usock *usock)
     self->usock_owner.fsm = &self->fsm;
     nn_usock_swap_owner (usock, &self->usock_owner);
     self->usock = usock;
+    self->seqpacket = seqpacket;
 
     /*  Launch the state machine. */
     nn_fsm_start (&self->fsm);
@@ -126,6 +160,7 @@ static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_sipc *sipc;
     struct nn_iovec iov [3];
+    size_t size;
 
     sipc = nn_cont (self, struct nn_sipc, pipebase);
 
@@ -136,10 +171,41 @@ static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_term (&sipc->outmsg);
     nn_msg_mv (&sipc->outmsg, msg);
 
+    size = nn_chunkref_size (&sipc->outmsg.sphdr) +
+        nn_chunkref_size (&sipc->outmsg.body);
+    sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
+
+#if defined NN_CHUNK_HAVE_SHMEM
+    /*  Messages in shared memory, and large messages in general, are
+        passed in a shared memory file if possible. */
+    if (sipc->shmem >= 0 && size > NN_CHUNKREF_MAX &&
+          nn_sipc_send_shmem (sipc, size))
+        return 0;
+#endif
+
     /*  Serialise the message header. */
-    sipc->outhdr [0] = NN_SIPC_MSG_NORMAL;
-    nn_putll (sipc->outhdr + 1, nn_chunkref_size (&sipc->outmsg.sphdr) +
-        nn_chunkref_size (&sipc->outmsg.body));
+    if (nn_compress_msg (&sipc->compress, &sipc->outmsg)) {
+        sipc->outhdr [0] = NN_SIPC_MSG_COMPRESSED;
+        size = nn_chunkref_size (&sipc->outmsg.sphdr) +
+            nn_chunkref_size (&sipc->outmsg.body);
+    }
+    else
+        sipc->outhdr [0] = NN_SIPC_MSG_NORMAL;
+    nn_putll (sipc->outhdr + 1, size);
+
+    /*  SOCK_SEQPACKET socket delivers each record in a single read as long
+        as the reader's buffer is large enough. Receiver reads the header
+        into its batch buffer, thus if the whole message doesn't fit there
+        the header is sent as a separate record and the body follows. */
+    if (sipc->seqpacket && size + sizeof (sipc->outhdr) >
+          NN_USOCK_BATCH_SIZE) {
+        sipc->outpos = 0;
+        iov [0].iov_base = sipc->outhdr;
+        iov [0].iov_len = sizeof (sipc->outhdr);
+        nn_usock_send (sipc->usock, iov, 1);
+        return 0;
+    }
+    sipc->outpos = size;
 
     /*  Start async sending. */
     iov [0].iov_base = sipc->outhdr;
@@ -150,8 +216,6 @@ static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg)
     iov [2].iov_len = nn_chunkref_size (&sipc->outmsg.body);
     nn_usock_send (sipc->usock, iov, 3);
 
-    sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
-
     return 0;
 }
 
@@ -170,11 +234,33 @@ static int nn_sipc_recv (struct nn_pipebase *self, struct nn_msg *msg)
 
     /*  Start receiving new message. */
     sipc->instate = NN_SIPC_INSTATE_HDR;
-    nn_usock_recv (sipc->usock, sipc->inhdr, sizeof (sipc->inhdr), NULL);
+    nn_usock_recv (sipc->usock, sipc->inhdr, sizeof (sipc->inhdr),
+        &sipc->infd);
 
     return 0;
 }
 
+static void nn_sipc_release (struct nn_pipebase *self)
+{
+    struct nn_sipc *sipc;
+    void *buf;
+
+    sipc = nn_cont (self, struct nn_sipc, pipebase);
+
+    if (!nn_chunkref_isborrowed (&sipc->inmsg.body))
+        return;
+
+    /*  Copy the message body out of the user's buffer and receive the rest
+        of it, if any, into the copy. */
+    buf = nn_chunkref_data (&sipc->inmsg.body);
+    nn_chunkref_own (&sipc->inmsg.body);
+#if !defined NN_HAVE_WINDOWS
+    if (sipc->instate == NN_SIPC_INSTATE_BODY)
+        nn_usock_recv_rebase (sipc->usock, buf,
+            nn_chunkref_data (&sipc->inmsg.body));
+#endif
+}
+
 static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
@@ -189,6 +275,12 @@ static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     }
     if (nn_slow (sipc->state == NN_SIPC_STATE_STOPPING)) {
         if (nn_streamhdr_isidle (&sipc->streamhdr)) {
+#if defined NN_CHUNK_HAVE_SHMEM
+            if (sipc->infd >= 0) {
+                nn_closefd (sipc->infd);
+                sipc->infd = -1;
+            }
+#endif
             nn_usock_swap_owner (sipc->usock, &sipc->usock_owner);
             sipc->usock = NULL;
             sipc->usock_owner.src = -1;
@@ -209,6 +301,7 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
     int rc;
     struct nn_sipc *sipc;
     uint64_t size;
+    void *buf;
     int opt;
     size_t opt_sz = sizeof (opt);
 
@@ -226,8 +319,26 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         case NN_FSM_ACTION:
             switch (type) {
             case NN_FSM_START:
+
+                /*  Offer to receive messages in shared memory files. */
+                sipc->shmem = -1;
+#if defined NN_CHUNK_HAVE_SHMEM
+                nn_pipebase_getopt (&sipc->pipebase, NN_IPC,
+                    NN_IPC_SHMEM_THRESHOLD, &opt, &opt_sz);
+                nn_assert (opt_sz == sizeof (opt));
+                sipc->shmem = opt;
+#endif
+
+                /*  Ask the kernel for receive timestamps if the user wants
+                    them. */
+                nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                    NN_RCVTIMESTAMP, &opt, &opt_sz);
+                if (opt)
+                    nn_usock_tstamp (sipc->usock);
+
                 nn_streamhdr_start (&sipc->streamhdr, sipc->usock,
-                    &sipc->pipebase);
+                    &sipc->pipebase,
+                    sipc->shmem >= 0 ? NN_STREAMHDR_SHMEM : 0);
                 sipc->state = NN_SIPC_STATE_PROTOHDR;
                 return;
             default:
@@ -280,7 +391,23 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_STREAMHDR_STOPPED:
 
+                 /*  With pipelined handshake nothing is agreed on until
+                     the peer's header arrives. */
+                 if (!(sipc->streamhdr.agreed & NN_STREAMHDR_SHMEM))
+                     sipc->shmem = -1;
+
+                 /*  Records must fit into the send buffer. */
+                 if (sipc->seqpacket) {
+                     nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                         NN_SNDBUF, &opt, &opt_sz);
+                     nn_assert (opt_sz == sizeof (opt) && opt > 0);
+                     sipc->recmax = (size_t) opt < NN_SIPC_RECMAX ?
+                         (size_t) opt : NN_SIPC_RECMAX;
+                 }
+
                  /*  Start the pipe. */
+                 nn_compress_start (&sipc->compress,
+                     sipc->streamhdr.compression);
                  rc = nn_pipebase_start (&sipc->pipebase);
                  if (nn_slow (rc < 0)) {
                     sipc->state = NN_SIPC_STATE_DONE;
@@ -288,10 +415,19 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                     return;
                  }
 
-                 /*  Start receiving a message in asynchronous manner. */
-                 sipc->instate = NN_SIPC_INSTATE_HDR;
-                 nn_usock_recv (sipc->usock, &sipc->inhdr,
-                     sizeof (sipc->inhdr), NULL);
+                 /*  Start receiving a message in asynchronous manner.
+                     If the handshake is pipelined the peer's protocol
+                     header comes first. */
+                 if (sipc->streamhdr.pipelined) {
+                     sipc->instate = NN_SIPC_INSTATE_PROTOHDR;
+                     nn_usock_recv (sipc->usock, sipc->streamhdr.protohdr,
+                         sizeof (sipc->streamhdr.protohdr), &sipc->infd);
+                 }
+                 else {
+                     sipc->instate = NN_SIPC_INSTATE_HDR;
+                     nn_usock_recv (sipc->usock, &sipc->inhdr,
+                         sizeof (sipc->inhdr), &sipc->infd);
+                 }
 
                  /*  Mark the pipe as available for sending. */
                  sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
@@ -317,8 +453,12 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_USOCK_SENT:
 
-                /*  The message is now fully sent. */
+                /*  Send the remaining records of a large message. */
                 nn_assert (sipc->outstate == NN_SIPC_OUTSTATE_SENDING);
+                if (nn_sipc_send_record (sipc))
+                    return;
+
+                /*  The message is now fully sent. */
                 sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
                 nn_msg_term (&sipc->outmsg);
                 nn_msg_init (&sipc->outmsg, 0);
@@ -328,26 +468,101 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
             case NN_USOCK_RECEIVED:
 
                 switch (sipc->instate) {
+                case NN_SIPC_INSTATE_PROTOHDR:
+
+                    /*  Peer's protocol header was received. If the peer is
+                        not acceptable, drop the connection along with any
+                        messages it has sent. Otherwise start using the
+                        options agreed on. */
+                    rc = nn_streamhdr_check (&sipc->streamhdr);
+                    if (nn_slow (rc < 0))
+                        goto protoerr;
+                    nn_compress_start (&sipc->compress,
+                        sipc->streamhdr.compression);
+#if defined NN_CHUNK_HAVE_SHMEM
+                    if (sipc->streamhdr.agreed & NN_STREAMHDR_SHMEM) {
+                        nn_pipebase_getopt (&sipc->pipebase, NN_IPC,
+                            NN_IPC_SHMEM_THRESHOLD, &opt, &opt_sz);
+                        sipc->shmem = opt;
+                    }
+#endif
+
+                    sipc->instate = NN_SIPC_INSTATE_HDR;
+                    nn_usock_recv (sipc->usock, sipc->inhdr,
+                        sizeof (sipc->inhdr), &sipc->infd);
+                    return;
+
                 case NN_SIPC_INSTATE_HDR:
 
                     /*  Message header was received. Check that message size
                         is acceptable by comparing with NN_RCVMAXSIZE;
                         if it's too large, drop the connection. */
-                    nn_assert (sipc->inhdr [0] == NN_SIPC_MSG_NORMAL);
                     size = nn_getll (sipc->inhdr + 1);
+                    sipc->intstamp = nn_usock_rcvtstamp (sipc->usock);
+
+                    /*  Compressed messages are only allowed if a codec
+                        was agreed on, shared memory messages if that was
+                        agreed on. Neither is ever empty. */
+                    switch (sipc->inhdr [0]) {
+                    case NN_SIPC_MSG_NORMAL:
+                        break;
+                    case NN_SIPC_MSG_COMPRESSED:
+                        if (!sipc->compress.codec || !size)
+                            goto protoerr;
+                        break;
+                    case NN_SIPC_MSG_SHMEM:
+                        if (sipc->shmem < 0 || !size)
+                            goto protoerr;
+                        break;
+                    default:
+                        goto protoerr;
+                    }
+
+                    /*  Only shared memory messages carry a file descriptor.
+                        Anything the peer attached to other messages is
+                        dropped so that it doesn't leak. */
+                    if (sipc->inhdr [0] != NN_SIPC_MSG_SHMEM &&
+                          sipc->infd >= 0) {
+                        nn_closefd (sipc->infd);
+                        sipc->infd = -1;
+                    }
 
                     nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
                         NN_RCVMAXSIZE, &opt, &opt_sz);
 
-                    if (opt >= 0 && size > (unsigned)opt) {
-                        sipc->state = NN_SIPC_STATE_DONE;
-                        nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                    if (opt >= 0 && size > (unsigned)opt)
+                        goto protoerr;
+
+                    /*  Shared memory message is followed by the offset of
+                        the data within the file passed along. */
+                    if (sipc->inhdr [0] == NN_SIPC_MSG_SHMEM) {
+                        sipc->instate = NN_SIPC_INSTATE_SHMEM;
+                        nn_usock_recv (sipc->usock, sipc->inshm,
+                            sizeof (sipc->inshm), &sipc->infd);
                         return;
                     }
 
-                    /*  Allocate memory for the message. */
+                    /*  Allocate memory for the message. If the user is
+                        waiting with a buffer that fits, receive the body
+                        straight into it unless it has to be inflated. */
                     nn_msg_term (&sipc->inmsg);
-                    nn_msg_init (&sipc->inmsg, (size_t) size);
+                    buf = NULL;
+#if !defined NN_HAVE_WINDOWS
+                    if (size > NN_CHUNKREF_MAX &&
+                          sipc->inhdr [0] == NN_SIPC_MSG_NORMAL)
+                        buf = nn_pipebase_rcvbuf (&sipc->pipebase,
+                            (size_t) size);
+#endif
+                    if (buf) {
+                        nn_msg_init (&sipc->inmsg, 0);
+                        nn_chunkref_term (&sipc->inmsg.body);
+                        nn_chunkref_init_borrowed (&sipc->inmsg.body, buf,
+                            (size_t) size);
+                    }
+                    else
+                        nn_msg_init (&sipc->inmsg, (size_t) size);
+                    if (sipc->intstamp)
+                        nn_msg_tstamp (&sipc->inmsg, sipc->intstamp);
 
                     /*  Special case when size of the message body is 0. */
                     if (!size) {
@@ -360,19 +575,52 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                     sipc->instate = NN_SIPC_INSTATE_BODY;
                     nn_usock_recv (sipc->usock,
                         nn_chunkref_data (&sipc->inmsg.body),
-                        (size_t) size, NULL);
+                        (size_t) size, &sipc->infd);
 
                     return;
 
                 case NN_SIPC_INSTATE_BODY:
 
-                    /*  Message body was received. Notify the owner that it
-                        can receive it. */
+                    /*  Drop a file descriptor passed along with the body. */
+                    if (sipc->infd >= 0) {
+                        nn_closefd (sipc->infd);
+                        sipc->infd = -1;
+                    }
+
+                    /*  Message body was received. Restore compressed
+                        message to its original form; if that fails,
+                        drop the connection. */
+                    if (sipc->inhdr [0] == NN_SIPC_MSG_COMPRESSED) {
+                        rc = nn_decompress_msg (&sipc->compress,
+                            &sipc->inmsg);
+                        if (nn_slow (rc < 0)) {
+                            sipc->state = NN_SIPC_STATE_DONE;
+                            nn_fsm_raise (&sipc->fsm, &sipc->done,
+                                NN_SIPC_ERROR);
+                            return;
+                        }
+                    }
+
+                    /*  Notify the owner that it can receive the message. */
                     sipc->instate = NN_SIPC_INSTATE_HASMSG;
                     nn_pipebase_received (&sipc->pipebase);
 
                     return;
 
+#if defined NN_CHUNK_HAVE_SHMEM
+                case NN_SIPC_INSTATE_SHMEM:
+
+                    /*  Map the passed file as the message. */
+                    rc = nn_sipc_recv_shmem (sipc);
+                    if (nn_slow (rc < 0))
+                        goto protoerr;
+                    if (sipc->intstamp)
+                        nn_msg_tstamp (&sipc->inmsg, sipc->intstamp);
+                    sipc->instate = NN_SIPC_INSTATE_HASMSG;
+                    nn_pipebase_received (&sipc->pipebase);
+                    return;
+#endif
+
                 default:
                     nn_assert (0);
                     return;
@@ -384,6 +632,7 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                 return;
 
             case NN_USOCK_ERROR:
+protoerr:
                 nn_pipebase_stop (&sipc->pipebase);
                 sipc->state = NN_SIPC_STATE_DONE;
                 nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
@@ -436,3 +685,123 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         nn_fsm_bad_state (sipc->state, src, type);
     }
 }
+
+/******************************************************************************/
+/*  State machine actions.                                                    */
+/******************************************************************************/
+
+/*  Hands the next record of a large message to a SOCK_SEQPACKET socket.
+    Returns 0 if the whole message was already sent. */
+static int nn_sipc_send_record (struct nn_sipc *self)
+{
+    size_t sphdrsz;
+    size_t bodysz;
+    size_t pos;
+    size_t len;
+    size_t sz;
+    struct nn_iovec iov [2];
+    int iovcnt;
+
+    sphdrsz = nn_chunkref_size (&self->outmsg.sphdr);
+    bodysz = nn_chunkref_size (&self->outmsg.body);
+    pos = self->outpos;
+    if (pos == sphdrsz + bodysz)
+        return 0;
+    len = sphdrsz + bodysz - pos;
+    if (len > self->recmax)
+        len = self->recmax;
+    self->outpos += len;
+
+    /*  The record may span both the SP header and the body. */
+    iovcnt = 0;
+    if (pos < sphdrsz) {
+        sz = sphdrsz - pos < len ? sphdrsz - pos : len;
+        iov [iovcnt].iov_base = ((uint8_t*) nn_chunkref_data (
+            &self->outmsg.sphdr)) + pos;
+        iov [iovcnt].iov_len = sz;
+        ++iovcnt;
+        pos += sz;
+        len -= sz;
+    }
+    if (len) {
+        iov [iovcnt].iov_base = ((uint8_t*) nn_chunkref_data (
+            &self->outmsg.body)) + (pos - sphdrsz);
+        iov [iovcnt].iov_len = len;
+        ++iovcnt;
+    }
+    nn_usock_send (self->usock, iov, iovcnt);
+
+    return 1;
+}
+
+#if defined NN_CHUNK_HAVE_SHMEM
+
+/*  Passes the message to the peer in a shared memory file. The body is
+    passed as is if it already lives in one and there's no SP header to
+    prepend. Otherwise, if the message is large enough, it's copied into
+    a new file. Returns 0 if the message is to be sent the usual way. */
+static int nn_sipc_send_shmem (struct nn_sipc *self, size_t size)
+{
+    int rc;
+    int fd;
+    void *chunk;
+    size_t offset;
+    size_t sphdrsz;
+    struct nn_iovec iov [2];
+
+    sphdrsz = nn_chunkref_size (&self->outmsg.sphdr);
+    fd = -1;
+    if (!sphdrsz)
+        fd = nn_chunk_shmem (nn_chunkref_data (&self->outmsg.body), &offset);
+    if (fd < 0) {
+        if (size < (size_t) self->shmem)
+            return 0;
+        rc = nn_chunk_alloc (size, NN_IPC_ALLOC_SHMEM, &chunk);
+        if (nn_slow (rc < 0))
+            return 0;
+        memcpy (chunk, nn_chunkref_data (&self->outmsg.sphdr), sphdrsz);
+        memcpy (((uint8_t*) chunk) + sphdrsz,
+            nn_chunkref_data (&self->outmsg.body), size - sphdrsz);
+        nn_msg_term (&self->outmsg);
+        nn_msg_init_chunk (&self->outmsg, chunk);
+        fd = nn_chunk_shmem (chunk, &offset);
+        nn_assert (fd >= 0);
+    }
+
+    /*  Only the header and the offset of the data go through the socket.
+        The message itself is kept until sending is done so that the file
+        stays alive till then. */
+    self->outhdr [0] = NN_SIPC_MSG_SHMEM;
+    nn_putll (self->outhdr + 1, size);
+    nn_putll (self->outshm, offset);
+    self->outpos = size;
+    iov [0].iov_base = self->outhdr;
+    iov [0].iov_len = sizeof (self->outhdr);
+    iov [1].iov_base = self->outshm;
+    iov [1].iov_len = sizeof (self->outshm);
+    nn_usock_send_fd (self->usock, iov, 2, fd);
+
+    return 1;
+}
+
+/*  Maps the file received along with the message header as the message. */
+static int nn_sipc_recv_shmem (struct nn_sipc *self)
+{
+    int rc;
+    void *chunk;
+
+    if (nn_slow (self->infd < 0))
+        return -EINVAL;
+    rc = nn_chunk_shmem_map (self->infd, (size_t) nn_getll (self->inshm),
+        (size_t) nn_getll (self->inhdr + 1), &chunk);
+    nn_closefd (self->infd);
+    self->infd = -1;
+    if (nn_slow (rc < 0))
+        return rc;
+
+    nn_msg_term (&self->inmsg);
+    nn_msg_init_chunk (&self->inmsg, chunk);
+    return 0;
+}
+
+#endif
@@ -30,12 +30,18 @@
 #include "../../aio/usock.h"
 
 #include "../utils/streamhdr.h"
+#include "../utils/compress.h"
 
 #include "../../utils/msg.h"
 
 /*  This state machine handles IPC connection from the point where it is
     established to the point when it is broken. */
 
+/*  UNIX domain sockets that preserve message boundaries are available. */
+#if defined NN_HAVE_UNIX_SOCKETS && defined SOCK_SEQPACKET
+#define NN_SIPC_HAVE_SEQPACKET
+#endif
+
 #define NN_SIPC_ERROR 1
 #define NN_SIPC_STOPPED 2
 
@@ -48,6 +54,9 @@ struct nn_sipc {
     /*  The underlying socket. */
     struct nn_usock *usock;
 
+    /*  1 if the underlying socket is of SOCK_SEQPACKET type. */
+    int seqpacket;
+
     /*  Child state machine to do protocol header exchange. */
     struct nn_streamhdr streamhdr;
 
@@ -57,12 +66,30 @@ struct nn_sipc {
     /*  Pipe connecting this IPC connection to the nanomsg core. */
     struct nn_pipebase pipebase;
 
+    /*  Compression of the messages passed through the pipe. */
+    struct nn_compress compress;
+
+    /*  Messages allocated in shared memory are passed to the peer as they
+        are, other messages of at least this size are copied to shared
+        memory first. Negative if disabled or not agreed on with the peer. */
+    int shmem;
+
     /*  State of inbound state machine. */
     int instate;
 
     /*  Buffer used to store the header of incoming message. */
     uint8_t inhdr [9];
 
+    /*  Offset of the message data within the file passed along with
+        the header of a shared memory message. */
+    uint8_t inshm [8];
+
+    /*  File descriptor received from the peer and not yet processed. */
+    int infd;
+
+    /*  Kernel receive timestamp of the header of incoming message. */
+    uint64_t intstamp;
+
     /*  Message being received at the moment. */
     struct nn_msg inmsg;
 
@@ -71,6 +98,13 @@ struct nn_sipc {
 
     /*  Buffer used to store the header of outgoing message. */
     uint8_t outhdr [9];
+    uint8_t outshm [8];
+
+    /*  With SOCK_SEQPACKET sockets, large messages are sent as a header
+        record followed by body records of at most 'recmax' bytes.
+        'outpos' is the number of body bytes already handed to the socket. */
+    size_t recmax;
+    size_t outpos;
 
     /*  Message being sent at the moment. */
     struct nn_msg outmsg;
@@ -84,7 +118,8 @@ void nn_sipc_init (struct nn_sipc *self, int src,
 void nn_sipc_term (struct nn_sipc *self);
 
 int nn_sipc_isidle (struct nn_sipc *self);
-void nn_sipc_start (struct nn_sipc *self, struct nn_usock *usock);
+void nn_sipc_start (struct nn_sipc *self, struct nn_usock *usock,
+    int seqpacket);
 void nn_sipc_stop (struct nn_sipc *self);
 
 #endif
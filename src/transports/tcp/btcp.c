@@ -23,12 +23,16 @@
 
 #include "btcp.h"
 #include "atcp.h"
+#include "loopback.h"
+
+#include "../../tcp.h"
 
 #include "../utils/port.h"
 #include "../utils/iface.h"
 
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
+#include "../../aio/ctx.h"
 
 #include "../utils/backoff.h"
 
@@ -47,10 +51,6 @@
 #include <netinet/in.h>
 #endif
 
-/*  The backlog is set relatively high so that there are not too many failed
-    connection attempts during re-connection storms. */
-#define NN_BTCP_BACKLOG 100
-
 #define NN_BTCP_STATE_IDLE 1
 #define NN_BTCP_STATE_ACTIVE 2
 #define NN_BTCP_STATE_STOPPING_ATCP 3
@@ -63,6 +63,25 @@
 
 #define NN_BTCP_TYPE_LISTEN_ERR 1
 
+/*  One listening TCP socket. With NN_TCP_REUSEPORT option there is one
+    listener per worker thread, otherwise there's only one. With NN_TCP_LOCAL
+    option there's an additional listener on a UNIX domain socket. */
+struct nn_btcp_listener {
+
+    /*  The underlying listening socket. */
+    struct nn_usock usock;
+
+    /*  1 if this is the UNIX domain socket listener. If it can't be opened
+        the usock is left idle and the endpoint is reachable via TCP only. */
+    int local;
+
+    /*  The connection being accepted at the moment. */
+    struct nn_atcp *atcp;
+
+    /*  Worker thread this listener and the connections it accepts are
+        pinned to. NULL if the worker is chosen by the pool. */
+    struct nn_worker *worker;
+};
 
 struct nn_btcp {
 
@@ -73,11 +92,9 @@ struct nn_btcp {
 
     struct nn_ep *ep;
 
-    /*  The underlying listening TCP socket. */
-    struct nn_usock usock;
-
-    /*  The connection being accepted at the moment. */
-    struct nn_atcp *atcp;
+    /*  The listening sockets. */
+    struct nn_btcp_listener *listeners;
+    int nlisteners;
 
     /*  List of accepted connections. */
     struct nn_list atcps;
@@ -97,11 +114,17 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
 static void nn_btcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static int nn_btcp_listen (struct nn_btcp *self);
-static void nn_btcp_start_accepting (struct nn_btcp *self);
+static int nn_btcp_listen_local (struct nn_usock *usock,
+    const struct sockaddr_storage *addr, uint16_t port, int backlog);
+static void nn_btcp_start_accepting (struct nn_btcp *self,
+    struct nn_btcp_listener *listener);
+static struct nn_btcp_listener *nn_btcp_find_listener (struct nn_btcp *self,
+    struct nn_atcp *atcp);
 
 int nn_btcp_create (struct nn_ep *ep)
 {
     int rc;
+    int i;
     struct nn_btcp *self;
     const char *addr;
     const char *end;
@@ -110,6 +133,13 @@ int nn_btcp_create (struct nn_ep *ep)
     size_t sslen;
     int ipv4only;
     size_t ipv4onlylen;
+    int local;
+    size_t sz;
+#if defined SO_REUSEPORT && !defined NN_HAVE_WINDOWS
+    struct nn_pool *pool;
+    int reuseport;
+    size_t reuseportlen;
+#endif
 
     /*  Allocate the new endpoint object. */
     self = nn_alloc (sizeof (struct nn_btcp), "btcp");
@@ -150,13 +180,53 @@ int nn_btcp_create (struct nn_ep *ep)
         nn_ep_getctx (ep));
     nn_fsm_event_init (&self->listen_error);
     self->state = NN_BTCP_STATE_IDLE;
-    self->atcp = NULL;
     nn_list_init (&self->atcps);
 
+    /*  With NN_TCP_REUSEPORT, open one listener per worker thread and let
+        the kernel spread the incoming connections among them. With a single
+        worker there's nothing to spread and SO_REUSEPORT would only allow
+        other processes to bind the same port, so it's not used. */
+    self->nlisteners = 1;
+#if defined SO_REUSEPORT && !defined NN_HAVE_WINDOWS
+    pool = nn_ep_getctx (ep)->pool;
+    reuseportlen = sizeof (reuseport);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_REUSEPORT, &reuseport, &reuseportlen);
+    nn_assert (reuseportlen == sizeof (reuseport));
+    reuseport = reuseport && nn_pool_size (pool) > 1;
+    if (reuseport)
+        self->nlisteners = nn_pool_size (pool);
+#endif
+
+    /*  Local peers can only use the UNIX domain socket if they would be able
+        to reach the endpoint via loopback interface anyway. */
+    sz = sizeof (local);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_LOCAL, &local, &sz);
+    nn_assert (sz == sizeof (local));
+    local = local && nn_tcp_loopback_reachable (&ss);
+    if (local)
+        ++self->nlisteners;
+
+    self->listeners = nn_alloc (sizeof (struct nn_btcp_listener) *
+        self->nlisteners, "btcp listeners");
+    alloc_assert (self->listeners);
+
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
 
-    nn_usock_init (&self->usock, NN_BTCP_SRC_USOCK, &self->fsm);
+    for (i = 0; i != self->nlisteners; ++i) {
+        self->listeners [i].atcp = NULL;
+        self->listeners [i].worker = NULL;
+        self->listeners [i].local = local && i == self->nlisteners - 1;
+        nn_usock_init (&self->listeners [i].usock, NN_BTCP_SRC_USOCK,
+            &self->fsm);
+#if defined SO_REUSEPORT && !defined NN_HAVE_WINDOWS
+        if (reuseport && !self->listeners [i].local) {
+            self->listeners [i].worker = nn_pool_worker (pool, i);
+            nn_usock_set_worker (&self->listeners [i].usock,
+                self->listeners [i].worker);
+        }
+#endif
+    }
 
     rc = nn_btcp_listen (self);
     if (rc != 0) {
@@ -178,11 +248,15 @@ static void nn_btcp_stop (void *self)
 static void nn_btcp_destroy (void *self)
 {
     struct nn_btcp *btcp = self;
+    int i;
 
     nn_assert_state (btcp, NN_BTCP_STATE_IDLE);
     nn_list_term (&btcp->atcps);
-    nn_assert (btcp->atcp == NULL);
-    nn_usock_term (&btcp->usock);
+    for (i = 0; i != btcp->nlisteners; ++i) {
+        nn_assert (btcp->listeners [i].atcp == NULL);
+        nn_usock_term (&btcp->listeners [i].usock);
+    }
+    nn_free (btcp->listeners);
     nn_fsm_term (&btcp->fsm);
 
     nn_free (btcp);
@@ -194,30 +268,35 @@ static void nn_btcp_shutdown (struct nn_fsm *self, int src, int type,
     struct nn_btcp *btcp;
     struct nn_list_item *it;
     struct nn_atcp *atcp;
+    int i;
 
     btcp = nn_cont (self, struct nn_btcp, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
-        if (btcp->atcp) {
-            nn_atcp_stop (btcp->atcp);
-            btcp->state = NN_BTCP_STATE_STOPPING_ATCP;
-        }
-        else {
-            btcp->state = NN_BTCP_STATE_STOPPING_USOCK;
-        }
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (btcp->listeners [i].atcp)
+                nn_atcp_stop (btcp->listeners [i].atcp);
+        btcp->state = NN_BTCP_STATE_STOPPING_ATCP;
     }
     if (nn_slow (btcp->state == NN_BTCP_STATE_STOPPING_ATCP)) {
-        if (!nn_atcp_isidle (btcp->atcp))
-            return;
-        nn_atcp_term (btcp->atcp);
-        nn_free (btcp->atcp);
-        btcp->atcp = NULL;
-        nn_usock_stop (&btcp->usock);
+        for (i = 0; i != btcp->nlisteners; ++i) {
+            atcp = btcp->listeners [i].atcp;
+            if (!atcp)
+                continue;
+            if (!nn_atcp_isidle (atcp))
+                return;
+            nn_atcp_term (atcp);
+            nn_free (atcp);
+            btcp->listeners [i].atcp = NULL;
+        }
+        for (i = 0; i != btcp->nlisteners; ++i)
+            nn_usock_stop (&btcp->listeners [i].usock);
         btcp->state = NN_BTCP_STATE_STOPPING_USOCK;
     }
     if (nn_slow (btcp->state == NN_BTCP_STATE_STOPPING_USOCK)) {
-       if (!nn_usock_isidle (&btcp->usock))
-            return;
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (!nn_usock_isidle (&btcp->listeners [i].usock))
+                return;
         for (it = nn_list_begin (&btcp->atcps);
               it != nn_list_end (&btcp->atcps);
               it = nn_list_next (&btcp->atcps, it)) {
@@ -255,6 +334,7 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
 {
     struct nn_btcp *btcp;
     struct nn_atcp *atcp;
+    struct nn_btcp_listener *listener;
 
     btcp = nn_cont (self, struct nn_btcp, fsm);
 
@@ -276,6 +356,7 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
     case NN_BTCP_STATE_ACTIVE:
         if (src == NN_BTCP_SRC_BTCP) {   
             nn_assert (type == NN_BTCP_TYPE_LISTEN_ERR);
+            nn_free (btcp->listeners);
             nn_free (btcp);
             return;
         }
@@ -291,11 +372,12 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
         atcp = (struct nn_atcp*) srcptr;
         switch (type) {
         case NN_ATCP_ACCEPTED:
-            nn_assert (btcp->atcp == atcp) ;
+            listener = nn_btcp_find_listener (btcp, atcp);
+            nn_assert (listener);
             nn_list_insert (&btcp->atcps, &atcp->item,
                 nn_list_end (&btcp->atcps));
-            btcp->atcp = NULL;
-            nn_btcp_start_accepting (btcp);
+            listener->atcp = NULL;
+            nn_btcp_start_accepting (btcp, listener);
             return;
         case NN_ATCP_ERROR:
             nn_atcp_stop (atcp);
@@ -320,6 +402,7 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
 static int nn_btcp_listen (struct nn_btcp *self)
 {
     int rc;
+    int i;
     struct sockaddr_storage ss;
     size_t sslen;
     int ipv4only;
@@ -328,6 +411,13 @@ static int nn_btcp_listen (struct nn_btcp *self)
     const char *end;
     const char *pos;
     uint16_t port;
+    struct nn_usock *usock;
+    int backlog;
+    size_t backloglen;
+    int localrc;
+#if defined SO_REUSEPORT && !defined NN_HAVE_WINDOWS
+    int opt;
+#endif
 
     /*  First, resolve the IP address. */
     addr = nn_ep_getaddr (self->ep);
@@ -369,25 +459,87 @@ static int nn_btcp_listen (struct nn_btcp *self)
         nn_assert (0);
     }
 
-    /*  Start listening for incoming connections. */
-    rc = nn_usock_start (&self->usock, ss.ss_family, SOCK_STREAM, 0);
-    if (rc < 0) {
-        return rc;
+    backloglen = sizeof (backlog);
+    nn_ep_getopt (self->ep, NN_TCP, NN_TCP_BACKLOG, &backlog, &backloglen);
+    nn_assert (backloglen == sizeof (backlog));
+
+    /*  Start listening for incoming connections. All the listeners are
+        opened before any of them starts accepting so that a failure
+        can be rolled back synchronously. */
+    for (i = 0; i != self->nlisteners; ++i) {
+        usock = &self->listeners [i].usock;
+        if (self->listeners [i].local) {
+            localrc = nn_btcp_listen_local (usock, &ss, port, backlog);
+            continue;
+        }
+        rc = nn_usock_start (usock, ss.ss_family, SOCK_STREAM, 0);
+        if (rc < 0)
+            goto error;
+
+#if defined SO_REUSEPORT && !defined NN_HAVE_WINDOWS
+
+        /*  Only the listeners of a sharded endpoint are bound to workers. */
+        if (self->listeners [i].worker) {
+            opt = 1;
+            rc = nn_usock_setsockopt (usock, SOL_SOCKET, SO_REUSEPORT,
+                &opt, sizeof (opt));
+            if (rc < 0) {
+                nn_usock_stop (usock);
+                goto error;
+            }
+        }
+#endif
+
+        rc = nn_usock_bind (usock, (struct sockaddr*) &ss, (size_t) sslen);
+        if (rc < 0) {
+            nn_usock_stop (usock);
+            goto error;
+        }
+
+        rc = nn_usock_listen (usock, backlog);
+        if (rc < 0) {
+            nn_usock_stop (usock);
+            goto error;
+        }
     }
+    for (i = 0; i != self->nlisteners; ++i)
+        if (!self->listeners [i].local || localrc == 0)
+            nn_btcp_start_accepting (self, &self->listeners [i]);
+
+    return 0;
 
-    rc = nn_usock_bind (&self->usock, (struct sockaddr*) &ss, (size_t) sslen);
+error:
+    while (i > 0)
+        nn_usock_stop (&self->listeners [--i].usock);
+    return rc;
+}
+
+static int nn_btcp_listen_local (struct nn_usock *usock,
+    const struct sockaddr_storage *addr, uint16_t port, int backlog)
+{
+    int rc;
+    struct sockaddr_storage ss;
+    size_t sslen;
+
+    /*  Failures are not reported to the user. If the socket name is already
+        taken by someone else, local peers find out that it doesn't belong to
+        the owner of the TCP listener and connect via TCP. */
+    rc = nn_tcp_loopback_addr (addr, port, &ss, &sslen);
+    if (rc < 0)
+        return rc;
+    rc = nn_usock_start (usock, ss.ss_family, SOCK_STREAM, 0);
+    if (rc < 0)
+        return rc;
+    rc = nn_usock_bind (usock, (struct sockaddr*) &ss, sslen);
     if (rc < 0) {
-       nn_usock_stop (&self->usock);
-       return rc;
+        nn_usock_stop (usock);
+        return rc;
     }
-
-    rc = nn_usock_listen (&self->usock, NN_BTCP_BACKLOG);
+    rc = nn_usock_listen (usock, backlog);
     if (rc < 0) {
-        nn_usock_stop (&self->usock);
+        nn_usock_stop (usock);
         return rc;
     }
-    nn_btcp_start_accepting(self);
-
     return 0;
 }
 
@@ -395,15 +547,34 @@ static int nn_btcp_listen (struct nn_btcp *self)
 /*  State machine actions.                                                    */
 /******************************************************************************/
 
-static void nn_btcp_start_accepting (struct nn_btcp *self)
+static void nn_btcp_start_accepting (struct nn_btcp *self,
+    struct nn_btcp_listener *listener)
 {
-    nn_assert (self->atcp == NULL);
+    nn_assert (listener->atcp == NULL);
 
     /*  Allocate new atcp state machine. */
-    self->atcp = nn_alloc (sizeof (struct nn_atcp), "atcp");
-    alloc_assert (self->atcp);
-    nn_atcp_init (self->atcp, NN_BTCP_SRC_ATCP, self->ep, &self->fsm);
+    listener->atcp = nn_alloc (sizeof (struct nn_atcp), "atcp");
+    alloc_assert (listener->atcp);
+    nn_atcp_init (listener->atcp, NN_BTCP_SRC_ATCP, self->ep, &self->fsm);
+
+    /*  The accepted connection is handled by the same worker thread as
+        the listener that accepted it. */
+#if !defined NN_HAVE_WINDOWS
+    if (listener->worker)
+        nn_usock_set_worker (&listener->atcp->usock, listener->worker);
+#endif
 
     /*  Start waiting for a new incoming connection. */
-    nn_atcp_start (self->atcp, &self->usock);
+    nn_atcp_start (listener->atcp, &listener->usock);
+}
+
+static struct nn_btcp_listener *nn_btcp_find_listener (struct nn_btcp *self,
+    struct nn_atcp *atcp)
+{
+    int i;
+
+    for (i = 0; i != self->nlisteners; ++i)
+        if (self->listeners [i].atcp == atcp)
+            return &self->listeners [i];
+    return NULL;
 }
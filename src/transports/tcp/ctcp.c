@@ -23,6 +23,7 @@
 
 #include "ctcp.h"
 #include "stcp.h"
+#include "loopback.h"
 
 #include "../../tcp.h"
 
@@ -34,6 +35,7 @@
 
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
+#include "../../aio/timer.h"
 
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
@@ -67,7 +69,22 @@
 #define NN_CTCP_SRC_RECONNECT_TIMER 2
 #define NN_CTCP_SRC_DNS 3
 #define NN_CTCP_SRC_STCP 4
+#define NN_CTCP_SRC_DELAY_TIMER 5
 
+/*  When the name resolves to several addresses, connection attempts to them
+    are raced against each other. Each subsequent attempt is started after
+    this many milliseconds, or straight away if the previous one fails.
+    The value is the one recommended by RFC 8305. */
+#define NN_CTCP_ATTEMPT_DELAY 250
+
+/*  Index of the socket used to connect to the peer's UNIX domain socket
+    (NN_TCP_LOCAL option). It comes after the per-address ones. */
+#define NN_CTCP_LOCAL NN_DNS_MAX_ADDRS
+#define NN_CTCP_MAX_USOCKS (NN_DNS_MAX_ADDRS + 1)
+
+struct nn_ctcp_group;
+
+/*  A single connection to the peer. */
 struct nn_ctcp {
 
     /*  The state machine. */
@@ -76,8 +93,29 @@ struct nn_ctcp {
 
     struct nn_ep *ep;
 
-    /*  The underlying TCP socket. */
-    struct nn_usock usock;
+    /*  The endpoint this connection belongs to. */
+    struct nn_ctcp_group *group;
+
+    /*  Sockets for the connection attempts, one per resolved address plus
+        one for the local shortcut. The first one to connect is handed to
+        stcp, the rest are closed. */
+    struct nn_usock usocks [NN_CTCP_MAX_USOCKS];
+
+    /*  The socket that won the race, if any. */
+    struct nn_usock *usock;
+
+    /*  User ID of the owner of the TCP listener that the local shortcut
+        is supposed to lead to. */
+    uint32_t owner;
+
+    /*  Staggers the starts of the connection attempts. */
+    struct nn_timer delay;
+
+    /*  Index of the next resolved address to try. */
+    int next;
+
+    /*  Number of connection attempts that are still in progress. */
+    int attempts;
 
     /*  Used to wait before retrying to connect. */
     struct nn_backoff retry;
@@ -92,6 +130,21 @@ struct nn_ctcp {
     struct nn_dns_result dns_result;
 };
 
+/*  The connecting endpoint. It opens NN_TCP_CONNECTIONS independent
+    connections to the peer, each of them registered as a separate pipe. */
+struct nn_ctcp_group {
+    struct nn_ep *ep;
+    struct nn_ctcp *conns;
+    int nconns;
+
+    /*  Number of connections that have already stopped. */
+    int nstopped;
+
+    /*  Number of connections that are established. The endpoint's error is
+        cleared only once all of them are. */
+    int nactive;
+};
+
 /*  nn_ep virtual interface implementation. */
 static void nn_ctcp_stop (void *);
 static void nn_ctcp_destroy (void *);
@@ -105,9 +158,18 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_ctcp_init (struct nn_ctcp *self, struct nn_ctcp_group *group);
+static void nn_ctcp_term (struct nn_ctcp *self);
 static void nn_ctcp_start_resolving (struct nn_ctcp *self);
-static void nn_ctcp_start_connecting (struct nn_ctcp *self,
-    struct sockaddr_storage *ss, size_t sslen);
+static void nn_ctcp_start_connecting (struct nn_ctcp *self);
+static int nn_ctcp_start_attempt (struct nn_ctcp *self,
+    struct nn_usock *usock, struct sockaddr_storage *ss, size_t sslen);
+static int nn_ctcp_start_local (struct nn_ctcp *self);
+static void nn_ctcp_next_attempt (struct nn_ctcp *self);
+static void nn_ctcp_attempt_failed (struct nn_ctcp *self,
+    struct nn_usock *usock);
+static void nn_ctcp_stop_attempts (struct nn_ctcp *self);
+static int nn_ctcp_attempts_idle (struct nn_ctcp *self);
 
 int nn_ctcp_create (struct nn_ep *ep)
 {
@@ -122,18 +184,10 @@ int nn_ctcp_create (struct nn_ep *ep)
     size_t sslen;
     int ipv4only;
     size_t ipv4onlylen;
-    struct nn_ctcp *self;
-    int reconnect_ivl;
-    int reconnect_ivl_max;
+    struct nn_ctcp_group *self;
+    int connections;
     size_t sz;
-
-    /*  Allocate the new endpoint object. */
-    self = nn_alloc (sizeof (struct nn_ctcp), "ctcp");
-    alloc_assert (self);
-
-    /*  Initalise the endpoint. */
-    self->ep = ep;
-    nn_ep_tran_setup (ep, &nn_ctcp_ep_ops, self);
+    int i;
 
     /*  Check whether IPv6 is to be used. */
     ipv4onlylen = sizeof (ipv4only);
@@ -149,77 +203,122 @@ int nn_ctcp_create (struct nn_ep *ep)
     end = addr + addrlen;
 
     /*  Parse the port. */
-    if (!colon) {
-        nn_free (self);
+    if (!colon)
         return -EINVAL;
-    }
     rc = nn_port_resolve (colon + 1, end - colon - 1);
-    if (rc < 0) {
-        nn_free (self);
+    if (rc < 0)
         return -EINVAL;
-    }
 
     /*  Check whether the host portion of the address is either a literal
         or a valid hostname. */
     if (nn_dns_check_hostname (hostname, colon - hostname) < 0 &&
           nn_literal_resolve (hostname, colon - hostname, ipv4only,
-          &ss, &sslen) < 0) {
-        nn_free (self);
+          &ss, &sslen) < 0)
         return -EINVAL;
-    }
 
     /*  If local address is specified, check whether it is valid. */
     if (semicolon) {
         rc = nn_iface_resolve (addr, semicolon - addr, ipv4only, &ss, &sslen);
-        if (rc < 0) {
-            nn_free (self);
+        if (rc < 0)
             return -ENODEV;
-        }
     }
 
-    /*  Initialise the structure. */
+    /*  Allocate the new endpoint object. */
+    sz = sizeof (connections);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_CONNECTIONS, &connections, &sz);
+    nn_assert (sz == sizeof (connections));
+    nn_assert (connections >= 1);
+
+    /*  Additional connections would be refused by the peer over and over
+        again. */
+    if (connections > 1 && nn_ep_isexclusive (ep))
+        return -EINVAL;
+
+    self = nn_alloc (sizeof (struct nn_ctcp_group), "ctcp");
+    alloc_assert (self);
+    self->conns = nn_alloc (sizeof (struct nn_ctcp) * connections,
+        "ctcp connections");
+    alloc_assert (self->conns);
+    self->ep = ep;
+    self->nconns = connections;
+    self->nstopped = 0;
+    self->nactive = 0;
+    nn_ep_tran_setup (ep, &nn_ctcp_ep_ops, self);
+
+    /*  Start the state machines. */
+    for (i = 0; i != self->nconns; ++i) {
+        nn_ctcp_init (&self->conns [i], self);
+        nn_fsm_start (&self->conns [i].fsm);
+    }
+
+    return 0;
+}
+
+static void nn_ctcp_init (struct nn_ctcp *self, struct nn_ctcp_group *group)
+{
+    int reconnect_ivl;
+    int reconnect_ivl_max;
+    size_t sz;
+    int i;
+
+    self->ep = group->ep;
+    self->group = group;
     nn_fsm_init_root (&self->fsm, nn_ctcp_handler, nn_ctcp_shutdown,
-        nn_ep_getctx (ep));
+        nn_ep_getctx (self->ep));
     self->state = NN_CTCP_STATE_IDLE;
-    nn_usock_init (&self->usock, NN_CTCP_SRC_USOCK, &self->fsm);
+    for (i = 0; i != NN_CTCP_MAX_USOCKS; ++i)
+        nn_usock_init (&self->usocks [i], NN_CTCP_SRC_USOCK, &self->fsm);
+    self->usock = NULL;
+    nn_timer_init (&self->delay, NN_CTCP_SRC_DELAY_TIMER, &self->fsm);
+    self->next = 0;
+    self->attempts = 0;
     sz = sizeof (reconnect_ivl);
-    nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RECONNECT_IVL, &reconnect_ivl, &sz);
+    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_RECONNECT_IVL,
+        &reconnect_ivl, &sz);
     nn_assert (sz == sizeof (reconnect_ivl));
     sz = sizeof (reconnect_ivl_max);
-    nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RECONNECT_IVL_MAX,
+    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_RECONNECT_IVL_MAX,
         &reconnect_ivl_max, &sz);
     nn_assert (sz == sizeof (reconnect_ivl_max));
     if (reconnect_ivl_max == 0)
         reconnect_ivl_max = reconnect_ivl;
     nn_backoff_init (&self->retry, NN_CTCP_SRC_RECONNECT_TIMER,
         reconnect_ivl, reconnect_ivl_max, &self->fsm);
-    nn_stcp_init (&self->stcp, NN_CTCP_SRC_STCP, ep, &self->fsm);
+    nn_stcp_init (&self->stcp, NN_CTCP_SRC_STCP, self->ep, &self->fsm);
     nn_dns_init (&self->dns, NN_CTCP_SRC_DNS, &self->fsm);
+}
 
-    /*  Start the state machine. */
-    nn_fsm_start (&self->fsm);
-
-    return 0;
+static void nn_ctcp_term (struct nn_ctcp *self)
+{
+    int i;
+
+    nn_dns_term (&self->dns);
+    nn_stcp_term (&self->stcp);
+    nn_backoff_term (&self->retry);
+    nn_timer_term (&self->delay);
+    for (i = 0; i != NN_CTCP_MAX_USOCKS; ++i)
+        nn_usock_term (&self->usocks [i]);
+    nn_fsm_term (&self->fsm);
 }
 
 static void nn_ctcp_stop (void *self)
 {
-    struct nn_ctcp *ctcp = self;
+    struct nn_ctcp_group *group = self;
+    int i;
 
-    nn_fsm_stop (&ctcp->fsm);
+    for (i = 0; i != group->nconns; ++i)
+        nn_fsm_stop (&group->conns [i].fsm);
 }
 
 static void nn_ctcp_destroy (void *self)
 {
-    struct nn_ctcp *ctcp = self;
-
-    nn_dns_term (&ctcp->dns);
-    nn_stcp_term (&ctcp->stcp);
-    nn_backoff_term (&ctcp->retry);
-    nn_usock_term (&ctcp->usock);
-    nn_fsm_term (&ctcp->fsm);
+    struct nn_ctcp_group *group = self;
+    int i;
 
-    nn_free (ctcp);
+    for (i = 0; i != group->nconns; ++i)
+        nn_ctcp_term (&group->conns [i]);
+    nn_free (group->conns);
+    nn_free (group);
 }
 
 static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
@@ -239,19 +338,27 @@ static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
     if (ctcp->state == NN_CTCP_STATE_STOPPING_STCP_FINAL) {
         if (!nn_stcp_isidle (&ctcp->stcp))
             return;
+        if (ctcp->attempts > 0)
+            nn_ep_stat_increment (ctcp->ep, NN_STAT_INPROGRESS_CONNECTIONS,
+                -ctcp->attempts);
+        ctcp->attempts = 0;
+        ctcp->usock = NULL;
         nn_backoff_stop (&ctcp->retry);
-        nn_usock_stop (&ctcp->usock);
+        nn_ctcp_stop_attempts (ctcp);
         nn_dns_stop (&ctcp->dns);
         ctcp->state = NN_CTCP_STATE_STOPPING;
     }
     if (nn_slow (ctcp->state == NN_CTCP_STATE_STOPPING)) {
         if (!nn_backoff_isidle (&ctcp->retry) ||
-              !nn_usock_isidle (&ctcp->usock) ||
+              !nn_ctcp_attempts_idle (ctcp) ||
               !nn_dns_isidle (&ctcp->dns))
             return;
         ctcp->state = NN_CTCP_STATE_IDLE;
         nn_fsm_stopped_noevent (&ctcp->fsm);
-        nn_ep_stopped (ctcp->ep);
+
+        /*  The endpoint is stopped once all its connections are. */
+        if (++ctcp->group->nstopped == ctcp->group->nconns)
+            nn_ep_stopped (ctcp->ep);
         return;
     }
 
@@ -259,7 +366,7 @@ static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
 }
 
 static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
-    NN_UNUSED void *srcptr)
+    void *srcptr)
 {
     struct nn_ctcp *ctcp;
 
@@ -318,9 +425,13 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
         case NN_CTCP_SRC_DNS:
             switch (type) {
             case NN_DNS_STOPPED:
+                if (ctcp->dns_result.origin == NN_DNS_CACHED)
+                    nn_ep_stat_increment (ctcp->ep, NN_STAT_DNS_CACHE_HITS, 1);
+                else if (ctcp->dns_result.origin == NN_DNS_RESOLVED)
+                    nn_ep_stat_increment (ctcp->ep,
+                        NN_STAT_DNS_CACHE_MISSES, 1);
                 if (ctcp->dns_result.error == 0) {
-                    nn_ctcp_start_connecting (ctcp, &ctcp->dns_result.addr,
-                        ctcp->dns_result.addrlen);
+                    nn_ctcp_start_connecting (ctcp);
                     return;
                 }
                 nn_backoff_start (&ctcp->retry);
@@ -336,7 +447,8 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
 
 /******************************************************************************/
 /*  CONNECTING state.                                                         */
-/*  Non-blocking connect is under way.                                        */
+/*  Non-blocking connects to one or more of the resolved addresses are under  */
+/*  way.                                                                      */
 /******************************************************************************/
     case NN_CTCP_STATE_CONNECTING:
         switch (src) {
@@ -344,21 +456,61 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
         case NN_CTCP_SRC_USOCK:
             switch (type) {
             case NN_USOCK_CONNECTED:
-                nn_stcp_start (&ctcp->stcp, &ctcp->usock);
-                ctcp->state = NN_CTCP_STATE_ACTIVE;
+
+                /*  Anybody could have taken the name of the UNIX domain
+                    socket. Talk only to the owner of the TCP listener. */
+                if (srcptr == &ctcp->usocks [NN_CTCP_LOCAL] &&
+                      !nn_tcp_loopback_trusted (srcptr, ctcp->owner)) {
+                    nn_ctcp_attempt_failed (ctcp, srcptr);
+                    return;
+                }
+
+                /*  We have a winner. Abandon all the other attempts. */
+                ctcp->usock = (struct nn_usock*) srcptr;
+                --ctcp->attempts;
                 nn_ep_stat_increment (ctcp->ep,
-                    NN_STAT_INPROGRESS_CONNECTIONS, -1);
+                    NN_STAT_INPROGRESS_CONNECTIONS, -1 - ctcp->attempts);
+                ctcp->attempts = 0;
+                nn_ctcp_stop_attempts (ctcp);
+                nn_stcp_start (&ctcp->stcp, ctcp->usock);
+                ctcp->state = NN_CTCP_STATE_ACTIVE;
                 nn_ep_stat_increment (ctcp->ep,
                     NN_STAT_ESTABLISHED_CONNECTIONS, 1);
-                nn_ep_clear_error (ctcp->ep);
+
+                /*  Sibling connections may still be failing. */
+                if (++ctcp->group->nactive == ctcp->group->nconns)
+                    nn_ep_clear_error (ctcp->ep);
                 return;
             case NN_USOCK_ERROR:
-                nn_ep_set_error (ctcp->ep, nn_usock_geterrno (&ctcp->usock));
-                nn_usock_stop (&ctcp->usock);
-                ctcp->state = NN_CTCP_STATE_STOPPING_USOCK;
-                nn_ep_stat_increment (ctcp->ep,
-                    NN_STAT_INPROGRESS_CONNECTIONS, -1);
-                nn_ep_stat_increment (ctcp->ep, NN_STAT_CONNECT_ERRORS, 1);
+
+                /*  Missing local shortcut is not an error, the peer may
+                    simply not have it enabled. */
+                if (srcptr != &ctcp->usocks [NN_CTCP_LOCAL]) {
+                    nn_ep_set_error (ctcp->ep,
+                        nn_usock_geterrno ((struct nn_usock*) srcptr));
+                    nn_ep_stat_increment (ctcp->ep,
+                        NN_STAT_CONNECT_ERRORS, 1);
+                }
+                nn_ctcp_attempt_failed (ctcp, srcptr);
+                return;
+            case NN_USOCK_SHUTDOWN:
+            case NN_USOCK_STOPPED:
+
+                /*  One of the failed attempts was closed. */
+                return;
+            default:
+                nn_fsm_bad_action (ctcp->state, src, type);
+            }
+
+        case NN_CTCP_SRC_DELAY_TIMER:
+            switch (type) {
+            case NN_TIMER_TIMEOUT:
+                nn_ctcp_next_attempt (ctcp);
+                nn_timer_stop (&ctcp->delay);
+                return;
+            case NN_TIMER_STOPPED:
+                if (ctcp->next < ctcp->dns_result.naddrs)
+                    nn_timer_start (&ctcp->delay, NN_CTCP_ATTEMPT_DELAY);
                 return;
             default:
                 nn_fsm_bad_action (ctcp->state, src, type);
@@ -375,11 +527,18 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
     case NN_CTCP_STATE_ACTIVE:
         switch (src) {
 
+        case NN_CTCP_SRC_USOCK:
+        case NN_CTCP_SRC_DELAY_TIMER:
+
+            /*  Leftovers from the abandoned connection attempts. */
+            return;
+
         case NN_CTCP_SRC_STCP:
             switch (type) {
             case NN_STCP_ERROR:
                 nn_stcp_stop (&ctcp->stcp);
                 ctcp->state = NN_CTCP_STATE_STOPPING_STCP;
+                --ctcp->group->nactive;
                 nn_ep_stat_increment (ctcp->ep, NN_STAT_BROKEN_CONNECTIONS, 1);
                 return;
             default:
@@ -397,12 +556,17 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
     case NN_CTCP_STATE_STOPPING_STCP:
         switch (src) {
 
+        case NN_CTCP_SRC_USOCK:
+        case NN_CTCP_SRC_DELAY_TIMER:
+            return;
+
         case NN_CTCP_SRC_STCP:
             switch (type) {
             case NN_USOCK_SHUTDOWN:
                 return;
             case NN_STCP_STOPPED:
-                nn_usock_stop (&ctcp->usock);
+                nn_usock_stop (ctcp->usock);
+                ctcp->usock = NULL;
                 ctcp->state = NN_CTCP_STATE_STOPPING_USOCK;
                 return;
             default:
@@ -415,22 +579,18 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
 
 /******************************************************************************/
 /*  STOPPING_USOCK state.                                                     */
-/*  usock object was asked to stop but it haven't stopped yet.                */
+/*  usock objects were asked to stop but they haven't stopped yet.            */
 /******************************************************************************/
     case NN_CTCP_STATE_STOPPING_USOCK:
         switch (src) {
 
         case NN_CTCP_SRC_USOCK:
-            switch (type) {
-            case NN_USOCK_SHUTDOWN:
-                return;
-            case NN_USOCK_STOPPED:
-                nn_backoff_start (&ctcp->retry);
-                ctcp->state = NN_CTCP_STATE_WAITING;
+        case NN_CTCP_SRC_DELAY_TIMER:
+            if (!nn_ctcp_attempts_idle (ctcp))
                 return;
-            default:
-                nn_fsm_bad_action (ctcp->state, src, type);
-            }
+            nn_backoff_start (&ctcp->retry);
+            ctcp->state = NN_CTCP_STATE_WAITING;
+            return;
 
         default:
             nn_fsm_bad_source (ctcp->state, src, type);
@@ -520,8 +680,158 @@ static void nn_ctcp_start_resolving (struct nn_ctcp *self)
     self->state = NN_CTCP_STATE_RESOLVING;
 }
 
-static void nn_ctcp_start_connecting (struct nn_ctcp *self,
-    struct sockaddr_storage *ss, size_t sslen)
+static void nn_ctcp_start_connecting (struct nn_ctcp *self)
+{
+    self->next = 0;
+    self->attempts = 0;
+    self->state = NN_CTCP_STATE_CONNECTING;
+
+    /*  If the peer is on the same host try its UNIX domain socket first. TCP
+        connection is attempted once the local one fails or, at the latest,
+        when the delay timer expires. Otherwise, start with the first address
+        and, if there are more of them, get ready to start the next attempt
+        later on. */
+    if (nn_ctcp_start_local (self) < 0)
+        nn_ctcp_next_attempt (self);
+    if (self->attempts == 0) {
+        self->state = NN_CTCP_STATE_STOPPING_USOCK;
+        if (nn_ctcp_attempts_idle (self)) {
+            nn_backoff_start (&self->retry);
+            self->state = NN_CTCP_STATE_WAITING;
+        }
+        return;
+    }
+    if (self->next < self->dns_result.naddrs)
+        nn_timer_start (&self->delay, NN_CTCP_ATTEMPT_DELAY);
+}
+
+static int nn_ctcp_start_local (struct nn_ctcp *self)
+{
+    int rc;
+    int i;
+    int val;
+    size_t sz;
+    const char *addr;
+    const char *end;
+    const char *colon;
+    struct sockaddr_storage ss;
+    size_t sslen;
+    struct nn_usock *usock;
+
+    sz = sizeof (val);
+    nn_ep_getopt (self->ep, NN_TCP, NN_TCP_LOCAL, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    if (!val)
+        return -ENOTSUP;
+
+    /*  Only bother if the peer is reachable via loopback interface. */
+    for (i = 0; i != self->dns_result.naddrs; ++i)
+        if (nn_tcp_loopback_islocal (&self->dns_result.addr [i]))
+            break;
+    if (i == self->dns_result.naddrs)
+        return -EADDRNOTAVAIL;
+
+    /*  Parse the port. */
+    addr = nn_ep_getaddr (self->ep);
+    end = addr + strlen (addr);
+    colon = strrchr (addr, ':');
+    rc = nn_port_resolve (colon + 1, end - colon - 1);
+    errnum_assert (rc > 0, -rc);
+
+    /*  Find the TCP listener the connection would get to otherwise. Its
+        UNIX domain socket is named after it and the peer has to be run by
+        the same user. */
+    rc = nn_tcp_loopback_find (&self->dns_result.addr [i], (uint16_t) rc,
+        &ss, &sslen, &self->owner);
+    if (rc < 0)
+        return rc;
+
+    usock = &self->usocks [NN_CTCP_LOCAL];
+    rc = nn_usock_start (usock, ss.ss_family, SOCK_STREAM, 0);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    /*  Set the relevant socket options. */
+    sz = sizeof (val);
+    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_SNDBUF, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    nn_usock_setsockopt (usock, SOL_SOCKET, SO_SNDBUF,
+        &val, sizeof (val));
+    sz = sizeof (val);
+    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_RCVBUF, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    nn_usock_setsockopt (usock, SOL_SOCKET, SO_RCVBUF,
+        &val, sizeof (val));
+
+    /*  Start connecting. */
+    nn_usock_connect (usock, (struct sockaddr*) &ss, sslen);
+    ++self->attempts;
+    nn_ep_stat_increment (self->ep, NN_STAT_INPROGRESS_CONNECTIONS, 1);
+    return 0;
+}
+
+static void nn_ctcp_next_attempt (struct nn_ctcp *self)
+{
+    int i;
+
+    /*  Start connecting to the next address. Addresses that can't even be
+        tried are skipped. */
+    while (self->next < self->dns_result.naddrs) {
+        i = self->next++;
+        if (nn_ctcp_start_attempt (self, &self->usocks [i],
+              &self->dns_result.addr [i], self->dns_result.addrlen [i]) == 0)
+            return;
+    }
+}
+
+static void nn_ctcp_attempt_failed (struct nn_ctcp *self,
+    struct nn_usock *usock)
+{
+    int next;
+
+    nn_usock_stop (usock);
+    --self->attempts;
+    nn_ep_stat_increment (self->ep, NN_STAT_INPROGRESS_CONNECTIONS, -1);
+
+    /*  Don't wait for the timer, try the next address now. */
+    next = self->next;
+    nn_ctcp_next_attempt (self);
+    if (self->attempts == 0) {
+        nn_timer_stop (&self->delay);
+        self->state = NN_CTCP_STATE_STOPPING_USOCK;
+        return;
+    }
+
+    /*  The address after that gets the full delay from now on. Once
+        stopped, the timer is started anew. */
+    if (self->next != next)
+        nn_timer_stop (&self->delay);
+}
+
+static void nn_ctcp_stop_attempts (struct nn_ctcp *self)
+{
+    int i;
+
+    for (i = 0; i != NN_CTCP_MAX_USOCKS; ++i)
+        if (&self->usocks [i] != self->usock)
+            nn_usock_stop (&self->usocks [i]);
+    nn_timer_stop (&self->delay);
+}
+
+static int nn_ctcp_attempts_idle (struct nn_ctcp *self)
+{
+    int i;
+
+    if (!nn_timer_isidle (&self->delay))
+        return 0;
+    for (i = 0; i != NN_CTCP_MAX_USOCKS; ++i)
+        if (!nn_usock_isidle (&self->usocks [i]))
+            return 0;
+    return 1;
+}
+
+static int nn_ctcp_start_attempt (struct nn_ctcp *self,
+    struct nn_usock *usock, struct sockaddr_storage *ss, size_t sslen)
 {
     int rc;
     struct sockaddr_storage remote;
@@ -563,11 +873,8 @@ static void nn_ctcp_start_connecting (struct nn_ctcp *self,
             &local, &locallen);
     else
         rc = nn_iface_resolve ("*", 1, ipv4only, &local, &locallen);
-    if (nn_slow (rc < 0)) {
-        nn_backoff_start (&self->retry);
-        self->state = NN_CTCP_STATE_WAITING;
-        return;
-    }
+    if (nn_slow (rc < 0))
+        return rc;
 
     /*  Combine the remote address and the port. */
     remote = *ss;
@@ -580,40 +887,37 @@ static void nn_ctcp_start_connecting (struct nn_ctcp *self,
         nn_assert (0);
 
     /*  Try to start the underlying socket. */
-    rc = nn_usock_start (&self->usock, remote.ss_family, SOCK_STREAM, 0);
-    if (nn_slow (rc < 0)) {
-        nn_backoff_start (&self->retry);
-        self->state = NN_CTCP_STATE_WAITING;
-        return;
-    }
+    rc = nn_usock_start (usock, remote.ss_family, SOCK_STREAM, 0);
+    if (nn_slow (rc < 0))
+        return rc;
 
     /*  Set the relevant socket options. */
     sz = sizeof (val);
     nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_SNDBUF, &val, &sz);
     nn_assert (sz == sizeof (val));
-    nn_usock_setsockopt (&self->usock, SOL_SOCKET, SO_SNDBUF,
+    nn_usock_setsockopt (usock, SOL_SOCKET, SO_SNDBUF,
         &val, sizeof (val));
     sz = sizeof (val);
     nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_RCVBUF, &val, &sz);
     nn_assert (sz == sizeof (val));
-    nn_usock_setsockopt (&self->usock, SOL_SOCKET, SO_RCVBUF,
+    nn_usock_setsockopt (usock, SOL_SOCKET, SO_RCVBUF,
         &val, sizeof (val));
     sz = sizeof (val);
     nn_ep_getopt (self->ep, NN_TCP, NN_TCP_NODELAY, &val, &sz);
     nn_assert (sz == sizeof (val));
-    nn_usock_setsockopt (&self->usock, IPPROTO_TCP, TCP_NODELAY,
+    nn_usock_setsockopt (usock, IPPROTO_TCP, TCP_NODELAY,
         &val, sizeof (val));
 
     /*  Bind the socket to the local network interface. */
-    rc = nn_usock_bind (&self->usock, (struct sockaddr*) &local, locallen);
+    rc = nn_usock_bind (usock, (struct sockaddr*) &local, locallen);
     if (nn_slow (rc != 0)) {
-        nn_backoff_start (&self->retry);
-        self->state = NN_CTCP_STATE_WAITING;
-        return;
+        nn_usock_stop (usock);
+        return rc;
     }
 
     /*  Start connecting. */
-    nn_usock_connect (&self->usock, (struct sockaddr*) &remote, remotelen);
-    self->state = NN_CTCP_STATE_CONNECTING;
+    nn_usock_connect (usock, (struct sockaddr*) &remote, remotelen);
+    ++self->attempts;
     nn_ep_stat_increment (self->ep, NN_STAT_INPROGRESS_CONNECTIONS, 1);
+    return 0;
 }
@@ -0,0 +1,386 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "loopback.h"
+
+#include "../../utils/err.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined NN_HAVE_WINDOWS
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/un.h>
+#endif
+
+#if defined NN_HAVE_LINUX
+#include <unistd.h>
+#include <netinet/tcp.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#endif
+
+#if defined NN_HAVE_LINUX
+
+/*  How well the address of a TCP listener matches that of the peer being
+    connected to. The kernel prefers the listener bound to the very address
+    over wildcard ones. IPv6 wildcard listener accepts IPv4 connections too. */
+#define NN_TCP_LOOPBACK_NOMATCH 0
+#define NN_TCP_LOOPBACK_ANY6 1
+#define NN_TCP_LOOPBACK_ANY 2
+#define NN_TCP_LOOPBACK_EXACT 3
+
+/*  State of a listening socket in /proc/net/tcp. */
+#define NN_TCP_LOOPBACK_LISTEN 0x0A
+
+/*  IPv4 addresses mapped to IPv6 are converted to plain IPv4 ones, so that
+    both forms of the same address get the same UNIX domain socket. */
+static void nn_tcp_loopback_normalize (const struct sockaddr_storage *src,
+    struct sockaddr_storage *dst)
+{
+    const struct sockaddr_in6 *in6;
+    struct sockaddr_in *in;
+
+    memcpy (dst, src, sizeof (struct sockaddr_storage));
+    if (src->ss_family != AF_INET6)
+        return;
+    in6 = (const struct sockaddr_in6*) src;
+    if (!IN6_IS_ADDR_V4MAPPED (&in6->sin6_addr))
+        return;
+    memset (dst, 0, sizeof (struct sockaddr_storage));
+    in = (struct sockaddr_in*) dst;
+    in->sin_family = AF_INET;
+    memcpy (&in->sin_addr, &in6->sin6_addr.s6_addr [12], 4);
+}
+
+static int nn_tcp_loopback_isany (const struct sockaddr_storage *ss)
+{
+    if (ss->ss_family == AF_INET)
+        return ((const struct sockaddr_in*) ss)->sin_addr.s_addr ==
+            htonl (INADDR_ANY);
+    return IN6_IS_ADDR_UNSPECIFIED (
+        &((const struct sockaddr_in6*) ss)->sin6_addr);
+}
+
+/*  Both addresses are normalized. */
+static int nn_tcp_loopback_match (const struct sockaddr_storage *listener,
+    const struct sockaddr_storage *peer)
+{
+    if (listener->ss_family == peer->ss_family) {
+        if (listener->ss_family == AF_INET ?
+              ((const struct sockaddr_in*) listener)->sin_addr.s_addr ==
+              ((const struct sockaddr_in*) peer)->sin_addr.s_addr :
+              IN6_ARE_ADDR_EQUAL (
+              &((const struct sockaddr_in6*) listener)->sin6_addr,
+              &((const struct sockaddr_in6*) peer)->sin6_addr))
+            return NN_TCP_LOOPBACK_EXACT;
+        if (nn_tcp_loopback_isany (listener))
+            return NN_TCP_LOOPBACK_ANY;
+        return NN_TCP_LOOPBACK_NOMATCH;
+    }
+    if (listener->ss_family == AF_INET6 && nn_tcp_loopback_isany (listener))
+        return NN_TCP_LOOPBACK_ANY6;
+    return NN_TCP_LOOPBACK_NOMATCH;
+}
+
+/*  Remembers the listener if it matches the peer better than the best one
+    found so far. */
+static void nn_tcp_loopback_rank (const struct sockaddr_storage *ss,
+    uint32_t uid, const struct sockaddr_storage *peer,
+    struct sockaddr_storage *best, int *rank, uint32_t *owner)
+{
+    struct sockaddr_storage listener;
+    int r;
+
+    nn_tcp_loopback_normalize (ss, &listener);
+    r = nn_tcp_loopback_match (&listener, peer);
+    if (r > *rank) {
+        *rank = r;
+        memcpy (best, &listener, sizeof (listener));
+        *owner = uid;
+    }
+}
+
+/*  Asks the kernel for the TCP listeners of the address family on 'port'
+    using the sock_diag netlink interface and ranks them. The kernel walks
+    only the listening sockets and filters them by port itself. Returns -1 if
+    the interface is not available. */
+static int nn_tcp_loopback_diag (int family,
+    const struct sockaddr_storage *peer, uint16_t port,
+    struct sockaddr_storage *best, int *rank, uint32_t *owner)
+{
+    int s;
+    int rc;
+    ssize_t nbytes;
+    struct {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } request;
+    struct sockaddr_nl nladdr;
+    long buf [2048];
+    struct nlmsghdr *nlh;
+    struct inet_diag_msg *msg;
+    struct sockaddr_storage ss;
+
+    s = socket (AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (s < 0)
+        return -1;
+
+    memset (&request, 0, sizeof (request));
+    request.nlh.nlmsg_len = sizeof (request);
+    request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.req.sdiag_family = (uint8_t) family;
+    request.req.sdiag_protocol = IPPROTO_TCP;
+    request.req.idiag_states = 1 << TCP_LISTEN;
+    request.req.id.idiag_sport = htons (port);
+    memset (&nladdr, 0, sizeof (nladdr));
+    nladdr.nl_family = AF_NETLINK;
+    nbytes = sendto (s, &request, sizeof (request), 0,
+        (struct sockaddr*) &nladdr, sizeof (nladdr));
+    if (nbytes != sizeof (request)) {
+        close (s);
+        return -1;
+    }
+
+    rc = -1;
+    while (1) {
+        nbytes = recv (s, buf, sizeof (buf), 0);
+        if (nbytes <= 0)
+            break;
+        for (nlh = (struct nlmsghdr*) buf; NLMSG_OK (nlh, nbytes);
+              nlh = NLMSG_NEXT (nlh, nbytes)) {
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                rc = 0;
+                goto done;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR)
+                goto done;
+            if (nlh->nlmsg_type != SOCK_DIAG_BY_FAMILY ||
+                  nlh->nlmsg_len < NLMSG_LENGTH (sizeof (*msg)))
+                continue;
+            msg = (struct inet_diag_msg*) NLMSG_DATA (nlh);
+
+            /*  Older kernels may not filter by port. */
+            if (msg->idiag_family != family ||
+                  msg->idiag_state != TCP_LISTEN ||
+                  msg->id.idiag_sport != htons (port))
+                continue;
+
+            memset (&ss, 0, sizeof (ss));
+            ss.ss_family = family;
+            if (family == AF_INET)
+                memcpy (&((struct sockaddr_in*) &ss)->sin_addr,
+                    msg->id.idiag_src, 4);
+            else
+                memcpy (&((struct sockaddr_in6*) &ss)->sin6_addr,
+                    msg->id.idiag_src, 16);
+            nn_tcp_loopback_rank (&ss, msg->idiag_uid, peer, best, rank,
+                owner);
+        }
+    }
+done:
+    close (s);
+    return rc;
+}
+
+/*  Same as above, for kernels without sock_diag. Goes through TCP sockets
+    listed in 'path'. The file has the addresses printed as 32-bit words in
+    host byte order. */
+static void nn_tcp_loopback_scan (const char *path, int family,
+    const struct sockaddr_storage *peer, uint16_t port,
+    struct sockaddr_storage *best, int *rank, uint32_t *owner)
+{
+    FILE *f;
+    char line [256];
+    char hex [33];
+    char word [9];
+    unsigned int lport;
+    unsigned int state;
+    unsigned int uid;
+    uint32_t val;
+    struct sockaddr_storage ss;
+    int i;
+
+    f = fopen (path, "r");
+    if (!f)
+        return;
+    while (fgets (line, sizeof (line), f)) {
+
+        /*  The header line doesn't parse. */
+        if (sscanf (line, " %*d: %32[0-9A-Fa-f]:%x %*s %x %*s %*s %*s %u",
+              hex, &lport, &state, &uid) != 4)
+            continue;
+        if (state != NN_TCP_LOOPBACK_LISTEN || lport != port)
+            continue;
+
+        memset (&ss, 0, sizeof (ss));
+        ss.ss_family = family;
+        if (family == AF_INET) {
+            if (strlen (hex) != 8)
+                continue;
+            val = (uint32_t) strtoul (hex, NULL, 16);
+            memcpy (&((struct sockaddr_in*) &ss)->sin_addr, &val, 4);
+        }
+        else {
+            if (strlen (hex) != 32)
+                continue;
+            for (i = 0; i != 4; ++i) {
+                memcpy (word, hex + i * 8, 8);
+                word [8] = 0;
+                val = (uint32_t) strtoul (word, NULL, 16);
+                memcpy (&((struct sockaddr_in6*) &ss)->sin6_addr.s6_addr [i * 4],
+                    &val, 4);
+            }
+        }
+        nn_tcp_loopback_rank (&ss, (uint32_t) uid, peer, best, rank, owner);
+    }
+    fclose (f);
+}
+
+#endif
+
+int nn_tcp_loopback_addr (const struct sockaddr_storage *addr, uint16_t port,
+    struct sockaddr_storage *ss, size_t *sslen)
+{
+#if defined NN_HAVE_LINUX
+    struct sockaddr_storage norm;
+    struct sockaddr_un *un;
+    char name [INET6_ADDRSTRLEN];
+    const void *src;
+    int len;
+
+    /*  Name the socket after both the address and the port, so that
+        endpoints bound to different addresses don't collide. */
+    nn_tcp_loopback_normalize (addr, &norm);
+    if (norm.ss_family == AF_INET)
+        src = &((struct sockaddr_in*) &norm)->sin_addr;
+    else
+        src = &((struct sockaddr_in6*) &norm)->sin6_addr;
+    if (!inet_ntop (norm.ss_family, src, name, sizeof (name)))
+        return -EAFNOSUPPORT;
+
+    /*  Use abstract namespace so that there's no file to clean up and
+        the socket disappears together with the endpoint. */
+    memset (ss, 0, sizeof (struct sockaddr_storage));
+    un = (struct sockaddr_un*) ss;
+    un->sun_family = AF_UNIX;
+    len = snprintf (un->sun_path + 1, sizeof (un->sun_path) - 1,
+        "nanomsg-tcp-%s-%d", name, (int) port);
+    nn_assert (len > 0 && len < (int) sizeof (un->sun_path) - 1);
+    *sslen = offsetof (struct sockaddr_un, sun_path) + 1 + len;
+    return 0;
+#else
+    (void) addr;
+    (void) port;
+    (void) ss;
+    (void) sslen;
+    return -EAFNOSUPPORT;
+#endif
+}
+
+int nn_tcp_loopback_find (const struct sockaddr_storage *peer, uint16_t port,
+    struct sockaddr_storage *ss, size_t *sslen, uint32_t *owner)
+{
+#if defined NN_HAVE_LINUX
+    struct sockaddr_storage norm;
+    struct sockaddr_storage best;
+    int rank;
+
+    nn_tcp_loopback_normalize (peer, &norm);
+    rank = NN_TCP_LOOPBACK_NOMATCH;
+    if (nn_tcp_loopback_diag (AF_INET, &norm, port, &best, &rank, owner) < 0)
+        nn_tcp_loopback_scan ("/proc/net/tcp", AF_INET, &norm, port,
+            &best, &rank, owner);
+    if (nn_tcp_loopback_diag (AF_INET6, &norm, port, &best, &rank, owner) < 0)
+        nn_tcp_loopback_scan ("/proc/net/tcp6", AF_INET6, &norm, port,
+            &best, &rank, owner);
+    if (rank == NN_TCP_LOOPBACK_NOMATCH)
+        return -ECONNREFUSED;
+    return nn_tcp_loopback_addr (&best, port, ss, sslen);
+#else
+    (void) peer;
+    (void) port;
+    (void) ss;
+    (void) sslen;
+    (void) owner;
+    return -EAFNOSUPPORT;
+#endif
+}
+
+int nn_tcp_loopback_trusted (struct nn_usock *usock, uint32_t owner)
+{
+#if defined NN_HAVE_LINUX
+    int rc;
+    struct ucred cred;
+    size_t sz;
+
+    sz = sizeof (cred);
+    rc = nn_usock_getsockopt (usock, SOL_SOCKET, SO_PEERCRED, &cred, &sz);
+    if (rc < 0 || sz != sizeof (cred))
+        return 0;
+    return cred.uid == owner;
+#else
+    (void) usock;
+    (void) owner;
+    return 0;
+#endif
+}
+
+int nn_tcp_loopback_islocal (const struct sockaddr_storage *ss)
+{
+    const struct in6_addr *in6;
+    uint32_t in4;
+
+    switch (ss->ss_family) {
+    case AF_INET:
+        in4 = ntohl (((const struct sockaddr_in*) ss)->sin_addr.s_addr);
+        return (in4 >> 24) == 127;
+    case AF_INET6:
+        in6 = &((const struct sockaddr_in6*) ss)->sin6_addr;
+        if (IN6_IS_ADDR_LOOPBACK (in6))
+            return 1;
+        return IN6_IS_ADDR_V4MAPPED (in6) && in6->s6_addr [12] == 127;
+    default:
+        return 0;
+    }
+}
+
+int nn_tcp_loopback_reachable (const struct sockaddr_storage *ss)
+{
+    switch (ss->ss_family) {
+    case AF_INET:
+        if (((const struct sockaddr_in*) ss)->sin_addr.s_addr ==
+              htonl (INADDR_ANY))
+            return 1;
+        break;
+    case AF_INET6:
+        if (IN6_IS_ADDR_UNSPECIFIED (
+              &((const struct sockaddr_in6*) ss)->sin6_addr))
+            return 1;
+        break;
+    }
+    return nn_tcp_loopback_islocal (ss);
+}
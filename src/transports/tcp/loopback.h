@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_TCP_LOOPBACK_INCLUDED
+#define NN_TCP_LOOPBACK_INCLUDED
+
+#if defined NN_HAVE_WINDOWS
+#include "../../utils/win.h"
+#else
+#include <sys/socket.h>
+#endif
+
+#include "../../aio/usock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Support for NN_TCP_LOCAL option. Bound endpoint that can be reached via
+    loopback interface additionally listens on a UNIX domain socket named
+    after its TCP address. Connecting endpoint that targets a loopback address
+    tries that socket first and falls back to TCP if it's not there.
+
+    Anybody on the host can take the name of the UNIX domain socket first.
+    Thus, the connecting endpoint looks up the TCP listener it would connect
+    to otherwise and only talks to the UNIX domain socket if the process on
+    the other end runs under the same user as the one who owns the listener. */
+
+/*  Fills in the UNIX domain socket address associated with the TCP address
+    the endpoint is bound to. Returns -EAFNOSUPPORT if the platform doesn't
+    support the feature. */
+int nn_tcp_loopback_addr (const struct sockaddr_storage *addr, uint16_t port,
+    struct sockaddr_storage *ss, size_t *sslen);
+
+/*  Finds the TCP listener that a connection to 'peer' and 'port' would reach.
+    Fills in the UNIX domain socket address associated with it and the user ID
+    of its owner. Returns -ECONNREFUSED if there's no such listener or
+    -EAFNOSUPPORT if the platform doesn't support the feature. */
+int nn_tcp_loopback_find (const struct sockaddr_storage *peer, uint16_t port,
+    struct sockaddr_storage *ss, size_t *sslen, uint32_t *owner);
+
+/*  Returns 1 if the peer connected to via the UNIX domain socket runs under
+    the user ID 'owner', 0 otherwise. */
+int nn_tcp_loopback_trusted (struct nn_usock *usock, uint32_t owner);
+
+/*  Returns 1 if the address belongs to the loopback interface. */
+int nn_tcp_loopback_islocal (const struct sockaddr_storage *ss);
+
+/*  Returns 1 if listening on the address accepts connections from the
+    loopback interface, i.e. the address is either loopback or wildcard. */
+int nn_tcp_loopback_reachable (const struct sockaddr_storage *ss);
+
+#endif
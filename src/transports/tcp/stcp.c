@@ -23,11 +23,14 @@
 
 #include "stcp.h"
 
+#include "../../tcp.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/alloc.h"
 
 /*  States of the object as a whole. */
 #define NN_STCP_STATE_IDLE 1
@@ -42,10 +45,29 @@
 #define NN_STCP_INSTATE_HDR 1
 #define NN_STCP_INSTATE_BODY 2
 #define NN_STCP_INSTATE_HASMSG 3
+#define NN_STCP_INSTATE_PROTOHDR 4
+#define NN_STCP_INSTATE_FRAGMENT 5
+#define NN_STCP_INSTATE_REST 6
 
 /*  Possible states of the outbound part of the object. */
 #define NN_STCP_OUTSTATE_IDLE 1
 #define NN_STCP_OUTSTATE_SENDING 2
+#define NN_STCP_OUTSTATE_SENDING_FRAGMENT 3
+
+/*  Top bit of the message size marks messages that are compressed. */
+#define NN_STCP_COMPRESSED (((uint64_t) 1) << 63)
+
+/*  If fragmentation was agreed on, large messages are announced by a header
+    with the start bit set carrying their total size and no data. The data
+    follow in fragments, marked by the fragment bit, which whole messages
+    may be interleaved with. */
+#define NN_STCP_FRAGMENT (((uint64_t) 1) << 62)
+#define NN_STCP_START (((uint64_t) 1) << 61)
+
+/*  If the user receives messages piece by piece, only this many bytes of
+    a larger message are received at once. The same applies to sending
+    message bodies produced piece by piece by the user. */
+#define NN_STCP_STREAMBUF 65536
 
 /*  Subordinate srcptr objects. */
 #define NN_STCP_SRC_USOCK 1
@@ -54,9 +76,14 @@
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg);
+static void nn_stcp_release (struct nn_pipebase *self);
+static void nn_stcp_stream (struct nn_pipebase *self, nn_stream_fn fn,
+    void *arg);
 const struct nn_pipebase_vfptr nn_stcp_pipebase_vfptr = {
     nn_stcp_send,
-    nn_stcp_recv
+    nn_stcp_recv,
+    nn_stcp_release,
+    nn_stcp_stream
 };
 
 /*  Private functions. */
@@ -64,6 +91,11 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_stcp_send_next (struct nn_stcp *self);
+static void nn_stcp_send_fragment (struct nn_stcp *self, size_t hdrlen);
+static int nn_stcp_send_rest (struct nn_stcp *self);
+static void nn_stcp_recv_rest (struct nn_stcp *self);
+static void nn_stcp_rest_done (struct nn_stcp *self);
 
 void nn_stcp_init (struct nn_stcp *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner)
@@ -76,10 +108,27 @@ void nn_stcp_init (struct nn_stcp *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     nn_pipebase_init (&self->pipebase, &nn_stcp_pipebase_vfptr, ep);
+    nn_compress_init (&self->compress, &self->pipebase);
     self->instate = -1;
     nn_msg_init (&self->inmsg, 0);
+    nn_msg_init (&self->bulkin, 0);
+    self->bulkinpos = 0;
+    self->bulkinsize = 0;
+    self->bulkincompressed = 0;
+    self->inrest = 0;
+    self->inrestlen = 0;
+    self->inrestbuf = NULL;
+    self->restfn = NULL;
+    self->restarg = NULL;
     self->outstate = -1;
     nn_msg_init (&self->outmsg, 0);
+    self->outqueued = 0;
+    self->outrest = 0;
+    self->outrestbuf = NULL;
+    self->fragsize = 0;
+    nn_msg_init (&self->bulkmsg, 0);
+    self->bulkpos = 0;
+    self->bulksize = 0;
     nn_fsm_event_init (&self->done);
 }
 
@@ -88,8 +137,15 @@ void nn_stcp_term (struct nn_stcp *self)
     nn_assert_state (self, NN_STCP_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
+    if (self->outrestbuf)
+        nn_free (self->outrestbuf);
+    if (self->inrestbuf)
+        nn_free (self->inrestbuf);
+    nn_msg_term (&self->bulkmsg);
     nn_msg_term (&self->outmsg);
+    nn_msg_term (&self->bulkin);
     nn_msg_term (&self->inmsg);
+    nn_compress_term (&self->compress);
     nn_pipebase_term (&self->pipebase);
     nn_streamhdr_term (&self->streamhdr);
     nn_fsm_term (&self->fsm);
@@ -121,32 +177,157 @@ void nn_stcp_stop (struct nn_stcp *self)
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_stcp *stcp;
-    struct nn_iovec iov [3];
+    uint64_t size;
 
     stcp = nn_cont (self, struct nn_stcp, pipebase);
 
     nn_assert_state (stcp, NN_STCP_STATE_ACTIVE);
-    nn_assert (stcp->outstate == NN_STCP_OUTSTATE_IDLE);
+    nn_assert (stcp->outstate != NN_STCP_OUTSTATE_SENDING &&
+        !stcp->outqueued);
 
     /*  Move the message to the local storage. */
     nn_msg_term (&stcp->outmsg);
     nn_msg_mv (&stcp->outmsg, msg);
 
-    /*  Serialise the message header. */
-    nn_putll (stcp->outhdr, nn_chunkref_size (&stcp->outmsg.sphdr) +
-        nn_chunkref_size (&stcp->outmsg.body));
+    /*  Serialise the message header. Bodies produced on the fly by the user
+        are never compressed. */
+    size = nn_chunkref_size (&stcp->outmsg.sphdr) +
+        nn_chunkref_size (&stcp->outmsg.body);
+    if (!nn_chunkref_isstream (&stcp->outmsg.body) &&
+          nn_compress_msg (&stcp->compress, &stcp->outmsg))
+        size = nn_chunkref_size (&stcp->outmsg.body) | NN_STCP_COMPRESSED;
+    nn_putll (stcp->outhdr, size);
+
+    /*  Start async sending unless a fragment is being sent at the moment. */
+    stcp->outqueued = 1;
+    if (stcp->outstate == NN_STCP_OUTSTATE_IDLE)
+        nn_stcp_send_next (stcp);
+
+    return 0;
+}
+
+/*  Returns 1 if the message waiting in outmsg is to be sent in fragments.
+    Bodies produced on the fly by the user are always sent whole. */
+static int nn_stcp_isbulk (struct nn_stcp *self)
+{
+    if (!self->fragsize || nn_chunkref_isstream (&self->outmsg.body) ||
+          !(self->streamhdr.agreed & NN_STREAMHDR_FRAGMENTS))
+        return 0;
+    return nn_chunkref_size (&self->outmsg.sphdr) +
+        nn_chunkref_size (&self->outmsg.body) > self->fragsize;
+}
+
+/*  Passes next piece of data to the usock, which must be idle. Queued whole
+    message takes precedence over fragments of the large message. */
+static void nn_stcp_send_next (struct nn_stcp *self)
+{
+    struct nn_iovec iov [3];
+
+    nn_assert (self->outstate == NN_STCP_OUTSTATE_IDLE);
+
+    if (self->outqueued && !nn_stcp_isbulk (self)) {
+        iov [0].iov_base = self->outhdr;
+        iov [0].iov_len = sizeof (self->outhdr);
+        iov [1].iov_base = nn_chunkref_data (&self->outmsg.sphdr);
+        iov [1].iov_len = nn_chunkref_size (&self->outmsg.sphdr);
+        self->outqueued = 0;
+        self->outstate = NN_STCP_OUTSTATE_SENDING;
+
+        /*  Body produced by the user follows the header piece by piece. */
+        if (nn_slow (nn_chunkref_isstream (&self->outmsg.body))) {
+            self->outrest = nn_chunkref_size (&self->outmsg.body);
+            nn_usock_send (self->usock, iov, 2);
+            return;
+        }
+
+        iov [2].iov_base = nn_chunkref_data (&self->outmsg.body);
+        iov [2].iov_len = nn_chunkref_size (&self->outmsg.body);
+        nn_usock_send (self->usock, iov, 3);
+        return;
+    }
+
+    /*  Only one message at a time is sent in fragments. Once the large
+        message gets under way the pipe is ready to accept more messages. */
+    if (self->outqueued && !self->bulksize) {
+        nn_msg_term (&self->bulkmsg);
+        nn_msg_mv (&self->bulkmsg, &self->outmsg);
+        nn_msg_init (&self->outmsg, 0);
+        self->outqueued = 0;
+        self->bulkpos = 0;
+        self->bulksize = nn_chunkref_size (&self->bulkmsg.sphdr) +
+            nn_chunkref_size (&self->bulkmsg.body);
+        nn_putll (self->bulkhdr, nn_getll (self->outhdr) | NN_STCP_START);
+        nn_stcp_send_fragment (self, 8);
+        nn_pipebase_sent (&self->pipebase);
+        return;
+    }
+
+    if (self->bulksize)
+        nn_stcp_send_fragment (self, 0);
+}
+
+/*  Sends next fragment of the large message, preceded by hdrlen bytes
+    already stored in the header buffer. */
+static void nn_stcp_send_fragment (struct nn_stcp *self, size_t hdrlen)
+{
+    struct nn_iovec iov [3];
+    int iovcnt;
+    size_t len;
+    size_t pos;
+    size_t sphdrsz;
+    size_t sz;
+
+    len = self->bulksize - self->bulkpos;
+    if (len > self->fragsize)
+        len = self->fragsize;
+    nn_putll (self->bulkhdr + hdrlen, len | NN_STCP_FRAGMENT);
+    iov [0].iov_base = self->bulkhdr;
+    iov [0].iov_len = hdrlen + 8;
+    iovcnt = 1;
+
+    /*  Fragment may span both the protocol header and the body. */
+    pos = self->bulkpos;
+    sz = len;
+    sphdrsz = nn_chunkref_size (&self->bulkmsg.sphdr);
+    if (pos < sphdrsz) {
+        iov [iovcnt].iov_base = ((uint8_t*)
+            nn_chunkref_data (&self->bulkmsg.sphdr)) + pos;
+        iov [iovcnt].iov_len = sphdrsz - pos < sz ? sphdrsz - pos : sz;
+        pos += iov [iovcnt].iov_len;
+        sz -= iov [iovcnt].iov_len;
+        ++iovcnt;
+    }
+    if (sz) {
+        iov [iovcnt].iov_base = ((uint8_t*)
+            nn_chunkref_data (&self->bulkmsg.body)) + (pos - sphdrsz);
+        iov [iovcnt].iov_len = sz;
+        ++iovcnt;
+    }
+    nn_usock_send (self->usock, iov, iovcnt);
 
-    /*  Start async sending. */
-    iov [0].iov_base = stcp->outhdr;
-    iov [0].iov_len = sizeof (stcp->outhdr);
-    iov [1].iov_base = nn_chunkref_data (&stcp->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&stcp->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&stcp->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&stcp->outmsg.body);
-    nn_usock_send (stcp->usock, iov, 3);
+    self->bulkpos += len;
+    self->outstate = NN_STCP_OUTSTATE_SENDING_FRAGMENT;
+}
 
-    stcp->outstate = NN_STCP_OUTSTATE_SENDING;
+/*  Sends next piece of the message body produced by the user. Returns
+    -ECONNABORTED if the user fails to produce it. */
+static int nn_stcp_send_rest (struct nn_stcp *self)
+{
+    int rc;
+    struct nn_iovec iov;
 
+    if (!self->outrestbuf) {
+        self->outrestbuf = nn_alloc (NN_STCP_STREAMBUF, "stream buffer");
+        alloc_assert (self->outrestbuf);
+    }
+    iov.iov_base = self->outrestbuf;
+    iov.iov_len = self->outrest < NN_STCP_STREAMBUF ?
+        self->outrest : NN_STCP_STREAMBUF;
+    rc = nn_chunkref_read (&self->outmsg.body, iov.iov_base, iov.iov_len);
+    if (nn_slow (rc < 0))
+        return rc;
+    nn_usock_send (self->usock, &iov, 1);
+    self->outrest -= iov.iov_len;
     return 0;
 }
 
@@ -163,6 +344,15 @@ static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_mv (msg, &stcp->inmsg);
     nn_msg_init (&stcp->inmsg, 0);
 
+    /*  If it's only the head of the message, the core tells what to do with
+        the rest of it. */
+    if (nn_slow (stcp->inrest)) {
+        nn_pipebase_rcvhead (&stcp->pipebase, nn_chunkref_data (&msg->body),
+            stcp->inrest);
+        stcp->instate = NN_STCP_INSTATE_REST;
+        return 0;
+    }
+
     /*  Start receiving new message. */
     stcp->instate = NN_STCP_INSTATE_HDR;
     nn_usock_recv (stcp->usock, stcp->inhdr, sizeof (stcp->inhdr), NULL);
@@ -170,6 +360,67 @@ static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg)
     return 0;
 }
 
+static void nn_stcp_release (struct nn_pipebase *self)
+{
+    struct nn_stcp *stcp;
+    void *buf;
+
+    stcp = nn_cont (self, struct nn_stcp, pipebase);
+
+    if (!nn_chunkref_isborrowed (&stcp->inmsg.body))
+        return;
+
+    /*  Copy the message body out of the user's buffer and receive the rest
+        of it, if any, into the copy. */
+    buf = nn_chunkref_data (&stcp->inmsg.body);
+    nn_chunkref_own (&stcp->inmsg.body);
+#if !defined NN_HAVE_WINDOWS
+    if (stcp->instate == NN_STCP_INSTATE_BODY)
+        nn_usock_recv_rebase (stcp->usock, buf,
+            nn_chunkref_data (&stcp->inmsg.body));
+#endif
+}
+
+static void nn_stcp_stream (struct nn_pipebase *self, nn_stream_fn fn,
+    void *arg)
+{
+    struct nn_stcp *stcp;
+
+    stcp = nn_cont (self, struct nn_stcp, pipebase);
+
+    nn_assert_state (stcp, NN_STCP_STATE_ACTIVE);
+    nn_assert (stcp->instate == NN_STCP_INSTATE_REST && !stcp->restfn);
+
+    /*  Start receiving the rest of the message. If there's no function to
+        pass it to, it is dropped. */
+    stcp->restfn = fn;
+    stcp->restarg = arg;
+    nn_stcp_recv_rest (stcp);
+}
+
+static void nn_stcp_recv_rest (struct nn_stcp *self)
+{
+    if (!self->inrestbuf) {
+        self->inrestbuf = nn_alloc (NN_STCP_STREAMBUF, "stream buffer");
+        alloc_assert (self->inrestbuf);
+    }
+    self->inrestlen = self->inrest < NN_STCP_STREAMBUF ?
+        self->inrest : NN_STCP_STREAMBUF;
+    nn_usock_recv (self->usock, self->inrestbuf, self->inrestlen, NULL);
+}
+
+/*  Lets the core know that no more of the message is going to be passed
+    to it. */
+static void nn_stcp_rest_done (struct nn_stcp *self)
+{
+    nn_stream_fn fn;
+
+    fn = self->restfn;
+    self->restfn = NULL;
+    if (fn)
+        fn (self->restarg, NULL, 0);
+}
+
 static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
@@ -178,6 +429,7 @@ static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     stcp = nn_cont (self, struct nn_stcp, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+        nn_stcp_rest_done (stcp);
         nn_pipebase_stop (&stcp->pipebase);
         nn_streamhdr_stop (&stcp->streamhdr);
         stcp->state = NN_STCP_STATE_STOPPING;
@@ -204,6 +456,8 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     int rc;
     struct nn_stcp *stcp;
     uint64_t size;
+    uint64_t tstamp;
+    void *buf;
     int opt;
     size_t opt_sz = sizeof (opt);
 
@@ -220,8 +474,26 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
         case NN_FSM_ACTION:
             switch (type) {
             case NN_FSM_START:
+
+                /*  Support for fragments is only announced if the user
+                    asked for fragmenting. That way the protocol header
+                    stays all zeros by default, which is what other SP
+                    implementations insist on. */
+                nn_pipebase_getopt (&stcp->pipebase, NN_TCP,
+                    NN_TCP_FRAGMENT, &opt, &opt_sz);
+                stcp->fragsize = (size_t) opt;
+
+                /*  Ask the kernel for receive timestamps if the user wants
+                    them. Where they are not available messages simply
+                    arrive without ones. */
+                nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                    NN_RCVTIMESTAMP, &opt, &opt_sz);
+                if (opt)
+                    nn_usock_tstamp (stcp->usock);
+
                 nn_streamhdr_start (&stcp->streamhdr, stcp->usock,
-                    &stcp->pipebase);
+                    &stcp->pipebase, stcp->fragsize ?
+                    NN_STREAMHDR_FRAGMENTS : 0);
                 stcp->state = NN_STCP_STATE_PROTOHDR;
                 return;
             default:
@@ -275,6 +547,8 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
             case NN_STREAMHDR_STOPPED:
 
                  /*  Start the pipe. */
+                 nn_compress_start (&stcp->compress,
+                     stcp->streamhdr.compression);
                  rc = nn_pipebase_start (&stcp->pipebase);
                  if (nn_slow (rc < 0)) {
                     stcp->state = NN_STCP_STATE_DONE;
@@ -282,13 +556,27 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                     return;
                  }
 
-                 /*  Start receiving a message in asynchronous manner. */
-                 stcp->instate = NN_STCP_INSTATE_HDR;
-                 nn_usock_recv (stcp->usock, &stcp->inhdr,
-                     sizeof (stcp->inhdr), NULL);
+                 /*  Start receiving a message in asynchronous manner.
+                     If the handshake is pipelined the peer's protocol
+                     header comes first. */
+                 if (stcp->streamhdr.pipelined) {
+                     stcp->instate = NN_STCP_INSTATE_PROTOHDR;
+                     nn_usock_recv (stcp->usock, stcp->streamhdr.protohdr,
+                         sizeof (stcp->streamhdr.protohdr), NULL);
+                 }
+                 else {
+                     stcp->instate = NN_STCP_INSTATE_HDR;
+                     nn_usock_recv (stcp->usock, &stcp->inhdr,
+                         sizeof (stcp->inhdr), NULL);
+                 }
 
                  /*  Mark the pipe as available for sending. */
                  stcp->outstate = NN_STCP_OUTSTATE_IDLE;
+                 stcp->outqueued = 0;
+                 stcp->bulksize = 0;
+                 stcp->bulkinsize = 0;
+                 stcp->inrest = 0;
+                 stcp->outrest = 0;
 
                  stcp->state = NN_STCP_STATE_ACTIVE;
                  return;
@@ -311,17 +599,69 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_USOCK_SENT:
 
-                /*  The message is now fully sent. */
+                /*  Fragment of the large message was sent. Once it's the
+                    last one, the message can be dropped. */
+                if (stcp->outstate == NN_STCP_OUTSTATE_SENDING_FRAGMENT) {
+                    stcp->outstate = NN_STCP_OUTSTATE_IDLE;
+                    if (stcp->bulkpos == stcp->bulksize) {
+                        nn_msg_term (&stcp->bulkmsg);
+                        nn_msg_init (&stcp->bulkmsg, 0);
+                        stcp->bulksize = 0;
+                    }
+                    nn_stcp_send_next (stcp);
+                    return;
+                }
+
+                /*  Continue with the body produced by the user, if any. If
+                    it can't be produced, the peer would never get the
+                    message whole, so drop the connection. */
                 nn_assert (stcp->outstate == NN_STCP_OUTSTATE_SENDING);
+                if (nn_slow (stcp->outrest)) {
+                    rc = nn_stcp_send_rest (stcp);
+                    if (nn_slow (rc < 0)) {
+                        nn_msg_term (&stcp->outmsg);
+                        nn_msg_init (&stcp->outmsg, 0);
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done,
+                            NN_STCP_ERROR);
+                    }
+                    return;
+                }
+
+                /*  The message is now fully sent. The user may send
+                    a new message right away. If not, continue with the
+                    large message, if any. */
                 stcp->outstate = NN_STCP_OUTSTATE_IDLE;
                 nn_msg_term (&stcp->outmsg);
                 nn_msg_init (&stcp->outmsg, 0);
                 nn_pipebase_sent (&stcp->pipebase);
+                if (stcp->outstate == NN_STCP_OUTSTATE_IDLE)
+                    nn_stcp_send_next (stcp);
                 return;
 
             case NN_USOCK_RECEIVED:
 
                 switch (stcp->instate) {
+                case NN_STCP_INSTATE_PROTOHDR:
+
+                    /*  Peer's protocol header was received. If the peer is
+                        not acceptable, drop the connection along with any
+                        messages it has sent. Messages sent so far weren't
+                        compressed; from now on the codec agreed on is used. */
+                    rc = nn_streamhdr_check (&stcp->streamhdr);
+                    if (nn_slow (rc < 0)) {
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                        return;
+                    }
+                    nn_compress_start (&stcp->compress,
+                        stcp->streamhdr.compression);
+
+                    stcp->instate = NN_STCP_INSTATE_HDR;
+                    nn_usock_recv (stcp->usock, stcp->inhdr,
+                        sizeof (stcp->inhdr), NULL);
+                    return;
+
                 case NN_STCP_INSTATE_HDR:
 
                     /*  Message header was received. Check that message size
@@ -329,18 +669,118 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                         if it's too large, drop the connection. */
                     size = nn_getll (stcp->inhdr);
 
-                    nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
-                        NN_RCVMAXSIZE, &opt, &opt_sz);
+                    /*  Fragment has to fit into the large message being
+                        reassembled. Start receiving its data. */
+                    if (nn_slow (size & NN_STCP_FRAGMENT)) {
+                        size &= ~NN_STCP_FRAGMENT;
+                        if (!stcp->bulkinsize || !size ||
+                              size > stcp->bulkinsize - stcp->bulkinpos) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                        stcp->instate = NN_STCP_INSTATE_FRAGMENT;
+                        nn_usock_recv (stcp->usock,
+                            ((uint8_t*) nn_chunkref_data (
+                            &stcp->bulkin.body)) + stcp->bulkinpos,
+                            (size_t) size, NULL);
+                        return;
+                    }
+
+                    /*  Large messages are only allowed if fragmentation was
+                        agreed on, one at a time, and are never empty. */
+                    if (nn_slow (size & NN_STCP_START)) {
+                        size &= ~NN_STCP_START;
+                        if (!(stcp->streamhdr.agreed &
+                              NN_STREAMHDR_FRAGMENTS) ||
+                              stcp->bulkinsize ||
+                              !(size & ~NN_STCP_COMPRESSED)) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                    }
 
-                    if (opt >= 0 && size > (unsigned)opt) {
-                        stcp->state = NN_STCP_STATE_DONE;
-                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                    /*  Compressed messages are only allowed if a codec
+                        was agreed on, and are never empty. */
+                    if (size & NN_STCP_COMPRESSED) {
+                        size &= ~NN_STCP_COMPRESSED;
+                        if (!stcp->compress.codec || !size) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                    }
+
+                    /*  If the user waits to receive a message piece by
+                        piece, receive only the head of a large one for now.
+                        The core decides what to do with the rest once the
+                        protocol is done with the head; it also checks
+                        NN_RCVMAXSIZE if needed. */
+                    stcp->inrest = 0;
+                    if (size > NN_STCP_STREAMBUF &&
+                          !(nn_getll (stcp->inhdr) &
+                          (NN_STCP_COMPRESSED | NN_STCP_START)) &&
+                          nn_pipebase_rcvsink (&stcp->pipebase)) {
+                        stcp->inrest = (size_t) size - NN_STCP_STREAMBUF;
+                        size = NN_STCP_STREAMBUF;
+                    }
+                    else {
+                        nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                            NN_RCVMAXSIZE, &opt, &opt_sz);
+                        if (opt >= 0 && size > (unsigned)opt) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                    }
+
+                    /*  Large message is reassembled aside while whole
+                        messages keep arriving. Wait for its first
+                        fragment. */
+                    if (nn_slow (nn_getll (stcp->inhdr) & NN_STCP_START)) {
+                        nn_msg_term (&stcp->bulkin);
+                        nn_msg_init (&stcp->bulkin, (size_t) size);
+                        tstamp = nn_usock_rcvtstamp (stcp->usock);
+                        if (tstamp)
+                            nn_msg_tstamp (&stcp->bulkin, tstamp);
+                        stcp->bulkinpos = 0;
+                        stcp->bulkinsize = (size_t) size;
+                        stcp->bulkincompressed =
+                            !!(nn_getll (stcp->inhdr) & NN_STCP_COMPRESSED);
+                        nn_usock_recv (stcp->usock, stcp->inhdr,
+                            sizeof (stcp->inhdr), NULL);
                         return;
                     }
 
-                    /*  Allocate memory for the message. */
+                    /*  Allocate memory for the message. If the user is
+                        waiting with a buffer that fits, receive the body
+                        straight into it. Compressed body has to be inflated
+                        first, so it can't. The time the first byte of the
+                        header arrived is the message's receive timestamp. */
                     nn_msg_term (&stcp->inmsg);
-                    nn_msg_init (&stcp->inmsg, (size_t) size);
+                    buf = NULL;
+#if !defined NN_HAVE_WINDOWS
+                    if (size > NN_CHUNKREF_MAX && !stcp->inrest &&
+                          !(nn_getll (stcp->inhdr) & NN_STCP_COMPRESSED))
+                        buf = nn_pipebase_rcvbuf (&stcp->pipebase,
+                            (size_t) size);
+#endif
+                    if (buf) {
+                        nn_msg_init (&stcp->inmsg, 0);
+                        nn_chunkref_term (&stcp->inmsg.body);
+                        nn_chunkref_init_borrowed (&stcp->inmsg.body, buf,
+                            (size_t) size);
+                    }
+                    else
+                        nn_msg_init (&stcp->inmsg, (size_t) size);
+                    tstamp = nn_usock_rcvtstamp (stcp->usock);
+                    if (tstamp)
+                        nn_msg_tstamp (&stcp->inmsg, tstamp);
 
                     /*  Special case when size of the message body is 0. */
                     if (!size) {
@@ -359,13 +799,81 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
 
                 case NN_STCP_INSTATE_BODY:
 
-                    /*  Message body was received. Notify the owner that it
-                        can receive it. */
+                    /*  Message body was received. Restore compressed
+                        message to its original form; if that fails,
+                        drop the connection. */
+                    if (nn_getll (stcp->inhdr) & NN_STCP_COMPRESSED) {
+                        rc = nn_decompress_msg (&stcp->compress,
+                            &stcp->inmsg);
+                        if (nn_slow (rc < 0)) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                    }
+
+                    /*  Notify the owner that it can receive the message. */
                     stcp->instate = NN_STCP_INSTATE_HASMSG;
                     nn_pipebase_received (&stcp->pipebase);
 
                     return;
 
+                case NN_STCP_INSTATE_REST:
+
+                    /*  Piece of the rest of the message was received. Pass
+                        it on. If the core refuses it, drop the rest. */
+                    if (stcp->restfn && stcp->restfn (stcp->restarg,
+                          stcp->inrestbuf, stcp->inrestlen) < 0)
+                        nn_stcp_rest_done (stcp);
+                    stcp->inrest -= stcp->inrestlen;
+                    if (stcp->inrest) {
+                        nn_stcp_recv_rest (stcp);
+                        return;
+                    }
+
+                    /*  The whole message was received. Start receiving new
+                        one. */
+                    nn_stcp_rest_done (stcp);
+                    stcp->instate = NN_STCP_INSTATE_HDR;
+                    nn_usock_recv (stcp->usock, stcp->inhdr,
+                        sizeof (stcp->inhdr), NULL);
+                    return;
+
+                case NN_STCP_INSTATE_FRAGMENT:
+
+                    /*  Fragment was received. Unless it was the last one,
+                        go on with receiving the next header. */
+                    stcp->bulkinpos += (size_t)
+                        (nn_getll (stcp->inhdr) & ~NN_STCP_FRAGMENT);
+                    if (stcp->bulkinpos < stcp->bulkinsize) {
+                        stcp->instate = NN_STCP_INSTATE_HDR;
+                        nn_usock_recv (stcp->usock, stcp->inhdr,
+                            sizeof (stcp->inhdr), NULL);
+                        return;
+                    }
+
+                    /*  Large message is complete. Restore it to its
+                        original form if it was compressed and pass it to
+                        the owner. */
+                    nn_msg_term (&stcp->inmsg);
+                    nn_msg_mv (&stcp->inmsg, &stcp->bulkin);
+                    nn_msg_init (&stcp->bulkin, 0);
+                    stcp->bulkinsize = 0;
+                    if (stcp->bulkincompressed) {
+                        rc = nn_decompress_msg (&stcp->compress,
+                            &stcp->inmsg);
+                        if (nn_slow (rc < 0)) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                    }
+                    stcp->instate = NN_STCP_INSTATE_HASMSG;
+                    nn_pipebase_received (&stcp->pipebase);
+                    return;
+
                 default:
                     nn_fsm_error("Unexpected socket instate",
                         stcp->state, src, type);
@@ -30,6 +30,7 @@
 #include "../../aio/usock.h"
 
 #include "../utils/streamhdr.h"
+#include "../utils/compress.h"
 
 #include "../../utils/msg.h"
 
@@ -57,6 +58,9 @@ struct nn_stcp {
     /*  Pipe connecting this TCP connection to the nanomsg core. */
     struct nn_pipebase pipebase;
 
+    /*  Compression of the messages passed through the pipe. */
+    struct nn_compress compress;
+
     /*  State of inbound state machine. */
     int instate;
 
@@ -66,14 +70,52 @@ struct nn_stcp {
     /*  Message being received at the moment. */
     struct nn_msg inmsg;
 
+    /*  Large message being reassembled from fragments, number of its bytes
+        received so far and its total size, zero if there's none. */
+    struct nn_msg bulkin;
+    size_t bulkinpos;
+    size_t bulkinsize;
+    int bulkincompressed;
+
+    /*  If only the head of a large message was received into inmsg, number
+        of bytes of the message that are still to be received. Those are
+        received piece by piece into the buffer and passed to the function
+        supplied by the core. */
+    size_t inrest;
+    size_t inrestlen;
+    uint8_t *inrestbuf;
+    nn_stream_fn restfn;
+    void *restarg;
+
     /*  State of the outbound state machine. */
     int outstate;
 
     /*  Buffer used to store the header of outgoing message. */
     uint8_t outhdr [8];
 
-    /*  Message being sent at the moment. */
+    /*  Message being sent at the moment. If outqueued is set it waits
+        for the fragment being sent to complete. */
     struct nn_msg outmsg;
+    int outqueued;
+
+    /*  If the body of outmsg is a stream, number of its bytes that are still
+        to be sent. They are read from the stream into the buffer piece by
+        piece. */
+    size_t outrest;
+    uint8_t *outrestbuf;
+
+    /*  Messages larger than this are sent in fragments of this size if
+        the peer supports it. Zero means messages are always sent whole. */
+    size_t fragsize;
+
+    /*  Large message being sent in fragments, number of its bytes sent so
+        far and its total size, zero if there's none. Header buffer holds
+        the fragment header preceded, for the first fragment, by the
+        header announcing the whole message. */
+    struct nn_msg bulkmsg;
+    size_t bulkpos;
+    size_t bulksize;
+    uint8_t bulkhdr [16];
 
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
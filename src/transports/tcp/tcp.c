@@ -29,6 +29,7 @@
 
 #include "../utils/port.h"
 #include "../utils/iface.h"
+#include "../utils/dns.h"
 
 #include "../../utils/err.h"
 #include "../../utils/alloc.h"
@@ -43,11 +44,19 @@
 #include <unistd.h>
 #endif
 
+/*  Upper limit for NN_TCP_CONNECTIONS option. */
+#define NN_TCP_MAX_CONNECTIONS 64
+
 /*  TCP-specific socket options. */
 
 struct nn_tcp_optset {
     struct nn_optset base;
     int nodelay;
+    int reuseport;
+    int backlog;
+    int connections;
+    int local;
+    int fragment;
 };
 
 static void nn_tcp_optset_destroy (struct nn_optset *self);
@@ -62,6 +71,7 @@ static const struct nn_optset_vfptr nn_tcp_optset_vfptr = {
 };
 
 /*  nn_transport interface. */
+static void nn_tcp_term (void);
 static int nn_tcp_bind (struct nn_ep *ep);
 static int nn_tcp_connect (struct nn_ep *ep);
 static struct nn_optset *nn_tcp_optset (void);
@@ -70,12 +80,18 @@ struct nn_transport nn_tcp = {
     "tcp",
     NN_TCP,
     NULL,
-    NULL,
+    nn_tcp_term,
     nn_tcp_bind,
     nn_tcp_connect,
     nn_tcp_optset,
 };
 
+static void nn_tcp_term (void)
+{
+    /*  Drop the host names resolved by the connecting endpoints. */
+    nn_dns_purge ();
+}
+
 static int nn_tcp_bind (struct nn_ep *ep)
 {
     return nn_btcp_create (ep);
@@ -96,6 +112,14 @@ static struct nn_optset *nn_tcp_optset ()
 
     /*  Default values for TCP socket options. */
     optset->nodelay = 0;
+    optset->reuseport = 0;
+
+    /*  The backlog is set relatively high so that there are not too many
+        failed connection attempts during re-connection storms. */
+    optset->backlog = 100;
+    optset->connections = 1;
+    optset->local = 0;
+    optset->fragment = 0;
 
     return &optset->base;   
 }
@@ -127,6 +151,31 @@ static int nn_tcp_optset_setopt (struct nn_optset *self, int option,
             return -EINVAL;
         optset->nodelay = val;
         return 0;
+    case NN_TCP_REUSEPORT:
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        optset->reuseport = val;
+        return 0;
+    case NN_TCP_BACKLOG:
+        if (nn_slow (val < 1))
+            return -EINVAL;
+        optset->backlog = val;
+        return 0;
+    case NN_TCP_CONNECTIONS:
+        if (nn_slow (val < 1 || val > NN_TCP_MAX_CONNECTIONS))
+            return -EINVAL;
+        optset->connections = val;
+        return 0;
+    case NN_TCP_LOCAL:
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        optset->local = val;
+        return 0;
+    case NN_TCP_FRAGMENT:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        optset->fragment = val;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -144,6 +193,21 @@ static int nn_tcp_optset_getopt (struct nn_optset *self, int option,
     case NN_TCP_NODELAY:
         intval = optset->nodelay;
         break;
+    case NN_TCP_REUSEPORT:
+        intval = optset->reuseport;
+        break;
+    case NN_TCP_BACKLOG:
+        intval = optset->backlog;
+        break;
+    case NN_TCP_CONNECTIONS:
+        intval = optset->connections;
+        break;
+    case NN_TCP_LOCAL:
+        intval = optset->local;
+        break;
+    case NN_TCP_FRAGMENT:
+        intval = optset->fragment;
+        break;
     default:
         return -ENOPROTOOPT;
     }
@@ -0,0 +1,292 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "compress.h"
+#include "lz.h"
+
+#include "../../utils/err.h"
+#include "../../utils/chunk.h"
+#include "../../utils/clock.h"
+#include "../../utils/wire.h"
+#include "../../utils/attr.h"
+
+#if defined NN_HAVE_LZ4
+#include <lz4.h>
+#endif
+#if defined NN_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <limits.h>
+#include <string.h>
+
+/*  Length of the header holding the size of the original message. */
+#define NN_COMPRESS_HDRLEN 8
+
+/*  The fastest zstd level still compresses markedly better than LZ4 while
+    keeping the CPU cost per byte in the same ballpark. */
+#define NN_COMPRESS_ZSTD_LEVEL 1
+
+int nn_compress_codecs (void)
+{
+    int codecs;
+
+    codecs = NN_COMPRESSION_LZ;
+#if defined NN_HAVE_LZ4
+    codecs |= NN_COMPRESSION_LZ4;
+#endif
+#if defined NN_HAVE_ZSTD
+    codecs |= NN_COMPRESSION_ZSTD;
+#endif
+    return codecs;
+}
+
+int nn_compress_select (int local, int remote)
+{
+    int common;
+
+    /*  Both peers evaluate this independently so the choice must depend
+        only on the intersection of the two sets. */
+    common = local & remote;
+    if (common & NN_COMPRESSION_ZSTD)
+        return NN_COMPRESSION_ZSTD;
+    if (common & NN_COMPRESSION_LZ4)
+        return NN_COMPRESSION_LZ4;
+    if (common & NN_COMPRESSION_LZ)
+        return NN_COMPRESSION_LZ;
+    return 0;
+}
+
+static size_t nn_compress_encode (int codec, const void *src, size_t srclen,
+    void *dst, size_t dstlen)
+{
+#if defined NN_HAVE_ZSTD
+    size_t rc;
+#endif
+
+    switch (codec) {
+    case NN_COMPRESSION_LZ:
+        return nn_lz_compress (src, srclen, dst, dstlen);
+#if defined NN_HAVE_LZ4
+    case NN_COMPRESSION_LZ4:
+        if (srclen > LZ4_MAX_INPUT_SIZE)
+            return 0;
+        if (dstlen > INT_MAX)
+            dstlen = INT_MAX;
+        return (size_t) LZ4_compress_default (src, dst, (int) srclen,
+            (int) dstlen);
+#endif
+#if defined NN_HAVE_ZSTD
+    case NN_COMPRESSION_ZSTD:
+        rc = ZSTD_compress (dst, dstlen, src, srclen, NN_COMPRESS_ZSTD_LEVEL);
+        return ZSTD_isError (rc) ? 0 : rc;
+#endif
+    default:
+        nn_assert (0);
+        return 0;
+    }
+}
+
+static int nn_compress_decode (int codec, const void *src, size_t srclen,
+    void *dst, size_t dstlen)
+{
+#if defined NN_HAVE_LZ4
+    int len;
+#endif
+#if defined NN_HAVE_ZSTD
+    size_t rc;
+#endif
+
+    switch (codec) {
+    case NN_COMPRESSION_LZ:
+        return nn_lz_decompress (src, srclen, dst, dstlen);
+#if defined NN_HAVE_LZ4
+    case NN_COMPRESSION_LZ4:
+        if (srclen > INT_MAX || dstlen > INT_MAX)
+            return -EPROTO;
+        len = LZ4_decompress_safe (src, dst, (int) srclen, (int) dstlen);
+        return len == (int) dstlen ? 0 : -EPROTO;
+#endif
+#if defined NN_HAVE_ZSTD
+    case NN_COMPRESSION_ZSTD:
+        rc = ZSTD_decompress (dst, dstlen, src, srclen);
+        return !ZSTD_isError (rc) && rc == dstlen ? 0 : -EPROTO;
+#endif
+    default:
+        nn_assert (0);
+        return -EPROTO;
+    }
+}
+
+void nn_compress_init (struct nn_compress *self,
+    struct nn_pipebase *pipebase)
+{
+    self->pipebase = pipebase;
+    self->codec = 0;
+    self->threshold = 0;
+}
+
+void nn_compress_term (NN_UNUSED struct nn_compress *self)
+{
+}
+
+void nn_compress_start (struct nn_compress *self, int codec)
+{
+    int opt;
+    size_t opt_sz = sizeof (opt);
+
+    nn_assert (codec == 0 || (codec & nn_compress_codecs ()) == codec);
+    self->codec = codec;
+
+    nn_pipebase_getopt (self->pipebase, NN_SOL_SOCKET,
+        NN_COMPRESSION_THRESHOLD, &opt, &opt_sz);
+    nn_assert (opt_sz == sizeof (opt) && opt >= 0);
+    self->threshold = (size_t) opt;
+}
+
+int nn_compress_msg (struct nn_compress *self, struct nn_msg *msg)
+{
+    int rc;
+    size_t sphdrlen;
+    size_t bodylen;
+    size_t srclen;
+    size_t len;
+    struct nn_chunkref src;
+    const void *data;
+    void *chunk;
+    uint64_t start;
+
+    if (!self->codec)
+        return 0;
+
+    /*  Compressed form of tiny messages can never be shorter. */
+    sphdrlen = nn_chunkref_size (&msg->sphdr);
+    bodylen = nn_chunkref_size (&msg->body);
+    srclen = sphdrlen + bodylen;
+    if (srclen < self->threshold || srclen <= NN_COMPRESS_HDRLEN + 1)
+        return 0;
+
+    start = nn_clock_us ();
+
+    /*  Codecs need contiguous input. SP headers are short and present only
+        with some protocols, so copying the message is the rare case. */
+    if (sphdrlen) {
+        nn_chunkref_init (&src, srclen);
+        memcpy (nn_chunkref_data (&src), nn_chunkref_data (&msg->sphdr),
+            sphdrlen);
+        memcpy ((uint8_t*) nn_chunkref_data (&src) + sphdrlen,
+            nn_chunkref_data (&msg->body), bodylen);
+        data = nn_chunkref_data (&src);
+    }
+    else {
+        nn_chunkref_init (&src, 0);
+        data = nn_chunkref_data (&msg->body);
+    }
+
+    /*  The output buffer is one byte shorter than the original message so
+        that the codec gives up early on data that doesn't compress. */
+    rc = nn_chunk_alloc (srclen - 1, 0, &chunk);
+    errnum_assert (rc == 0, -rc);
+    len = nn_compress_encode (self->codec, data, srclen,
+        (uint8_t*) chunk + NN_COMPRESS_HDRLEN,
+        srclen - 1 - NN_COMPRESS_HDRLEN);
+    nn_chunkref_term (&src);
+
+    nn_pipebase_stat_increment (self->pipebase, NN_STAT_COMPRESSION_TIME,
+        (int64_t) (nn_clock_us () - start));
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_COMPRESSION_MESSAGES, 1);
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_COMPRESSION_BYTES_IN, (int64_t) srclen);
+
+    if (!len) {
+        nn_chunk_free (chunk);
+        nn_pipebase_stat_increment (self->pipebase,
+            NN_STAT_COMPRESSION_BYTES_OUT, (int64_t) srclen);
+        return 0;
+    }
+
+    /*  Shrinking a chunk never moves it. */
+    nn_putll (chunk, (uint64_t) srclen);
+    rc = nn_chunk_realloc (NN_COMPRESS_HDRLEN + len, &chunk);
+    errnum_assert (rc == 0, -rc);
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_COMPRESSION_BYTES_OUT, (int64_t) (NN_COMPRESS_HDRLEN + len));
+
+    nn_chunkref_term (&msg->sphdr);
+    nn_chunkref_init (&msg->sphdr, 0);
+    nn_chunkref_term (&msg->body);
+    nn_chunkref_init_chunk (&msg->body, chunk);
+
+    return 1;
+}
+
+int nn_decompress_buf (struct nn_compress *self, const void *src,
+    size_t srclen, struct nn_chunkref *dst)
+{
+    int rc;
+    uint64_t size;
+    uint64_t start;
+    int opt;
+    size_t opt_sz = sizeof (opt);
+
+    /*  Compressed messages are only valid once a codec was agreed on. */
+    if (!self->codec || srclen < NN_COMPRESS_HDRLEN)
+        return -EPROTO;
+
+    size = nn_getll (src);
+    nn_pipebase_getopt (self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &opt, &opt_sz);
+    if (opt >= 0 && size > (unsigned) opt)
+        return -EMSGSIZE;
+
+    start = nn_clock_us ();
+    nn_chunkref_init (dst, (size_t) size);
+    rc = nn_compress_decode (self->codec,
+        (const uint8_t*) src + NN_COMPRESS_HDRLEN, srclen - NN_COMPRESS_HDRLEN,
+        nn_chunkref_data (dst), (size_t) size);
+    nn_pipebase_stat_increment (self->pipebase, NN_STAT_DECOMPRESSION_TIME,
+        (int64_t) (nn_clock_us () - start));
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_DECOMPRESSION_MESSAGES, 1);
+    if (nn_slow (rc < 0)) {
+        nn_chunkref_term (dst);
+        return rc;
+    }
+
+    return 0;
+}
+
+int nn_decompress_msg (struct nn_compress *self, struct nn_msg *msg)
+{
+    int rc;
+    struct nn_chunkref body;
+
+    rc = nn_decompress_buf (self, nn_chunkref_data (&msg->body),
+        nn_chunkref_size (&msg->body), &body);
+    if (nn_slow (rc < 0))
+        return rc;
+    nn_chunkref_term (&msg->body);
+    nn_chunkref_mv (&msg->body, &body);
+
+    return 0;
+}
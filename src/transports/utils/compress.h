@@ -0,0 +1,81 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_COMPRESS_INCLUDED
+#define NN_COMPRESS_INCLUDED
+
+#include "../../transport.h"
+
+#include "../../utils/chunkref.h"
+#include "../../utils/msg.h"
+
+#include <stddef.h>
+
+/*  Per-connection message compression. Peers advertise the NN_COMPRESSION_*
+    codecs they are willing to use when the connection is being established
+    and agree on one of them. Afterwards each message larger than
+    NN_COMPRESSION_THRESHOLD is compressed on its own, and transports mark
+    compressed messages in their framing. A compressed message is the 64-bit
+    size of the original message followed by the codec output. */
+
+/*  Returns the set of codecs supported by this build. */
+int nn_compress_codecs (void);
+
+/*  Chooses the codec to use given the sets of codecs offered by both peers.
+    Returns zero if they have no codec in common. */
+int nn_compress_select (int local, int remote);
+
+struct nn_compress {
+
+    /*  Pipe the compressed messages travel through. */
+    struct nn_pipebase *pipebase;
+
+    /*  Codec agreed on with the peer, zero if compression is off. */
+    int codec;
+
+    /*  Messages shorter than this are sent as they are. */
+    size_t threshold;
+};
+
+void nn_compress_init (struct nn_compress *self,
+    struct nn_pipebase *pipebase);
+void nn_compress_term (struct nn_compress *self);
+
+/*  Starts compressing with the specified codec, zero meaning that the
+    connection doesn't use compression. */
+void nn_compress_start (struct nn_compress *self, int codec);
+
+/*  Returns 1 if the message is worth compressing and was replaced by its
+    compressed form, 0 if it was left intact. */
+int nn_compress_msg (struct nn_compress *self, struct nn_msg *msg);
+
+/*  Decompresses 'srclen' bytes received from the peer into a newly
+    initialised 'dst'. Returns -EPROTO if the data is malformed or
+    -EMSGSIZE if the original message exceeds NN_RCVMAXSIZE; 'dst' is left
+    uninitialised in such case. */
+int nn_decompress_buf (struct nn_compress *self, const void *src,
+    size_t srclen, struct nn_chunkref *dst);
+
+/*  Same as above, replacing the body of the message in place. */
+int nn_decompress_msg (struct nn_compress *self, struct nn_msg *msg);
+
+#endif
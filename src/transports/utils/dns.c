@@ -23,8 +23,62 @@
 #include "dns.h"
 
 #include "../../utils/err.h"
+#include "../../utils/alloc.h"
+#include "../../utils/list.h"
+#include "../../utils/cont.h"
+#include "../../utils/mutex.h"
+#include "../../utils/once.h"
+#include "../../utils/clock.h"
 
 #include <string.h>
+#include <stdlib.h>
+
+#ifndef NN_HAVE_WINDOWS
+#include <netinet/in.h>
+#include <netdb.h>
+#endif
+
+/*  Maximum number of hostnames kept in the lookup cache. */
+#define NN_DNS_CACHE_MAX 64
+
+/*  Default time, in milliseconds, for which the lookup results are cached.
+    Can be overridden by NN_DNS_CACHE_TTL environment variable. */
+#define NN_DNS_CACHE_TTL 10000
+
+/*  Cached result of a lookup of a single hostname. While the lookup is in
+    progress 'leader' points to the nn_dns object doing the lookup and
+    other objects asking for the same name wait in the 'waiters' list. */
+struct nn_dns_entry {
+    struct nn_list_item item;
+    char hostname [NN_SOCKADDR_MAX];
+    int ipv4only;
+    uint64_t expiry;
+    struct nn_dns *leader;
+    struct nn_list waiters;
+    struct nn_dns_result result;
+};
+
+/*  The process-wide lookup cache, shared by all the endpoints. */
+static struct {
+    struct nn_mutex sync;
+    struct nn_list entries;
+    int nentries;
+    int ttl;
+} nn_dns_cache;
+static nn_once_t nn_dns_cache_once = NN_ONCE_INITIALIZER;
+
+/*  Private functions. */
+static int nn_dns_isv4 (const struct sockaddr *addr);
+static void nn_dns_store (struct nn_dns_result *result,
+    const struct addrinfo *reply);
+static void nn_dns_cache_init (void);
+static void nn_dns_cache_lock (void);
+static void nn_dns_cache_unlock (void);
+static struct nn_dns_entry *nn_dns_cache_find (const char *hostname,
+    int ipv4only);
+static struct nn_dns_entry *nn_dns_cache_add (const char *hostname,
+    int ipv4only);
+static void nn_dns_cache_rm (struct nn_dns_entry *entry);
 
 int nn_dns_check_hostname (const char *name, size_t namelen)
 {
@@ -83,6 +137,184 @@ int nn_dns_check_hostname (const char *name, size_t namelen)
     }
 }
 
+static int nn_dns_isv4 (const struct sockaddr *addr)
+{
+    if (addr->sa_family == AF_INET)
+        return 1;
+    if (addr->sa_family == AF_INET6 && IN6_IS_ADDR_V4MAPPED (
+          &((const struct sockaddr_in6*) addr)->sin6_addr))
+        return 1;
+    return 0;
+}
+
+/*  Copies the addresses returned by getaddrinfo into the result. Duplicates
+    are dropped and IPv6 and IPv4 addresses are interleaved, starting with
+    the family of the first returned address (RFC 8305, section 4). That way
+    the connecting side doesn't wait for all the addresses of a broken
+    family to time out before trying the other one. */
+static void nn_dns_store (struct nn_dns_result *result,
+    const struct addrinfo *reply)
+{
+    const struct addrinfo *it;
+    const struct addrinfo *fams [2][NN_DNS_MAX_ADDRS];
+    int nfams [2];
+    int pos [2];
+    int fam;
+    int first;
+    int dup;
+    int i;
+
+    nfams [0] = nfams [1] = 0;
+    first = -1;
+    for (it = reply; it; it = it->ai_next) {
+        if (it->ai_addrlen > sizeof (struct sockaddr_storage))
+            continue;
+        fam = nn_dns_isv4 (it->ai_addr);
+        if (first < 0)
+            first = fam;
+        if (nfams [fam] == NN_DNS_MAX_ADDRS)
+            continue;
+        dup = 0;
+        for (i = 0; i != nfams [fam]; ++i) {
+            if (fams [fam][i]->ai_addrlen == it->ai_addrlen &&
+                  memcmp (fams [fam][i]->ai_addr, it->ai_addr,
+                  it->ai_addrlen) == 0) {
+                dup = 1;
+                break;
+            }
+        }
+        if (!dup)
+            fams [fam][nfams [fam]++] = it;
+    }
+
+    result->naddrs = 0;
+    pos [0] = pos [1] = 0;
+    fam = first;
+    while (result->naddrs != NN_DNS_MAX_ADDRS &&
+          (pos [0] != nfams [0] || pos [1] != nfams [1])) {
+        if (pos [fam] != nfams [fam]) {
+            it = fams [fam][pos [fam]++];
+            memcpy (&result->addr [result->naddrs], it->ai_addr,
+                it->ai_addrlen);
+            result->addrlen [result->naddrs] = (size_t) it->ai_addrlen;
+            ++result->naddrs;
+        }
+        fam = !fam;
+    }
+    result->error = result->naddrs ? 0 : EINVAL;
+}
+
+static void nn_dns_cache_init (void)
+{
+    char *envvar;
+
+    nn_mutex_init (&nn_dns_cache.sync);
+    nn_list_init (&nn_dns_cache.entries);
+    nn_dns_cache.nentries = 0;
+
+    /*  Zero TTL disables caching. Lookups that are already under way are
+        still shared, though. */
+    nn_dns_cache.ttl = NN_DNS_CACHE_TTL;
+    envvar = getenv ("NN_DNS_CACHE_TTL");
+    if (envvar && *envvar) {
+        nn_dns_cache.ttl = atoi (envvar);
+        if (nn_dns_cache.ttl < 0)
+            nn_dns_cache.ttl = 0;
+    }
+}
+
+static void nn_dns_cache_lock (void)
+{
+    nn_do_once (&nn_dns_cache_once, nn_dns_cache_init);
+    nn_mutex_lock (&nn_dns_cache.sync);
+}
+
+static void nn_dns_cache_unlock (void)
+{
+    nn_mutex_unlock (&nn_dns_cache.sync);
+}
+
+static struct nn_dns_entry *nn_dns_cache_find (const char *hostname,
+    int ipv4only)
+{
+    uint64_t now;
+    struct nn_list_item *it;
+    struct nn_dns_entry *entry;
+
+    now = nn_clock_ms ();
+    it = nn_list_begin (&nn_dns_cache.entries);
+    while (it != nn_list_end (&nn_dns_cache.entries)) {
+        entry = nn_cont (it, struct nn_dns_entry, item);
+        it = nn_list_next (&nn_dns_cache.entries, it);
+
+        /*  Drop the expired entries on the way. */
+        if (!entry->leader && entry->expiry <= now) {
+            nn_dns_cache_rm (entry);
+            continue;
+        }
+
+        if (entry->ipv4only == ipv4only &&
+              strcmp (entry->hostname, hostname) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+static struct nn_dns_entry *nn_dns_cache_add (const char *hostname,
+    int ipv4only)
+{
+    struct nn_list_item *it;
+    struct nn_dns_entry *entry;
+
+    /*  If the cache is full, evict the oldest entry that is not being
+        resolved at the moment. */
+    if (nn_dns_cache.nentries >= NN_DNS_CACHE_MAX) {
+        for (it = nn_list_begin (&nn_dns_cache.entries);
+              it != nn_list_end (&nn_dns_cache.entries);
+              it = nn_list_next (&nn_dns_cache.entries, it)) {
+            entry = nn_cont (it, struct nn_dns_entry, item);
+            if (!entry->leader) {
+                nn_dns_cache_rm (entry);
+                break;
+            }
+        }
+    }
+
+    entry = nn_alloc (sizeof (struct nn_dns_entry), "dns cache entry");
+    alloc_assert (entry);
+    nn_list_item_init (&entry->item);
+    nn_assert (strlen (hostname) < sizeof (entry->hostname));
+    strcpy (entry->hostname, hostname);
+    entry->ipv4only = ipv4only;
+    entry->expiry = 0;
+    entry->leader = NULL;
+    nn_list_init (&entry->waiters);
+    memset (&entry->result, 0, sizeof (entry->result));
+    nn_list_insert (&nn_dns_cache.entries, &entry->item,
+        nn_list_end (&nn_dns_cache.entries));
+    ++nn_dns_cache.nentries;
+    return entry;
+}
+
+static void nn_dns_cache_rm (struct nn_dns_entry *entry)
+{
+    nn_assert (!entry->leader);
+    nn_list_term (&entry->waiters);
+    nn_list_erase (&nn_dns_cache.entries, &entry->item);
+    nn_list_item_term (&entry->item);
+    nn_free (entry);
+    --nn_dns_cache.nentries;
+}
+
+void nn_dns_purge (void)
+{
+    nn_dns_cache_lock ();
+    while (!nn_list_empty (&nn_dns_cache.entries))
+        nn_dns_cache_rm (nn_cont (nn_list_begin (&nn_dns_cache.entries),
+            struct nn_dns_entry, item));
+    nn_dns_cache_unlock ();
+}
+
 #if defined NN_HAVE_GETADDRINFO_A && !defined NN_DISABLE_GETADDRINFO_A
 #include "dns_getaddrinfo_a.inc"
 #else
@@ -41,10 +41,24 @@ int nn_dns_check_hostname (const char *name, size_t namelen);
 #include "dns_getaddrinfo.h"
 #endif
 
+/*  Maximum number of addresses kept from a single lookup. */
+#define NN_DNS_MAX_ADDRS 8
+
+/*  Where the result came from: the address was a literal, the lookup was
+    served from the process-wide cache (or shared with a lookup of the same
+    name that was already under way), or an actual lookup was done. */
+#define NN_DNS_LITERAL 1
+#define NN_DNS_CACHED 2
+#define NN_DNS_RESOLVED 3
+
+/*  Resolved addresses are stored in the order they should be tried in.
+    Literal addresses always yield exactly one entry. */
 struct nn_dns_result {
     int error;
-    struct sockaddr_storage addr;
-    size_t addrlen;
+    int origin;
+    int naddrs;
+    struct sockaddr_storage addr [NN_DNS_MAX_ADDRS];
+    size_t addrlen [NN_DNS_MAX_ADDRS];
 };
 
 void nn_dns_init (struct nn_dns *self, int src, struct nn_fsm *owner);
@@ -55,4 +69,8 @@ void nn_dns_start (struct nn_dns *self, const char *addr, size_t addrlen,
     int ipv4only, struct nn_dns_result *result);
 void nn_dns_stop (struct nn_dns *self);
 
+/*  Drops all the cached lookup results. There must be no lookups in progress.
+    Called when the library is being terminated. */
+void nn_dns_purge (void);
+
 #endif
@@ -24,6 +24,8 @@
 
 #include "../../nn.h"
 
+#include "../../utils/list.h"
+
 #if defined NN_HAVE_WINDOWS
 #include "../../utils/win.h"
 #else
@@ -39,5 +41,12 @@ struct nn_dns {
     struct gaicb gcb;
     struct nn_dns_result *result;
     struct nn_fsm_event done;
+
+    /*  Cache entry of the lookup this object is doing or waiting for.
+        NULL once the lookup is finished. Guarded by the cache lock. */
+    struct nn_dns_entry *entry;
+
+    /*  Item in the list of objects waiting for another object's lookup. */
+    struct nn_list_item item;
 };
 
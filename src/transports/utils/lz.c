@@ -0,0 +1,267 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "lz.h"
+
+#include "../../utils/err.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*  Shortest back-reference worth encoding. */
+#define NN_LZ_MINMATCH 4
+
+/*  Back-references can reach at most this far. */
+#define NN_LZ_MAXOFFSET 65535
+
+/*  Largest hash table used by the compressor, log2 of the number of
+    entries. Smaller inputs use smaller tables to keep clearing them cheap. */
+#define NN_LZ_HASHLOG 12
+#define NN_LZ_MINHASHLOG 8
+
+/*  After this many bytes without finding a match, the compressor starts
+    skipping ahead faster so that incompressible data is cheap to reject. */
+#define NN_LZ_SKIPSTRENGTH 6
+
+static uint32_t nn_lz_read32 (const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy (&v, p, sizeof (v));
+    return v;
+}
+
+static uint32_t nn_lz_hash (uint32_t v, int hashlog)
+{
+    return (v * 2654435761U) >> (32 - hashlog);
+}
+
+/*  Writes the extension bytes of a length that didn't fit into its 4-bit
+    field of the token. Returns NULL if there's not enough room. */
+static uint8_t *nn_lz_putlen (uint8_t *op, uint8_t *oend, size_t len)
+{
+    while (len >= 255) {
+        if (op >= oend)
+            return NULL;
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend)
+        return NULL;
+    *op++ = (uint8_t) len;
+    return op;
+}
+
+/*  Emits a token with 'litlen' literals starting at 'lit' followed by
+    a back-reference. If 'matchlen' is zero this is the final token and no
+    back-reference is written. */
+static uint8_t *nn_lz_emit (uint8_t *op, uint8_t *oend, const uint8_t *lit,
+    size_t litlen, size_t offset, size_t matchlen)
+{
+    uint8_t *token;
+    size_t mlcode;
+
+    if (op >= oend)
+        return NULL;
+    token = op++;
+    mlcode = matchlen ? matchlen - NN_LZ_MINMATCH : 0;
+    *token = (uint8_t) ((litlen < 15 ? litlen : 15) << 4 |
+        (mlcode < 15 ? mlcode : 15));
+
+    if (litlen >= 15) {
+        op = nn_lz_putlen (op, oend, litlen - 15);
+        if (!op)
+            return NULL;
+    }
+    if ((size_t) (oend - op) < litlen)
+        return NULL;
+    memcpy (op, lit, litlen);
+    op += litlen;
+
+    if (!matchlen)
+        return op;
+
+    if (oend - op < 2)
+        return NULL;
+    *op++ = (uint8_t) (offset & 0xff);
+    *op++ = (uint8_t) (offset >> 8);
+    if (mlcode >= 15) {
+        op = nn_lz_putlen (op, oend, mlcode - 15);
+        if (!op)
+            return NULL;
+    }
+    return op;
+}
+
+size_t nn_lz_compress (const void *src, size_t srclen, void *dst,
+    size_t dstlen)
+{
+    uint32_t table [1 << NN_LZ_HASHLOG];
+    int hashlog;
+    const uint8_t *base;
+    const uint8_t *ip;
+    const uint8_t *anchor;
+    const uint8_t *end;
+    const uint8_t *limit;
+    const uint8_t *ref;
+    uint8_t *op;
+    uint8_t *oend;
+    uint32_t seq;
+    uint32_t h;
+    size_t matchlen;
+
+    base = src;
+    ip = base;
+    anchor = base;
+    end = base + srclen;
+    op = dst;
+    oend = op + dstlen;
+
+    /*  Pick a table size proportional to the input. */
+    hashlog = NN_LZ_MINHASHLOG;
+    while (hashlog < NN_LZ_HASHLOG && ((size_t) 1 << hashlog) < srclen)
+        ++hashlog;
+    memset (table, 0, sizeof (uint32_t) << hashlog);
+
+    /*  Positions are stored as 32-bit offsets from the start of the input;
+        longer inputs are simply stored as literals past that point. */
+    limit = srclen > NN_LZ_MINMATCH ? end - NN_LZ_MINMATCH : base;
+    if (srclen > UINT32_MAX)
+        limit = base + UINT32_MAX - NN_LZ_MINMATCH;
+
+    while (ip < limit) {
+        seq = nn_lz_read32 (ip);
+        h = nn_lz_hash (seq, hashlog);
+        ref = base + table [h];
+        table [h] = (uint32_t) (ip - base);
+
+        if (ref >= ip || ip - ref > NN_LZ_MAXOFFSET ||
+              nn_lz_read32 (ref) != seq) {
+            ip += 1 + ((ip - anchor) >> NN_LZ_SKIPSTRENGTH);
+            continue;
+        }
+
+        /*  Extend the match as far as possible. */
+        matchlen = NN_LZ_MINMATCH;
+        while (ip + matchlen < end && ref [matchlen] == ip [matchlen])
+            ++matchlen;
+
+        op = nn_lz_emit (op, oend, anchor, ip - anchor, ip - ref, matchlen);
+        if (!op)
+            return 0;
+        ip += matchlen;
+        anchor = ip;
+    }
+
+    op = nn_lz_emit (op, oend, anchor, end - anchor, 0, 0);
+    if (!op)
+        return 0;
+    return op - (uint8_t*) dst;
+}
+
+/*  Reads the extension bytes of a length. Returns NULL if the input
+    ends prematurely. */
+static const uint8_t *nn_lz_getlen (const uint8_t *ip, const uint8_t *iend,
+    size_t *len)
+{
+    uint8_t b;
+
+    do {
+        if (ip >= iend)
+            return NULL;
+        b = *ip++;
+        *len += b;
+    } while (b == 255);
+    return ip;
+}
+
+int nn_lz_decompress (const void *src, size_t srclen, void *dst,
+    size_t dstlen)
+{
+    const uint8_t *ip;
+    const uint8_t *iend;
+    uint8_t *op;
+    uint8_t *ostart;
+    uint8_t *oend;
+    const uint8_t *ref;
+    uint8_t token;
+    size_t litlen;
+    size_t matchlen;
+    size_t offset;
+
+    ip = src;
+    iend = ip + srclen;
+    ostart = dst;
+    op = ostart;
+    oend = op + dstlen;
+
+    while (1) {
+        if (ip >= iend)
+            return -EPROTO;
+        token = *ip++;
+
+        /*  Copy the literals. */
+        litlen = token >> 4;
+        if (litlen == 15) {
+            ip = nn_lz_getlen (ip, iend, &litlen);
+            if (!ip)
+                return -EPROTO;
+        }
+        if ((size_t) (iend - ip) < litlen || (size_t) (oend - op) < litlen)
+            return -EPROTO;
+        memcpy (op, ip, litlen);
+        ip += litlen;
+        op += litlen;
+
+        /*  The last token has no back-reference. */
+        if (ip == iend)
+            break;
+
+        /*  Copy the back-reference. Source and destination may overlap
+            so the copy is done byte by byte in that case. */
+        if (iend - ip < 2)
+            return -EPROTO;
+        offset = ip [0] | ((size_t) ip [1] << 8);
+        ip += 2;
+        matchlen = token & 0x0f;
+        if (matchlen == 15) {
+            ip = nn_lz_getlen (ip, iend, &matchlen);
+            if (!ip)
+                return -EPROTO;
+        }
+        matchlen += NN_LZ_MINMATCH;
+        if (offset == 0 || offset > (size_t) (op - ostart) ||
+              (size_t) (oend - op) < matchlen)
+            return -EPROTO;
+        ref = op - offset;
+        if (offset >= matchlen) {
+            memcpy (op, ref, matchlen);
+            op += matchlen;
+        }
+        else {
+            while (matchlen--)
+                *op++ = *ref++;
+        }
+    }
+
+    return op == oend ? 0 : -EPROTO;
+}
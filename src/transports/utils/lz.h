@@ -0,0 +1,43 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_LZ_INCLUDED
+#define NN_LZ_INCLUDED
+
+#include <stddef.h>
+
+/*  Small LZ77 block codec used when no external compression library is
+    available. The format is a sequence of tokens, each followed by a run of
+    literals and, except for the last one, a back-reference into the last
+    64kB of output. It is tuned for speed rather than ratio. */
+
+/*  Compresses 'srclen' bytes into 'dst'. Returns size of compressed data or
+    zero if it doesn't fit into 'dstlen' bytes. */
+size_t nn_lz_compress (const void *src, size_t srclen, void *dst,
+    size_t dstlen);
+
+/*  Decompresses 'srclen' bytes into 'dst'. Returns zero if the data
+    decompressed into exactly 'dstlen' bytes, -EPROTO if it's malformed. */
+int nn_lz_decompress (const void *src, size_t srclen, void *dst,
+    size_t dstlen);
+
+#endif
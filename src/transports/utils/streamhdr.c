@@ -22,6 +22,7 @@
 */
 
 #include "streamhdr.h"
+#include "compress.h"
 
 #include "../../aio/timer.h"
 
@@ -64,6 +65,11 @@ void nn_streamhdr_init (struct nn_streamhdr *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     self->pipebase = NULL;
+    self->codecs = 0;
+    self->compression = 0;
+    self->features = 0;
+    self->agreed = 0;
+    self->pipelined = 0;
 }
 
 void nn_streamhdr_term (struct nn_streamhdr *self)
@@ -81,7 +87,7 @@ int nn_streamhdr_isidle (struct nn_streamhdr *self)
 }
 
 void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
-    struct nn_pipebase *pipebase)
+    struct nn_pipebase *pipebase, int features)
 {
     size_t sz;
     int protocol;
@@ -99,9 +105,29 @@ void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
     nn_pipebase_getopt (pipebase, NN_SOL_SOCKET, NN_PROTOCOL, &protocol, &sz);
     nn_assert (sz == sizeof (protocol));
 
-    /*  Compose the protocol header. */
+    /*  Get the compression codecs this endpoint is willing to use. */
+    sz = sizeof (self->codecs);
+    nn_pipebase_getopt (pipebase, NN_SOL_SOCKET, NN_COMPRESSION,
+        &self->codecs, &sz);
+    nn_assert (sz == sizeof (self->codecs));
+    self->compression = 0;
+    self->features = features;
+    self->agreed = 0;
+
+    /*  Find out whether to wait for the peer's header. */
+    sz = sizeof (self->pipelined);
+    nn_pipebase_getopt (pipebase, NN_SOL_SOCKET, NN_PIPELINED_HANDSHAKE,
+        &self->pipelined, &sz);
+    nn_assert (sz == sizeof (self->pipelined));
+
+    /*  Compose the protocol header. The reserved bytes carry the set of
+        compression codecs and the optional features. Older peers send zeros
+        there and don't look at them, so neither is ever agreed on with
+        them. */
     memcpy (self->protohdr, "\0SP\0\0\0\0\0", 8);
     nn_puts (self->protohdr + 4, (uint16_t) protocol);
+    self->protohdr [6] = (uint8_t) self->codecs;
+    self->protohdr [7] = (uint8_t) self->features;
 
     /*  Launch the state machine. */
     nn_fsm_start (&self->fsm);
@@ -112,6 +138,23 @@ void nn_streamhdr_stop (struct nn_streamhdr *self)
     nn_fsm_stop (&self->fsm);
 }
 
+int nn_streamhdr_check (struct nn_streamhdr *self)
+{
+    int protocol;
+
+    /*  Here we are checking whether the peer speaks the same protocol as
+        this socket. */
+    if (memcmp (self->protohdr, "\0SP\0", 4) != 0)
+        return -EPROTO;
+    protocol = nn_gets (self->protohdr + 4);
+    if (!nn_pipebase_ispeer (self->pipebase, protocol))
+        return -EPROTO;
+
+    self->compression = nn_compress_select (self->codecs, self->protohdr [6]);
+    self->agreed = self->features & self->protohdr [7];
+    return 0;
+}
+
 static void nn_streamhdr_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
@@ -139,7 +182,6 @@ static void nn_streamhdr_handler (struct nn_fsm *self, int src, int type,
 {
     struct nn_streamhdr *streamhdr;
     struct nn_iovec iovec;
-    int protocol;
 
     streamhdr = nn_cont (self, struct nn_streamhdr, fsm);
 
@@ -178,6 +220,15 @@ static void nn_streamhdr_handler (struct nn_fsm *self, int src, int type,
         case NN_STREAMHDR_SRC_USOCK:
             switch (type) {
             case NN_USOCK_SENT:
+
+                /*  In pipelined mode the owner receives the peer's header
+                    itself, thus it can start sending messages right away. */
+                if (streamhdr->pipelined) {
+                    nn_timer_stop (&streamhdr->timer);
+                    streamhdr->state = NN_STREAMHDR_STATE_STOPPING_TIMER_DONE;
+                    return;
+                }
+
                 nn_usock_recv (streamhdr->usock, streamhdr->protohdr,
                     sizeof (streamhdr->protohdr), NULL);
                 streamhdr->state = NN_STREAMHDR_STATE_RECEIVING;
@@ -216,13 +267,7 @@ static void nn_streamhdr_handler (struct nn_fsm *self, int src, int type,
         case NN_STREAMHDR_SRC_USOCK:
             switch (type) {
             case NN_USOCK_RECEIVED:
-
-                /*  Here we are checking whether the peer speaks the same
-                    protocol as this socket. */
-                if (memcmp (streamhdr->protohdr, "\0SP\0", 4) != 0)
-                    goto invalidhdr;
-                protocol = nn_gets (streamhdr->protohdr + 4);
-                if (!nn_pipebase_ispeer (streamhdr->pipebase, protocol))
+                if (nn_streamhdr_check (streamhdr) < 0)
                     goto invalidhdr;
                 nn_timer_stop (&streamhdr->timer);
                 streamhdr->state = NN_STREAMHDR_STATE_STOPPING_TIMER_DONE;
@@ -36,6 +36,11 @@
 #define NN_STREAMHDR_ERROR 2
 #define NN_STREAMHDR_STOPPED 3
 
+/*  Optional features announced in the second reserved byte of the protocol
+    header. A feature is used only if both peers announce it. */
+#define NN_STREAMHDR_SHMEM 0x01
+#define NN_STREAMHDR_FRAGMENTS 0x02
+
 struct nn_streamhdr {
 
     /*  The state machine. */
@@ -57,6 +62,23 @@ struct nn_streamhdr {
     /*  Protocol header. */
     uint8_t protohdr [8];
 
+    /*  Compression codecs offered to the peer. */
+    int codecs;
+
+    /*  Compression codec agreed on with the peer. Valid once the exchange
+        has succeeded, zero if messages are not to be compressed. */
+    int compression;
+
+    /*  Optional features offered to the peer and, once the exchange has
+        succeeded, the subset of them the peer offered as well. */
+    int features;
+    int agreed;
+
+    /*  If set, the exchange succeeds as soon as the local header is sent.
+        The owner then receives the peer's header into 'protohdr' ahead of
+        the first message and checks it using nn_streamhdr_check. */
+    int pipelined;
+
     /*  Event fired when the state machine ends. */
     struct nn_fsm_event done;
 };
@@ -67,7 +89,11 @@ void nn_streamhdr_term (struct nn_streamhdr *self);
 
 int nn_streamhdr_isidle (struct nn_streamhdr *self);
 void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
-    struct nn_pipebase *pipebase);
+    struct nn_pipebase *pipebase, int features);
 void nn_streamhdr_stop (struct nn_streamhdr *self);
 
+/*  Checks the peer's protocol header stored in 'protohdr' and works out
+    the options agreed on. Returns -EPROTO if the peer is not acceptable. */
+int nn_streamhdr_check (struct nn_streamhdr *self);
+
 #endif
@@ -383,9 +383,14 @@ static void nn_cws_handler (struct nn_fsm *self, int src, int type,
         case NN_CWS_SRC_DNS:
             switch (type) {
             case NN_DNS_STOPPED:
+                if (cws->dns_result.origin == NN_DNS_CACHED)
+                    nn_ep_stat_increment (cws->ep, NN_STAT_DNS_CACHE_HITS, 1);
+                else if (cws->dns_result.origin == NN_DNS_RESOLVED)
+                    nn_ep_stat_increment (cws->ep,
+                        NN_STAT_DNS_CACHE_MISSES, 1);
                 if (cws->dns_result.error == 0) {
-                    nn_cws_start_connecting (cws, &cws->dns_result.addr,
-                        cws->dns_result.addrlen);
+                    nn_cws_start_connecting (cws, &cws->dns_result.addr [0],
+                        cws->dns_result.addrlen [0]);
                     return;
                 }
                 nn_backoff_start (&cws->retry);
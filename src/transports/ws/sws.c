@@ -23,6 +23,8 @@
 */
 
 #include "sws.h"
+#include "ws_mask.h"
+#include "ws_utf8.h"
 #include "../../ws.h"
 #include "../../nn.h"
 
@@ -56,6 +58,13 @@
 /*  Possible states of the outbound part of the object. */
 #define NN_SWS_OUTSTATE_IDLE 1
 #define NN_SWS_OUTSTATE_SENDING 2
+#define NN_SWS_OUTSTATE_FLUSHING 3
+#define NN_SWS_OUTSTATE_CLOSING 4
+
+/*  Size of the buffer the frames of small queued messages are copied to, and
+    the largest message that is copied there rather than written in place. */
+#define NN_SWS_BATCH_SIZE 16384
+#define NN_SWS_BATCH_MSG_SIZE 1024
 
 /*  Subordinate srcptr objects. */
 #define NN_SWS_SRC_USOCK 1
@@ -95,16 +104,15 @@
 #define NN_SWS_CLOSE_ERR_EXTENSION 1010
 #define NN_SWS_CLOSE_ERR_SERVER 1011
 
-/*  UTF-8 validation. */
-#define NN_SWS_UTF8_INVALID -2
-#define NN_SWS_UTF8_FRAGMENT -1
-
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg);
+static void nn_sws_release (struct nn_pipebase *self);
 const struct nn_pipebase_vfptr nn_sws_pipebase_vfptr = {
     nn_sws_send,
-    nn_sws_recv
+    nn_sws_recv,
+    nn_sws_release,
+    NULL
 };
 
 /*  Private functions. */
@@ -120,9 +128,31 @@ static void nn_sws_fail_conn (struct nn_sws *self, int code, char *reason);
 /*  Start receiving new message chunk. */
 static int nn_sws_recv_hdr (struct nn_sws *self);
 
-/*  Mask or unmask message payload. */
-static void nn_sws_mask_payload (uint8_t *payload, size_t payload_len,
-    const uint8_t *mask, size_t mask_len, int *mask_start_pos);
+/*  Writes the frame of outmsg, preceded by the batched frames, if any. */
+static void nn_sws_send_next (struct nn_sws *self);
+
+/*  Writes the closing handshake once the connection failed. */
+static void nn_sws_send_close (struct nn_sws *self);
+
+/*  Makes room for the payload of the frame being received at the end of the
+    message and points inmsg_current_chunk_buf to it. The message must not
+    exceed 'maxsize' bytes unless it's negative. Payload of a message sent
+    in a single frame goes straight to the user's buffer if possible. */
+static void nn_sws_inmsg_reserve (struct nn_sws *self, int maxsize);
+
+/*  Discards the message being received. */
+static void nn_sws_inmsg_term (struct nn_sws *self);
+
+/*  Called when the last frame of a data message was received. Restores
+    compressed message to its original form and notifies the pipe. */
+static void nn_sws_msg_received (struct nn_sws *self);
+
+/*  Replaces chunks of compressed message with its original content. */
+static int nn_sws_decompress (struct nn_sws *self);
+
+/*  Decompresses a buffer with the codec selected by the message's RSV bits. */
+static int nn_sws_decompress_buf (struct nn_sws *self, const void *src,
+    size_t srclen, struct nn_chunkref *dst);
 
 /*  Validates incoming text chunks for UTF-8 compliance as per RFC 3629. */
 static void nn_sws_validate_utf8_chunk (struct nn_sws *self);
@@ -143,10 +173,21 @@ void nn_sws_init (struct nn_sws *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     nn_pipebase_init (&self->pipebase, &nn_sws_pipebase_vfptr, ep);
+    nn_compress_init (&self->compress, &self->pipebase);
+    nn_ws_deflate_configure (&self->deflate_local, ep);
+    nn_ws_deflate_init (&self->deflate, &self->pipebase);
     self->instate = -1;
-    nn_list_init (&self->inmsg_array);
+    self->inmsg_chunk = NULL;
+    self->inmsg_capacity = 0;
+    self->inmsg_hint = 0;
+    self->inmsg_borrowed = NULL;
     self->outstate = -1;
+    self->outhdr_len = 0;
     nn_msg_init (&self->outmsg, 0);
+    self->outqueued = 0;
+    self->outbatch = NULL;
+    self->outbatch_len = 0;
+    self->outbatching = 0;
 
     self->continuing = 0;
 
@@ -168,7 +209,11 @@ void nn_sws_term (struct nn_sws *self)
 
     nn_fsm_event_term (&self->done);
     nn_msg_term (&self->outmsg);
-    nn_msg_array_term (&self->inmsg_array);
+    if (self->outbatch)
+        nn_free (self->outbatch);
+    nn_sws_inmsg_term (self);
+    nn_ws_deflate_term (&self->deflate);
+    nn_compress_term (&self->compress);
     nn_pipebase_term (&self->pipebase);
     nn_ws_handshake_term (&self->handshaker);
     nn_fsm_term (&self->fsm);
@@ -191,6 +236,8 @@ void nn_sws_start (struct nn_sws *self, struct nn_usock *usock, int mode,
     self->mode = mode;
     self->resource = resource;
     self->remote_host = host;
+    if (mode == NN_WS_CLIENT)
+        nn_random_secure_init (&self->rng);
 
     self->msg_type = msg_type;
 
@@ -203,163 +250,167 @@ void nn_sws_stop (struct nn_sws *self)
     nn_fsm_stop (&self->fsm);
 }
 
-void *nn_msg_chunk_new (size_t size, struct nn_list *msg_array)
+static void nn_sws_inmsg_reserve (struct nn_sws *self, int maxsize)
 {
-    struct msg_chunk *self;
-
-    self = nn_alloc (sizeof (struct msg_chunk), "msg_chunk");
-    alloc_assert (self);
+    int rc;
+    size_t size;
+    size_t received;
+    size_t capacity;
+
+    size = self->inmsg_total_size;
+    received = size - self->inmsg_current_chunk_len;
+
+    /*  If the user is waiting with a buffer that fits, receive the payload
+        straight into it. Compressed payload has to be inflated first, so it
+        can't. Masked payload is unmasked in place, wherever it is. */
+#if !defined NN_HAVE_WINDOWS
+    if (self->inmsg_chunks == 1 && self->is_final_frame &&
+          size > NN_CHUNKREF_MAX && !(self->inmsg_hdr &
+          (NN_SWS_FRAME_BITMASK_RSV1 | NN_SWS_FRAME_BITMASK_RSV2))) {
+        self->inmsg_borrowed = nn_pipebase_rcvbuf (&self->pipebase, size);
+        if (self->inmsg_borrowed) {
+            self->inmsg_current_chunk_buf = self->inmsg_borrowed;
+            return;
+        }
+    }
+#endif
+
+    if (size > self->inmsg_capacity) {
+
+        /*  Once the final frame arrives the size of the message is known.
+            Until then it's expected to be as large as the previous
+            fragmented one and the buffer grows geometrically beyond that,
+            so that a message split into many frames is moved only a few
+            times. Messages sent in a single frame, the common case, are
+            received into a buffer of their exact size. */
+        capacity = size;
+        if (!self->is_final_frame) {
+            if (capacity < self->inmsg_capacity * 2)
+                capacity = self->inmsg_capacity * 2;
+            if (capacity < self->inmsg_hint)
+                capacity = self->inmsg_hint;
+            if (maxsize >= 0 && capacity > (size_t) maxsize)
+                capacity = (size_t) maxsize;
+        }
 
-    nn_chunkref_init (&self->chunk, size);
-    nn_list_item_init (&self->item);
+        if (!self->inmsg_chunk) {
+            rc = nn_chunk_alloc (capacity, 0, &self->inmsg_chunk);
+            errnum_assert (rc == 0, -rc);
+        }
+        else {
 
-    nn_list_insert (msg_array, &self->item, nn_list_end (msg_array));
+            /*  Shrinking is free and leaves only the data received so far
+                to be copied to the new buffer. */
+            rc = nn_chunk_realloc (received, &self->inmsg_chunk);
+            errnum_assert (rc == 0, -rc);
+            rc = nn_chunk_realloc (capacity, &self->inmsg_chunk);
+            errnum_assert (rc == 0, -rc);
+        }
+        self->inmsg_capacity = capacity;
+    }
 
-    return nn_chunkref_data (&self->chunk);
+    self->inmsg_current_chunk_buf = (uint8_t*) self->inmsg_chunk + received;
 }
 
-void nn_msg_chunk_term (struct msg_chunk *it, struct nn_list *msg_array)
+static void nn_sws_inmsg_term (struct nn_sws *self)
 {
-    nn_chunkref_term (&it->chunk);
-    nn_list_erase (msg_array, &it->item);
-    nn_list_item_term (&it->item);
-    nn_free (it);
+    if (self->inmsg_chunk)
+        nn_chunk_free (self->inmsg_chunk);
+    self->inmsg_chunk = NULL;
+    self->inmsg_capacity = 0;
+    self->inmsg_borrowed = NULL;
 }
 
-void nn_msg_array_term (struct nn_list *msg_array)
+static int nn_sws_recv_hdr (struct nn_sws *self)
 {
-    struct nn_list_item *it;
-    struct msg_chunk *ch;
+    if (!self->continuing) {
+        nn_assert (self->inmsg_chunk == NULL);
 
-    while (!nn_list_empty (msg_array)) {
-        it = nn_list_begin (msg_array);
-        ch = nn_cont (it, struct msg_chunk, item);
-        nn_msg_chunk_term (ch, msg_array);
+        self->inmsg_current_chunk_buf = NULL;
+        self->inmsg_chunks = 0;
+        self->inmsg_current_chunk_len = 0;
+        self->inmsg_total_size = 0;
     }
 
-    nn_list_term (msg_array);
+    memset (self->inmsg_control, 0, NN_SWS_PAYLOAD_MAX_LENGTH);
+    memset (self->inhdr, 0, NN_SWS_FRAME_MAX_HDR_LEN);
+    self->instate = NN_SWS_INSTATE_RECV_HDR;
+    nn_usock_recv (self->usock, self->inhdr, NN_SWS_FRAME_SIZE_INITIAL, NULL);
+
+    return 0;
 }
 
-/*  Given a buffer location, this function determines whether the leading
-    octets form a valid UTF-8 code point. */
-static int nn_utf8_code_point (const uint8_t *buffer, size_t len)
+static void nn_sws_msg_received (struct nn_sws *self)
 {
-    /*  The lack of information is considered neither valid nor invalid. */
-    if (!buffer || !len)
-        return NN_SWS_UTF8_FRAGMENT;
-
-    /*  RFC 3629 section 4 UTF8-1. */
-    if (buffer [0] <= 0x7F)
-        return 1;
-
-    /*  0xC2, or 11000001, is the smallest conceivable multi-octet code
-        point that is not an illegal overlong encoding. */
-    if (buffer [0] < 0xC2)
-        return NN_SWS_UTF8_INVALID;
-
-    /*  Largest 2-octet code point starts with 0xDF (11011111). */
-    if (buffer [0] <= 0xDF) {
-        if (len < 2)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Ensure continuation byte in form of 10xxxxxx */
-        else if ((buffer [1] & 0xC0) != 0x80)
-            return NN_SWS_UTF8_INVALID;
-        else
-            return 2;
-    }
+    int rc;
 
-    /*  RFC 3629 section 4 UTF8-3, where 0xEF is 11101111. */
-    if (buffer [0] <= 0xEF) {
-        /*  Fragment. */
-        if (len < 2)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Illegal overlong sequence detection. */
-        else if (buffer [0] == 0xE0 && (buffer [1] < 0xA0 || buffer [1] == 0x80))
-            return NN_SWS_UTF8_INVALID;
-        /*  Illegal UTF-16 surrogate pair half U+D800 through U+DFFF. */
-        else if (buffer [0] == 0xED && buffer [1] >= 0xA0)
-            return NN_SWS_UTF8_INVALID;
-        /*  Fragment. */
-        else if (len < 3)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Ensure continuation bytes 2 and 3 in form of 10xxxxxx */
-        else if ((buffer [1] & 0xC0) != 0x80 || (buffer [2] & 0xC0) != 0x80)
-            return NN_SWS_UTF8_INVALID;
-        else
-            return 3;
+    if (self->inmsg_hdr & NN_SWS_FRAME_BITMASK_RSV2) {
+        rc = nn_sws_decompress (self);
+        if (nn_slow (rc < 0)) {
+            if (rc == -EMSGSIZE)
+                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_TOOBIG,
+                    "Message size exceeds limit.");
+            else
+                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+                    "Malformed compressed message.");
+            return;
+        }
+        self->inmsg_hdr &= ~NN_SWS_FRAME_BITMASK_RSV2;
     }
 
-    /*  RFC 3629 section 4 UTF8-4, where 0xF4 is 11110100. Why
-        not 11110111 to follow the pattern? Because UTF-8 encoding
-        stops at 0x10FFFF as per RFC 3629. */
-    if (buffer [0] <= 0xF4) {
-        /*  Fragment. */
-        if (len < 2)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Illegal overlong sequence detection. */
-        else if (buffer [0] == 0xF0 && buffer [1] < 0x90)
-            return NN_SWS_UTF8_INVALID;
-        /*  Illegal code point greater than U+10FFFF. */
-        else if (buffer [0] == 0xF4 && buffer [1] >= 0x90)
-            return NN_SWS_UTF8_INVALID;
-        /*  Fragment. */
-        else if (len < 4)
-            return NN_SWS_UTF8_FRAGMENT;
-        /*  Ensure continuation bytes 2, 3, and 4 in form of 10xxxxxx */
-        else if ((buffer [1] & 0xC0) != 0x80 ||
-            (buffer [2] & 0xC0) != 0x80 ||
-            (buffer [3] & 0xC0) != 0x80)
-            return NN_SWS_UTF8_INVALID;
-        else
-            return 4;
-    }
+    if (self->inmsg_hdr & NN_SWS_FRAME_BITMASK_RSV1) {
+        rc = nn_sws_decompress (self);
+        if (nn_slow (rc < 0)) {
+            if (rc == -EMSGSIZE)
+                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_TOOBIG,
+                    "Message size exceeds limit.");
+            else
+                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+                    "Malformed compressed message.");
+            return;
+        }
+        self->inmsg_hdr &= ~NN_SWS_FRAME_BITMASK_RSV1;
 
-    /*  UTF-8 encoding stops at U+10FFFF and only defines up to 4-octet
-        code point sequences. */
-    if (buffer [0] >= 0xF5)
-        return NN_SWS_UTF8_INVALID;
+        /*  Text was not validated chunk by chunk as it arrived. */
+        if ((self->inmsg_hdr & NN_SWS_FRAME_BITMASK_OPCODE) ==
+              NN_WS_OPCODE_TEXT) {
+            if (nn_ws_utf8_valid (self->inmsg_chunk,
+                  self->inmsg_total_size) != self->inmsg_total_size) {
+                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+                    "Invalid UTF-8 code point in payload.");
+                return;
+            }
+        }
+    }
 
-    /*  Algorithm error; a case above should have been satisfied. */
-    nn_assert (0);
+    self->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
+    nn_pipebase_received (&self->pipebase);
 }
 
-static void nn_sws_mask_payload (uint8_t *payload, size_t payload_len,
-    const uint8_t *mask, size_t mask_len, int *mask_start_pos)
+static int nn_sws_decompress_buf (struct nn_sws *self, const void *src,
+    size_t srclen, struct nn_chunkref *dst)
 {
-    unsigned i;
-
-    if (mask_start_pos) {
-        for (i = 0; i < payload_len; i++) {
-            payload [i] ^= mask [(i + *mask_start_pos) % mask_len];
-        }
-
-        *mask_start_pos = (i + *mask_start_pos) % mask_len;
-
-        return;
-    }
-    else {
-        for (i = 0; i < payload_len; i++) {
-            payload [i] ^= mask [i % mask_len];
-        }
-        return;
-    }
+    if (self->inmsg_hdr & NN_SWS_FRAME_BITMASK_RSV1)
+        return nn_ws_inflate_buf (&self->deflate, src, srclen, dst);
+    return nn_decompress_buf (&self->compress, src, srclen, dst);
 }
 
-static int nn_sws_recv_hdr (struct nn_sws *self)
+static int nn_sws_decompress (struct nn_sws *self)
 {
-    if (!self->continuing) {
-        nn_assert (nn_list_empty (&self->inmsg_array));
+    int rc;
+    struct nn_chunkref dst;
 
-        self->inmsg_current_chunk_buf = NULL;
-        self->inmsg_chunks = 0;
-        self->inmsg_current_chunk_len = 0;
-        self->inmsg_total_size = 0;
-    }
+    rc = nn_sws_decompress_buf (self, self->inmsg_chunk,
+        self->inmsg_total_size, &dst);
+    if (nn_slow (rc < 0))
+        return rc;
 
-    memset (self->inmsg_control, 0, NN_SWS_PAYLOAD_MAX_LENGTH);
-    memset (self->inhdr, 0, NN_SWS_FRAME_MAX_HDR_LEN);
-    self->instate = NN_SWS_INSTATE_RECV_HDR;
-    nn_usock_recv (self->usock, self->inhdr, NN_SWS_FRAME_SIZE_INITIAL, NULL);
+    /*  Replace the payload by the original message. */
+    nn_sws_inmsg_term (self);
+    self->inmsg_total_size = nn_chunkref_size (&dst);
+    self->inmsg_capacity = self->inmsg_total_size;
+    self->inmsg_chunk = nn_chunkref_getchunk (&dst);
+    nn_chunkref_term (&dst);
 
     return 0;
 }
@@ -367,18 +418,19 @@ static int nn_sws_recv_hdr (struct nn_sws *self)
 static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_sws *sws;
-    struct nn_iovec iov [3];
-    int mask_pos;
+    uint8_t opcode;
+    size_t mask_pos;
     size_t nn_msg_size;
     size_t hdr_len;
     struct nn_cmsghdr *cmsg;
     struct nn_msghdr msghdr;
     uint8_t rand_mask [NN_SWS_FRAME_SIZE_MASK];
+    uint8_t *pos;
 
     sws = nn_cont (self, struct nn_sws, pipebase);
 
     nn_assert_state (sws, NN_SWS_STATE_ACTIVE);
-    nn_assert (sws->outstate == NN_SWS_OUTSTATE_IDLE);
+    nn_assert (sws->outstate != NN_SWS_OUTSTATE_SENDING && !sws->outqueued);
 
     /*  Move the message to the local storage. */
     nn_msg_term (&sws->outmsg);
@@ -414,6 +466,18 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
     /*  For now, enforce that outgoing messages are the final frame. */
     sws->outhdr [0] |= NN_SWS_FRAME_BITMASK_FIN;
 
+    /*  nanomsg's compression is used for binary messages only; text
+        messages have to remain valid UTF-8 on the wire. permessage-deflate
+        applies to both. */
+    opcode = sws->outhdr [0] & NN_SWS_FRAME_BITMASK_OPCODE;
+    if (opcode == NN_WS_OPCODE_BINARY &&
+          nn_compress_msg (&sws->compress, &sws->outmsg))
+        sws->outhdr [0] |= NN_SWS_FRAME_BITMASK_RSV2;
+    else if ((opcode == NN_WS_OPCODE_BINARY ||
+          opcode == NN_WS_OPCODE_TEXT) &&
+          nn_ws_deflate_msg (&sws->deflate, &sws->outmsg))
+        sws->outhdr [0] |= NN_SWS_FRAME_BITMASK_RSV1;
+
     nn_msg_size = nn_chunkref_size (&sws->outmsg.sphdr) +
         nn_chunkref_size (&sws->outmsg.body);
 
@@ -437,22 +501,11 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
         sws->outhdr [1] |= NN_SWS_FRAME_BITMASK_MASKED;
 
         /*  Generate 32-bit mask as per RFC 6455 5.3. */
-        nn_random_generate (rand_mask, NN_SWS_FRAME_SIZE_MASK);
+        nn_random_secure_generate (&sws->rng, rand_mask,
+            NN_SWS_FRAME_SIZE_MASK);
 
         memcpy (&sws->outhdr [hdr_len], rand_mask, NN_SWS_FRAME_SIZE_MASK);
         hdr_len += NN_SWS_FRAME_SIZE_MASK;
-
-        /*  Mask payload, beginning with header and moving to body. */
-        mask_pos = 0;
-
-        nn_sws_mask_payload (nn_chunkref_data (&sws->outmsg.sphdr),
-            nn_chunkref_size (&sws->outmsg.sphdr),
-            rand_mask, NN_SWS_FRAME_SIZE_MASK, &mask_pos);
-
-        nn_sws_mask_payload (nn_chunkref_data (&sws->outmsg.body),
-            nn_chunkref_size (&sws->outmsg.body),
-            rand_mask, NN_SWS_FRAME_SIZE_MASK, &mask_pos);
-
     }
     else if (sws->mode == NN_WS_SERVER) {
         sws->outhdr [1] |= NN_SWS_FRAME_BITMASK_NOT_MASKED;
@@ -461,31 +514,90 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
         /*  Developer error; sws object was not constructed properly. */
         nn_assert (0);
     }
+    sws->outhdr_len = hdr_len;
+
+    /*  While the pipe passes the messages from its send queue, small ones
+        are copied to the batch buffer and acknowledged straight away so
+        that the following ones, control frames included, go out in the same
+        write. Room is always left for the header of a message that doesn't
+        fit in. */
+    if (sws->outbatching && nn_msg_size <= NN_SWS_BATCH_MSG_SIZE &&
+          sws->outbatch_len + hdr_len + nn_msg_size <=
+          NN_SWS_BATCH_SIZE - NN_SWS_FRAME_MAX_HDR_LEN) {
+        if (nn_slow (!sws->outbatch)) {
+            sws->outbatch = nn_alloc (NN_SWS_BATCH_SIZE, "ws batch");
+            alloc_assert (sws->outbatch);
+        }
+        pos = sws->outbatch + sws->outbatch_len;
+        memcpy (pos, sws->outhdr, hdr_len);
+        pos += hdr_len;
+        memcpy (pos, nn_chunkref_data (&sws->outmsg.sphdr),
+            nn_chunkref_size (&sws->outmsg.sphdr));
+        memcpy (pos + nn_chunkref_size (&sws->outmsg.sphdr),
+            nn_chunkref_data (&sws->outmsg.body),
+            nn_chunkref_size (&sws->outmsg.body));
+        if (sws->mode == NN_WS_CLIENT)
+            nn_ws_mask (pos, nn_msg_size, rand_mask, 0);
+        sws->outbatch_len += hdr_len + nn_msg_size;
+        nn_msg_term (&sws->outmsg);
+        nn_msg_init (&sws->outmsg, 0);
+        nn_pipebase_sent (&sws->pipebase);
+        return 0;
+    }
 
-    /*  Start async sending. */
-    iov [0].iov_base = sws->outhdr;
-    iov [0].iov_len = hdr_len;
-    iov [1].iov_base = nn_chunkref_data (&sws->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&sws->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&sws->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&sws->outmsg.body);
-    nn_usock_send (sws->usock, iov, 3);
+    /*  Mask payload, beginning with header and moving to body. */
+    if (sws->mode == NN_WS_CLIENT) {
+        mask_pos = nn_ws_mask (nn_chunkref_data (&sws->outmsg.sphdr),
+            nn_chunkref_size (&sws->outmsg.sphdr), rand_mask, 0);
+        nn_ws_mask (nn_chunkref_data (&sws->outmsg.body),
+            nn_chunkref_size (&sws->outmsg.body), rand_mask, mask_pos);
+    }
 
-    sws->outstate = NN_SWS_OUTSTATE_SENDING;
+    /*  Start async sending unless the batch is being written at the moment. */
+    sws->outqueued = 1;
+    if (sws->outstate == NN_SWS_OUTSTATE_IDLE)
+        nn_sws_send_next (sws);
 
     return 0;
 }
 
+static void nn_sws_send_next (struct nn_sws *self)
+{
+    struct nn_iovec iov [3];
+
+    nn_assert (self->outstate == NN_SWS_OUTSTATE_IDLE && self->outqueued);
+
+    /*  The header is appended to the batched frames so that the whole lot
+        fits into three buffers. */
+    if (self->outbatch_len) {
+        memcpy (self->outbatch + self->outbatch_len, self->outhdr,
+            self->outhdr_len);
+        self->outbatch_len += self->outhdr_len;
+        iov [0].iov_base = self->outbatch;
+        iov [0].iov_len = self->outbatch_len;
+    }
+    else {
+        iov [0].iov_base = self->outhdr;
+        iov [0].iov_len = self->outhdr_len;
+    }
+    iov [1].iov_base = nn_chunkref_data (&self->outmsg.sphdr);
+    iov [1].iov_len = nn_chunkref_size (&self->outmsg.sphdr);
+    iov [2].iov_base = nn_chunkref_data (&self->outmsg.body);
+    iov [2].iov_len = nn_chunkref_size (&self->outmsg.body);
+    nn_usock_send (self->usock, iov, 3);
+
+    self->outqueued = 0;
+    self->outstate = NN_SWS_OUTSTATE_SENDING;
+}
+
 static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg)
 {
+    int rc;
     struct nn_sws *sws;
-    struct nn_list_item *it;
-    struct msg_chunk *ch;
     struct nn_cmsghdr *cmsg;
     uint8_t opcode_hdr;
     uint8_t opcode;
     size_t cmsgsz;
-    size_t pos;
 
     sws = nn_cont (self, struct nn_sws, pipebase);
 
@@ -509,23 +621,35 @@ static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg)
         nn_assert (opcode == NN_WS_OPCODE_BINARY ||
                    opcode == NN_WS_OPCODE_TEXT);
 
-        nn_msg_init (msg, sws->inmsg_total_size);
-
-        pos = 0;
-
-        /*  Reassemble incoming message scatter array. */
-        while (!nn_list_empty (&sws->inmsg_array)) {
-            it = nn_list_begin (&sws->inmsg_array);
-            ch = nn_cont (it, struct msg_chunk, item);
-            memcpy (((uint8_t*) nn_chunkref_data (&msg->body)) + pos,
-                nn_chunkref_data (&ch->chunk),
-                nn_chunkref_size (&ch->chunk));
-            pos += nn_chunkref_size (&ch->chunk);
-            nn_msg_chunk_term (ch, &sws->inmsg_array);
+        if (sws->inmsg_chunks > 1)
+            sws->inmsg_hint = sws->inmsg_total_size;
+
+        /*  The payload was received in place and becomes the message body.
+            Only if the buffer was sized for a much larger message is the
+            payload copied, so as not to hold on to the spare memory. */
+        if (sws->inmsg_borrowed) {
+            nn_msg_init (msg, 0);
+            nn_chunkref_term (&msg->body);
+            nn_chunkref_init_borrowed (&msg->body, sws->inmsg_borrowed,
+                sws->inmsg_total_size);
+            sws->inmsg_borrowed = NULL;
+        }
+        else if (!sws->inmsg_chunk) {
+            nn_msg_init (msg, 0);
+        }
+        else if (sws->inmsg_capacity / 2 > sws->inmsg_total_size) {
+            nn_msg_init (msg, sws->inmsg_total_size);
+            memcpy (nn_chunkref_data (&msg->body), sws->inmsg_chunk,
+                sws->inmsg_total_size);
+            nn_sws_inmsg_term (sws);
+        }
+        else {
+            rc = nn_chunk_realloc (sws->inmsg_total_size, &sws->inmsg_chunk);
+            errnum_assert (rc == 0, -rc);
+            nn_msg_init_chunk (msg, sws->inmsg_chunk);
+            sws->inmsg_chunk = NULL;
+            sws->inmsg_capacity = 0;
         }
-
-        nn_assert (pos == sws->inmsg_total_size);
-        nn_assert (nn_list_empty (&sws->inmsg_array));
 
         /*  No longer collecting scatter array of incoming msg chunks. */
         sws->continuing = 0;
@@ -578,10 +702,37 @@ static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg)
     return 0;
 }
 
+static void nn_sws_release (struct nn_pipebase *self)
+{
+    int rc;
+    struct nn_sws *sws;
+
+    sws = nn_cont (self, struct nn_sws, pipebase);
+
+    if (!sws->inmsg_borrowed)
+        return;
+
+    /*  Copy the payload out of the user's buffer and receive the rest of
+        it, if any, into the copy. */
+    nn_assert (!sws->inmsg_chunk);
+    rc = nn_chunk_alloc (sws->inmsg_total_size, 0, &sws->inmsg_chunk);
+    errnum_assert (rc == 0, -rc);
+    memcpy (sws->inmsg_chunk, sws->inmsg_borrowed, sws->inmsg_total_size);
+    sws->inmsg_capacity = sws->inmsg_total_size;
+    sws->inmsg_current_chunk_buf = sws->inmsg_chunk;
+#if !defined NN_HAVE_WINDOWS
+    if (sws->instate == NN_SWS_INSTATE_RECV_PAYLOAD)
+        nn_usock_recv_rebase (sws->usock, sws->inmsg_borrowed,
+            sws->inmsg_chunk);
+#endif
+    sws->inmsg_borrowed = NULL;
+}
+
 static void nn_sws_validate_utf8_chunk (struct nn_sws *self)
 {
     uint8_t *pos;
     int code_point_len;
+    size_t valid_len;
     size_t len;
 
     len = self->inmsg_current_chunk_len;
@@ -597,53 +748,58 @@ static void nn_sws_validate_utf8_chunk (struct nn_sws *self)
 
         /*  Keep adding octets from fresh buffer to previous code point
             fragment to check for validity. */
-        while (len > 0) {
+        while (1) {
+            if (len == 0) {
+                if (self->is_final_frame) {
+                    nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+                        "Truncated UTF-8 payload with invalid code point.");
+                    return;
+                }
+
+                /*  The code point continues in the next chunk. */
+                nn_sws_recv_hdr (self);
+                return;
+            }
+
             self->utf8_code_pt_fragment [self->utf8_code_pt_fragment_len] = *pos;
             self->utf8_code_pt_fragment_len++;
             pos++;
             len--;
 
-            code_point_len = nn_utf8_code_point (self->utf8_code_pt_fragment,
+            code_point_len = nn_ws_utf8_code_point (self->utf8_code_pt_fragment,
                 self->utf8_code_pt_fragment_len);
 
             if (code_point_len > 0) {
-                /*  Valid code point found; continue validating. */
+                /*  Valid code point found; continue validating the rest
+                    of the chunk. */
+                self->utf8_code_pt_fragment_len = 0;
+                memset (self->utf8_code_pt_fragment, 0,
+                    NN_SWS_UTF8_MAX_CODEPOINT_LEN);
                 break;
             }
-            else if (code_point_len == NN_SWS_UTF8_INVALID) {
+            else if (code_point_len == NN_WS_UTF8_INVALID) {
                 nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
                     "Invalid UTF-8 code point split on previous frame.");
                 return;
             }
-            else if (code_point_len == NN_SWS_UTF8_FRAGMENT) {
-                if (self->is_final_frame) {
-                    nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
-                        "Truncated UTF-8 payload with invalid code point.");
-                    return;
-                }
-                else {
-                    /*  This chunk is well-formed; now recv the next chunk. */
-                    nn_sws_recv_hdr (self);
-                    return;
-                }
-            }
+
+            /*  Still a fragment; it needs more octets. */
+            nn_assert (code_point_len == NN_WS_UTF8_FRAGMENT);
+            nn_assert (self->utf8_code_pt_fragment_len <
+                NN_SWS_UTF8_MAX_CODEPOINT_LEN);
         }
     }
 
-    if (self->utf8_code_pt_fragment_len >= NN_SWS_UTF8_MAX_CODEPOINT_LEN)
-        nn_assert (0);
+    /*  Skip the well-formed part of the buffer in bulk. Whatever is left
+        starts with an invalid or a truncated code point. */
+    valid_len = nn_ws_utf8_valid (pos, len);
+    len -= valid_len;
+    pos += valid_len;
 
-    while (len > 0) {
-        code_point_len = nn_utf8_code_point (pos, len);
+    if (len > 0) {
+        code_point_len = nn_ws_utf8_code_point (pos, len);
 
-        if (code_point_len > 0) {
-            /*  Valid code point found; continue validating. */
-            nn_assert (len >= (size_t) code_point_len);
-            len -= code_point_len;
-            pos += code_point_len;
-            continue;
-        }
-        else if (code_point_len == NN_SWS_UTF8_INVALID) {
+        if (code_point_len == NN_WS_UTF8_INVALID) {
             self->utf8_code_pt_fragment_len = 0;
             memset (self->utf8_code_pt_fragment, 0,
                 NN_SWS_UTF8_MAX_CODEPOINT_LEN);
@@ -651,21 +807,21 @@ static void nn_sws_validate_utf8_chunk (struct nn_sws *self)
                 "Invalid UTF-8 code point in payload.");
             return;
         }
-        else if (code_point_len == NN_SWS_UTF8_FRAGMENT) {
-            nn_assert (len < NN_SWS_UTF8_MAX_CODEPOINT_LEN);
-            self->utf8_code_pt_fragment_len = len;
-            memcpy (self->utf8_code_pt_fragment, pos, len);
-            if (self->is_final_frame) {
-                nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
-                    "Truncated UTF-8 payload with invalid code point.");
-            }
-            else {
-                /*  Previous frame ended in the middle of a code point;
-                    receive more. */
-                nn_sws_recv_hdr (self);
-            }
-            return;
+
+        nn_assert (code_point_len == NN_WS_UTF8_FRAGMENT);
+        nn_assert (len < NN_SWS_UTF8_MAX_CODEPOINT_LEN);
+        self->utf8_code_pt_fragment_len = len;
+        memcpy (self->utf8_code_pt_fragment, pos, len);
+        if (self->is_final_frame) {
+            nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_INVALID_FRAME,
+                "Truncated UTF-8 payload with invalid code point.");
+        }
+        else {
+            /*  Previous frame ended in the middle of a code point;
+                receive more. */
+            nn_sws_recv_hdr (self);
         }
+        return;
     }
 
     /*  Entire buffer is well-formed. */
@@ -689,7 +845,6 @@ static void nn_sws_acknowledge_close_handshake (struct nn_sws *self)
 {
     uint8_t *pos;
     uint16_t close_code;
-    int code_point_len;
     size_t len;
 
     len = self->inmsg_current_chunk_len;
@@ -709,27 +864,14 @@ static void nn_sws_acknowledge_close_handshake (struct nn_sws *self)
 
     /*  As per RFC 6455 7.1.6, the Close Reason following the Close Code
         must be well-formed UTF-8. */
-    while (len > 0) {
-        code_point_len = nn_utf8_code_point (pos, len);
-
-        if (code_point_len > 0) {
-            /*  Valid code point found; continue validating. */
-            nn_assert (len >= (size_t) code_point_len);
-            len -= code_point_len;
-            pos += code_point_len;
-            continue;
-        }
-        else {
-            /*  RFC 6455 7.1.6 */
-            nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_PROTO,
-                "Invalid UTF-8 sent as Close Reason.");
-            return;
-        }
+    if (nn_ws_utf8_valid (pos, len) != len) {
+        /*  RFC 6455 7.1.6 */
+        nn_sws_fail_conn (self, NN_SWS_CLOSE_ERR_PROTO,
+            "Invalid UTF-8 sent as Close Reason.");
+        return;
     }
 
     /*  Entire Close Reason is well-formed UTF-8 (or empty) */
-    nn_assert (len == 0);
-
     close_code = nn_gets (self->inmsg_current_chunk_buf);
 
     if (close_code == NN_SWS_CLOSE_NORMAL ||
@@ -760,7 +902,6 @@ static void nn_sws_fail_conn (struct nn_sws *self, int code, char *reason)
     size_t payload_len;
     uint8_t rand_mask [NN_SWS_FRAME_SIZE_MASK];
     uint8_t *payload_pos;
-    struct nn_iovec iov;
 
     nn_assert_state (self, NN_SWS_STATE_ACTIVE);
 
@@ -769,7 +910,7 @@ static void nn_sws_fail_conn (struct nn_sws *self, int code, char *reason)
     nn_pipebase_stop (&self->pipebase);
 
     /*  Destroy any remnant incoming message fragments. */
-    nn_msg_array_term (&self->inmsg_array);
+    nn_sws_inmsg_term (self);
 
     reason_len = strlen (reason);
 
@@ -794,7 +935,8 @@ static void nn_sws_fail_conn (struct nn_sws *self, int code, char *reason)
         self->fail_msg [1] |= NN_SWS_FRAME_BITMASK_MASKED;
 
         /*  Generate 32-bit mask as per RFC 6455 5.3. */
-        nn_random_generate (rand_mask, NN_SWS_FRAME_SIZE_MASK);
+        nn_random_secure_generate (&self->rng, rand_mask,
+            NN_SWS_FRAME_SIZE_MASK);
 
         memcpy (&self->fail_msg [NN_SWS_FRAME_SIZE_INITIAL],
             rand_mask, NN_SWS_FRAME_SIZE_MASK);
@@ -818,23 +960,27 @@ static void nn_sws_fail_conn (struct nn_sws *self, int code, char *reason)
 
     /*  If this is a client, apply mask. */
     if (self->mode == NN_WS_CLIENT) {
-        nn_sws_mask_payload (payload_pos, payload_len,
-            rand_mask, NN_SWS_FRAME_SIZE_MASK, NULL);
+        nn_ws_mask (payload_pos, payload_len, rand_mask, 0);
     }
 
 
-    if (self->outstate == NN_SWS_OUTSTATE_IDLE) {
-        iov.iov_base = self->fail_msg;
-        iov.iov_len = self->fail_msg_len;
-        nn_usock_send (self->usock, &iov, 1);
-        self->outstate = NN_SWS_OUTSTATE_SENDING;
-        self->state = NN_SWS_STATE_CLOSING_CONNECTION;
-    } else {
-        self->state = NN_SWS_STATE_DONE;
-        nn_fsm_raise (&self->fsm, &self->done, NN_SWS_RETURN_CLOSE_HANDSHAKE);
-    }
+    /*  If frames are being written at the moment, the closing handshake
+        follows them once they are. Messages that weren't written yet are
+        dropped along with the pipe. */
+    self->state = NN_SWS_STATE_CLOSING_CONNECTION;
+    self->outqueued = 0;
+    if (self->outstate == NN_SWS_OUTSTATE_IDLE)
+        nn_sws_send_close (self);
+}
 
-    return;
+static void nn_sws_send_close (struct nn_sws *self)
+{
+    struct nn_iovec iov;
+
+    iov.iov_base = self->fail_msg;
+    iov.iov_len = self->fail_msg_len;
+    nn_usock_send (self->usock, &iov, 1);
+    self->outstate = NN_SWS_OUTSTATE_CLOSING;
 }
 
 static void nn_sws_shutdown (struct nn_fsm *self, int src, int type,
@@ -873,6 +1019,8 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
     int rc;
     int opt;
     size_t opt_sz = sizeof (opt);
+    uint8_t rsv;
+    struct nn_iovec iov;
 
     sws = nn_cont (self, struct nn_sws, fsm);
 
@@ -888,7 +1036,8 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_FSM_START:
                 nn_ws_handshake_start (&sws->handshaker, sws->usock,
-                    &sws->pipebase, sws->mode, sws->resource, sws->remote_host);
+                    &sws->pipebase, sws->mode, sws->resource, sws->remote_host,
+                    &sws->deflate_local);
                 sws->state = NN_SWS_STATE_HANDSHAKE;
                 return;
             default:
@@ -943,6 +1092,10 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
             case NN_WS_HANDSHAKE_STOPPED:
 
                  /*  Start the pipe. */
+                 nn_compress_start (&sws->compress,
+                     sws->handshaker.compression);
+                 nn_ws_deflate_start (&sws->deflate,
+                     &sws->handshaker.deflate, sws->mode);
                  rc = nn_pipebase_start (&sws->pipebase);
                  if (nn_slow (rc < 0)) {
                     sws->state = NN_SWS_STATE_DONE;
@@ -977,12 +1130,34 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_USOCK_SENT:
 
-                /*  The message is now fully sent. */
+                /*  Batched frames were acknowledged as they were copied.
+                    Continue with the message that arrived in the meantime,
+                    if any. */
+                sws->outbatch_len = 0;
+                if (sws->outstate == NN_SWS_OUTSTATE_FLUSHING) {
+                    sws->outstate = NN_SWS_OUTSTATE_IDLE;
+                    if (sws->outqueued)
+                        nn_sws_send_next (sws);
+                    return;
+                }
+
+                /*  The message is now fully sent. Let the pipe pass the
+                    messages from its send queue and write the small ones
+                    that were batched at once. */
                 nn_assert (sws->outstate == NN_SWS_OUTSTATE_SENDING);
                 sws->outstate = NN_SWS_OUTSTATE_IDLE;
                 nn_msg_term (&sws->outmsg);
                 nn_msg_init (&sws->outmsg, 0);
+                sws->outbatching = 1;
                 nn_pipebase_sent (&sws->pipebase);
+                sws->outbatching = 0;
+                if (sws->outstate == NN_SWS_OUTSTATE_IDLE &&
+                      sws->outbatch_len) {
+                    iov.iov_base = sws->outbatch;
+                    iov.iov_len = sws->outbatch_len;
+                    nn_usock_send (sws->usock, &iov, 1);
+                    sws->outstate = NN_SWS_OUTSTATE_FLUSHING;
+                }
                 return;
 
             case NN_USOCK_RECEIVED:
@@ -991,10 +1166,24 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                 case NN_SWS_INSTATE_RECV_HDR:
 
                     /*  Require RSV1, RSV2, and RSV3 bits to be unset for
-                        x-nanomsg protocol as per RFC 6455 section 5.2. */
-                    if (sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV1 ||
-                        sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV2 ||
-                        sws->inhdr [0] & NN_SWS_FRAME_BITMASK_RSV3) {
+                        x-nanomsg protocol as per RFC 6455 section 5.2.
+                        The exceptions are RSV2 marking the first frame of
+                        a compressed binary message, if compression was
+                        negotiated, and RSV1 marking the first frame of
+                        a data message compressed by permessage-deflate. */
+                    rsv = sws->inhdr [0] & (NN_SWS_FRAME_BITMASK_RSV1 |
+                        NN_SWS_FRAME_BITMASK_RSV2 | NN_SWS_FRAME_BITMASK_RSV3);
+                    if (sws->compress.codec &&
+                          (sws->inhdr [0] & NN_SWS_FRAME_BITMASK_OPCODE) ==
+                          NN_WS_OPCODE_BINARY)
+                        rsv &= ~NN_SWS_FRAME_BITMASK_RSV2;
+                    if (sws->deflate.active &&
+                          ((sws->inhdr [0] & NN_SWS_FRAME_BITMASK_OPCODE) ==
+                          NN_WS_OPCODE_BINARY ||
+                          (sws->inhdr [0] & NN_SWS_FRAME_BITMASK_OPCODE) ==
+                          NN_WS_OPCODE_TEXT))
+                        rsv &= ~NN_SWS_FRAME_BITMASK_RSV1;
+                    if (rsv) {
                         nn_sws_fail_conn (sws, NN_SWS_CLOSE_ERR_PROTO,
                             "RSV1, RSV2, and RSV3 must be unset.");
                         return;
@@ -1103,8 +1292,7 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                             else {
                                 /*  Special case when there is no payload,
                                     mask, or additional frames. */
-                                sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                                nn_pipebase_received (&sws->pipebase);
+                                nn_sws_msg_received (sws);
                                 return;
                             }
                             }
@@ -1132,8 +1320,7 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                             else {
                                 /*  Special case when there is no payload,
                                     mask, or additional frames. */
-                                sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                                nn_pipebase_received (&sws->pipebase);
+                                nn_sws_msg_received (sws);
                                 return;
                             }
                         }
@@ -1284,9 +1471,7 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                                 return;
                             }
                             sws->inmsg_chunks++;
-                            sws->inmsg_current_chunk_buf =
-                                nn_msg_chunk_new (sws->inmsg_current_chunk_len,
-                                &sws->inmsg_array);
+                            nn_sws_inmsg_reserve (sws, opt);
                         }
 
                         sws->instate = NN_SWS_INSTATE_RECV_PAYLOAD;
@@ -1355,12 +1540,13 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                             if (sws->opcode == NN_WS_OPCODE_CLOSE) {
                                 nn_sws_acknowledge_close_handshake (sws);
                             }
-                            else {
-                                sws->instate = (sws->is_control_frame ?
-                                    NN_SWS_INSTATE_RECVD_CONTROL :
-                                    NN_SWS_INSTATE_RECVD_CHUNKED);
+                            else if (sws->is_control_frame) {
+                                sws->instate = NN_SWS_INSTATE_RECVD_CONTROL;
                                 nn_pipebase_received (&sws->pipebase);
                             }
+                            else {
+                                nn_sws_msg_received (sws);
+                            }
                         }
                         else {
                             nn_sws_recv_hdr (sws);
@@ -1391,9 +1577,7 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                             return;
                         }
                         sws->inmsg_chunks++;
-                        sws->inmsg_current_chunk_buf =
-                            nn_msg_chunk_new (sws->inmsg_current_chunk_len,
-                            &sws->inmsg_array);
+                        nn_sws_inmsg_reserve (sws, opt);
                     }
 
                     sws->instate = NN_SWS_INSTATE_RECV_PAYLOAD;
@@ -1405,21 +1589,28 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
 
                     /*  Unmask if necessary. */
                     if (sws->masked) {
-                        nn_sws_mask_payload (sws->inmsg_current_chunk_buf,
-                            sws->inmsg_current_chunk_len, sws->mask,
-                            NN_SWS_FRAME_SIZE_MASK, NULL);
+                        nn_ws_mask (sws->inmsg_current_chunk_buf,
+                            sws->inmsg_current_chunk_len, sws->mask, 0);
                     }
 
                     switch (sws->opcode) {
 
                     case NN_WS_OPCODE_TEXT:
-                        nn_sws_validate_utf8_chunk (sws);
+                        /*  Compressed text is validated once inflated. */
+                        if (!(sws->inmsg_hdr & NN_SWS_FRAME_BITMASK_RSV1)) {
+                            nn_sws_validate_utf8_chunk (sws);
+                        }
+                        else if (sws->is_final_frame) {
+                            nn_sws_msg_received (sws);
+                        }
+                        else {
+                            nn_sws_recv_hdr (sws);
+                        }
                         return;
 
                     case NN_WS_OPCODE_BINARY:
                         if (sws->is_final_frame) {
-                            sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                            nn_pipebase_received (&sws->pipebase);
+                            nn_sws_msg_received (sws);
                         }
                         else {
                             nn_sws_recv_hdr (sws);
@@ -1430,12 +1621,12 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                         /*  Must check original opcode to see if this fragment
                             needs UTF-8 validation. */
                         if ((sws->inmsg_hdr & NN_SWS_FRAME_BITMASK_OPCODE) ==
-                            NN_WS_OPCODE_TEXT) {
+                            NN_WS_OPCODE_TEXT &&
+                            !(sws->inmsg_hdr & NN_SWS_FRAME_BITMASK_RSV1)) {
                             nn_sws_validate_utf8_chunk (sws);
                         }
                         else if (sws->is_final_frame) {
-                            sws->instate = NN_SWS_INSTATE_RECVD_CHUNKED;
-                            nn_pipebase_received (&sws->pipebase);
+                            nn_sws_msg_received (sws);
                         }
                         else {
                             nn_sws_recv_hdr (sws);
@@ -1498,9 +1689,16 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
         case NN_SWS_SRC_USOCK:
             switch (type) {
             case NN_USOCK_SENT:
+                /*  Frames being written when the connection failed were
+                    sent; the closing handshake follows them. */
+                if (sws->outstate != NN_SWS_OUTSTATE_CLOSING) {
+                    sws->outbatch_len = 0;
+                    nn_sws_send_close (sws);
+                    return;
+                }
+
                 /*  Wait for acknowledgement closing handshake was sent
                     to peer. */
-                nn_assert (sws->outstate == NN_SWS_OUTSTATE_SENDING);
                 sws->outstate = NN_SWS_OUTSTATE_IDLE;
                 sws->state = NN_SWS_STATE_DONE;
                 nn_fsm_raise (&sws->fsm, &sws->done,
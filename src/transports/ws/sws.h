@@ -32,8 +32,11 @@
 
 #include "ws_handshake.h"
 
+#include "../utils/compress.h"
+#include "ws_deflate.h"
+
 #include "../../utils/msg.h"
-#include "../../utils/list.h"
+#include "../../utils/random.h"
 
 /*  This state machine handles WebSocket connection from the point where it is
     established to the point when it is broken. */
@@ -90,6 +93,10 @@ struct nn_sws {
         a Client or a Server. */
     int mode;
 
+    /*  Generates masks of the frames sent when acting as a Client. Masks
+        must be unpredictable for the peer, as per RFC 6455 10.3. */
+    struct nn_random_secure rng;
+
     /*  The underlying socket. */
     struct nn_usock *usock;
 
@@ -102,6 +109,15 @@ struct nn_sws {
     /*  Pipe connecting this WebSocket connection to the nanomsg core. */
     struct nn_pipebase pipebase;
 
+    /*  Compression of binary messages passed through the pipe. Compressed
+        messages are marked by RSV2 bit on their first frame. */
+    struct nn_compress compress;
+
+    /*  RFC 7692 permessage-deflate. It's used instead of the above with
+        peers other than nanomsg, compressed messages are marked by RSV1. */
+    struct nn_ws_deflate_params deflate_local;
+    struct nn_ws_deflate deflate;
+
     /*  Requested resource when acting as client. */
     const char* resource;
 
@@ -142,14 +158,26 @@ struct nn_sws {
     int pings_received;
     int pongs_received;
 
-    /*  Fragments of message being received at the moment. */
-    struct nn_list inmsg_array;
+    /*  Message being received at the moment. Payloads of its frames are
+        received back to back into a single chunk, which is grown as needed
+        and finally passed to the user as the message body. */
+    void *inmsg_chunk;
+    size_t inmsg_capacity;
     uint8_t *inmsg_current_chunk_buf;
     size_t inmsg_current_chunk_len;
     size_t inmsg_total_size;
     int inmsg_chunks;
     uint8_t inmsg_hdr;
 
+    /*  Size of the last fragmented message received. The next one is
+        expected to be alike and its buffer is sized accordingly. */
+    size_t inmsg_hint;
+
+    /*  If set, the payload of the message sent in a single frame is received
+        into the buffer of the user blocked in nn_recv() rather than into
+        inmsg_chunk. */
+    void *inmsg_borrowed;
+
     /*  Control message being received at the moment. Because these can be
         interspersed between fragmented TEXT and BINARY messages, they are
         stored in this buffer so as not to interrupt the message array. */
@@ -164,30 +192,26 @@ struct nn_sws {
 
     /*  Buffer used to store the header of outgoing message. */
     uint8_t outhdr [NN_SWS_FRAME_MAX_HDR_LEN];
+    size_t outhdr_len;
 
-    /*  Message being sent at the moment. */
+    /*  Message being sent at the moment. If outqueued is set it waits
+        for the batch being written to complete. */
     struct nn_msg outmsg;
+    int outqueued;
+
+    /*  Frames of small messages passed by the pipe from its send queue,
+        copied back to back to be written at once. They are followed by the
+        header of outmsg if it didn't fit in. Allocated on first use. */
+    uint8_t *outbatch;
+    size_t outbatch_len;
+
+    /*  Set while the pipe passes the messages from its send queue. */
+    int outbatching;
 
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
 };
 
-/*  Scatter/gather array element type forincoming message chunks. Fragmented
-    message frames are reassembled prior to notifying the user. */
-struct msg_chunk {
-    struct nn_list_item item;
-    struct nn_chunkref chunk;
-};
-
-/*  Allocate a new message chunk, append it to message array, and return
-    pointer to its buffer. */
-void *nn_msg_chunk_new (size_t size, struct nn_list *msg_array);
-
-/*  Deallocate a message chunk and remove it from array. */
-void nn_msg_chunk_term (struct msg_chunk *it, struct nn_list *msg_array);
-
-/*  Deallocate an entire message array. */
-void nn_msg_array_term (struct nn_list *msg_array);
 
 void nn_sws_init (struct nn_sws *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner);
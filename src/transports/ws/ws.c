@@ -26,11 +26,15 @@
 #include "bws.h"
 #include "cws.h"
 #include "sws.h"
+#include "ws_mask.h"
+#include "ws_utf8.h"
+#include "ws_deflate.h"
 
 #include "../../ws.h"
 
 #include "../utils/port.h"
 #include "../utils/iface.h"
+#include "../utils/dns.h"
 
 #include "../../utils/err.h"
 #include "../../utils/alloc.h"
@@ -49,6 +53,9 @@
 struct nn_ws_optset {
     struct nn_optset base;
     int msg_type;
+    int deflate;
+    int deflate_takeover;
+    int deflate_window_bits;
 };
 
 static void nn_ws_optset_destroy (struct nn_optset *self);
@@ -63,6 +70,8 @@ static const struct nn_optset_vfptr nn_ws_optset_vfptr = {
 };
 
 /*  nn_transport interface. */
+static void nn_ws_init (void);
+static void nn_ws_term (void);
 static int nn_ws_bind (struct nn_ep *);
 static int nn_ws_connect (struct nn_ep *);
 static struct nn_optset *nn_ws_optset (void);
@@ -70,13 +79,27 @@ static struct nn_optset *nn_ws_optset (void);
 struct nn_transport nn_ws = {
     "ws",
     NN_WS,
-    NULL,
-    NULL,
+    nn_ws_init,
+    nn_ws_term,
     nn_ws_bind,
     nn_ws_connect,
     nn_ws_optset,
 };
 
+static void nn_ws_init (void)
+{
+    /*  Select the payload masking and UTF-8 validation routines for
+        this CPU. */
+    nn_ws_mask_init ();
+    nn_ws_utf8_init ();
+}
+
+static void nn_ws_term (void)
+{
+    /*  Drop the host names resolved by the connecting endpoints. */
+    nn_dns_purge ();
+}
+
 static int nn_ws_bind (struct nn_ep *ep)
 {
     return nn_bws_create (ep);
@@ -97,6 +120,9 @@ static struct nn_optset *nn_ws_optset ()
 
     /*  Default values for WebSocket options. */
     optset->msg_type = NN_WS_MSG_TYPE_BINARY;
+    optset->deflate = 0;
+    optset->deflate_takeover = 1;
+    optset->deflate_window_bits = NN_WS_DEFLATE_MAX_WINDOW_BITS;
 
     return &optset->base;   
 }
@@ -131,6 +157,24 @@ static int nn_ws_optset_setopt (struct nn_optset *self, int option,
         default:
             return -EINVAL;
         }
+    case NN_WS_DEFLATE:
+        if (val != 0 && val != 1)
+            return -EINVAL;
+        if (val && !nn_ws_deflate_supported ())
+            return -EINVAL;
+        optset->deflate = val;
+        return 0;
+    case NN_WS_DEFLATE_TAKEOVER:
+        if (val != 0 && val != 1)
+            return -EINVAL;
+        optset->deflate_takeover = val;
+        return 0;
+    case NN_WS_DEFLATE_WINDOW_BITS:
+        if (val < NN_WS_DEFLATE_MIN_WINDOW_BITS ||
+              val > NN_WS_DEFLATE_MAX_WINDOW_BITS)
+            return -EINVAL;
+        optset->deflate_window_bits = val;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -149,6 +193,21 @@ static int nn_ws_optset_getopt (struct nn_optset *self, int option,
             *optvallen < sizeof (int) ? *optvallen : sizeof (int));
         *optvallen = sizeof (int);
         return 0;
+    case NN_WS_DEFLATE:
+        memcpy (optval, &optset->deflate,
+            *optvallen < sizeof (int) ? *optvallen : sizeof (int));
+        *optvallen = sizeof (int);
+        return 0;
+    case NN_WS_DEFLATE_TAKEOVER:
+        memcpy (optval, &optset->deflate_takeover,
+            *optvallen < sizeof (int) ? *optvallen : sizeof (int));
+        *optvallen = sizeof (int);
+        return 0;
+    case NN_WS_DEFLATE_WINDOW_BITS:
+        memcpy (optval, &optset->deflate_window_bits,
+            *optvallen < sizeof (int) ? *optvallen : sizeof (int));
+        *optvallen = sizeof (int);
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
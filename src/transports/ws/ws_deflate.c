@@ -0,0 +1,667 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "ws_deflate.h"
+#include "ws_handshake.h"
+
+#include "../../ws.h"
+
+#include "../../utils/err.h"
+#include "../../utils/chunk.h"
+#include "../../utils/clock.h"
+#include "../../utils/fast.h"
+#include "../../utils/strncasecmp.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/*  zlib's default level. Compression is meant for slow links where bytes on
+    the wire cost more than the extra CPU time the faster levels would save;
+    NN_STAT_COMPRESSION_TIME shows what it costs. */
+#define NN_WS_DEFLATE_LEVEL 6
+
+/*  Parameters as found in one element of the Sec-WebSocket-Extensions list.
+    Window sizes are zero if absent; client_bits is -1 if present without
+    a value. */
+struct nn_ws_deflate_ext {
+    int server_no_takeover;
+    int client_no_takeover;
+    int server_bits;
+    int client_bits;
+};
+
+#if defined NN_HAVE_ZLIB
+/*  Every message compressed with a sync flush ends with this. It is stripped
+    from the wire as per RFC 7692 section 7.2.1. */
+static const uint8_t nn_ws_deflate_trailer [4] = {0x00, 0x00, 0xff, 0xff};
+#endif
+
+static int nn_ws_deflate_isspace (char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static int nn_ws_deflate_match (const char *name, size_t len,
+    const char *ref)
+{
+    return len == strlen (ref) && nn_strncasecmp (name, ref, len) == 0;
+}
+
+/*  Window sizes are one or two digits, without leading zeros. */
+static int nn_ws_deflate_bits (const char *val, size_t len)
+{
+    if (len == 1 && val [0] >= '8' && val [0] <= '9')
+        return val [0] - '0';
+    if (len == 2 && val [0] == '1' && val [1] >= '0' && val [1] <= '5')
+        return 10 + val [1] - '0';
+    return -1;
+}
+
+/*  Parses the parameters following the extension name. Unknown, duplicate
+    and malformed parameters are all errors. */
+static int nn_ws_deflate_parse (const char *pos, const char *end,
+    struct nn_ws_deflate_ext *ext)
+{
+    const char *name;
+    size_t name_len;
+    const char *val;
+    size_t val_len;
+    int bits;
+
+    memset (ext, 0, sizeof (*ext));
+
+    while (1) {
+        while (pos != end && nn_ws_deflate_isspace (*pos))
+            ++pos;
+        if (pos == end)
+            return 0;
+        if (*pos != ';')
+            return -EPROTO;
+        ++pos;
+        while (pos != end && nn_ws_deflate_isspace (*pos))
+            ++pos;
+
+        name = pos;
+        while (pos != end && *pos != '=' && *pos != ';' &&
+              !nn_ws_deflate_isspace (*pos))
+            ++pos;
+        name_len = pos - name;
+        while (pos != end && nn_ws_deflate_isspace (*pos))
+            ++pos;
+
+        val = NULL;
+        val_len = 0;
+        if (pos != end && *pos == '=') {
+            ++pos;
+            while (pos != end && nn_ws_deflate_isspace (*pos))
+                ++pos;
+            if (pos != end && *pos == '"') {
+                val = ++pos;
+                while (pos != end && *pos != '"')
+                    ++pos;
+                if (pos == end)
+                    return -EPROTO;
+                val_len = pos - val;
+                ++pos;
+            }
+            else {
+                val = pos;
+                while (pos != end && *pos != ';' &&
+                      !nn_ws_deflate_isspace (*pos))
+                    ++pos;
+                val_len = pos - val;
+            }
+        }
+
+        if (nn_ws_deflate_match (name, name_len,
+              "server_no_context_takeover")) {
+            if (val || ext->server_no_takeover)
+                return -EPROTO;
+            ext->server_no_takeover = 1;
+        }
+        else if (nn_ws_deflate_match (name, name_len,
+              "client_no_context_takeover")) {
+            if (val || ext->client_no_takeover)
+                return -EPROTO;
+            ext->client_no_takeover = 1;
+        }
+        else if (nn_ws_deflate_match (name, name_len,
+              "server_max_window_bits")) {
+            if (!val || ext->server_bits)
+                return -EPROTO;
+            bits = nn_ws_deflate_bits (val, val_len);
+            if (bits < 0)
+                return -EPROTO;
+            ext->server_bits = bits;
+        }
+        else if (nn_ws_deflate_match (name, name_len,
+              "client_max_window_bits")) {
+            if (ext->client_bits)
+                return -EPROTO;
+            if (val) {
+                bits = nn_ws_deflate_bits (val, val_len);
+                if (bits < 0)
+                    return -EPROTO;
+                ext->client_bits = bits;
+            }
+            else
+                ext->client_bits = -1;
+        }
+        else
+            return -EPROTO;
+    }
+}
+
+/*  Finds the next permessage-deflate element of the extension list starting
+    at *pos. Returns 1 and sets [*params, *params_end) to its parameters if
+    there's one, 0 otherwise. */
+static int nn_ws_deflate_next (const char **pos, const char *end,
+    const char **params, const char **params_end)
+{
+    const char *elem;
+    const char *elem_end;
+    const char *name_end;
+    int quoted;
+
+    while (*pos != end) {
+
+        /*  Elements are separated by commas outside of quoted strings. */
+        elem = *pos;
+        quoted = 0;
+        while (*pos != end && (quoted || **pos != ',')) {
+            if (**pos == '"')
+                quoted = !quoted;
+            ++*pos;
+        }
+        elem_end = *pos;
+        if (*pos != end)
+            ++*pos;
+
+        while (elem != elem_end && nn_ws_deflate_isspace (*elem))
+            ++elem;
+        name_end = elem;
+        while (name_end != elem_end && *name_end != ';' &&
+              !nn_ws_deflate_isspace (*name_end))
+            ++name_end;
+        if (nn_ws_deflate_match (elem, name_end - elem, NN_WS_DEFLATE_EXT)) {
+            *params = name_end;
+            *params_end = elem_end;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int nn_ws_deflate_supported (void)
+{
+#if defined NN_HAVE_ZLIB
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void nn_ws_deflate_configure (struct nn_ws_deflate_params *self,
+    struct nn_ep *ep)
+{
+    int val;
+    size_t sz;
+
+    sz = sizeof (val);
+    nn_ep_getopt (ep, NN_WS, NN_WS_DEFLATE, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    self->enabled = val;
+
+    sz = sizeof (val);
+    nn_ep_getopt (ep, NN_WS, NN_WS_DEFLATE_TAKEOVER, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    self->server_no_takeover = !val;
+    self->client_no_takeover = !val;
+
+    sz = sizeof (val);
+    nn_ep_getopt (ep, NN_WS, NN_WS_DEFLATE_WINDOW_BITS, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    self->server_bits = val;
+    self->client_bits = val;
+}
+
+void nn_ws_deflate_offer (const struct nn_ws_deflate_params *local,
+    char *buf, size_t len)
+{
+    int rc;
+
+    /*  The client always announces it can limit its window, so that servers
+        short of memory are free to ask for it. */
+    if (local->client_bits < NN_WS_DEFLATE_MAX_WINDOW_BITS)
+        rc = snprintf (buf, len, "%s; client_max_window_bits=%d",
+            NN_WS_DEFLATE_EXT, local->client_bits);
+    else
+        rc = snprintf (buf, len, "%s; client_max_window_bits",
+            NN_WS_DEFLATE_EXT);
+    nn_assert (rc > 0 && (size_t) rc < len);
+
+    if (local->server_bits < NN_WS_DEFLATE_MAX_WINDOW_BITS) {
+        rc += snprintf (buf + rc, len - rc, "; server_max_window_bits=%d",
+            local->server_bits);
+        nn_assert ((size_t) rc < len);
+    }
+    if (local->server_no_takeover) {
+        rc += snprintf (buf + rc, len - rc,
+            "; server_no_context_takeover; client_no_context_takeover");
+        nn_assert ((size_t) rc < len);
+    }
+}
+
+void nn_ws_deflate_accept (const struct nn_ws_deflate_params *local,
+    const char *ext, size_t ext_len, struct nn_ws_deflate_params *result,
+    char *buf, size_t len)
+{
+    int rc;
+    const char *pos;
+    const char *end;
+    const char *params;
+    const char *params_end;
+    struct nn_ws_deflate_ext offer;
+
+    memset (result, 0, sizeof (*result));
+    nn_assert (len > 0);
+    buf [0] = 0;
+
+    if (!local->enabled || !ext)
+        return;
+
+    /*  Offers are in order of the client's preference. Those that can't be
+        parsed are declined rather than failing the handshake. */
+    pos = ext;
+    end = ext + ext_len;
+    while (nn_ws_deflate_next (&pos, end, &params, &params_end)) {
+        if (nn_ws_deflate_parse (params, params_end, &offer) < 0)
+            continue;
+
+        result->enabled = 1;
+        result->server_no_takeover = local->server_no_takeover ||
+            offer.server_no_takeover;
+        result->client_no_takeover = local->client_no_takeover ||
+            offer.client_no_takeover;
+
+        /*  Server's own window must not exceed what the client asked for. */
+        result->server_bits = local->server_bits;
+        if (offer.server_bits && offer.server_bits < result->server_bits)
+            result->server_bits = offer.server_bits;
+
+        /*  Client's window can only be limited if it said it supports it. */
+        result->client_bits = NN_WS_DEFLATE_MAX_WINDOW_BITS;
+        if (offer.client_bits) {
+            result->client_bits = local->client_bits;
+            if (offer.client_bits > 0 &&
+                  offer.client_bits < result->client_bits)
+                result->client_bits = offer.client_bits;
+        }
+
+        rc = snprintf (buf, len, "%s", NN_WS_DEFLATE_EXT);
+        if (result->server_no_takeover)
+            rc += snprintf (buf + rc, len - rc,
+                "; server_no_context_takeover");
+        if (result->client_no_takeover)
+            rc += snprintf (buf + rc, len - rc,
+                "; client_no_context_takeover");
+        if (offer.server_bits)
+            rc += snprintf (buf + rc, len - rc,
+                "; server_max_window_bits=%d", result->server_bits);
+        if (offer.client_bits &&
+              result->client_bits < NN_WS_DEFLATE_MAX_WINDOW_BITS)
+            rc += snprintf (buf + rc, len - rc,
+                "; client_max_window_bits=%d", result->client_bits);
+        nn_assert ((size_t) rc < len);
+        return;
+    }
+}
+
+int nn_ws_deflate_confirm (const struct nn_ws_deflate_params *local,
+    const char *ext, size_t ext_len, struct nn_ws_deflate_params *result)
+{
+    const char *pos;
+    const char *end;
+    const char *params;
+    const char *params_end;
+    struct nn_ws_deflate_ext resp;
+
+    memset (result, 0, sizeof (*result));
+
+    if (!ext)
+        return 0;
+    pos = ext;
+    end = ext + ext_len;
+    if (!nn_ws_deflate_next (&pos, end, &params, &params_end))
+        return 0;
+
+    /*  The server may only accept what was offered, exactly once. */
+    if (!local->enabled)
+        return -EPROTO;
+    if (nn_ws_deflate_parse (params, params_end, &resp) < 0)
+        return -EPROTO;
+    if (nn_ws_deflate_next (&pos, end, &params, &params_end))
+        return -EPROTO;
+    if (resp.client_bits < 0)
+        return -EPROTO;
+    if (resp.server_bits && resp.server_bits > local->server_bits)
+        return -EPROTO;
+
+    result->enabled = 1;
+    result->server_no_takeover = resp.server_no_takeover;
+    result->client_no_takeover = resp.client_no_takeover ||
+        local->client_no_takeover;
+    result->server_bits = resp.server_bits ? resp.server_bits :
+        NN_WS_DEFLATE_MAX_WINDOW_BITS;
+    result->client_bits = local->client_bits;
+    if (resp.client_bits && resp.client_bits < result->client_bits)
+        result->client_bits = resp.client_bits;
+
+    return 0;
+}
+
+void nn_ws_deflate_init (struct nn_ws_deflate *self,
+    struct nn_pipebase *pipebase)
+{
+    self->pipebase = pipebase;
+    self->out_bits = 0;
+    self->in_bits = 0;
+    self->out_reset = 0;
+    self->in_reset = 0;
+    self->threshold = 0;
+    self->active = 0;
+#if defined NN_HAVE_ZLIB
+    self->deflater_ready = 0;
+    self->inflater_ready = 0;
+#endif
+}
+
+void nn_ws_deflate_term (struct nn_ws_deflate *self)
+{
+#if defined NN_HAVE_ZLIB
+    if (self->deflater_ready)
+        deflateEnd (&self->deflater);
+    if (self->inflater_ready)
+        inflateEnd (&self->inflater);
+#endif
+    self->active = 0;
+}
+
+void nn_ws_deflate_start (struct nn_ws_deflate *self,
+    const struct nn_ws_deflate_params *params, int mode)
+{
+    int opt;
+    size_t opt_sz = sizeof (opt);
+
+    self->active = params->enabled;
+    if (!self->active)
+        return;
+
+    if (mode == NN_WS_SERVER) {
+        self->out_bits = params->server_bits;
+        self->out_reset = params->server_no_takeover;
+        self->in_bits = params->client_bits;
+        self->in_reset = params->client_no_takeover;
+    }
+    else {
+        self->out_bits = params->client_bits;
+        self->out_reset = params->client_no_takeover;
+        self->in_bits = params->server_bits;
+        self->in_reset = params->server_no_takeover;
+    }
+
+    /*  The peer may have asked for a window zlib can't produce. Sending
+        everything uncompressed is the only way to comply. Inflating with
+        a larger window than the peer's is always fine. */
+    if (self->out_bits < NN_WS_DEFLATE_MIN_WINDOW_BITS)
+        self->out_bits = 0;
+    if (self->in_bits < NN_WS_DEFLATE_MIN_WINDOW_BITS)
+        self->in_bits = NN_WS_DEFLATE_MIN_WINDOW_BITS;
+
+    nn_pipebase_getopt (self->pipebase, NN_SOL_SOCKET,
+        NN_COMPRESSION_THRESHOLD, &opt, &opt_sz);
+    nn_assert (opt_sz == sizeof (opt) && opt >= 0);
+    self->threshold = (size_t) opt;
+}
+
+int nn_ws_deflate_msg (struct nn_ws_deflate *self, struct nn_msg *msg)
+{
+#if defined NN_HAVE_ZLIB
+    int rc;
+    int zrc;
+    int ok;
+    size_t sphdrlen;
+    size_t bodylen;
+    size_t srclen;
+    size_t cap;
+    size_t len;
+    void *chunk;
+    uint64_t start;
+
+    if (!self->active || !self->out_bits)
+        return 0;
+
+    sphdrlen = nn_chunkref_size (&msg->sphdr);
+    bodylen = nn_chunkref_size (&msg->body);
+    srclen = sphdrlen + bodylen;
+    if (srclen < self->threshold || srclen == 0 || srclen > INT_MAX)
+        return 0;
+
+    start = nn_clock_us ();
+
+    /*  Memory taken by the compressor is dominated by its hash table, so it
+        is scaled down with the window: zlib's default for the full one. */
+    if (!self->deflater_ready) {
+        memset (&self->deflater, 0, sizeof (self->deflater));
+        zrc = deflateInit2 (&self->deflater, NN_WS_DEFLATE_LEVEL, Z_DEFLATED,
+            -self->out_bits, self->out_bits - 7, Z_DEFAULT_STRATEGY);
+        nn_assert (zrc == Z_OK);
+        self->deflater_ready = 1;
+    }
+
+    /*  The output buffer is sized so that the codec gives up as soon as the
+        message, less the trailer, would not be shorter than the original. */
+    cap = srclen + sizeof (nn_ws_deflate_trailer) - 1;
+    rc = nn_chunk_alloc (cap, 0, &chunk);
+    errnum_assert (rc == 0, -rc);
+    self->deflater.next_out = chunk;
+    self->deflater.avail_out = (uInt) cap;
+
+    /*  SP header and body are fed to the compressor one after another,
+        without copying them into a contiguous buffer. */
+    zrc = Z_OK;
+    if (sphdrlen) {
+        self->deflater.next_in = nn_chunkref_data (&msg->sphdr);
+        self->deflater.avail_in = (uInt) sphdrlen;
+        zrc = deflate (&self->deflater, Z_NO_FLUSH);
+    }
+    if (zrc == Z_OK && self->deflater.avail_in == 0) {
+        self->deflater.next_in = nn_chunkref_data (&msg->body);
+        self->deflater.avail_in = (uInt) bodylen;
+        zrc = deflate (&self->deflater, Z_SYNC_FLUSH);
+    }
+    len = cap - self->deflater.avail_out;
+    ok = zrc == Z_OK && self->deflater.avail_in == 0 &&
+        self->deflater.avail_out != 0 &&
+        len >= sizeof (nn_ws_deflate_trailer) &&
+        memcmp ((uint8_t*) chunk + len - sizeof (nn_ws_deflate_trailer),
+        nn_ws_deflate_trailer, sizeof (nn_ws_deflate_trailer)) == 0;
+    if (ok)
+        len -= sizeof (nn_ws_deflate_trailer);
+
+    nn_pipebase_stat_increment (self->pipebase, NN_STAT_COMPRESSION_TIME,
+        (int64_t) (nn_clock_us () - start));
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_COMPRESSION_MESSAGES, 1);
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_COMPRESSION_BYTES_IN, (int64_t) srclen);
+
+    /*  The message is sent as it is. The peer won't see the data that went
+        into the compressor, so it must be dropped from the context. */
+    if (!ok || len >= srclen) {
+        deflateReset (&self->deflater);
+        nn_chunk_free (chunk);
+        nn_pipebase_stat_increment (self->pipebase,
+            NN_STAT_COMPRESSION_BYTES_OUT, (int64_t) srclen);
+        return 0;
+    }
+    if (self->out_reset)
+        deflateReset (&self->deflater);
+
+    /*  Shrinking a chunk never moves it. */
+    rc = nn_chunk_realloc (len, &chunk);
+    errnum_assert (rc == 0, -rc);
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_COMPRESSION_BYTES_OUT, (int64_t) len);
+
+    nn_chunkref_term (&msg->sphdr);
+    nn_chunkref_init (&msg->sphdr, 0);
+    nn_chunkref_term (&msg->body);
+    nn_chunkref_init_chunk (&msg->body, chunk);
+
+    return 1;
+#else
+    nn_assert (!self->active);
+    (void) msg;
+    return 0;
+#endif
+}
+
+int nn_ws_inflate_buf (struct nn_ws_deflate *self, const void *src,
+    size_t srclen, struct nn_chunkref *dst)
+{
+#if defined NN_HAVE_ZLIB
+    int rc;
+    int zrc;
+    int opt;
+    size_t opt_sz = sizeof (opt);
+    size_t maxsize;
+    size_t cap;
+    size_t len;
+    void *chunk;
+    uint64_t start;
+    int trailer;
+
+    /*  Compressed messages are only valid once the extension was agreed
+        on. */
+    if (!self->active)
+        return -EPROTO;
+    if (srclen > INT_MAX)
+        return -EMSGSIZE;
+
+    nn_pipebase_getopt (self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &opt, &opt_sz);
+    maxsize = opt < 0 ? INT_MAX : (size_t) opt;
+
+    start = nn_clock_us ();
+
+    if (!self->inflater_ready) {
+        memset (&self->inflater, 0, sizeof (self->inflater));
+        zrc = inflateInit2 (&self->inflater, -self->in_bits);
+        nn_assert (zrc == Z_OK);
+        self->inflater_ready = 1;
+    }
+
+    /*  Size of the original message is not known in advance. The guess is
+        grown as needed, up to one byte past the limit to detect overflow. */
+    cap = srclen * 4 + 64;
+    if (cap > maxsize + 1)
+        cap = maxsize + 1;
+    rc = nn_chunk_alloc (cap, 0, &chunk);
+    errnum_assert (rc == 0, -rc);
+    len = 0;
+
+    self->inflater.next_in = (Bytef*) src;
+    self->inflater.avail_in = (uInt) srclen;
+    trailer = 0;
+    while (1) {
+        self->inflater.next_out = (uint8_t*) chunk + len;
+        self->inflater.avail_out = (uInt) (cap - len);
+        zrc = inflate (&self->inflater, Z_SYNC_FLUSH);
+        len = cap - self->inflater.avail_out;
+
+        /*  The peer ended the stream with a final block. What follows, if
+            anything, is ignored and the next message starts a new stream. */
+        if (zrc == Z_STREAM_END) {
+            inflateReset (&self->inflater);
+            break;
+        }
+        if (zrc != Z_OK && zrc != Z_BUF_ERROR) {
+            rc = -EPROTO;
+            goto fail;
+        }
+
+        if (self->inflater.avail_out == 0) {
+            if (len > maxsize) {
+                rc = -EMSGSIZE;
+                goto fail;
+            }
+            cap = cap * 2 > maxsize + 1 ? maxsize + 1 : cap * 2;
+            rc = nn_chunk_realloc (cap, &chunk);
+            errnum_assert (rc == 0, -rc);
+            continue;
+        }
+
+        /*  All input was consumed and all output produced. The trailer
+            stripped by the peer is fed to the inflater to complete the
+            last block. */
+        if (self->inflater.avail_in == 0) {
+            if (trailer)
+                break;
+            self->inflater.next_in = (Bytef*) nn_ws_deflate_trailer;
+            self->inflater.avail_in = sizeof (nn_ws_deflate_trailer);
+            trailer = 1;
+            continue;
+        }
+
+        /*  No progress despite space on both sides. */
+        rc = -EPROTO;
+        goto fail;
+    }
+    if (self->in_reset)
+        inflateReset (&self->inflater);
+
+    nn_pipebase_stat_increment (self->pipebase, NN_STAT_DECOMPRESSION_TIME,
+        (int64_t) (nn_clock_us () - start));
+    nn_pipebase_stat_increment (self->pipebase,
+        NN_STAT_DECOMPRESSION_MESSAGES, 1);
+
+    rc = nn_chunk_realloc (len, &chunk);
+    errnum_assert (rc == 0, -rc);
+    nn_chunkref_init_chunk (dst, chunk);
+    return 0;
+
+fail:
+    inflateReset (&self->inflater);
+    nn_chunk_free (chunk);
+    return rc;
+#else
+    nn_assert (!self->active);
+    (void) src;
+    (void) srclen;
+    (void) dst;
+    return -EPROTO;
+#endif
+}
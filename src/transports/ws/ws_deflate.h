@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_WS_DEFLATE_INCLUDED
+#define NN_WS_DEFLATE_INCLUDED
+
+#include "../../transport.h"
+
+#include "../../utils/chunkref.h"
+#include "../../utils/msg.h"
+
+#include <stddef.h>
+
+#if defined NN_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/*  RFC 7692 permessage-deflate extension. The extension is negotiated in the
+    opening handshake through the Sec-WebSocket-Extensions header. Afterwards
+    each data message may be compressed on its own, in which case RSV1 is set
+    on its first frame. */
+
+#define NN_WS_DEFLATE_EXT "permessage-deflate"
+
+/*  Range of LZ77 window sizes (base-2 logarithm). zlib can't produce
+    streams for 256-byte windows, so these are accepted from peers but never
+    configured locally. */
+#define NN_WS_DEFLATE_MIN_WINDOW_BITS 9
+#define NN_WS_DEFLATE_MAX_WINDOW_BITS 15
+
+/*  Parameters of the extension as per RFC 7692 section 7.1. */
+struct nn_ws_deflate_params {
+
+    /*  Zero if the extension is not in use. */
+    int enabled;
+
+    /*  Whether the server and the client, respectively, start each message
+        with an empty compression context. */
+    int server_no_takeover;
+    int client_no_takeover;
+
+    /*  Window sizes used by the compressors of the server and the client,
+        respectively. */
+    int server_bits;
+    int client_bits;
+};
+
+/*  Returns 1 if this build supports permessage-deflate, 0 otherwise. */
+int nn_ws_deflate_supported (void);
+
+/*  Fills in the local configuration from the NN_WS_DEFLATE* options. */
+void nn_ws_deflate_configure (struct nn_ws_deflate_params *self,
+    struct nn_ep *ep);
+
+/*  Formats the client's offer into the buffer. */
+void nn_ws_deflate_offer (const struct nn_ws_deflate_params *local,
+    char *buf, size_t len);
+
+/*  Server side. Looks for an acceptable offer in the value of the client's
+    Sec-WebSocket-Extensions header. If there's one, fills in 'result' and
+    formats the response into the buffer; otherwise result->enabled is
+    zero and the buffer holds an empty string. */
+void nn_ws_deflate_accept (const struct nn_ws_deflate_params *local,
+    const char *ext, size_t ext_len, struct nn_ws_deflate_params *result,
+    char *buf, size_t len);
+
+/*  Client side. Checks the server's response against the offer made and
+    fills in 'result'. Returns -EPROTO if the server answered with
+    parameters that weren't offered. */
+int nn_ws_deflate_confirm (const struct nn_ws_deflate_params *local,
+    const char *ext, size_t ext_len, struct nn_ws_deflate_params *result);
+
+struct nn_ws_deflate {
+
+    /*  Pipe the compressed messages travel through. */
+    struct nn_pipebase *pipebase;
+
+    /*  Window sizes for outbound and inbound messages. Outbound messages are
+        not compressed if the window is zero. */
+    int out_bits;
+    int in_bits;
+
+    /*  Whether the compression contexts are reset after each message. */
+    int out_reset;
+    int in_reset;
+
+    /*  Messages shorter than this are sent as they are. */
+    size_t threshold;
+
+    /*  Zero if the extension is not in use on this connection. */
+    int active;
+
+#if defined NN_HAVE_ZLIB
+    /*  The compression contexts, set up on first use. */
+    z_stream deflater;
+    z_stream inflater;
+    int deflater_ready;
+    int inflater_ready;
+#endif
+};
+
+void nn_ws_deflate_init (struct nn_ws_deflate *self,
+    struct nn_pipebase *pipebase);
+void nn_ws_deflate_term (struct nn_ws_deflate *self);
+
+/*  Starts compressing according to the negotiated parameters. */
+void nn_ws_deflate_start (struct nn_ws_deflate *self,
+    const struct nn_ws_deflate_params *params, int mode);
+
+/*  Returns 1 if the message was worth compressing and was replaced by its
+    compressed form, 0 if it was left intact. */
+int nn_ws_deflate_msg (struct nn_ws_deflate *self, struct nn_msg *msg);
+
+/*  Decompresses 'srclen' bytes of a message received from the peer into
+    a newly initialised 'dst'. Returns -EPROTO if the data is malformed or
+    -EMSGSIZE if the original message exceeds NN_RCVMAXSIZE; 'dst' is left
+    uninitialised in such case. */
+int nn_ws_inflate_buf (struct nn_ws_deflate *self, const void *src,
+    size_t srclen, struct nn_chunkref *dst);
+
+#endif
@@ -30,6 +30,7 @@
 #include "../../core/sock.h"
 
 #include "../utils/base64.h"
+#include "../utils/compress.h"
 
 #include "../../utils/alloc.h"
 #include "../../utils/err.h"
@@ -38,7 +39,7 @@
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
 #include "../../utils/random.h"
-#include "../../utils/strcasestr.h"
+#include "../../utils/strncasecmp.h"
 
 #include <stddef.h>
 #include <string.h>
@@ -130,6 +131,10 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self);
 static void nn_ws_handshake_server_reply (struct nn_ws_handshake *self);
 static void nn_ws_handshake_client_request (struct nn_ws_handshake *self);
 static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self);
+static int nn_ws_handshake_received (struct nn_ws_handshake *self,
+    const char *buf);
+static int nn_ws_handshake_recv (struct nn_ws_handshake *self, char *buf,
+    size_t bufsz);
 static int nn_ws_handshake_hash_key (const char *key, size_t key_len,
     char *hashed, size_t hashed_len);
 
@@ -152,11 +157,29 @@ static int nn_ws_match_value (const char* termseq, const char **subj,
     int ignore_leading_sp, int ignore_trailing_sp, const char **addr,
     size_t* const len);
 
+/*  Splits the header field line at the subject position into its name and
+    its value, the latter without leading and trailing spaces, and advances
+    the subject pointer to the next line. Returns NN_WS_HANDSHAKE_MATCH on
+    success; else, NN_WS_HANDSHAKE_NOMATCH. */
+static int nn_ws_match_field (const char **subj, const char **name,
+    size_t *name_len, const char **value, size_t *value_len);
+
+/*  Looks for token in a comma-separated list of them, ignoring case. Returns
+    pointer to the list item found or NULL if there's no such item. */
+static const char *nn_ws_match_list (const char *token, const char *list,
+    size_t list_len);
+
 /*  Compares subject octet stream to expected value, optionally ignoring
     case sensitivity. Returns non-zero on success, zero on failure. */
 static int nn_ws_validate_value (const char* expected, const char *subj,
     size_t subj_len, int case_insensitive);
 
+/*  Looks for the nanomsg compression extension in the value of
+    Sec-WebSocket-Extensions header. Returns the value of its parameter,
+    or zero if either the extension or the parameter is not present. */
+static int nn_ws_handshake_compress_param (const char *ext, size_t ext_len,
+    const char *param);
+
 void nn_ws_handshake_init (struct nn_ws_handshake *self, int src,
     struct nn_fsm *owner)
 {
@@ -170,6 +193,10 @@ void nn_ws_handshake_init (struct nn_ws_handshake *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     self->pipebase = NULL;
+    self->codecs = 0;
+    self->compression = 0;
+    memset (&self->deflate_local, 0, sizeof (self->deflate_local));
+    memset (&self->deflate, 0, sizeof (self->deflate));
 }
 
 void nn_ws_handshake_term (struct nn_ws_handshake *self)
@@ -188,8 +215,11 @@ int nn_ws_handshake_isidle (struct nn_ws_handshake *self)
 
 void nn_ws_handshake_start (struct nn_ws_handshake *self,
     struct nn_usock *usock, struct nn_pipebase *pipebase,
-    int mode, const char *resource, const char *host)
+    int mode, const char *resource, const char *host,
+    const struct nn_ws_deflate_params *deflate)
 {
+    size_t sz;
+
     /*  It's expected this resource has been allocated during intial connect. */
     if (mode == NN_WS_CLIENT)
         nn_assert (strlen (resource) >= 1);
@@ -211,9 +241,17 @@ void nn_ws_handshake_start (struct nn_ws_handshake *self,
     self->recv_pos = 0;
     self->retries = 0;
 
+    /*  Get the compression codecs this endpoint is willing to use. */
+    sz = sizeof (self->codecs);
+    nn_pipebase_getopt (pipebase, NN_SOL_SOCKET, NN_COMPRESSION,
+        &self->codecs, &sz);
+    nn_assert (sz == sizeof (self->codecs));
+    self->compression = 0;
+    self->deflate_local = *deflate;
+    memset (&self->deflate, 0, sizeof (self->deflate));
+
     /*  Calculate the absolute minimum length possible for a valid opening
-        handshake. This is an optimization since we must poll for the
-        remainder of the opening handshake in small byte chunks. */
+        handshake. Receiving it can't overshoot the end of the handshake. */
     switch (self->mode) {
     case NN_WS_SERVER:
         self->recv_len = strlen (
@@ -389,13 +427,67 @@ static int nn_ws_validate_value (const char* expected, const char *subj,
     return NN_WS_HANDSHAKE_MATCH;
 }
 
+static int nn_ws_match_field (const char **subj, const char **name,
+    size_t *name_len, const char **value, size_t *value_len)
+{
+    const char *pos;
+    const char *end;
+
+    /*  Field name extends up to the colon. */
+    pos = *subj;
+    while (*pos != ':') {
+        if (!*pos || *pos == '\r' || *pos == '\n')
+            return NN_WS_HANDSHAKE_NOMATCH;
+        pos++;
+    }
+    *name = *subj;
+    *name_len = pos - *subj;
+
+    /*  Field value extends up to the end of the line. */
+    pos++;
+    while (*pos == '\x20')
+        pos++;
+    end = strchr (pos, '\r');
+    if (!end || end [1] != '\n')
+        return NN_WS_HANDSHAKE_NOMATCH;
+    *subj = end + 2;
+    while (end > pos && *(end - 1) == '\x20')
+        end--;
+    *value = pos;
+    *value_len = end - pos;
+
+    return NN_WS_HANDSHAKE_MATCH;
+}
+
+static const char *nn_ws_match_list (const char *token, const char *list,
+    size_t list_len)
+{
+    const char *end;
+    const char *item;
+    size_t item_len;
+
+    end = list + list_len;
+    while (list < end) {
+        while (list < end && (*list == '\x20' || *list == ','))
+            list++;
+        item = list;
+        while (list < end && *list != ',')
+            list++;
+        item_len = list - item;
+        while (item_len && item [item_len - 1] == '\x20')
+            item_len--;
+        if (item_len && nn_ws_validate_value (token, item, item_len, 1))
+            return item;
+    }
+
+    return NULL;
+}
+
 static void nn_ws_handshake_handler (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
     struct nn_ws_handshake *handshaker;
 
-    size_t i;
-
     handshaker = nn_cont (self, struct nn_ws_handshake, fsm);
 
     switch (handshaker->state) {
@@ -470,54 +562,19 @@ static void nn_ws_handshake_handler (struct nn_fsm *self, int src, int type,
                 case NN_WS_HANDSHAKE_RECV_MORE:
                     /*  Not enough bytes have been received to determine
                         validity; remain in the receive state, and retrieve
-                        more bytes from client. */
-                    handshaker->recv_pos += handshaker->recv_len;
-
-                    /*  Validate the previous recv operation. */
-                    nn_assert (handshaker->recv_pos <
-                        sizeof (handshaker->opening_hs));
-
-                    /*  Ensure we can back-track at least the length of the
-                        termination sequence to determine how many bytes to
-                        receive on the next retry. This is an assertion, not
-                        a conditional, since under no condition is it
-                        necessary to initially receive so few bytes. */
-                    nn_assert (handshaker->recv_pos >=
-                        (int) NN_WS_HANDSHAKE_TERMSEQ_LEN);
-
-                    /*  We only compare if we have at least one byte to
-                        compare against.  When i drops to zero, it means
-                        we don't have any bytes to match against, and it is
-                        automatically true. */
-                    for (i = NN_WS_HANDSHAKE_TERMSEQ_LEN; i > 0; i--) {
-                        if (memcmp (NN_WS_HANDSHAKE_TERMSEQ,
-                            handshaker->opening_hs + handshaker->recv_pos - i,
-                            i) == 0) {
-                            break;
-                        }
-                    }
-
-                    nn_assert (i < NN_WS_HANDSHAKE_TERMSEQ_LEN);
-
-                    handshaker->recv_len = NN_WS_HANDSHAKE_TERMSEQ_LEN - i;
-
-                    /*  In the unlikely case the client would overflow what we
-                        assumed was a sufficiently-large buffer to receive the
-                        handshake, we fail the client. */
-                    if (handshaker->recv_len + handshaker->recv_pos >
-                        sizeof (handshaker->opening_hs)) {
+                        more bytes from client. In the unlikely case the
+                        client would overflow what we assumed was
+                        a sufficiently-large buffer to receive the handshake,
+                        we fail the client. */
+                    if (nn_ws_handshake_recv (handshaker,
+                          handshaker->opening_hs,
+                          sizeof (handshaker->opening_hs)) < 0) {
                         handshaker->response_code =
                             NN_WS_HANDSHAKE_RESPONSE_TOO_BIG;
                         handshaker->state =
                             NN_WS_HANDSHAKE_STATE_SERVER_REPLY;
                         nn_ws_handshake_server_reply (handshaker);
                     }
-                    else {
-                        handshaker->retries++;
-                        nn_usock_recv (handshaker->usock,
-                            handshaker->opening_hs + handshaker->recv_pos,
-                            handshaker->recv_len, NULL);
-                    }
                     return;
                 default:
                     nn_fsm_error ("Unexpected handshake result",
@@ -652,49 +709,17 @@ static void nn_ws_handshake_handler (struct nn_fsm *self, int src, int type,
                 case NN_WS_HANDSHAKE_RECV_MORE:
                     /*  Not enough bytes have been received to determine
                         validity; remain in the receive state, and retrieve
-                        more bytes from client. */
-                    handshaker->recv_pos += handshaker->recv_len;
-
-                    /*  Validate the previous recv operation. */
-                    nn_assert (handshaker->recv_pos <
-                        sizeof (handshaker->response));
-
-                    /*  Ensure we can back-track at least the length of the
-                        termination sequence to determine how many bytes to
-                        receive on the next retry. This is an assertion, not
-                        a conditional, since under no condition is it
-                        necessary to initially receive so few bytes. */
-                    nn_assert (handshaker->recv_pos >=
-                        (int) NN_WS_HANDSHAKE_TERMSEQ_LEN);
-
-                    /*  If i goes to 0, it no need to compare. */
-                    for (i = NN_WS_HANDSHAKE_TERMSEQ_LEN; i > 0; i--) {
-                        if (memcmp (NN_WS_HANDSHAKE_TERMSEQ,
-                            handshaker->response + handshaker->recv_pos - i,
-                            i) == 0) {
-                            break;
-                        }
-                    }
-
-                    nn_assert (i < NN_WS_HANDSHAKE_TERMSEQ_LEN);
-
-                    handshaker->recv_len = NN_WS_HANDSHAKE_TERMSEQ_LEN - i;
-
-                    /*  In the unlikely case the client would overflow what we
-                        assumed was a sufficiently-large buffer to receive the
-                        handshake, we fail the connection. */
-                    if (handshaker->recv_len + handshaker->recv_pos >
-                        sizeof (handshaker->response)) {
+                        more bytes from server. In the unlikely case the
+                        server would overflow what we assumed was
+                        a sufficiently-large buffer to receive the handshake,
+                        we fail the connection. */
+                    if (nn_ws_handshake_recv (handshaker,
+                          handshaker->response,
+                          sizeof (handshaker->response)) < 0) {
                         nn_timer_stop (&handshaker->timer);
                         handshaker->state =
                             NN_WS_HANDSHAKE_STATE_STOPPING_TIMER_ERROR;
                     }
-                    else {
-                        handshaker->retries++;
-                        nn_usock_recv (handshaker->usock,
-                            handshaker->response + handshaker->recv_pos,
-                            handshaker->recv_len, NULL);
-                    }
                     return;
                 default:
                     nn_fsm_error ("Unexpected handshake result",
@@ -853,8 +878,12 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
         reserved for accepted connections, not as fields within these
         headers. */
 
-    int rc;
     const char *pos;
+    const char *name;
+    size_t name_len;
+    const char *value;
+    size_t value_len;
+    const char *conn;
     unsigned i;
 
     /*  Guarantee that a NULL terminator exists to enable treating this
@@ -868,7 +897,7 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
     pos = self->opening_hs;
 
     /*  Is the opening handshake from the client fully received? */
-    if (!strstr (pos, NN_WS_HANDSHAKE_TERMSEQ))
+    if (!nn_ws_handshake_received (self, self->opening_hs))
         return NN_WS_HANDSHAKE_RECV_MORE;
 
     self->host = NULL;
@@ -879,6 +908,7 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
     self->version = NULL;
     self->protocol = NULL;
     self->uri = NULL;
+    self->extensions = NULL;
 
     self->host_len = 0;
     self->origin_len = 0;
@@ -888,6 +918,7 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
     self->version_len = 0;
     self->protocol_len = 0;
     self->uri_len = 0;
+    self->extensions_len = 0;
 
     /*  NB: If we got here, we already have a fully received set of
         HTTP headers.  So there is no point in asking for more if the
@@ -901,95 +932,77 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
     /*  RFC 7230 3.1.1 Request Line: HTTP Method
         Note requirement of one space and case sensitivity. */
     if (!nn_ws_match_token ("GET\x20", &pos, 0, 0))
-        return NN_WS_HANDSHAKE_INVALID;
+        goto malformed;
 
     /*  RFC 7230 3.1.1 Request Line: Requested Resource. */
     if (!nn_ws_match_value ("\x20", &pos, 0, 0, &self->uri, &self->uri_len))
-        return NN_WS_HANDSHAKE_INVALID;
+        goto malformed;
 
     /*  RFC 7230 3.1.1 Request Line: HTTP version. Note case sensitivity. */
     if (!nn_ws_match_token ("HTTP/1.1", &pos, 0, 0))
-        return NN_WS_HANDSHAKE_INVALID;
+        goto malformed;
 
     if (!nn_ws_match_token (CRLF, &pos, 0, 0))
-        return NN_WS_HANDSHAKE_INVALID;
+        goto malformed;
 
     /*  It's expected the current position is now at the first
-        header field. Match them one by one. */
-    while (strlen (pos))
-    {
-        const char *conn = NULL;
-        size_t conn_len = 0;
-        if (nn_ws_match_token ("Host:", &pos, 1, 0)) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->host, &self->host_len);
+        header field. Split them one by one and pick the known ones by name,
+        in a single pass over the handshake. */
+    while (!nn_ws_match_token (CRLF, &pos, 0, 0)) {
+        if (!nn_ws_match_field (&pos, &name, &name_len, &value, &value_len))
+            goto malformed;
+        if (nn_ws_validate_value ("Host", name, name_len, 1)) {
+            self->host = value;
+            self->host_len = value_len;
         }
-        else if (nn_ws_match_token ("Origin:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->origin, &self->origin_len);
+        else if (nn_ws_validate_value ("Origin", name, name_len, 1)) {
+            self->origin = value;
+            self->origin_len = value_len;
         }
-        else if (nn_ws_match_token ("Sec-WebSocket-Key:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->key, &self->key_len);
+        else if (nn_ws_validate_value ("Sec-WebSocket-Key",
+              name, name_len, 1)) {
+            self->key = value;
+            self->key_len = value_len;
         }
-        else if (nn_ws_match_token ("Upgrade:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->upgrade, &self->upgrade_len);
+        else if (nn_ws_validate_value ("Upgrade", name, name_len, 1)) {
+            self->upgrade = value;
+            self->upgrade_len = value_len;
         }
-        else if (nn_ws_match_token ("Connection:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1, &conn, &conn_len);
+        else if (nn_ws_validate_value ("Connection", name, name_len, 1)) {
 
             /*  The values here can be comma delimited, or they can be
                 listed as separate Connection headers.  We only care about
-                the presence of the Upgrade header, and we're willing to
-                assume well-formedness.  This crummy parse may let clients
-                send us a malformed header that we ought to reject, but
-                we'll just cite Postel's law here if anyone asks. */
-            self->conn = nn_strcasestr (conn, "upgrade");
-            if (self->conn != NULL) {
-                self->conn_len = strlen ("upgrade");
+                the presence of the Upgrade header. */
+            conn = nn_ws_match_list ("Upgrade", value, value_len);
+            if (conn) {
+                self->conn = conn;
+                self->conn_len = strlen ("Upgrade");
             }
         }
-        else if (nn_ws_match_token ("Sec-WebSocket-Version:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->version, &self->version_len);
-        }
-        else if (nn_ws_match_token ("Sec-WebSocket-Protocol:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->protocol, &self->protocol_len);
-        }
-        else if (nn_ws_match_token ("Sec-WebSocket-Extensions:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->extensions, &self->extensions_len);
+        else if (nn_ws_validate_value ("Sec-WebSocket-Version",
+              name, name_len, 1)) {
+            self->version = value;
+            self->version_len = value_len;
         }
-        else if (nn_ws_match_token (CRLF,
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            /*  Exit loop since all headers are parsed. */
-            break;
+        else if (nn_ws_validate_value ("Sec-WebSocket-Protocol",
+              name, name_len, 1)) {
+            self->protocol = value;
+            self->protocol_len = value_len;
         }
-        else {
-            /*  Skip unknown headers. */
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                NULL, NULL);
+        else if (nn_ws_validate_value ("Sec-WebSocket-Extensions",
+              name, name_len, 1)) {
+            self->extensions = value;
+            self->extensions_len = value_len;
         }
 
-        if (rc != NN_WS_HANDSHAKE_MATCH)
-            return NN_WS_HANDSHAKE_INVALID;
+        /*  Unknown headers are skipped. */
     }
 
-    /*  Validate the opening handshake is now fully parsed. Additionally,
-        as per RFC 6455 section 4.1, the client should not send additional data
-        after the opening handshake, so this assertion validates upstream recv
-        logic prevented this case. */
-    nn_assert (strlen (pos) == 0);
+    /*  Validate the opening handshake is now fully parsed. The blank line
+        ending the header fields may come before the end of what was received,
+        followed by garbage, so this can't be asserted. */
+    if (strlen (pos) != 0)
+        goto malformed;
 
     /*  TODO: protocol expectations below this point are hard-coded here as
         an initial design decision. Perhaps in the future these values should
@@ -1064,6 +1077,11 @@ static int nn_ws_handshake_parse_client_opening (struct nn_ws_handshake *self)
             return NN_WS_HANDSHAKE_INVALID;
         }
     }
+
+malformed:
+    /*  Malformed request is not a WebSocket opening handshake. */
+    self->response_code = NN_WS_HANDSHAKE_RESPONSE_WSPROTO;
+    return NN_WS_HANDSHAKE_INVALID;
 }
 
 static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
@@ -1074,8 +1092,11 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
         reserved for accepted connections, not as fields within these
         headers. */
 
-    int rc;
     const char *pos;
+    const char *name;
+    size_t name_len;
+    const char *value;
+    size_t value_len;
 
     /*  Guarantee that a NULL terminator exists to enable treating this
         recv buffer like a string. The lack of such would indicate a failure
@@ -1089,7 +1110,7 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
     pos = self->response;
 
     /*  Is the response from the server fully received? */
-    if (!strstr (pos, NN_WS_HANDSHAKE_TERMSEQ))
+    if (!nn_ws_handshake_received (self, self->response))
         return NN_WS_HANDSHAKE_RECV_MORE;
 
     self->status_code = NULL;
@@ -1100,6 +1121,7 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
     self->conn = NULL;
     self->version = NULL;
     self->protocol = NULL;
+    self->extensions = NULL;
 
     self->status_code_len = 0;
     self->reason_phrase_len = 0;
@@ -1109,79 +1131,69 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
     self->conn_len = 0;
     self->version_len = 0;
     self->protocol_len = 0;
+    self->extensions_len = 0;
 
     /*  RFC 7230 3.1.2 Status Line: HTTP Version. */
     if (!nn_ws_match_token ("HTTP/1.1\x20", &pos, 0, 0))
-        return NN_WS_HANDSHAKE_RECV_MORE;
+        return NN_WS_HANDSHAKE_INVALID;
 
     /*  RFC 7230 3.1.2 Status Line: Status Code. */
     if (!nn_ws_match_value ("\x20", &pos, 0, 0, &self->status_code,
         &self->status_code_len))
-        return NN_WS_HANDSHAKE_RECV_MORE;
+        return NN_WS_HANDSHAKE_INVALID;
 
     /*  RFC 7230 3.1.2 Status Line: Reason Phrase. */
     if (!nn_ws_match_value (CRLF, &pos, 0, 0,
         &self->reason_phrase, &self->reason_phrase_len))
-        return NN_WS_HANDSHAKE_RECV_MORE;
+        return NN_WS_HANDSHAKE_INVALID;
 
     /*  It's expected the current position is now at the first
-        header field. Match them one by one. */
-    while (strlen (pos))
-    {
-        if (nn_ws_match_token ("Server:", &pos, 1, 0)) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->server, &self->server_len);
-        }
-        else if (nn_ws_match_token ("Sec-WebSocket-Accept:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->accept_key, &self->accept_key_len);
-        }
-        else if (nn_ws_match_token ("Upgrade:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->upgrade, &self->upgrade_len);
+        header field. Split them one by one and pick the known ones by name,
+        in a single pass over the response. */
+    while (!nn_ws_match_token (CRLF, &pos, 0, 0)) {
+        if (!nn_ws_match_field (&pos, &name, &name_len, &value, &value_len))
+            return NN_WS_HANDSHAKE_INVALID;
+        if (nn_ws_validate_value ("Server", name, name_len, 1)) {
+            self->server = value;
+            self->server_len = value_len;
         }
-        else if (nn_ws_match_token ("Connection:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->conn, &self->conn_len);
+        else if (nn_ws_validate_value ("Sec-WebSocket-Accept",
+              name, name_len, 1)) {
+            self->accept_key = value;
+            self->accept_key_len = value_len;
         }
-        else if (nn_ws_match_token ("Sec-WebSocket-Version-Server:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->version, &self->version_len);
+        else if (nn_ws_validate_value ("Upgrade", name, name_len, 1)) {
+            self->upgrade = value;
+            self->upgrade_len = value_len;
         }
-        else if (nn_ws_match_token ("Sec-WebSocket-Protocol-Server:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->protocol, &self->protocol_len);
+        else if (nn_ws_validate_value ("Connection", name, name_len, 1)) {
+            self->conn = value;
+            self->conn_len = value_len;
         }
-        else if (nn_ws_match_token ("Sec-WebSocket-Extensions:",
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                &self->extensions, &self->extensions_len);
+        else if (nn_ws_validate_value ("Sec-WebSocket-Version-Server",
+              name, name_len, 1)) {
+            self->version = value;
+            self->version_len = value_len;
         }
-        else if (nn_ws_match_token (CRLF,
-            &pos, 1, 0) == NN_WS_HANDSHAKE_MATCH) {
-            /*  Exit loop since all headers are parsed. */
-            break;
+        else if (nn_ws_validate_value ("Sec-WebSocket-Protocol-Server",
+              name, name_len, 1)) {
+            self->protocol = value;
+            self->protocol_len = value_len;
         }
-        else {
-            /*  Skip unknown headers. */
-            rc = nn_ws_match_value (CRLF, &pos, 1, 1,
-                NULL, NULL);
+        else if (nn_ws_validate_value ("Sec-WebSocket-Extensions",
+              name, name_len, 1)) {
+            self->extensions = value;
+            self->extensions_len = value_len;
         }
 
-        if (rc != NN_WS_HANDSHAKE_MATCH)
-            return NN_WS_HANDSHAKE_RECV_MORE;
+        /*  Unknown headers are skipped. */
     }
 
-    /*  Validate the opening handshake is now fully parsed. Additionally,
-        as per RFC 6455 section 4.1, the client should not send additional data
-        after the opening handshake, so this assertion validates upstream recv
-        logic prevented this case. */
-    nn_assert (strlen (pos) == 0);
+    /*  Validate the opening handshake is now fully parsed. The blank line
+        ending the header fields may come before the end of what was received,
+        followed by garbage, so this can't be asserted. */
+    if (strlen (pos) != 0)
+        return NN_WS_HANDSHAKE_INVALID;
 
     /*  TODO: protocol expectations below this point are hard-coded here as
         an initial design decision. Perhaps in the future these values should
@@ -1214,10 +1226,95 @@ static int nn_ws_handshake_parse_server_response (struct nn_ws_handshake *self)
         self->accept_key_len, 1) != NN_WS_HANDSHAKE_MATCH)
         return NN_WS_HANDSHAKE_INVALID;
 
+    /*  The server may only pick one of the compression codecs offered. */
+    self->compression = nn_ws_handshake_compress_param (self->extensions,
+        self->extensions_len, "codec");
+    if (self->compression && nn_compress_select (self->codecs,
+          self->compression) != self->compression)
+        return NN_WS_HANDSHAKE_INVALID;
+
+    /*  permessage-deflate must match the offer, and can't be combined with
+        nanomsg's own compression. */
+    if (nn_ws_deflate_confirm (&self->deflate_local, self->extensions,
+          self->extensions_len, &self->deflate) < 0)
+        return NN_WS_HANDSHAKE_INVALID;
+    if (self->compression && self->deflate.enabled)
+        return NN_WS_HANDSHAKE_INVALID;
+
     /*  Server response meets RFC 6455 compliance for opening handshake. */
     return NN_WS_HANDSHAKE_VALID;
 }
 
+static int nn_ws_handshake_received (struct nn_ws_handshake *self,
+    const char *buf)
+{
+    size_t len;
+
+    /*  No byte past the end of the handshake is ever received, so it's
+        enough to check the end of what has been received so far. */
+    len = self->recv_pos + self->recv_len;
+    return len >= NN_WS_HANDSHAKE_TERMSEQ_LEN &&
+        memcmp (buf + len - NN_WS_HANDSHAKE_TERMSEQ_LEN,
+        NN_WS_HANDSHAKE_TERMSEQ, NN_WS_HANDSHAKE_TERMSEQ_LEN) == 0;
+}
+
+static int nn_ws_handshake_recv (struct nn_ws_handshake *self, char *buf,
+    size_t bufsz)
+{
+    size_t matched;
+    size_t avail;
+    size_t len;
+    const char *data;
+    const void *peeked;
+
+    self->recv_pos += self->recv_len;
+
+    /*  Ensure we can back-track at least the length of the termination
+        sequence. This is an assertion, not a conditional, since under no
+        condition is it necessary to initially receive so few bytes. */
+    nn_assert (self->recv_pos >= NN_WS_HANDSHAKE_TERMSEQ_LEN);
+
+    /*  Find out how much of the termination sequence has been received
+        already. */
+    for (matched = NN_WS_HANDSHAKE_TERMSEQ_LEN - 1; matched > 0; matched--)
+        if (memcmp (NN_WS_HANDSHAKE_TERMSEQ,
+              buf + self->recv_pos - matched, matched) == 0)
+            break;
+
+    /*  The peer is free to send data right after the handshake, so no more
+        bytes than up to the end of the termination sequence may be received
+        here. Look for it in what the socket has read already, to receive
+        the rest of the handshake at once. */
+#if defined NN_HAVE_WINDOWS
+    avail = 0;
+    peeked = NULL;
+#else
+    avail = nn_usock_peek (self->usock, &peeked);
+#endif
+    data = peeked;
+    for (len = 0; len != avail && matched != NN_WS_HANDSHAKE_TERMSEQ_LEN;
+          len++) {
+        if (data [len] == NN_WS_HANDSHAKE_TERMSEQ [matched])
+            matched++;
+        else
+            matched = data [len] == NN_WS_HANDSHAKE_TERMSEQ [0];
+    }
+
+    /*  Nothing is buffered. Ask for as many bytes as can't overshoot the
+        termination sequence, the socket reads whatever more it can. */
+    if (!len)
+        len = NN_WS_HANDSHAKE_TERMSEQ_LEN - matched;
+
+    /*  Leave space for the terminating NULL. */
+    if (self->recv_pos + len >= bufsz)
+        return -EMSGSIZE;
+
+    self->recv_len = len;
+    self->retries++;
+    nn_usock_recv (self->usock, buf + self->recv_pos, len, NULL);
+    return 0;
+}
+
 static void nn_ws_handshake_client_request (struct nn_ws_handshake *self)
 {
     struct nn_iovec open_request;
@@ -1227,12 +1324,24 @@ static void nn_ws_handshake_client_request (struct nn_ws_handshake *self)
 
     /*  Generate random 16-byte key as per RFC 6455 4.1 */
     uint8_t rand_key [16];
+    struct nn_random rng;
+    uint64_t rnd;
 
     /*  Known length required to base64 encode above random key plus
         string NULL terminator. */
     char encoded_key [24 + 1];
 
-    nn_random_generate (rand_key, sizeof (rand_key));
+    /*  Optional Sec-WebSocket-Extensions header. */
+    char extensions [256];
+    char deflate [128];
+
+    /*  The key is generated by a generator of its own, to be unrelated to
+        anything the server might have seen. */
+    nn_random_init (&rng);
+    rnd = nn_random_next (&rng);
+    memcpy (rand_key, &rnd, sizeof (rnd));
+    rnd = nn_random_next (&rng);
+    memcpy (rand_key + sizeof (rnd), &rnd, sizeof (rnd));
 
     rc = nn_base64_encode (rand_key, sizeof (rand_key),
         encoded_key, sizeof (encoded_key));
@@ -1260,6 +1369,23 @@ static void nn_ws_handshake_client_request (struct nn_ws_handshake *self)
     /*  Guarantee that the socket type was found in the map. */
     nn_assert (i < NN_WS_HANDSHAKE_SP_MAP_LEN);
 
+    /*  Offer compression codecs and permessage-deflate, if any. nanomsg's
+        own compression comes first as the one preferred. */
+    if (self->deflate_local.enabled)
+        nn_ws_deflate_offer (&self->deflate_local, deflate, sizeof (deflate));
+    else
+        deflate [0] = '\0';
+    if (self->codecs && deflate [0])
+        sprintf (extensions, "Sec-WebSocket-Extensions: %s; codecs=%d, %s\r\n",
+            NN_WS_HANDSHAKE_COMPRESS_EXT, self->codecs, deflate);
+    else if (self->codecs)
+        sprintf (extensions, "Sec-WebSocket-Extensions: %s; codecs=%d\r\n",
+            NN_WS_HANDSHAKE_COMPRESS_EXT, self->codecs);
+    else if (deflate [0])
+        sprintf (extensions, "Sec-WebSocket-Extensions: %s\r\n", deflate);
+    else
+        extensions [0] = '\0';
+
     sprintf (self->opening_hs,
         "GET %s HTTP/1.1\r\n"
         "Host: %s\r\n"
@@ -1267,9 +1393,10 @@ static void nn_ws_handshake_client_request (struct nn_ws_handshake *self)
         "Connection: Upgrade\r\n"
         "Sec-WebSocket-Key: %s\r\n"
         "Sec-WebSocket-Version: 13\r\n"
-        "Sec-WebSocket-Protocol: %s\r\n\r\n",
+        "Sec-WebSocket-Protocol: %s\r\n"
+        "%s\r\n",
         self->resource, self->remote_host, encoded_key,
-        NN_WS_HANDSHAKE_SP_MAP[i].ws_sp);
+        NN_WS_HANDSHAKE_SP_MAP[i].ws_sp, extensions);
 
     open_request.iov_len = strlen (self->opening_hs);
     open_request.iov_base = self->opening_hs;
@@ -1288,6 +1415,10 @@ static void nn_ws_handshake_server_reply (struct nn_ws_handshake *self)
     /*  Allow room for NULL terminator. */
     char accept_key [NN_WS_HANDSHAKE_ACCEPT_KEY_LEN + 1];
 
+    /*  Optional Sec-WebSocket-Extensions header. */
+    char extensions [256];
+    char deflate [128];
+
     memset (self->response, 0, sizeof (self->response));
 
     if (self->response_code == NN_WS_HANDSHAKE_RESPONSE_OK) {
@@ -1304,13 +1435,35 @@ static void nn_ws_handshake_server_reply (struct nn_ws_handshake *self)
         strncpy (protocol, self->protocol, self->protocol_len);
         protocol [self->protocol_len] = '\0';
 
+        /*  Pick a compression codec among those offered by the client. */
+        self->compression = nn_compress_select (self->codecs,
+            nn_ws_handshake_compress_param (self->extensions,
+            self->extensions_len, "codecs"));
+        if (self->compression)
+            sprintf (extensions, "Sec-WebSocket-Extensions: %s; codec=%d\r\n",
+                NN_WS_HANDSHAKE_COMPRESS_EXT, self->compression);
+        else {
+
+            /*  Otherwise accept permessage-deflate, which is what browsers
+                offer. */
+            nn_ws_deflate_accept (&self->deflate_local, self->extensions,
+                self->extensions_len, &self->deflate, deflate,
+                sizeof (deflate));
+            if (self->deflate.enabled)
+                sprintf (extensions, "Sec-WebSocket-Extensions: %s\r\n",
+                    deflate);
+            else
+                extensions [0] = '\0';
+        }
+
         sprintf (self->response,
             "HTTP/1.1 101 Switching Protocols\r\n"
             "Upgrade: websocket\r\n"
             "Connection: Upgrade\r\n"
             "Sec-WebSocket-Accept: %s\r\n"
-            "Sec-WebSocket-Protocol: %s\r\n\r\n",
-            accept_key, protocol);
+            "Sec-WebSocket-Protocol: %s\r\n"
+            "%s\r\n",
+            accept_key, protocol, extensions);
 
         nn_free (protocol);
     }
@@ -1384,3 +1537,68 @@ static int nn_ws_handshake_hash_key (const char *key, size_t key_len,
     return rc;
 }
 
+
+static int nn_ws_handshake_compress_param (const char *ext, size_t ext_len,
+    const char *param)
+{
+    const char *pos;
+    const char *end;
+    const char *name;
+    size_t tok_len;
+    size_t param_len;
+    int quoted;
+    int val;
+
+    if (!ext)
+        return 0;
+
+    /*  Find the extension among the comma-separated list. Its name must
+        match as a whole, not as a part of the name or of a parameter of
+        another extension. */
+    end = ext + ext_len;
+    tok_len = strlen (NN_WS_HANDSHAKE_COMPRESS_EXT);
+    pos = ext;
+    while (1) {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == ','))
+            ++pos;
+        if (pos == end)
+            return 0;
+        name = pos;
+        while (pos < end && *pos != ';' && *pos != ',' && *pos != ' ' &&
+              *pos != '\t')
+            ++pos;
+        if ((size_t) (pos - name) == tok_len &&
+              nn_strncasecmp (name, NN_WS_HANDSHAKE_COMPRESS_EXT,
+              tok_len) == 0)
+            break;
+
+        /*  Skip parameters of other extensions. Quoted strings may contain
+            commas. */
+        quoted = 0;
+        while (pos < end && (quoted || *pos != ',')) {
+            if (*pos == '"')
+                quoted = !quoted;
+            ++pos;
+        }
+    }
+
+    /*  Scan its semicolon-separated parameters. */
+    param_len = strlen (param);
+    for (; pos < end && *pos != ','; ++pos) {
+        if (*pos != ';')
+            continue;
+        while (pos + 1 < end && pos [1] == ' ')
+            ++pos;
+        if ((size_t) (end - pos - 1) <= param_len ||
+              memcmp (pos + 1, param, param_len) != 0 ||
+              pos [1 + param_len] != '=')
+            continue;
+        val = 0;
+        for (pos += param_len + 2; pos < end && isdigit ((unsigned char) *pos) &&
+              val < 256; ++pos)
+            val = val * 10 + (*pos - '0');
+        return val < 256 ? val : 0;
+    }
+
+    return 0;
+}
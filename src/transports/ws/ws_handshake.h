@@ -31,6 +31,8 @@
 #include "../../aio/usock.h"
 #include "../../aio/timer.h"
 
+#include "ws_deflate.h"
+
 /*  This state machine exchanges a handshake with a WebSocket client. */
 
 /*  Return codes of this state machine. */
@@ -53,6 +55,10 @@
 #define NN_WS_HANDSHAKE_TERMSEQ "\r\n\r\n"
 #define NN_WS_HANDSHAKE_TERMSEQ_LEN strlen (NN_WS_HANDSHAKE_TERMSEQ)
 
+/*  Extension used to negotiate nanomsg message compression. The client
+    offers "codecs=<set>" and the server answers with "codec=<choice>". */
+#define NN_WS_HANDSHAKE_COMPRESS_EXT "x-nanomsg-compress"
+
 /*  Expected Accept Key length based on RFC 6455 4.2.2.5.4. */
 #define NN_WS_HANDSHAKE_ACCEPT_KEY_LEN 28
 
@@ -138,6 +144,20 @@ struct nn_ws_handshake {
     const char *extensions;
     size_t extensions_len;
 
+    /*  Compression codecs offered to the peer. */
+    int codecs;
+
+    /*  Compression codec agreed on with the peer. Valid once the handshake
+        has succeeded, zero if messages are not to be compressed. */
+    int compression;
+
+    /*  permessage-deflate configuration of this endpoint. */
+    struct nn_ws_deflate_params deflate_local;
+
+    /*  permessage-deflate parameters agreed on with the peer. Valid once the
+        handshake has succeeded, 'enabled' is zero if not in use. */
+    struct nn_ws_deflate_params deflate;
+
     /*  Identifies the response to be sent to client's opening handshake. */
     int response_code;
 
@@ -169,7 +189,8 @@ void nn_ws_handshake_term (struct nn_ws_handshake *self);
 int nn_ws_handshake_isidle (struct nn_ws_handshake *self);
 void nn_ws_handshake_start (struct nn_ws_handshake *self,
     struct nn_usock *usock, struct nn_pipebase *pipebase,
-    int mode, const char *resource, const char *host);
+    int mode, const char *resource, const char *host,
+    const struct nn_ws_deflate_params *deflate);
 void nn_ws_handshake_stop (struct nn_ws_handshake *self);
 
 #endif
@@ -0,0 +1,193 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "ws_mask.h"
+
+#include <string.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define NN_WS_MASK_X86
+#include <immintrin.h>
+#elif defined _MSC_VER && (defined _M_X64 || defined _M_AMD64)
+#include <emmintrin.h>
+#endif
+
+/*  SSE2 is part of the baseline instruction set on x86-64, so it is used
+    unconditionally there. AVX2 has to be detected at run time, which is
+    only done with compilers supporting per-function target attributes. */
+#if defined __SSE2__ || defined _M_X64 || defined _M_AMD64
+#define NN_WS_MASK_SSE2
+#endif
+#if defined NN_WS_MASK_X86 && defined NN_WS_MASK_SSE2
+#define NN_WS_MASK_AVX2
+#endif
+
+/*  Below this size setting up the vector registers does not pay off and
+    buffers are masked a word at a time. */
+#define NN_WS_MASK_MIN_VECTOR 128
+
+typedef size_t (*nn_ws_mask_fn) (uint8_t *buf, size_t len,
+    const uint8_t *mask, size_t pos);
+
+static nn_ws_mask_fn nn_ws_mask_impl;
+
+/*  Reference implementation, one byte at a time. Also used for the unaligned
+    head and the tail of the buffer by the word implementation. */
+static size_t nn_ws_mask_bytes (uint8_t *buf, size_t len,
+    const uint8_t *mask, size_t pos)
+{
+    size_t i;
+
+    for (i = 0; i != len; ++i)
+        buf [i] ^= mask [(pos + i) & (NN_WS_MASK_SIZE - 1)];
+    return (pos + len) & (NN_WS_MASK_SIZE - 1);
+}
+
+/*  Returns the masking key rotated to start at 'pos', in memory order. */
+static uint32_t nn_ws_mask_key (const uint8_t *mask, size_t pos)
+{
+    uint8_t key [NN_WS_MASK_SIZE];
+    uint32_t k;
+    size_t i;
+
+    for (i = 0; i != NN_WS_MASK_SIZE; ++i)
+        key [i] = mask [(pos + i) & (NN_WS_MASK_SIZE - 1)];
+    memcpy (&k, key, sizeof (k));
+    return k;
+}
+
+/*  Portable implementation, one machine word at a time. */
+static size_t nn_ws_mask_word (uint8_t *buf, size_t len,
+    const uint8_t *mask, size_t pos)
+{
+    uint64_t k;
+    uint64_t w;
+    size_t i;
+
+    /*  Process the bytes up to the first word boundary one by one. */
+    i = (sizeof (uint64_t) - ((uintptr_t) buf & (sizeof (uint64_t) - 1))) &
+        (sizeof (uint64_t) - 1);
+    if (i > len)
+        i = len;
+    pos = nn_ws_mask_bytes (buf, i, mask, pos);
+
+    k = nn_ws_mask_key (mask, pos);
+    k |= k << 32;
+
+    /*  The length of a word is a multiple of the key length, so the key
+        stays aligned with the data for the whole loop. */
+    for (; len - i >= sizeof (uint64_t); i += sizeof (uint64_t)) {
+        memcpy (&w, buf + i, sizeof (w));
+        w ^= k;
+        memcpy (buf + i, &w, sizeof (w));
+    }
+
+    return nn_ws_mask_bytes (buf + i, len - i, mask, pos);
+}
+
+/*  The vector implementations use unaligned loads and stores: on the CPUs
+    that support them these are as fast as aligned ones when the data
+    happens to be aligned and avoid a byte-by-byte head otherwise. The rest
+    of the buffer that does not fill a whole vector is passed to the word
+    implementation. */
+
+#if defined NN_WS_MASK_SSE2
+
+static size_t nn_ws_mask_sse2 (uint8_t *buf, size_t len,
+    const uint8_t *mask, size_t pos)
+{
+    __m128i k;
+    __m128i *p;
+    size_t i;
+
+    k = _mm_set1_epi32 ((int) nn_ws_mask_key (mask, pos));
+
+    for (i = 0; len - i >= 64; i += 64) {
+        p = (__m128i*) (buf + i);
+        _mm_storeu_si128 (p, _mm_xor_si128 (_mm_loadu_si128 (p), k));
+        _mm_storeu_si128 (p + 1, _mm_xor_si128 (_mm_loadu_si128 (p + 1), k));
+        _mm_storeu_si128 (p + 2, _mm_xor_si128 (_mm_loadu_si128 (p + 2), k));
+        _mm_storeu_si128 (p + 3, _mm_xor_si128 (_mm_loadu_si128 (p + 3), k));
+    }
+    for (; len - i >= 16; i += 16) {
+        p = (__m128i*) (buf + i);
+        _mm_storeu_si128 (p, _mm_xor_si128 (_mm_loadu_si128 (p), k));
+    }
+
+    return nn_ws_mask_word (buf + i, len - i, mask, pos);
+}
+
+#endif
+
+#if defined NN_WS_MASK_AVX2
+
+__attribute__ ((target ("avx2")))
+static size_t nn_ws_mask_avx2 (uint8_t *buf, size_t len,
+    const uint8_t *mask, size_t pos)
+{
+    __m256i k;
+    __m256i *p;
+    size_t i;
+
+    k = _mm256_set1_epi32 ((int) nn_ws_mask_key (mask, pos));
+
+    for (i = 0; len - i >= 128; i += 128) {
+        p = (__m256i*) (buf + i);
+        _mm256_storeu_si256 (p,
+            _mm256_xor_si256 (_mm256_loadu_si256 (p), k));
+        _mm256_storeu_si256 (p + 1,
+            _mm256_xor_si256 (_mm256_loadu_si256 (p + 1), k));
+        _mm256_storeu_si256 (p + 2,
+            _mm256_xor_si256 (_mm256_loadu_si256 (p + 2), k));
+        _mm256_storeu_si256 (p + 3,
+            _mm256_xor_si256 (_mm256_loadu_si256 (p + 3), k));
+    }
+    for (; len - i >= 32; i += 32) {
+        p = (__m256i*) (buf + i);
+        _mm256_storeu_si256 (p,
+            _mm256_xor_si256 (_mm256_loadu_si256 (p), k));
+    }
+
+    return nn_ws_mask_word (buf + i, len - i, mask, pos);
+}
+
+#endif
+
+void nn_ws_mask_init (void)
+{
+    nn_ws_mask_impl = nn_ws_mask_word;
+#if defined NN_WS_MASK_SSE2
+    nn_ws_mask_impl = nn_ws_mask_sse2;
+#endif
+#if defined NN_WS_MASK_AVX2
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        nn_ws_mask_impl = nn_ws_mask_avx2;
+#endif
+}
+
+size_t nn_ws_mask (uint8_t *buf, size_t len, const uint8_t *mask, size_t pos)
+{
+    if (len < NN_WS_MASK_MIN_VECTOR)
+        return nn_ws_mask_word (buf, len, mask, pos);
+    return nn_ws_mask_impl (buf, len, mask, pos);
+}
@@ -0,0 +1,42 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_WS_MASK_INCLUDED
+#define NN_WS_MASK_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Size of the WebSocket masking key as per RFC 6455 5.3. */
+#define NN_WS_MASK_SIZE 4
+
+/*  Picks the fastest masking implementation the CPU supports. Must be called
+    before nn_ws_mask is used. */
+void nn_ws_mask_init (void);
+
+/*  XORs the buffer in place with the 4-byte masking key. 'pos' is the offset
+    into the key of the first byte of the buffer; the offset of the byte
+    following the buffer is returned, so that a payload split into several
+    buffers can be masked piece by piece. */
+size_t nn_ws_mask (uint8_t *buf, size_t len, const uint8_t *mask, size_t pos);
+
+#endif
@@ -0,0 +1,402 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "ws_utf8.h"
+
+#include "../../utils/err.h"
+
+#include <string.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define NN_WS_UTF8_SIMD
+#include <immintrin.h>
+#endif
+
+/*  The ASCII fast path of the portable implementation checks this many
+    octets at a time. */
+#define NN_WS_UTF8_WORD 8
+
+/*  Bits in the top of every octet of a word. */
+#define NN_WS_UTF8_HIGH_BITS 0x8080808080808080ULL
+
+typedef size_t (*nn_ws_utf8_fn) (const uint8_t *buf, size_t len);
+
+static nn_ws_utf8_fn nn_ws_utf8_impl;
+
+int nn_ws_utf8_code_point (const uint8_t *buffer, size_t len)
+{
+    /*  The lack of information is considered neither valid nor invalid. */
+    if (!buffer || !len)
+        return NN_WS_UTF8_FRAGMENT;
+
+    /*  RFC 3629 section 4 UTF8-1. */
+    if (buffer [0] <= 0x7F)
+        return 1;
+
+    /*  0xC2, or 11000001, is the smallest conceivable multi-octet code
+        point that is not an illegal overlong encoding. */
+    if (buffer [0] < 0xC2)
+        return NN_WS_UTF8_INVALID;
+
+    /*  Largest 2-octet code point starts with 0xDF (11011111). */
+    if (buffer [0] <= 0xDF) {
+        if (len < 2)
+            return NN_WS_UTF8_FRAGMENT;
+        /*  Ensure continuation byte in form of 10xxxxxx */
+        else if ((buffer [1] & 0xC0) != 0x80)
+            return NN_WS_UTF8_INVALID;
+        else
+            return 2;
+    }
+
+    /*  RFC 3629 section 4 UTF8-3, where 0xEF is 11101111. */
+    if (buffer [0] <= 0xEF) {
+        /*  Fragment. */
+        if (len < 2)
+            return NN_WS_UTF8_FRAGMENT;
+        /*  Illegal overlong sequence detection. */
+        else if (buffer [0] == 0xE0 && (buffer [1] < 0xA0 || buffer [1] == 0x80))
+            return NN_WS_UTF8_INVALID;
+        /*  Illegal UTF-16 surrogate pair half U+D800 through U+DFFF. */
+        else if (buffer [0] == 0xED && buffer [1] >= 0xA0)
+            return NN_WS_UTF8_INVALID;
+        /*  Fragment. */
+        else if (len < 3)
+            return NN_WS_UTF8_FRAGMENT;
+        /*  Ensure continuation bytes 2 and 3 in form of 10xxxxxx */
+        else if ((buffer [1] & 0xC0) != 0x80 || (buffer [2] & 0xC0) != 0x80)
+            return NN_WS_UTF8_INVALID;
+        else
+            return 3;
+    }
+
+    /*  RFC 3629 section 4 UTF8-4, where 0xF4 is 11110100. Why
+        not 11110111 to follow the pattern? Because UTF-8 encoding
+        stops at 0x10FFFF as per RFC 3629. */
+    if (buffer [0] <= 0xF4) {
+        /*  Fragment. */
+        if (len < 2)
+            return NN_WS_UTF8_FRAGMENT;
+        /*  Illegal overlong sequence detection. */
+        else if (buffer [0] == 0xF0 && buffer [1] < 0x90)
+            return NN_WS_UTF8_INVALID;
+        /*  Illegal code point greater than U+10FFFF. */
+        else if (buffer [0] == 0xF4 && buffer [1] >= 0x90)
+            return NN_WS_UTF8_INVALID;
+        /*  Fragment. */
+        else if (len < 4)
+            return NN_WS_UTF8_FRAGMENT;
+        /*  Ensure continuation bytes 2, 3, and 4 in form of 10xxxxxx */
+        else if ((buffer [1] & 0xC0) != 0x80 ||
+            (buffer [2] & 0xC0) != 0x80 ||
+            (buffer [3] & 0xC0) != 0x80)
+            return NN_WS_UTF8_INVALID;
+        else
+            return 4;
+    }
+
+    /*  UTF-8 encoding stops at U+10FFFF and only defines up to 4-octet
+        code point sequences. */
+    if (buffer [0] >= 0xF5)
+        return NN_WS_UTF8_INVALID;
+
+    /*  Algorithm error; a case above should have been satisfied. */
+    nn_assert (0);
+}
+
+/*  Portable implementation. Runs of ASCII characters are skipped a word at
+    a time, anything else is validated one code point at a time. */
+static size_t nn_ws_utf8_valid_word (const uint8_t *buf, size_t len)
+{
+    uint64_t w;
+    size_t i;
+    int rc;
+
+    i = 0;
+    while (i != len) {
+        if (len - i >= NN_WS_UTF8_WORD) {
+            memcpy (&w, buf + i, sizeof (w));
+            if (!(w & NN_WS_UTF8_HIGH_BITS)) {
+                i += NN_WS_UTF8_WORD;
+                continue;
+            }
+        }
+        rc = nn_ws_utf8_code_point (buf + i, len - i);
+        if (rc < 0)
+            break;
+        i += rc;
+    }
+    return i;
+}
+
+#if defined NN_WS_UTF8_SIMD
+
+/*  The vector implementations follow "Validating UTF-8 In Less Than One
+    Instruction Per Byte" by Keiser and Lemire. Each octet is classified,
+    using table lookups, by its high nibble, by the low nibble of the
+    preceding octet and by the high nibble of the preceding octet. A set bit
+    common to all three classifications identifies an invalid two-octet
+    sequence. The octets that must be the third or fourth of a multi-octet
+    sequence are found by looking two and three octets back.
+
+    Blocks consisting only of ASCII skip the classification altogether.
+    Scanning stops at the first block that contains an error, after which
+    the rest of the buffer is handed to the portable implementation, so
+    that the exact position of the error is found by the same code in all
+    cases. */
+
+/*  Error classes of two-octet sequences. */
+#define NN_WS_UTF8_TOO_SHORT (1 << 0)
+#define NN_WS_UTF8_TOO_LONG (1 << 1)
+#define NN_WS_UTF8_OVERLONG_3 (1 << 2)
+#define NN_WS_UTF8_TOO_LARGE (1 << 3)
+#define NN_WS_UTF8_SURROGATE (1 << 4)
+#define NN_WS_UTF8_OVERLONG_2 (1 << 5)
+#define NN_WS_UTF8_TOO_LARGE_1000 (1 << 6)
+#define NN_WS_UTF8_OVERLONG_4 (1 << 6)
+#define NN_WS_UTF8_TWO_CONTS (1 << 7)
+#define NN_WS_UTF8_CARRY \
+    (NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_TWO_CONTS)
+
+/*  Lookup table indexed by the high nibble of the preceding octet. */
+#define NN_WS_UTF8_BYTE_1_HIGH \
+    NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG, \
+    NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG, \
+    NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG, \
+    NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG, \
+    NN_WS_UTF8_TWO_CONTS, NN_WS_UTF8_TWO_CONTS, \
+    NN_WS_UTF8_TWO_CONTS, NN_WS_UTF8_TWO_CONTS, \
+    NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_OVERLONG_2, \
+    NN_WS_UTF8_TOO_SHORT, \
+    NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_SURROGATE, \
+    NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_TOO_LARGE | \
+        NN_WS_UTF8_TOO_LARGE_1000 | NN_WS_UTF8_OVERLONG_4
+
+/*  Lookup table indexed by the low nibble of the preceding octet. */
+#define NN_WS_UTF8_BYTE_1_LOW \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_OVERLONG_2 | \
+        NN_WS_UTF8_OVERLONG_4, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_OVERLONG_2, \
+    NN_WS_UTF8_CARRY, \
+    NN_WS_UTF8_CARRY, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000 | \
+        NN_WS_UTF8_SURROGATE, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000, \
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000
+
+/*  Lookup table indexed by the high nibble of the current octet. */
+#define NN_WS_UTF8_BYTE_2_HIGH \
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, \
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, \
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, \
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, \
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS | \
+        NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_TOO_LARGE_1000 | \
+        NN_WS_UTF8_OVERLONG_4, \
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS | \
+        NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_TOO_LARGE, \
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS | \
+        NN_WS_UTF8_SURROGATE | NN_WS_UTF8_TOO_LARGE, \
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS | \
+        NN_WS_UTF8_SURROGATE | NN_WS_UTF8_TOO_LARGE, \
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, \
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT
+
+/*  Given that the octets before 'end' passed the checks, returns the start
+    of the multi-octet sequence that is cut by 'end', if any. */
+static size_t nn_ws_utf8_boundary (const uint8_t *buf, size_t end)
+{
+    size_t i;
+    size_t seqlen;
+
+    for (i = end; i != 0 && end - i < 3; --i) {
+        if (buf [i - 1] < 0x80)
+            break;
+        if (buf [i - 1] >= 0xC0) {
+            seqlen = buf [i - 1] >= 0xF0 ? 4 : buf [i - 1] >= 0xE0 ? 3 : 2;
+            return i - 1 + seqlen > end ? i - 1 : end;
+        }
+    }
+    return end;
+}
+
+__attribute__ ((target ("ssse3")))
+static size_t nn_ws_utf8_valid_ssse3 (const uint8_t *buf, size_t len)
+{
+    __m128i in;
+    __m128i prev;
+    __m128i incomplete;
+    __m128i prev1;
+    __m128i lo;
+    __m128i hi;
+    __m128i sc;
+    __m128i must23;
+    __m128i err;
+    const __m128i nibble = _mm_set1_epi8 (0x0F);
+    const __m128i byte_1_high = _mm_setr_epi8 (NN_WS_UTF8_BYTE_1_HIGH);
+    const __m128i byte_1_low = _mm_setr_epi8 (NN_WS_UTF8_BYTE_1_LOW);
+    const __m128i byte_2_high = _mm_setr_epi8 (NN_WS_UTF8_BYTE_2_HIGH);
+    const __m128i max = _mm_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, (char) (0xF0 - 1), (char) (0xE0 - 1),
+        (char) (0xC0 - 1));
+    size_t i;
+
+    prev = _mm_setzero_si128 ();
+    incomplete = _mm_setzero_si128 ();
+    for (i = 0; len - i >= 16; i += 16) {
+        in = _mm_loadu_si128 ((const __m128i*) (buf + i));
+
+        /*  ASCII fast path. Only a sequence left unfinished by the previous
+            block can make the block invalid. */
+        if (_mm_movemask_epi8 (in) == 0) {
+            if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (incomplete,
+                  _mm_setzero_si128 ())) != 0xFFFF)
+                break;
+            prev = in;
+            continue;
+        }
+
+        prev1 = _mm_alignr_epi8 (in, prev, 15);
+        hi = _mm_and_si128 (_mm_srli_epi16 (prev1, 4), nibble);
+        lo = _mm_and_si128 (prev1, nibble);
+        sc = _mm_and_si128 (_mm_shuffle_epi8 (byte_1_high, hi),
+            _mm_shuffle_epi8 (byte_1_low, lo));
+        hi = _mm_and_si128 (_mm_srli_epi16 (in, 4), nibble);
+        sc = _mm_and_si128 (sc, _mm_shuffle_epi8 (byte_2_high, hi));
+
+        must23 = _mm_or_si128 (
+            _mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 14),
+                _mm_set1_epi8 ((char) (0xE0 - 0x80))),
+            _mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 13),
+                _mm_set1_epi8 ((char) (0xF0 - 0x80))));
+        must23 = _mm_and_si128 (must23, _mm_set1_epi8 ((char) 0x80));
+        err = _mm_xor_si128 (must23, sc);
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (err,
+              _mm_setzero_si128 ())) != 0xFFFF)
+            break;
+
+        incomplete = _mm_subs_epu8 (in, max);
+        prev = in;
+    }
+
+    i = nn_ws_utf8_boundary (buf, i);
+    return i + nn_ws_utf8_valid_word (buf + i, len - i);
+}
+
+__attribute__ ((target ("avx2")))
+static size_t nn_ws_utf8_valid_avx2 (const uint8_t *buf, size_t len)
+{
+    __m256i in;
+    __m256i prev;
+    __m256i incomplete;
+    __m256i shifted;
+    __m256i prev1;
+    __m256i lo;
+    __m256i hi;
+    __m256i sc;
+    __m256i must23;
+    __m256i err;
+    const __m256i nibble = _mm256_set1_epi8 (0x0F);
+    const __m256i byte_1_high = _mm256_setr_epi8 (NN_WS_UTF8_BYTE_1_HIGH,
+        NN_WS_UTF8_BYTE_1_HIGH);
+    const __m256i byte_1_low = _mm256_setr_epi8 (NN_WS_UTF8_BYTE_1_LOW,
+        NN_WS_UTF8_BYTE_1_LOW);
+    const __m256i byte_2_high = _mm256_setr_epi8 (NN_WS_UTF8_BYTE_2_HIGH,
+        NN_WS_UTF8_BYTE_2_HIGH);
+    const __m256i max = _mm256_setr_epi8 (-1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, (char) (0xF0 - 1), (char) (0xE0 - 1),
+        (char) (0xC0 - 1));
+    size_t i;
+
+    prev = _mm256_setzero_si256 ();
+    incomplete = _mm256_setzero_si256 ();
+    for (i = 0; len - i >= 32; i += 32) {
+        in = _mm256_loadu_si256 ((const __m256i*) (buf + i));
+
+        /*  ASCII fast path. Only a sequence left unfinished by the previous
+            block can make the block invalid. */
+        if (_mm256_movemask_epi8 (in) == 0) {
+            if (!_mm256_testz_si256 (incomplete, incomplete))
+                break;
+            prev = in;
+            continue;
+        }
+
+        /*  The upper half of the previous block followed by the lower half
+            of this one, so that the octets preceding each lane can be
+            shifted in. */
+        shifted = _mm256_permute2x128_si256 (prev, in, 0x21);
+        prev1 = _mm256_alignr_epi8 (in, shifted, 15);
+        hi = _mm256_and_si256 (_mm256_srli_epi16 (prev1, 4), nibble);
+        lo = _mm256_and_si256 (prev1, nibble);
+        sc = _mm256_and_si256 (_mm256_shuffle_epi8 (byte_1_high, hi),
+            _mm256_shuffle_epi8 (byte_1_low, lo));
+        hi = _mm256_and_si256 (_mm256_srli_epi16 (in, 4), nibble);
+        sc = _mm256_and_si256 (sc, _mm256_shuffle_epi8 (byte_2_high, hi));
+
+        must23 = _mm256_or_si256 (
+            _mm256_subs_epu8 (_mm256_alignr_epi8 (in, shifted, 14),
+                _mm256_set1_epi8 ((char) (0xE0 - 0x80))),
+            _mm256_subs_epu8 (_mm256_alignr_epi8 (in, shifted, 13),
+                _mm256_set1_epi8 ((char) (0xF0 - 0x80))));
+        must23 = _mm256_and_si256 (must23, _mm256_set1_epi8 ((char) 0x80));
+        err = _mm256_xor_si256 (must23, sc);
+        if (!_mm256_testz_si256 (err, err))
+            break;
+
+        incomplete = _mm256_subs_epu8 (in, max);
+        prev = in;
+    }
+
+    i = nn_ws_utf8_boundary (buf, i);
+    return i + nn_ws_utf8_valid_word (buf + i, len - i);
+}
+
+#endif
+
+void nn_ws_utf8_init (void)
+{
+    nn_ws_utf8_impl = nn_ws_utf8_valid_word;
+#if defined NN_WS_UTF8_SIMD
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        nn_ws_utf8_impl = nn_ws_utf8_valid_avx2;
+    else if (__builtin_cpu_supports ("ssse3"))
+        nn_ws_utf8_impl = nn_ws_utf8_valid_ssse3;
+#endif
+}
+
+size_t nn_ws_utf8_valid (const uint8_t *buf, size_t len)
+{
+    return nn_ws_utf8_impl (buf, len);
+}
@@ -0,0 +1,50 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_WS_UTF8_INCLUDED
+#define NN_WS_UTF8_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Return values of nn_ws_utf8_code_point other than code point length. */
+#define NN_WS_UTF8_INVALID -2
+#define NN_WS_UTF8_FRAGMENT -1
+
+/*  Picks the fastest validation implementation the CPU supports. Must be
+    called before nn_ws_utf8_valid is used. */
+void nn_ws_utf8_init (void);
+
+/*  Given a buffer location, this function determines whether the leading
+    octets form a valid UTF-8 code point as per RFC 3629. Returns the length
+    of the code point, NN_WS_UTF8_FRAGMENT if the buffer ends before the
+    code point is complete, or NN_WS_UTF8_INVALID. */
+int nn_ws_utf8_code_point (const uint8_t *buf, size_t len);
+
+/*  Returns the length of the longest prefix of the buffer that consists of
+    complete, valid code points. If it is shorter than the buffer, the rest
+    starts with a code point that is either invalid or truncated, which can
+    be told apart using nn_ws_utf8_code_point. */
+size_t nn_ws_utf8_valid (const uint8_t *buf, size_t len);
+
+#endif
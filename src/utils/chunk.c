@@ -29,8 +29,18 @@
 #include "wire.h"
 #include "err.h"
 
+#include "../ipc.h"
+
 #include <string.h>
 
+#if defined NN_CHUNK_HAVE_SHMEM
+#include "closefd.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #define NN_CHUNK_TAG 0xdeadcafe
 #define NN_CHUNK_TAG_DEALLOCATED 0xbeadfeed
 
@@ -52,16 +62,36 @@ struct nn_chunk {
         the message data itself. */
 };
 
+/*  Chunks living in a shared memory file are immediately preceded by
+    the description of the mapping. */
+struct nn_chunk_mapping {
+
+    /*  The whole mapped file. */
+    void *addr;
+    size_t len;
+
+    /*  The file itself, or -1 if the file was received from a peer. */
+    int fd;
+};
+
 /*  Private functions. */
 static struct nn_chunk *nn_chunk_getptr (void *p);
 static void *nn_chunk_getdata (struct nn_chunk *c);
 static void nn_chunk_default_free (void *p);
 static size_t nn_chunk_hdrsize ();
+#if defined NN_CHUNK_HAVE_SHMEM
+static int nn_chunk_shmem_alloc (size_t size, struct nn_chunk **result);
+static void nn_chunk_shmem_free (void *p);
+#endif
 
 int nn_chunk_alloc (size_t size, int type, void **result)
 {
+#if defined NN_CHUNK_HAVE_SHMEM
+    int rc;
+#endif
     size_t sz;
     struct nn_chunk *self;
+    nn_chunk_free_fn ffn;
     const size_t hdrsz = nn_chunk_hdrsize ();
 
     /*  Compute total size to be allocated. Check for overflow. */
@@ -73,17 +103,26 @@ int nn_chunk_alloc (size_t size, int type, void **result)
     switch (type) {
     case 0:
         self = nn_alloc (sz, "message chunk");
+        if (nn_slow (!self))
+            return -ENOMEM;
+        ffn = nn_chunk_default_free;
         break;
+#if defined NN_CHUNK_HAVE_SHMEM
+    case NN_IPC_ALLOC_SHMEM:
+        rc = nn_chunk_shmem_alloc (sz, &self);
+        if (nn_slow (rc < 0))
+            return rc;
+        ffn = nn_chunk_shmem_free;
+        break;
+#endif
     default:
         return -EINVAL;
     }
-    if (nn_slow (!self))
-        return -ENOMEM;
 
     /*  Fill in the chunk header. */
     nn_atomic_init (&self->refcount, 1);
     self->size = size;
-    self->ffn = nn_chunk_default_free;
+    self->ffn = ffn;
 
     /*  Fill in the size of the empty space between the chunk header
         and the message. */
@@ -224,6 +263,81 @@ void *nn_chunk_trim (void *p, size_t n)
     return p;
 }
 
+int nn_chunk_shmem (void *p, size_t *offset)
+{
+#if defined NN_CHUNK_HAVE_SHMEM
+    struct nn_chunk *self;
+    struct nn_chunk_mapping *map;
+
+    self = nn_chunk_getptr (p);
+    if (self->ffn != nn_chunk_shmem_free)
+        return -1;
+    map = ((struct nn_chunk_mapping*) self) - 1;
+    if (map->fd < 0)
+        return -1;
+    *offset = (uint8_t*) p - (uint8_t*) map->addr;
+    return map->fd;
+#else
+    return -1;
+#endif
+}
+
+int nn_chunk_shmem_map (int fd, size_t offset, size_t size, void **result)
+{
+#if defined NN_CHUNK_HAVE_SHMEM
+    int rc;
+    int seals;
+    struct stat st;
+    size_t len;
+    size_t pos;
+    uint8_t *addr;
+    struct nn_chunk *self;
+    struct nn_chunk_mapping *map;
+    const size_t hdrsz = nn_chunk_hdrsize ();
+
+    /*  The file must not shrink while it's mapped, otherwise the peer could
+        crash us by truncating it. */
+    seals = fcntl (fd, F_GET_SEALS);
+    if (nn_slow (seals < 0 || !(seals & F_SEAL_SHRINK)))
+        return -EINVAL;
+    rc = fstat (fd, &st);
+    if (nn_slow (rc < 0))
+        return -EINVAL;
+    len = (size_t) st.st_size;
+
+    /*  The data must fit into the file and there must be enough space in
+        front of it to construct the chunk header. The header is aligned
+        to 8 bytes, the difference is accounted for as empty space. */
+    if (nn_slow (offset > len || size > len - offset || offset < hdrsz))
+        return -EINVAL;
+    pos = (offset - hdrsz) & ~((size_t) 7);
+    if (nn_slow (pos < sizeof (struct nn_chunk_mapping)))
+        return -EINVAL;
+
+    addr = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (nn_slow (addr == MAP_FAILED))
+        return -ENOMEM;
+
+    /*  Fill in the mapping and the chunk header. */
+    self = (struct nn_chunk*) (addr + pos);
+    map = ((struct nn_chunk_mapping*) self) - 1;
+    map->addr = addr;
+    map->len = len;
+    map->fd = -1;
+    nn_atomic_init (&self->refcount, 1);
+    self->size = size;
+    self->ffn = nn_chunk_shmem_free;
+    nn_putl (addr + offset - 2 * sizeof (uint32_t),
+        (uint32_t) (offset - hdrsz - pos));
+    nn_putl (addr + offset - sizeof (uint32_t), NN_CHUNK_TAG);
+
+    *result = addr + offset;
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
 static struct nn_chunk *nn_chunk_getptr (void *p)
 {
     uint32_t off;
@@ -250,3 +364,67 @@ static size_t nn_chunk_hdrsize ()
     return sizeof (struct nn_chunk) + 2 * sizeof (uint32_t);
 }
 
+#if defined NN_CHUNK_HAVE_SHMEM
+
+static int nn_chunk_shmem_alloc (size_t size, struct nn_chunk **result)
+{
+    int rc;
+    int fd;
+    size_t pos;
+    size_t len;
+    uint8_t *addr;
+    struct nn_chunk_mapping *map;
+
+    /*  The chunk header is 8-byte aligned, with the description of the
+        mapping in front of it. */
+    pos = (sizeof (struct nn_chunk_mapping) + 7) & ~((size_t) 7);
+    len = pos + size;
+    if (nn_slow (len < size))
+        return -ENOMEM;
+
+    fd = memfd_create ("nanomsg", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (nn_slow (fd < 0))
+        return -errno;
+    rc = ftruncate (fd, len);
+    if (nn_slow (rc < 0)) {
+        nn_closefd (fd);
+        return -ENOMEM;
+    }
+
+    /*  Peers map the file as well. Make sure its size can't change under
+        their hands. Peers refuse files that are not sealed, so if the
+        file system doesn't support sealing, shared memory can't be used. */
+    rc = fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    if (nn_slow (rc < 0)) {
+        nn_closefd (fd);
+        return -ENOSYS;
+    }
+
+    addr = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (nn_slow (addr == MAP_FAILED)) {
+        nn_closefd (fd);
+        return -ENOMEM;
+    }
+
+    *result = (struct nn_chunk*) (addr + pos);
+    map = ((struct nn_chunk_mapping*) *result) - 1;
+    map->addr = addr;
+    map->len = len;
+    map->fd = fd;
+    return 0;
+}
+
+static void nn_chunk_shmem_free (void *p)
+{
+    int rc;
+    struct nn_chunk_mapping map;
+
+    /*  The description of the mapping is unmapped along with the chunk. */
+    map = *(((struct nn_chunk_mapping*) p) - 1);
+    rc = munmap (map.addr, map.len);
+    errno_assert (rc == 0);
+    if (map.fd >= 0)
+        nn_closefd (map.fd);
+}
+
+#endif
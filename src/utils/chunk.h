@@ -26,6 +26,12 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*  Chunks can be allocated in anonymous shared memory files, which can be
+    passed to other processes. */
+#if defined NN_HAVE_MEMFD_CREATE
+#define NN_CHUNK_HAVE_SHMEM
+#endif
+
 /*  Allocates the chunk using the allocation mechanism specified by 'type'. */
 int nn_chunk_alloc (size_t size, int type, void **result);
 
@@ -46,5 +52,16 @@ size_t nn_chunk_size (void *p);
     chunk. */
 void *nn_chunk_trim (void *p, size_t n);
 
+/*  If the chunk lives in a shared memory file, returns the file descriptor
+    and stores offset of the chunk data within the file to 'offset'.
+    Otherwise returns -1. */
+int nn_chunk_shmem (void *p, size_t *offset);
+
+/*  Creates a chunk of 'size' bytes from the data at 'offset' within shared
+    memory file 'fd'. The file is mapped privately, thus modifications of the
+    chunk are not visible to other processes. The descriptor can be closed
+    afterwards. */
+int nn_chunk_shmem_map (int fd, size_t offset, size_t size, void **result);
+
 #endif
 
@@ -23,10 +23,13 @@
 
 #include "chunkref.h"
 #include "err.h"
+#include "fast.h"
 
 #include <string.h>
 
 #define NN_CHUNKREF_EXT ((size_t)-1)
+#define NN_CHUNKREF_BORROWED ((size_t)-2)
+#define NN_CHUNKREF_STREAM ((size_t)-3)
 
 void nn_chunkref_init (struct nn_chunkref *self, size_t size)
 {
@@ -48,11 +51,83 @@ void nn_chunkref_init_chunk (struct nn_chunkref *self, void *chunk)
     self->u.chunk = chunk;
 }
 
+void nn_chunkref_init_borrowed (struct nn_chunkref *self, void *data,
+    size_t size)
+{
+    self->size = NN_CHUNKREF_BORROWED;
+    self->u.borrowed.data = data;
+    self->u.borrowed.size = size;
+}
+
+int nn_chunkref_isborrowed (struct nn_chunkref *self)
+{
+    return self->size == NN_CHUNKREF_BORROWED;
+}
+
+void nn_chunkref_own (struct nn_chunkref *self)
+{
+    uint8_t *data;
+    size_t size;
+
+    if (self->size != NN_CHUNKREF_BORROWED)
+        return;
+
+    data = self->u.borrowed.data;
+    size = self->u.borrowed.size;
+    nn_chunkref_init (self, size);
+    memcpy (nn_chunkref_data (self), data, size);
+}
+
+void nn_chunkref_init_stream (struct nn_chunkref *self, size_t size,
+    nn_stream_fn fn, void *arg)
+{
+    self->size = NN_CHUNKREF_STREAM;
+    self->u.stream.fn = fn;
+    self->u.stream.arg = arg;
+    self->u.stream.size = size;
+}
+
+int nn_chunkref_isstream (struct nn_chunkref *self)
+{
+    return self->size == NN_CHUNKREF_STREAM;
+}
+
+int nn_chunkref_read (struct nn_chunkref *self, void *buf, size_t len)
+{
+    nn_assert (self->size == NN_CHUNKREF_STREAM);
+    if (nn_slow (self->u.stream.fn (self->u.stream.arg, buf, len) < 0))
+        return -ECONNABORTED;
+    return 0;
+}
+
+int nn_chunkref_load (struct nn_chunkref *self)
+{
+    int rc;
+    struct nn_chunkref stream;
+
+    if (self->size != NN_CHUNKREF_STREAM)
+        return 0;
+
+    stream = *self;
+    nn_chunkref_init (self, stream.u.stream.size);
+    rc = nn_chunkref_read (&stream, nn_chunkref_data (self),
+        stream.u.stream.size);
+    nn_chunkref_term (&stream);
+    if (nn_slow (rc < 0)) {
+        nn_chunkref_term (self);
+        nn_chunkref_init (self, 0);
+    }
+    return rc;
+}
+
 void nn_chunkref_term (struct nn_chunkref *self)
 {
     if (self->size == NN_CHUNKREF_EXT) {
         nn_chunk_free (self->u.chunk);
     }
+    else if (self->size == NN_CHUNKREF_STREAM) {
+        self->u.stream.fn (self->u.stream.arg, NULL, 0);
+    }
 }
 
 void *nn_chunkref_getchunk (struct nn_chunkref *self)
@@ -60,6 +135,8 @@ void *nn_chunkref_getchunk (struct nn_chunkref *self)
     int rc;
     void *chunk;
 
+    nn_assert (self->size != NN_CHUNKREF_STREAM);
+    nn_chunkref_own (self);
     if (self->size == NN_CHUNKREF_EXT) {
         chunk = self->u.chunk;
         self->u.chunk = NULL;
@@ -80,6 +157,10 @@ void nn_chunkref_mv (struct nn_chunkref *dst, struct nn_chunkref *src)
     dst->size = src->size;
     if (src->size == NN_CHUNKREF_EXT) {
         dst->u.chunk = src->u.chunk;
+    } else if (src->size == NN_CHUNKREF_BORROWED) {
+        dst->u.borrowed = src->u.borrowed;
+    } else if (src->size == NN_CHUNKREF_STREAM) {
+        dst->u.stream = src->u.stream;
     } else {
         nn_assert (src->size <= NN_CHUNKREF_MAX);
         memcpy (dst->u.ref, src->u.ref, src->size);
@@ -88,6 +169,15 @@ void nn_chunkref_mv (struct nn_chunkref *dst, struct nn_chunkref *src)
 
 void nn_chunkref_cp (struct nn_chunkref *dst, struct nn_chunkref *src)
 {
+    /*  Borrowed memory can't be shared, the copy gets its own. */
+    if (src->size == NN_CHUNKREF_BORROWED) {
+        nn_chunkref_init (dst, src->u.borrowed.size);
+        memcpy (nn_chunkref_data (dst), src->u.borrowed.data,
+            src->u.borrowed.size);
+        return;
+    }
+
+    nn_assert (src->size != NN_CHUNKREF_STREAM);
     dst->size = src->size;
     if (src->size == NN_CHUNKREF_EXT) {
         nn_chunk_addref(src->u.chunk, 1);
@@ -100,7 +190,10 @@ void nn_chunkref_cp (struct nn_chunkref *dst, struct nn_chunkref *src)
 
 void *nn_chunkref_data (struct nn_chunkref *self)
 {
-    if (self->size > NN_CHUNKREF_MAX) {
+    nn_assert (self->size != NN_CHUNKREF_STREAM);
+    if (self->size == NN_CHUNKREF_BORROWED) {
+        return self->u.borrowed.data;
+    } else if (self->size > NN_CHUNKREF_MAX) {
         return self->u.chunk;
     } else {
         return self->u.ref;
@@ -109,6 +202,12 @@ void *nn_chunkref_data (struct nn_chunkref *self)
 
 size_t nn_chunkref_size (struct nn_chunkref *self)
 {
+    if (self->size == NN_CHUNKREF_BORROWED) {
+        return self->u.borrowed.size;
+    }
+    if (self->size == NN_CHUNKREF_STREAM) {
+        return self->u.stream.size;
+    }
     if (self->size > NN_CHUNKREF_MAX) {
         return (nn_chunk_size(self->u.chunk));
     }
@@ -117,8 +216,15 @@ size_t nn_chunkref_size (struct nn_chunkref *self)
 
 void nn_chunkref_trim (struct nn_chunkref *self, size_t n)
 {
+    nn_assert (self->size != NN_CHUNKREF_STREAM);
     if (self->size == NN_CHUNKREF_EXT) {
-        nn_chunk_trim (self->u.chunk, n);
+        self->u.chunk = nn_chunk_trim (self->u.chunk, n);
+        return;
+    }
+    if (self->size == NN_CHUNKREF_BORROWED) {
+        nn_assert (self->u.borrowed.size >= n);
+        self->u.borrowed.data += n;
+        self->u.borrowed.size -= n;
         return;
     }
 
@@ -130,6 +236,8 @@ void nn_chunkref_trim (struct nn_chunkref *self, size_t n)
 
 void nn_chunkref_bulkcopy_start (struct nn_chunkref *self, uint32_t copies)
 {
+    nn_assert (self->size != NN_CHUNKREF_STREAM);
+    nn_chunkref_own (self);
     if (self->size == NN_CHUNKREF_EXT) {
         nn_chunk_addref (self->u.chunk, copies);
     }
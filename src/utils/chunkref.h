@@ -27,6 +27,8 @@
 
 #include "chunk.h"
 
+#include "../nn.h"
+
 #include <stddef.h>
 #include <stdint.h>
 
@@ -34,13 +36,27 @@
     reference to data allocated on the heap, or if short enough, it may store
     the data in itself. While user messages are not often short enough to store
     them inside the chunkref itself, SP protocol headers mostly are and thus
-    we can avoid additional memory allocation per message. */
+    we can avoid additional memory allocation per message. It can also
+    borrow memory owned by someone else, such as the buffer passed to
+    nn_recv(), so that the data can be received into it directly. Finally,
+    the data may not be in memory at all but produced piece by piece by
+    a function supplied by the user, such as the one passed to
+    nn_sendstream(). */
 
 struct nn_chunkref {
     size_t size; /* if <= NN_CHUNKREF_MAX then data is in ref */
     union {
         void *chunk; /* actually an nn_chunk  */
         uint8_t ref [NN_CHUNKREF_MAX]; /* inline data for the chunk */
+        struct {
+            uint8_t *data;
+            size_t size;
+        } borrowed; /* memory owned by someone else */
+        struct {
+            nn_stream_fn fn;
+            void *arg;
+            size_t size;
+        } stream; /* data produced by the user on demand */
     } u;
 };
 
@@ -51,6 +67,37 @@ void nn_chunkref_init (struct nn_chunkref *self, size_t size);
 /*  Create a chunkref from an existing chunk object. */
 void nn_chunkref_init_chunk (struct nn_chunkref *self, void *chunk);
 
+/*  Create a chunkref referring to memory it doesn't own. The memory has to
+    outlive the chunkref unless nn_chunkref_own is called first. */
+void nn_chunkref_init_borrowed (struct nn_chunkref *self, void *data,
+    size_t size);
+
+/*  Returns 1 if the chunkref refers to borrowed memory, 0 otherwise. */
+int nn_chunkref_isborrowed (struct nn_chunkref *self);
+
+/*  If the chunkref refers to borrowed memory, replaces it by a private copy
+    of the data. */
+void nn_chunkref_own (struct nn_chunkref *self);
+
+/*  Create a chunkref whose 'size' bytes of data are produced by 'fn' as they
+    are read using nn_chunkref_read. Once the chunkref is terminated, 'fn' is
+    called with NULL buffer. Streams can't be copied or accessed directly;
+    use nn_chunkref_load to read the data into memory first. */
+void nn_chunkref_init_stream (struct nn_chunkref *self, size_t size,
+    nn_stream_fn fn, void *arg);
+
+/*  Returns 1 if the data are produced by a stream, 0 otherwise. */
+int nn_chunkref_isstream (struct nn_chunkref *self);
+
+/*  Reads next 'len' bytes of the stream into 'buf'. Returns -ECONNABORTED if
+    the stream fails to produce them. */
+int nn_chunkref_read (struct nn_chunkref *self, void *buf, size_t len);
+
+/*  If the chunkref refers to a stream, replaces it by the data read from it.
+    Returns -ECONNABORTED if the stream fails, in which case the chunkref is
+    left empty. */
+int nn_chunkref_load (struct nn_chunkref *self);
+
 /*  Deallocate the chunk. */
 void nn_chunkref_term (struct nn_chunkref *self);
 
@@ -37,18 +37,18 @@
 #include "err.h"
 #include "attr.h"
 
-uint64_t nn_clock_ms (void)
+uint64_t nn_clock_us (void)
 {
 #if defined NN_HAVE_WINDOWS
 
     LARGE_INTEGER tps;
     LARGE_INTEGER time;
-    double tpms;
+    double tpus;
 
     QueryPerformanceFrequency (&tps);
     QueryPerformanceCounter (&time);
-    tpms = (double) (tps.QuadPart / 1000);
-    return (uint64_t) (time.QuadPart / tpms);
+    tpus = (double) tps.QuadPart / 1000000;
+    return (uint64_t) (time.QuadPart / tpus);
 
 #elif defined NN_HAVE_OSX
 
@@ -61,11 +61,11 @@ uint64_t nn_clock_ms (void)
 
     ticks = mach_absolute_time ();
     return ticks * nn_clock_timebase_info.numer /
-        nn_clock_timebase_info.denom / 1000000;
+        nn_clock_timebase_info.denom / 1000;
 
 #elif defined NN_HAVE_GETHRTIME
 
-    return gethrtime () / 1000000;
+    return gethrtime () / 1000;
 
 #elif defined NN_HAVE_CLOCK_MONOTONIC
 
@@ -74,7 +74,7 @@ uint64_t nn_clock_ms (void)
 
     rc = clock_gettime (CLOCK_MONOTONIC, &tv);
     errno_assert (rc == 0);
-    return tv.tv_sec * (uint64_t) 1000 + tv.tv_nsec / 1000000;
+    return tv.tv_sec * (uint64_t) 1000000 + tv.tv_nsec / 1000;
 
 #else
 
@@ -85,7 +85,12 @@ uint64_t nn_clock_ms (void)
         monotonic. Thus, it's used as a last resort mechanism. */
     rc = gettimeofday (&tv, NULL);
     errno_assert (rc == 0);
-    return tv.tv_sec * (uint64_t) 1000 + tv.tv_usec / 1000;
+    return tv.tv_sec * (uint64_t) 1000000 + tv.tv_usec;
 
 #endif
 }
+
+uint64_t nn_clock_ms (void)
+{
+    return nn_clock_us () / 1000;
+}
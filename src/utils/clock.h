@@ -25,6 +25,9 @@
 
 #include <stdint.h>
 
+/*  Returns current time in microseconds. */
+uint64_t nn_clock_us (void);
+
 /*  Returns current time in milliseconds. */
 uint64_t nn_clock_ms (void);
 
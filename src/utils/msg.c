@@ -22,6 +22,8 @@
 
 #include "msg.h"
 
+#include "../nn.h"
+
 #include <string.h>
 
 void nn_msg_init (struct nn_msg *self, size_t size)
@@ -79,3 +81,18 @@ void nn_msg_replace_body (struct nn_msg *self, struct nn_chunkref new_body)
     self->body = new_body;
 }
 
+void nn_msg_tstamp (struct nn_msg *self, uint64_t tstamp)
+{
+    struct nn_cmsghdr *cmsg;
+    size_t cmsgsz;
+
+    cmsgsz = NN_CMSG_SPACE (sizeof (tstamp));
+    nn_chunkref_term (&self->hdrs);
+    nn_chunkref_init (&self->hdrs, cmsgsz);
+    cmsg = nn_chunkref_data (&self->hdrs);
+    cmsg->cmsg_level = NN_SOL_SOCKET;
+    cmsg->cmsg_type = NN_RCVTIMESTAMP;
+    cmsg->cmsg_len = cmsgsz;
+    memcpy (NN_CMSG_DATA (cmsg), &tstamp, sizeof (tstamp));
+}
+
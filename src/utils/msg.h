@@ -72,5 +72,9 @@ void nn_msg_bulkcopy_cp (struct nn_msg *dst, struct nn_msg *src);
     that substantially rewrite or preprocess the userland message to be written. */
 void nn_msg_replace_body(struct nn_msg *self, struct nn_chunkref newBody);
 
+/*  Attaches kernel receive timestamp (in nanoseconds since the epoch) to the
+    message as NN_RCVTIMESTAMP ancillary property. */
+void nn_msg_tstamp (struct nn_msg *self, uint64_t tstamp);
+
 #endif
 
@@ -22,9 +22,9 @@
 
 #include "msgqueue.h"
 
-#include "../../utils/alloc.h"
-#include "../../utils/fast.h"
-#include "../../utils/err.h"
+#include "alloc.h"
+#include "fast.h"
+#include "err.h"
 
 #include <string.h>
 
@@ -23,7 +23,7 @@
 #ifndef NN_MSGQUEUE_INCLUDED
 #define NN_MSGQUEUE_INCLUDED
 
-#include "../../utils/msg.h"
+#include "msg.h"
 
 #include <stddef.h>
 
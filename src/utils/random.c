@@ -29,12 +29,53 @@
 #else
 #include <sys/types.h>
 #include <unistd.h>
+#include <fcntl.h>
+#endif
+#if defined NN_HAVE_GETRANDOM
+#include <sys/random.h>
 #endif
 
 #include <string.h>
 
 static uint64_t nn_random_state;
 
+/*  Secret mixed into the seeds of nn_random generators. */
+static uint64_t nn_random_key;
+
+/*  SplitMix64 finaliser. Turns consecutive or otherwise similar inputs into
+    unrelated outputs. */
+static uint64_t nn_random_mix (uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/*  Fills the buffer with random bytes obtained from the OS. Returns -1 if
+    there's no way to get them. */
+static int nn_random_os (void *buf, size_t len)
+{
+#if defined NN_HAVE_GETRANDOM
+    if (getrandom (buf, len, 0) == (ssize_t) len)
+        return 0;
+#endif
+#ifndef NN_HAVE_WINDOWS
+    {
+        int fd;
+        ssize_t nbytes;
+
+        fd = open ("/dev/urandom", O_RDONLY);
+        if (fd >= 0) {
+            nbytes = read (fd, buf, len);
+            close (fd);
+            if (nbytes == (ssize_t) len)
+                return 0;
+        }
+    }
+#endif
+    return -1;
+}
+
 void nn_random_seed ()
 {
     uint64_t pid;
@@ -49,6 +90,15 @@ void nn_random_seed ()
         the exact timestamp and process ID. */
     memcpy (&nn_random_state, "\xfa\x9b\x23\xe3\x07\xcc\x61\x1f", 8);
     nn_random_state ^= pid + nn_clock_ms();
+
+    /*  Key for the per-object generators comes from the OS where possible.
+        It's obtained only once per process, as reading it is expensive. */
+    if (nn_random_key)
+        return;
+    if (nn_random_os (&nn_random_key, sizeof (nn_random_key)) < 0)
+        nn_random_key = 0;
+    if (!nn_random_key)
+        nn_random_key = nn_random_mix (nn_random_state + nn_clock_ms ()) | 1;
 }
 
 void nn_random_generate (void *buf, size_t len)
@@ -71,3 +121,129 @@ void nn_random_generate (void *buf, size_t len)
     }
 }
 
+void nn_random_init (struct nn_random *self)
+{
+    uint64_t seed [2];
+
+    nn_random_generate (seed, sizeof (seed));
+    self->state [0] = nn_random_mix (seed [0] ^ nn_random_key);
+    self->state [1] = nn_random_mix (seed [1] + nn_random_key);
+
+    /*  All-zero state would generate only zeros. */
+    if (nn_slow (!self->state [0] && !self->state [1]))
+        self->state [0] = 1;
+}
+
+uint64_t nn_random_next (struct nn_random *self)
+{
+    uint64_t s0;
+    uint64_t s1;
+
+    /*  xorshift128+ */
+    s1 = self->state [0];
+    s0 = self->state [1];
+    self->state [0] = s0;
+    s1 ^= s1 << 23;
+    self->state [1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+    return self->state [1] + s0;
+}
+
+#define NN_RANDOM_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define NN_RANDOM_QUARTERROUND(a, b, c, d) \
+    do {\
+        a += b; d ^= a; d = NN_RANDOM_ROTL (d, 16);\
+        c += d; b ^= c; b = NN_RANDOM_ROTL (b, 12);\
+        a += b; d ^= a; d = NN_RANDOM_ROTL (d, 8);\
+        c += d; b ^= c; b = NN_RANDOM_ROTL (b, 7);\
+    } while (0)
+
+/*  Computes one ChaCha block with the given number of rounds. */
+static void nn_random_chacha (const uint32_t input [16], uint8_t out [64],
+    int rounds)
+{
+    uint32_t x [16];
+    int i;
+
+    memcpy (x, input, sizeof (x));
+    for (i = 0; i < rounds; i += 2) {
+        NN_RANDOM_QUARTERROUND (x [0], x [4], x [8], x [12]);
+        NN_RANDOM_QUARTERROUND (x [1], x [5], x [9], x [13]);
+        NN_RANDOM_QUARTERROUND (x [2], x [6], x [10], x [14]);
+        NN_RANDOM_QUARTERROUND (x [3], x [7], x [11], x [15]);
+        NN_RANDOM_QUARTERROUND (x [0], x [5], x [10], x [15]);
+        NN_RANDOM_QUARTERROUND (x [1], x [6], x [11], x [12]);
+        NN_RANDOM_QUARTERROUND (x [2], x [7], x [8], x [13]);
+        NN_RANDOM_QUARTERROUND (x [3], x [4], x [9], x [14]);
+    }
+    for (i = 0; i != 16; ++i) {
+        x [i] += input [i];
+        out [i * 4] = (uint8_t) x [i];
+        out [i * 4 + 1] = (uint8_t) (x [i] >> 8);
+        out [i * 4 + 2] = (uint8_t) (x [i] >> 16);
+        out [i * 4 + 3] = (uint8_t) (x [i] >> 24);
+    }
+}
+
+void nn_random_secure_init (struct nn_random_secure *self)
+{
+    uint8_t key [32];
+    uint64_t word;
+    int i;
+
+    /*  Without the OS, fall back to the global generator. The result is
+        as predictable as that, but still differs between objects. */
+    if (nn_slow (nn_random_os (key, sizeof (key)) < 0)) {
+        nn_random_generate (key, sizeof (key));
+        for (i = 0; i != 4; ++i) {
+            memcpy (&word, key + i * 8, 8);
+            word = nn_random_mix (word ^ nn_random_key);
+            memcpy (key + i * 8, &word, 8);
+        }
+    }
+
+    /*  "expand 32-byte k", the key, the 64-bit block counter and
+        a zero nonce. */
+    self->input [0] = 0x61707865;
+    self->input [1] = 0x3320646e;
+    self->input [2] = 0x79622d32;
+    self->input [3] = 0x6b206574;
+    for (i = 0; i != 8; ++i)
+        self->input [4 + i] = (uint32_t) key [i * 4] |
+            (uint32_t) key [i * 4 + 1] << 8 |
+            (uint32_t) key [i * 4 + 2] << 16 |
+            (uint32_t) key [i * 4 + 3] << 24;
+    memset (self->input + 12, 0, 4 * sizeof (uint32_t));
+    memset (key, 0, sizeof (key));
+    self->pos = sizeof (self->buf);
+}
+
+void nn_random_secure_generate (struct nn_random_secure *self,
+    void *buf, size_t len)
+{
+    uint8_t *pos;
+    size_t sz;
+
+    pos = (uint8_t*) buf;
+    while (len) {
+
+        /*  Refill the buffer with the next block of the keystream. */
+        if (nn_slow (self->pos == sizeof (self->buf))) {
+            nn_random_chacha (self->input, self->buf, 12);
+            if (!++self->input [12])
+                ++self->input [13];
+            self->pos = 0;
+        }
+
+        sz = sizeof (self->buf) - self->pos;
+        if (sz > len)
+            sz = len;
+        memcpy (pos, self->buf + self->pos, sz);
+
+        /*  Output handed out is not kept around. */
+        memset (self->buf + self->pos, 0, sz);
+        self->pos += sz;
+        pos += sz;
+        len -= sz;
+    }
+}
@@ -24,6 +24,7 @@
 #define NN_RANDOM_INCLUDED
 
 #include <stddef.h>
+#include <stdint.h>
 
 /*  Seeds the pseudorandom number generator. */
 void nn_random_seed ();
@@ -31,4 +32,41 @@ void nn_random_seed ();
 /*  Generate a pseudorandom byte sequence. */
 void nn_random_generate (void *buf, size_t len);
 
+/*  Pseudorandom number generator for hot paths, such as masking of every
+    WebSocket frame. Its state is owned by a single object, e.g. a connection,
+    so it is used without any synchronisation. Each one is seeded from
+    the global generator mixed with a key obtained from the OS, so that
+    different objects don't produce the same sequence. The generator is not
+    cryptographically secure though: its state, and thus all its future
+    output, can be worked out from a few consecutive outputs, e.g. from the
+    masking keys seen by the peer. Use nn_random_secure where that matters. */
+struct nn_random {
+    uint64_t state [2];
+};
+
+/*  Seeds the generator. */
+void nn_random_init (struct nn_random *self);
+
+/*  Returns next pseudorandom 64-bit number. */
+uint64_t nn_random_next (struct nn_random *self);
+
+/*  Cryptographically secure generator for values the peer must not be able
+    to predict, such as WebSocket masking keys. It's a ChaCha12 keystream
+    under a key obtained from the OS for each object separately. Output is
+    generated 64 bytes at a time and handed out from the buffer, so that
+    a small value costs little more than a copy. Like nn_random, it's owned
+    by a single object and used without any synchronisation. */
+struct nn_random_secure {
+    uint32_t input [16];
+    uint8_t buf [64];
+    size_t pos;
+};
+
+/*  Keys the generator. */
+void nn_random_secure_init (struct nn_random_secure *self);
+
+/*  Fills the buffer with unpredictable bytes. */
+void nn_random_secure_generate (struct nn_random_secure *self,
+    void *buf, size_t len);
+
 #endif
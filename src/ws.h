@@ -38,6 +38,14 @@ extern "C" {
     Attempting to set other message types is undefined.  */
 #define NN_WS_MSG_TYPE 1
 
+/*  RFC 7692 permessage-deflate compression. NN_WS_DEFLATE enables it,
+    NN_WS_DEFLATE_TAKEOVER allows the compression context to be kept from one
+    message to the next and NN_WS_DEFLATE_WINDOW_BITS limits the size of the
+    LZ77 window, and hence the memory used by each connection. */
+#define NN_WS_DEFLATE 2
+#define NN_WS_DEFLATE_TAKEOVER 3
+#define NN_WS_DEFLATE_WINDOW_BITS 4
+
 /*  WebSocket opcode constants as per RFC 6455 5.2  */
 #define NN_WS_MSG_TYPE_TEXT 0x01
 #define NN_WS_MSG_TYPE_BINARY 0x02
@@ -25,9 +25,13 @@
 #include "../src/nn.h"
 #include "../src/tcp.h"
 #include "../src/reqrep.h"
+#include "../src/pair.h"
+#include "../src/ipc.h"
 
 #include "testutil.h"
 
+#include <time.h>
+
 int main (int argc, const char *argv[])
 {
     int rc;
@@ -41,6 +45,15 @@ int main (int argc, const char *argv[])
     unsigned char *data;
     void *buf;
     char socket_address[128];
+#if defined NN_HAVE_SO_TIMESTAMPING
+    int i;
+    int opt;
+    int sb;
+    int sc;
+    uint64_t tstamp;
+    char ipc_address [] = "ipc://test-cmsg.ipc";
+    char *addrs [2];
+#endif
 
     test_addr_from(socket_address, "tcp", "127.0.0.1",
             get_test_port(argc, argv));
@@ -111,6 +124,68 @@ int main (int argc, const char *argv[])
     test_close (req);
     test_close (rep);
 
+#if defined NN_HAVE_SO_TIMESTAMPING
+
+    /* Test kernel receive timestamps. UNIX domain sockets provide them
+       only in SOCK_SEQPACKET mode. */
+
+    addrs [0] = socket_address;
+    addrs [1] = ipc_address;
+    for (i = 0; i != 2; ++i) {
+        sb = test_socket (AF_SP, NN_PAIR);
+        opt = 1;
+        test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMESTAMP, &opt,
+            sizeof (opt));
+        sc = test_socket (AF_SP, NN_PAIR);
+        if (i == 1) {
+            test_setsockopt (sb, NN_IPC, NN_IPC_SEQPACKET, &opt, sizeof (opt));
+            test_setsockopt (sc, NN_IPC, NN_IPC_SEQPACKET, &opt, sizeof (opt));
+        }
+        test_bind (sb, addrs [i]);
+        test_connect (sc, addrs [i]);
+
+        test_send (sc, "ABC");
+
+        memset (ctrl, 0, sizeof (ctrl));
+        iovec.iov_base = body;
+        iovec.iov_len = sizeof (body);
+        hdr.msg_iov = &iovec;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = ctrl;
+        hdr.msg_controllen = sizeof (ctrl);
+        rc = nn_recvmsg (sb, &hdr, 0);
+        errno_assert (rc == 3);
+
+        cmsg = NN_CMSG_FIRSTHDR (&hdr);
+        while (1) {
+            nn_assert (cmsg && cmsg->cmsg_len);
+            if (cmsg->cmsg_level == NN_SOL_SOCKET &&
+                  cmsg->cmsg_type == NN_RCVTIMESTAMP)
+                break;
+            cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+        }
+        nn_assert (cmsg->cmsg_len == NN_CMSG_SPACE (sizeof (tstamp)));
+        memcpy (&tstamp, NN_CMSG_DATA (cmsg), sizeof (tstamp));
+        nn_assert (tstamp / 1000000000 + 10 > (uint64_t) time (NULL));
+        nn_assert (tstamp / 1000000000 < (uint64_t) time (NULL) + 10);
+
+        /*  Messages received without the option carry no timestamp. */
+        test_send (sb, "ABC");
+        memset (ctrl, 0, sizeof (ctrl));
+        rc = nn_recvmsg (sc, &hdr, 0);
+        errno_assert (rc == 3);
+        cmsg = NN_CMSG_FIRSTHDR (&hdr);
+        while (cmsg && cmsg->cmsg_len) {
+            nn_assert (cmsg->cmsg_level != NN_SOL_SOCKET ||
+                cmsg->cmsg_type != NN_RCVTIMESTAMP);
+            cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+        }
+
+        test_close (sc);
+        test_close (sb);
+    }
+#endif
+
     return 0;
 }
 
@@ -0,0 +1,188 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/reqrep.h"
+
+#include "testutil.h"
+
+/*  Tests per-connection message compression over the stream transports. */
+
+#define TEST_BIGSZ 65536
+
+static void test_compressed_transfer (char *addr, int compressed)
+{
+    int sb;
+    int sc;
+    int rc;
+    int i;
+    int opt;
+    char *buf;
+    void *rbuf;
+    uint32_t seed;
+    uint64_t in;
+    uint64_t out;
+
+    buf = malloc (TEST_BIGSZ);
+    nn_assert (buf);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = NN_COMPRESSION_LZ;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    if (compressed)
+        test_setsockopt (sc, NN_SOL_SOCKET, NN_COMPRESSION,
+            &opt, sizeof (opt));
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+
+    /*  Messages below the threshold are passed through untouched. */
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+
+    /*  Highly compressible message, in both directions. */
+    for (i = 0; i != TEST_BIGSZ; ++i)
+        buf [i] = (char) ('a' + (i % 16));
+    rc = nn_send (sc, buf, TEST_BIGSZ, 0);
+    errno_assert (rc == TEST_BIGSZ);
+    rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+    errno_assert (rc == TEST_BIGSZ);
+    nn_assert (memcmp (rbuf, buf, TEST_BIGSZ) == 0);
+    rc = nn_send (sb, &rbuf, NN_MSG, 0);
+    errno_assert (rc == TEST_BIGSZ);
+    rc = nn_recv (sc, &rbuf, NN_MSG, 0);
+    errno_assert (rc == TEST_BIGSZ);
+    nn_assert (memcmp (rbuf, buf, TEST_BIGSZ) == 0);
+    nn_freemsg (rbuf);
+
+    /*  Incompressible message is sent as-is. */
+    seed = 0x12345678;
+    for (i = 0; i != TEST_BIGSZ; ++i) {
+        seed = seed * 1103515245 + 12345;
+        buf [i] = (char) (seed >> 24);
+    }
+    rc = nn_send (sc, buf, TEST_BIGSZ, 0);
+    errno_assert (rc == TEST_BIGSZ);
+    rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+    errno_assert (rc == TEST_BIGSZ);
+    nn_assert (memcmp (rbuf, buf, TEST_BIGSZ) == 0);
+    nn_freemsg (rbuf);
+
+    in = nn_get_statistic (sc, NN_STAT_COMPRESSION_BYTES_IN);
+    out = nn_get_statistic (sc, NN_STAT_COMPRESSION_BYTES_OUT);
+    if (compressed) {
+        nn_assert (in == 2 * TEST_BIGSZ);
+        nn_assert (out < in);
+        nn_assert (out > TEST_BIGSZ);
+    }
+    else {
+        nn_assert (in == 0 && out == 0);
+        nn_assert (nn_get_statistic (sb, NN_STAT_COMPRESSION_BYTES_IN) == 0);
+    }
+
+    test_close (sc);
+    test_close (sb);
+    free (buf);
+}
+
+int main (int argc, const char *argv[])
+{
+    int sb;
+    int sc;
+    int rc;
+    int opt;
+    size_t sz;
+    int port;
+    char addr [128];
+    char *buf;
+
+    port = get_test_port (argc, argv);
+
+    /*  Option validation. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt) && opt == 0);
+    rc = nn_getsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION_THRESHOLD,
+        &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 512);
+    opt = 0x4000;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = -1;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION_THRESHOLD,
+        &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = NN_COMPRESSION_LZ;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    rc = nn_getsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == NN_COMPRESSION_LZ);
+    test_close (sb);
+
+    /*  Both peers agree on a codec. */
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    test_compressed_transfer (addr, 1);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 1);
+    test_compressed_transfer (addr, 1);
+#if !defined NN_HAVE_WINDOWS && !defined NN_HAVE_WSL
+    test_compressed_transfer ("ipc://test-compress.ipc", 1);
+#endif
+
+    /*  Only one peer asks for compression; nothing gets compressed. */
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 2);
+    test_compressed_transfer (addr, 0);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 3);
+    test_compressed_transfer (addr, 0);
+#if !defined NN_HAVE_WINDOWS && !defined NN_HAVE_WSL
+    test_compressed_transfer ("ipc://test-compress.ipc", 0);
+#endif
+
+    /*  Protocol headers travel inside the compressed payload. */
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 4);
+    sb = test_socket (AF_SP, NN_REP);
+    sc = test_socket (AF_SP, NN_REQ);
+    opt = NN_COMPRESSION_LZ;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    opt = 16;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION_THRESHOLD,
+        &opt, sizeof (opt));
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_COMPRESSION_THRESHOLD,
+        &opt, sizeof (opt));
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+    buf = "0123456701234567012345670123456701234567012345670123456701234567";
+    test_send (sc, buf);
+    test_recv (sb, buf);
+    test_send (sb, buf);
+    test_recv (sc, buf);
+    nn_assert (nn_get_statistic (sb, NN_STAT_COMPRESSION_BYTES_IN) > 0);
+    nn_assert (nn_get_statistic (sc, NN_STAT_COMPRESSION_BYTES_IN) > 0);
+    test_close (sc);
+    test_close (sb);
+
+    return 0;
+}
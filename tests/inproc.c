@@ -120,6 +120,70 @@ int main ()
     test_close (sc);
     test_close (sb);
 
+    /*  Invalid ring sizes are rejected. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    val = -1;
+    rc = nn_setsockopt (sb, NN_INPROC, NN_INPROC_RING, &val, sizeof (val));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+    /*  Messages passed through rings both ways. */
+    val = 4;
+    test_setsockopt (sb, NN_INPROC, NN_INPROC_RING, &val, sizeof (val));
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (sc, NN_INPROC, NN_INPROC_RING, &val, sizeof (val));
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 100; ++i) {
+        test_send (sc, "ABC");
+        test_recv (sb, "ABC");
+        test_send (sb, "DEFG");
+        test_recv (sc, "DEFG");
+    }
+
+    /*  The sender blocks once the ring is full and resumes once there's
+        a free slot again. */
+    val = 200;
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_SNDTIMEO, &val, sizeof (val));
+    i = 0;
+    while (1) {
+        rc = nn_send (sc, "0123456789", 10, 0);
+        if (rc < 0 && nn_errno () == ETIMEDOUT)
+            break;
+        errno_assert (rc == 10);
+        ++i;
+    }
+    nn_assert (i == 4);
+    test_recv (sb, "0123456789");
+    test_send (sc, "0123456789");
+    rc = nn_send (sc, "0123456789", 10, 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+    for (i = 0; i != 4; ++i)
+        test_recv (sb, "0123456789");
+    test_send (sc, "XYZ");
+    test_recv (sb, "XYZ");
+
+    /*  Messages left in the ring are dropped on close. */
+    test_send (sc, "XYZ");
+    test_close (sc);
+    test_close (sb);
+
+    /*  SP header is passed through the ring. */
+    sb = test_socket (AF_SP, NN_REP);
+    val = 1;
+    test_setsockopt (sb, NN_INPROC, NN_INPROC_RING, &val, sizeof (val));
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_REQ);
+    test_setsockopt (sc, NN_INPROC, NN_INPROC_RING, &val, sizeof (val));
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 10; ++i) {
+        test_send (sc, "ABC");
+        test_recv (sb, "ABC");
+        test_send (sb, "DEFG");
+        test_recv (sc, "DEFG");
+    }
+    test_close (sc);
+    test_close (sb);
+
 #if 0
     /*  Test whether connection rejection is handled decently. */
     sb = test_socket (AF_SP, NN_PAIR);
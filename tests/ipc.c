@@ -28,10 +28,70 @@
 
 #include "testutil.h"
 
+#if defined NN_HAVE_LINUX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 /*  Tests IPC transport. */
 
 #define SOCKET_ADDRESS "ipc://test.ipc"
 
+#if defined NN_HAVE_LINUX
+/*  Number of file descriptors open in the process. */
+static int test_fd_count (void)
+{
+    DIR *dir;
+    int count;
+
+    dir = opendir ("/proc/self/fd");
+    errno_assert (dir);
+    count = 0;
+    while (readdir (dir))
+        ++count;
+    closedir (dir);
+    return count;
+}
+
+/*  Sends 'len' bytes over a raw UNIX domain socket, passing 'nfds' copies
+    of /dev/null along. */
+static void test_send_fds (int s, const void *buf, size_t len, int nfds)
+{
+    struct msghdr hdr;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    unsigned char ctrl [CMSG_SPACE (4 * sizeof (int))];
+    int fds [4];
+    int i;
+    ssize_t nbytes;
+
+    nn_assert (nfds <= 4);
+    for (i = 0; i != nfds; ++i) {
+        fds [i] = open ("/dev/null", O_RDONLY);
+        errno_assert (fds [i] >= 0);
+    }
+    iov.iov_base = (void*) buf;
+    iov.iov_len = len;
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = CMSG_SPACE (nfds * sizeof (int));
+    cmsg = CMSG_FIRSTHDR (&hdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (nfds * sizeof (int));
+    memcpy (CMSG_DATA (cmsg), fds, nfds * sizeof (int));
+    nbytes = sendmsg (s, &hdr, 0);
+    errno_assert (nbytes == (ssize_t) len);
+    for (i = 0; i != nfds; ++i)
+        close (fds [i]);
+}
+#endif
+
 int main ()
 {
 #ifndef NN_HAVE_WSL
@@ -46,6 +106,11 @@ int main ()
 
     int size;
     char * buf;
+#if defined NN_HAVE_LINUX
+    int fd;
+    int count;
+    struct sockaddr_un un;
+#endif
 
     /*  Try closing a IPC socket while it not connected. */
     sc = test_socket (AF_SP, NN_PAIR);
@@ -162,6 +227,139 @@ int main ()
     errno_assert (nn_errno () == EINVAL);
     test_close (sb);
 
+#if defined NN_HAVE_LINUX
+    /*  Test SOCK_SEQPACKET listener. Connecting peer adapts to it. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 2;
+    rc = nn_setsockopt (sb, NN_IPC, NN_IPC_SEQPACKET, &opt, opt_sz);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    test_setsockopt (sb, NN_IPC, NN_IPC_SEQPACKET, &opt, opt_sz);
+    opt = 8192;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_SNDBUF, &opt, opt_sz);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    size = 100000;
+    buf = malloc (size);
+    alloc_assert (buf);
+    for (i = 0; i < size; ++i) {
+        buf[i] = 48 + i % 10;
+    }
+    buf[size-1] = '\0';
+    test_send (sc, buf);
+    test_recv (sb, buf);
+    for (i = 0; i != 10; ++i) {
+        test_send (sb, buf);
+        test_recv (sc, buf);
+    }
+    buf[2040] = '\0';
+    test_send (sb, buf);
+    test_recv (sc, buf);
+    free (buf);
+    test_close (sc);
+
+    /*  And SOCK_SEQPACKET connecting peer adapts to a stream listener. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 1;
+    test_setsockopt (sc, NN_IPC, NN_IPC_SEQPACKET, &opt, opt_sz);
+    test_connect (sc, "ipc://test-stream.ipc");
+    s1 = test_socket (AF_SP, NN_PAIR);
+    test_bind (s1, "ipc://test-stream.ipc");
+    test_send (sc, "ABC");
+    test_recv (s1, "ABC");
+    test_close (s1);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Descriptors the peer attaches to ordinary messages are not leaked,
+        whether they come with the header or with the body. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    nn_sleep (100);
+    count = test_fd_count ();
+    fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&un, 0, sizeof (un));
+    un.sun_family = AF_UNIX;
+    strcpy (un.sun_path, "test.ipc");
+    rc = connect (fd, (struct sockaddr*) &un, sizeof (un));
+    errno_assert (rc == 0);
+    test_send_fds (fd, "\0SP\0\0\x10\0\0", 8, 1);
+    test_send_fds (fd, "\x01\0\0\0\0\0\0\0\x03" "ABC", 12, 3);
+    nn_sleep (10);
+    test_send_fds (fd, "\x01\0\0\0\0\0\0\0\x03", 9, 4);
+    nn_sleep (10);
+    test_send_fds (fd, "DEF", 3, 2);
+    test_recv (sb, "ABC");
+    test_recv (sb, "DEF");
+    nn_assert (test_fd_count () == count + 2);
+    close (fd);
+    nn_sleep (100);
+    nn_assert (test_fd_count () == count);
+    test_close (sb);
+#endif
+
+#if defined NN_HAVE_MEMFD_CREATE
+    /*  Test passing large messages in shared memory files, both allocated
+        by the user and copied there by the transport. It's off by default. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    rc = nn_getsockopt (sb, NN_IPC, NN_IPC_SHMEM_THRESHOLD, &opt, &opt_sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == -1);
+    opt = 65536;
+    test_setsockopt (sb, NN_IPC, NN_IPC_SHMEM_THRESHOLD, &opt, opt_sz);
+    opt = -1;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, opt_sz);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 65536;
+    test_setsockopt (sc, NN_IPC, NN_IPC_SHMEM_THRESHOLD, &opt, opt_sz);
+    test_connect (sc, SOCKET_ADDRESS);
+    size = 4 * 1024 * 1024;
+    buf = nn_allocmsg (size, NN_IPC_ALLOC_SHMEM);
+    alloc_assert (buf);
+    for (i = 0; i < size; ++i) {
+        buf[i] = 48 + i % 10;
+    }
+    rc = nn_send (sc, &buf, NN_MSG, 0);
+    errno_assert (rc == size);
+    rc = nn_recv (sb, &dummy_buf, NN_MSG, 0);
+    errno_assert (rc == size);
+    for (i = 0; i < size; ++i) {
+        nn_assert (((char*) dummy_buf)[i] == 48 + i % 10);
+    }
+    buf = malloc (100000);
+    alloc_assert (buf);
+    memcpy (buf, dummy_buf, 100000);
+    buf[99999] = '\0';
+    rc = nn_freemsg (dummy_buf);
+    errno_assert (rc == 0);
+    for (i = 0; i != 10; ++i) {
+        test_send (sb, buf);
+        test_recv (sc, buf);
+    }
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    test_close (sc);
+
+    /*  Peer that doesn't accept shared memory gets the data through
+        the socket. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = -1;
+    test_setsockopt (sc, NN_IPC, NN_IPC_SHMEM_THRESHOLD, &opt, opt_sz);
+    test_connect (sc, SOCKET_ADDRESS);
+    test_send (sb, buf);
+    test_recv (sc, buf);
+    test_send (sc, buf);
+    test_recv (sb, buf);
+    free (buf);
+    test_close (sc);
+    test_close (sb);
+#endif
+
     /*  Test closing a socket that is waiting to connect. */
     sc = test_socket (AF_SP, NN_PAIR);
     test_connect (sc, SOCKET_ADDRESS);
@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/utils/err.c"
+#include "../src/utils/clock.c"
+#include "../src/utils/random.c"
+
+#include <string.h>
+
+/*  Checks the ChaCha block function against the test vector from RFC 7539
+    2.3.2 and the secure generator built on top of it. */
+
+static const uint8_t chacha20_block [64] = {
+    0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+    0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+    0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03,
+    0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+    0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+    0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+    0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9,
+    0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+};
+
+int main ()
+{
+    uint32_t input [16];
+    uint8_t out [200];
+    uint8_t ref [200];
+    struct nn_random_secure rng1;
+    struct nn_random_secure rng2;
+    size_t i;
+
+    /*  Key 00 01 .. 1f, block counter 1, nonce 00 00 00 09 00 00 00 4a
+        00 00 00 00. */
+    input [0] = 0x61707865;
+    input [1] = 0x3320646e;
+    input [2] = 0x79622d32;
+    input [3] = 0x6b206574;
+    for (i = 0; i != 8; ++i)
+        input [4 + i] = (uint32_t) (i * 4) | (uint32_t) (i * 4 + 1) << 8 |
+            (uint32_t) (i * 4 + 2) << 16 | (uint32_t) (i * 4 + 3) << 24;
+    input [12] = 0x00000001;
+    input [13] = 0x09000000;
+    input [14] = 0x4a000000;
+    input [15] = 0x00000000;
+    nn_random_chacha (input, out, 20);
+    nn_assert (memcmp (out, chacha20_block, 64) == 0);
+
+    /*  The keystream doesn't depend on how it is split into pieces. */
+    nn_random_seed ();
+    nn_random_secure_init (&rng1);
+    memcpy (&rng2, &rng1, sizeof (rng2));
+    nn_random_secure_generate (&rng1, ref, sizeof (ref));
+    for (i = 0; i != sizeof (out); i += 4)
+        nn_random_secure_generate (&rng2, out + i, 4);
+    nn_assert (memcmp (out, ref, sizeof (out)) == 0);
+
+    /*  Each generator has a key of its own. */
+    nn_random_secure_init (&rng2);
+    nn_random_secure_generate (&rng2, out, sizeof (out));
+    nn_assert (memcmp (out, ref, sizeof (out)) != 0);
+
+    return 0;
+}
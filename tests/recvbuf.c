@@ -0,0 +1,331 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/reqrep.h"
+
+#include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/thread.c"
+
+#if !defined NN_HAVE_WINDOWS
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+/*  Tests receiving message bodies directly into the buffer passed to
+    a blocking nn_recv(). */
+
+#define MSG_SIZE (256 * 1024)
+#define REP_SIZE (4 * 1024 * 1024)
+#define REQ_COUNT 300
+
+static int sc;
+static char *sndbuf;
+static char *repbuf;
+#if !defined NN_HAVE_WINDOWS
+static int fd;
+static const char *rawhdr;
+#endif
+
+static void sender (NN_UNUSED void *arg)
+{
+    int rc;
+
+    /*  Wait for the main thread to block. */
+    nn_sleep (100);
+    rc = nn_send (sc, sndbuf, MSG_SIZE, 0);
+    errno_assert (rc == MSG_SIZE);
+}
+
+/*  Receiving socket is the connecting one if 'connect' is set. */
+static void test_direct (char *addr, int protocol, int peer, int connect)
+{
+    int rc;
+    int sb;
+    int i;
+    char *buf;
+    struct nn_thread thread;
+
+    sb = test_socket (AF_SP, protocol);
+    sc = test_socket (AF_SP, peer);
+    if (connect) {
+        test_bind (sc, addr);
+        test_connect (sb, addr);
+    }
+    else {
+        test_bind (sb, addr);
+        test_connect (sc, addr);
+    }
+
+    /*  The buffer is larger than the message. REP strips the request ID
+        from the beginning of what was received into the buffer. */
+    buf = malloc (MSG_SIZE + 100);
+    nn_assert (buf);
+    for (i = 0; i != 3; ++i) {
+        memset (buf, 0, MSG_SIZE + 100);
+        nn_thread_init (&thread, sender, NULL);
+        rc = nn_recv (sb, buf, MSG_SIZE + 100, 0);
+        errno_assert (rc == MSG_SIZE);
+        nn_assert (memcmp (buf, sndbuf, MSG_SIZE) == 0);
+        nn_thread_term (&thread);
+        if (protocol == NN_REP)
+            test_send (sb, "OK");
+        if (peer == NN_REQ)
+            test_recv (sc, "OK");
+    }
+    free (buf);
+
+    /*  Buffer that is too small gets a truncated copy. */
+    nn_thread_init (&thread, sender, NULL);
+    rc = nn_recv (sb, sndbuf + MSG_SIZE, 64, 0);
+    errno_assert (rc == MSG_SIZE);
+    nn_assert (memcmp (sndbuf + MSG_SIZE, sndbuf, 64) == 0);
+    nn_thread_term (&thread);
+
+    test_close (sc);
+    test_close (sb);
+}
+
+#if !defined NN_HAVE_WINDOWS
+static void replier (NN_UNUSED void *arg)
+{
+    int rc;
+    int i;
+    void *req;
+
+    /*  Reply around the time the requester gives up waiting. */
+    for (i = 0; i != REQ_COUNT; ++i) {
+        rc = nn_recv (sc, &req, NN_MSG, 0);
+        errno_assert (rc >= 0);
+        nn_freemsg (req);
+        usleep ((i * 37) % 4000);
+        rc = nn_send (sc, repbuf, REP_SIZE, 0);
+        errno_assert (rc == REP_SIZE);
+    }
+}
+
+/*  REQ stores a reply as soon as it arrives. If nn_recv() times out at that
+    moment, the reply must not refer to the buffer passed to it. */
+static void test_req_timeout (char *addr)
+{
+    int rc;
+    int sb;
+    int opt;
+    int i;
+    char *buf;
+    char *buf2;
+    char *rbuf;
+    struct nn_thread thread;
+
+    sb = test_socket (AF_SP, NN_REQ);
+    sc = test_socket (AF_SP, NN_REP);
+    opt = 2;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    opt = -1;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+
+    buf = malloc (REP_SIZE + 100);
+    nn_assert (buf);
+    buf2 = malloc (REP_SIZE + 100);
+    nn_assert (buf2);
+    nn_thread_init (&thread, replier, NULL);
+    for (i = 0; i != REQ_COUNT; ++i) {
+        test_send (sb, "ABC");
+        rbuf = buf;
+        rc = nn_recv (sb, buf, REP_SIZE + 100, 0);
+        if (rc < 0) {
+            errno_assert (nn_errno () == ETIMEDOUT);
+
+            /*  The buffer is the user's again. The reply is received into
+                another one once it arrives. */
+            memset (buf, 'x', REP_SIZE + 100);
+            do
+                rc = nn_recv (sb, buf2, REP_SIZE + 100, 0);
+            while (rc < 0 && nn_errno () == ETIMEDOUT);
+            rbuf = buf2;
+        }
+        errno_assert (rc == REP_SIZE);
+        nn_assert (memcmp (rbuf, repbuf, REP_SIZE) == 0);
+    }
+    nn_thread_term (&thread);
+    free (buf2);
+    free (buf);
+
+    test_close (sc);
+    test_close (sb);
+}
+
+static void raw_sender (NN_UNUSED void *arg)
+{
+    ssize_t nbytes;
+    uint8_t frame [8 + 500];
+
+    /*  Send the message header and half of the body while the main thread
+        is blocked in nn_recv(). */
+    nn_sleep (50);
+    memcpy (frame, rawhdr, 8);
+    memset (frame + 8, 'a', 500);
+    nbytes = send (fd, frame, sizeof (frame), 0);
+    nn_assert (nbytes == (ssize_t) sizeof (frame));
+
+    /*  Send the rest of the body once nn_recv() has timed out. */
+    nn_sleep (300);
+    memset (frame, 'b', 500);
+    nbytes = send (fd, frame, 500, 0);
+    nn_assert (nbytes == 500);
+}
+
+/*  Over WebSocket, the message is sent as a binary frame masked with zeros,
+    whose header is as long as that of TCP. */
+static void test_release (char *addr, int port, int ws)
+{
+    int rc;
+    int sb;
+    int opt;
+    int i;
+    ssize_t nbytes;
+    struct sockaddr_in sin;
+    char hdr [8];
+    char buf [1000];
+    const char *req;
+    size_t pos;
+    struct nn_thread thread;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 200;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (sb, addr);
+
+    /*  Connect to the socket by hand and exchange the protocol headers. */
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = connect (fd, (struct sockaddr*) &sin, sizeof (sin));
+    errno_assert (rc == 0);
+    if (ws) {
+        req = "GET / HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "Sec-WebSocket-Protocol: pair.sp.nanomsg.org\r\n"
+            "\r\n";
+        nbytes = send (fd, req, strlen (req), 0);
+        nn_assert (nbytes == (ssize_t) strlen (req));
+        for (pos = 0; pos < 4 || memcmp (buf + pos - 4, "\r\n\r\n", 4) != 0;
+              ++pos) {
+            nn_assert (pos < sizeof (buf));
+            nbytes = recv (fd, buf + pos, 1, 0);
+            nn_assert (nbytes == 1);
+        }
+        rawhdr = "\x82\xfe\x03\xe8\0\0\0\0";
+    }
+    else {
+        nbytes = send (fd, "\0SP\0\0\x10\0\0", 8, 0);
+        nn_assert (nbytes == 8);
+        nbytes = recv (fd, hdr, 8, MSG_WAITALL);
+        nn_assert (nbytes == 8);
+        rawhdr = "\0\0\0\0\0\0\x03\xe8";
+    }
+
+    /*  Time out while the body is being received into the buffer. */
+    nn_thread_init (&thread, raw_sender, NULL);
+    rc = nn_recv (sb, buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+
+    /*  The buffer is the user's again. The rest of the message is received
+        elsewhere and the part received so far is preserved. */
+    memset (buf, 'x', sizeof (buf));
+    nn_sleep (300);
+    memset (buf, 0, sizeof (buf));
+    rc = nn_recv (sb, buf, sizeof (buf), 0);
+    errno_assert (rc == 1000);
+    for (i = 0; i != 1000; ++i)
+        nn_assert (buf [i] == (i < 500 ? 'a' : 'b'));
+    nn_thread_term (&thread);
+
+    close (fd);
+    test_close (sb);
+}
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int i;
+    int port;
+    char addr [128];
+
+    port = get_test_port (argc, argv);
+
+    sndbuf = malloc (MSG_SIZE + 64);
+    nn_assert (sndbuf);
+    for (i = 0; i != MSG_SIZE; ++i)
+        sndbuf [i] = (char) (i % 251);
+
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    test_direct (addr, NN_PAIR, NN_PAIR, 0);
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 1);
+    test_direct (addr, NN_REP, NN_REQ, 0);
+    strcpy (addr, "ipc://test_recvbuf.ipc");
+    test_direct (addr, NN_PAIR, NN_PAIR, 0);
+    strcpy (addr, "inproc://test_recvbuf");
+    test_direct (addr, NN_PAIR, NN_PAIR, 0);
+
+    /*  WebSocket clients receive unmasked frames, servers masked ones. */
+    test_addr_from (addr, "ws", "127.0.0.1", port + 3);
+    test_direct (addr, NN_PAIR, NN_PAIR, 1);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 4);
+    test_direct (addr, NN_REP, NN_REQ, 0);
+
+#if !defined NN_HAVE_WINDOWS
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 2);
+    test_release (addr, port + 2, 0);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 5);
+    test_release (addr, port + 5, 1);
+
+    /*  Over WebSocket, REQ server unmasks the whole reply after receiving
+        it, which leaves plenty of time for nn_recv() to time out. */
+    repbuf = malloc (REP_SIZE);
+    nn_assert (repbuf);
+    for (i = 0; i != REP_SIZE; ++i)
+        repbuf [i] = (char) (i % 241);
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 6);
+    test_req_timeout (addr);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 7);
+    test_req_timeout (addr);
+    free (repbuf);
+#endif
+
+    free (sndbuf);
+    return 0;
+}
@@ -23,14 +23,29 @@
 
 #include "../src/nn.h"
 #include "../src/reqrep.h"
+#include "../src/pipeline.h"
 
 #include "testutil.h"
 
 int main (int argc, const char *argv[])
 {
+    int rc;
     int rep1;
     int req1;
+    int push1;
+    int pull1;
+    int opt;
+    int i;
+    int sent;
+    void *buf;
     char socket_address[128];
+#if defined NN_HAVE_WINDOWS
+    SOCKET fd;
+#else
+    int fd;
+#endif
+    size_t sz;
+    struct nn_pollfd pfd;
 
     test_addr_from(socket_address, "tcp", "127.0.0.1",
             get_test_port(argc, argv));
@@ -94,6 +109,86 @@ int main (int argc, const char *argv[])
 
     test_close (rep1);
 
+    /*  Test occupancy of the send queues. The queue is bounded either by
+        the number of messages (NN_SNDHWM) or by their size (NN_SNDBUF). */
+    for (i = 0; i != 2; ++i) {
+        pull1 = test_socket (AF_SP, NN_PULL);
+        opt = -1;
+        test_setsockopt (pull1, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+            &opt, sizeof (opt));
+        test_bind (pull1, socket_address);
+
+        push1 = test_socket (AF_SP, NN_PUSH);
+        opt = i == 0 ? 4 : 100;
+        test_setsockopt (push1, NN_SOL_SOCKET, NN_SNDHWM, &opt, sizeof (opt));
+        opt = i == 0 ? 64 * 1024 * 1024 : 5 * 512 * 1024;
+        test_setsockopt (push1, NN_SOL_SOCKET, NN_SNDBUF, &opt, sizeof (opt));
+        opt = 100;
+        test_setsockopt (push1, NN_SOL_SOCKET, NN_SNDTIMEO,
+            &opt, sizeof (opt));
+        test_connect (push1, socket_address);
+
+        /*  Nobody is receiving the messages so they pile up. */
+        sent = 0;
+        while (1) {
+            buf = nn_allocmsg (1024 * 1024, 0);
+            alloc_assert (buf);
+            rc = nn_send (push1, &buf, NN_MSG, 0);
+            if (rc < 0) {
+                errno_assert (nn_errno () == ETIMEDOUT);
+                nn_freemsg (buf);
+                break;
+            }
+            ++sent;
+        }
+        nn_assert (nn_get_statistic (push1,
+            NN_STAT_CURRENT_SND_QUEUE_MESSAGES) == (i == 0 ? 4 : 3));
+        nn_assert (nn_get_statistic (push1,
+            NN_STAT_CURRENT_SND_QUEUE_BYTES) == (i == 0 ? 4 : 3) * 1024 * 1024);
+
+        while (sent--) {
+            rc = nn_recv (pull1, &buf, NN_MSG, 0);
+            errno_assert (rc == 1024 * 1024);
+            nn_freemsg (buf);
+        }
+        nn_assert (nn_get_statistic (push1,
+            NN_STAT_CURRENT_SND_QUEUE_MESSAGES) == 0);
+        nn_assert (nn_get_statistic (push1,
+            NN_STAT_CURRENT_SND_QUEUE_BYTES) == 0);
+
+        test_close (push1);
+        test_close (pull1);
+    }
+
+    /*  A burst of messages is passed without toggling the efds for each
+        of them, unless the user polls them. */
+    pull1 = test_socket (AF_SP, NN_PULL);
+    test_bind (pull1, "inproc://stats");
+    push1 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push1, "inproc://stats");
+    for (i = 0; i != 100; ++i)
+        test_send (push1, "ABC");
+    for (i = 0; i != 100; ++i)
+        test_recv (pull1, "ABC");
+    nn_assert (nn_get_statistic (push1, NN_STAT_FD_SYSCALLS) <= 2);
+    nn_assert (nn_get_statistic (pull1, NN_STAT_FD_SYSCALLS) <= 2);
+    rc = nn_recv (pull1, &buf, NN_MSG, NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+    nn_assert (nn_get_statistic (pull1, NN_STAT_FD_SYSCALLS) <= 3);
+
+    /*  The efd left signalled is unsignalled once the user asks for it. */
+    test_send (push1, "ABC");
+    test_recv (pull1, "ABC");
+    sz = sizeof (fd);
+    rc = nn_getsockopt (pull1, NN_SOL_SOCKET, NN_RCVFD, &fd, &sz);
+    errno_assert (rc == 0);
+    pfd.fd = pull1;
+    pfd.events = NN_POLLIN;
+    rc = nn_poll (&pfd, 1, 0);
+    errno_assert (rc == 0);
+    test_close (push1);
+    test_close (pull1);
+
     return 0;
 }
 
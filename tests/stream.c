@@ -0,0 +1,334 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/reqrep.h"
+
+#include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/thread.c"
+
+#if !defined NN_HAVE_WINDOWS
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+/*  Tests sending and receiving message bodies piece by piece. */
+
+#define MSG_SIZE (1024 * 1024 + 17)
+
+/*  Position in the message body, offset at which to fail and number of
+    final calls. */
+struct stream {
+    size_t pos;
+    size_t fail;
+    int done;
+};
+
+static int sc;
+static struct stream out;
+
+static int source (void *arg, void *buf, size_t len)
+{
+    struct stream *st;
+    size_t i;
+
+    st = (struct stream*) arg;
+    if (!buf) {
+        ++st->done;
+        return 0;
+    }
+    if (st->fail && st->pos + len > st->fail)
+        return -1;
+    for (i = 0; i != len; ++i)
+        ((char*) buf) [i] = (char) ((st->pos + i) % 251);
+    st->pos += len;
+    return 0;
+}
+
+static int sink (void *arg, void *buf, size_t len)
+{
+    struct stream *st;
+    size_t i;
+
+    st = (struct stream*) arg;
+    nn_assert (buf && len);
+    if (st->fail && st->pos + len > st->fail)
+        return -1;
+    for (i = 0; i != len; ++i)
+        nn_assert (((char*) buf) [i] == (char) ((st->pos + i) % 251));
+    st->pos += len;
+    return 0;
+}
+
+static void sender (NN_UNUSED void *arg)
+{
+    int rc;
+
+    /*  Wait for the main thread to block. */
+    nn_sleep (100);
+    rc = nn_sendstream (sc, MSG_SIZE, source, &out, 0);
+    errno_assert (rc == 0);
+}
+
+static void test_stream (char *addr, int protocol, int peer)
+{
+    int rc;
+    int sb;
+    int opt;
+    int i;
+    size_t sz;
+    char *buf;
+    struct stream in;
+    struct nn_thread thread;
+
+    sb = test_socket (AF_SP, protocol);
+    opt = -1;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    test_bind (sb, addr);
+    sc = test_socket (AF_SP, peer);
+    test_connect (sc, addr);
+
+    buf = malloc (MSG_SIZE);
+    nn_assert (buf);
+    memset (&out, 0, sizeof (out));
+    rc = source (&out, buf, MSG_SIZE);
+    nn_assert (rc == 0);
+
+    for (i = 0; i != 3; ++i) {
+
+        /*  The message is passed to the sink as it arrives. */
+        memset (&in, 0, sizeof (in));
+        memset (&out, 0, sizeof (out));
+        if (peer == NN_REQ) {
+
+            /*  REQ may need to resend the request, so it can't send
+                the body piece by piece. */
+            rc = nn_sendstream (sc, MSG_SIZE, source, &out, 0);
+            nn_assert (rc < 0 && nn_errno () == ENOTSUP);
+            rc = nn_send (sc, buf, MSG_SIZE, 0);
+            errno_assert (rc == MSG_SIZE);
+        }
+        else
+            nn_thread_init (&thread, sender, NULL);
+        rc = nn_recvstream (sb, sink, &in, &sz, 0);
+        errno_assert (rc == 0);
+        nn_assert (sz == MSG_SIZE);
+        nn_assert (in.pos == MSG_SIZE);
+        if (peer == NN_REQ) {
+            test_send (sb, "OK");
+            test_recv (sc, "OK");
+            continue;
+        }
+        nn_thread_term (&thread);
+        nn_assert (out.pos == MSG_SIZE && out.done == 1);
+
+        /*  Plain nn_recv() gets the message whole. */
+        out.pos = 0;
+        nn_thread_init (&thread, sender, NULL);
+        memset (buf, 0, MSG_SIZE);
+        rc = nn_recv (sb, buf, MSG_SIZE, 0);
+        errno_assert (rc == MSG_SIZE);
+        memset (&in, 0, sizeof (in));
+        rc = sink (&in, buf, MSG_SIZE);
+        nn_assert (rc == 0);
+        nn_thread_term (&thread);
+        nn_assert (out.done == 2);
+    }
+
+    /*  Small message is passed to the sink in one go. */
+    memset (&in, 0, sizeof (in));
+    memset (&out, 0, sizeof (out));
+    if (peer == NN_REQ) {
+        rc = source (&out, buf, 10);
+        nn_assert (rc == 0);
+        rc = nn_send (sc, buf, 10, 0);
+        errno_assert (rc == 10);
+    }
+    else {
+        rc = nn_sendstream (sc, 10, source, &out, 0);
+        errno_assert (rc == 0);
+    }
+    rc = nn_recvstream (sb, sink, &in, &sz, 0);
+    errno_assert (rc == 0);
+    nn_assert (sz == 10);
+    nn_assert (in.pos == 10);
+
+    free (buf);
+    test_close (sc);
+    test_close (sb);
+}
+
+static void test_fail (char *addr)
+{
+    int rc;
+    int sb;
+    struct stream in;
+    struct nn_thread thread;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, addr);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, addr);
+
+    /*  Sink that fails gets the rest of the message dropped. The connection
+        survives. */
+    memset (&in, 0, sizeof (in));
+    memset (&out, 0, sizeof (out));
+    in.fail = MSG_SIZE / 2;
+    nn_thread_init (&thread, sender, NULL);
+    rc = nn_recvstream (sb, sink, &in, NULL, 0);
+    nn_assert (rc < 0 && nn_errno () == ECONNABORTED);
+    nn_thread_term (&thread);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+
+    /*  Source that fails breaks the connection. */
+    memset (&in, 0, sizeof (in));
+    memset (&out, 0, sizeof (out));
+    out.fail = MSG_SIZE / 2;
+    nn_thread_init (&thread, sender, NULL);
+    rc = nn_recvstream (sb, sink, &in, NULL, 0);
+    nn_assert (rc < 0 && nn_errno () == ECONNRESET);
+    nn_thread_term (&thread);
+    nn_sleep (100);
+    nn_assert (out.done == 1);
+
+    test_close (sc);
+    test_close (sb);
+}
+
+static void test_fallback (char *addr)
+{
+    int rc;
+    int sb;
+    void *buf;
+    struct stream in;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, addr);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, addr);
+
+    /*  Transports that can't stream the body read it whole on send. */
+    memset (&out, 0, sizeof (out));
+    rc = nn_sendstream (sc, MSG_SIZE, source, &out, 0);
+    errno_assert (rc == 0);
+    nn_assert (out.pos == MSG_SIZE && out.done == 1);
+    rc = nn_recv (sb, &buf, NN_MSG, 0);
+    errno_assert (rc == MSG_SIZE);
+    memset (&in, 0, sizeof (in));
+    rc = sink (&in, buf, MSG_SIZE);
+    nn_assert (rc == 0);
+    nn_freemsg (buf);
+
+    /*  Failure to produce the body loses the message. */
+    memset (&out, 0, sizeof (out));
+    out.fail = 100;
+    rc = nn_sendstream (sc, MSG_SIZE, source, &out, 0);
+    errno_assert (rc == 0);
+    nn_assert (out.done == 1);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+
+    test_close (sc);
+    test_close (sb);
+}
+
+#if !defined NN_HAVE_WINDOWS
+static void test_sendfd (char *addr)
+{
+    int rc;
+    int sb;
+    int opt;
+    int fds [2];
+    FILE *f;
+    char *buf;
+    struct stream in;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = -1;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    test_bind (sb, addr);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, addr);
+
+    buf = malloc (MSG_SIZE);
+    nn_assert (buf);
+    memset (&out, 0, sizeof (out));
+    rc = source (&out, buf, MSG_SIZE);
+    nn_assert (rc == 0);
+    f = tmpfile ();
+    nn_assert (f);
+    nn_assert (fwrite (buf, 1, MSG_SIZE, f) == MSG_SIZE);
+    rc = fflush (f);
+    nn_assert (rc == 0);
+    nn_assert (lseek (fileno (f), 0, SEEK_SET) == 0);
+
+    /*  The file is sent from its current position. */
+    rc = nn_sendfd (sc, fileno (f), MSG_SIZE, 0);
+    errno_assert (rc == 0);
+    fclose (f);
+    memset (buf, 0, MSG_SIZE);
+    rc = nn_recv (sb, buf, MSG_SIZE, 0);
+    errno_assert (rc == MSG_SIZE);
+    memset (&in, 0, sizeof (in));
+    rc = sink (&in, buf, MSG_SIZE);
+    nn_assert (rc == 0);
+    free (buf);
+
+    /*  Reading from anything but a regular file could block the library. */
+    rc = pipe (fds);
+    errno_assert (rc == 0);
+    rc = nn_sendfd (sc, fds [0], 10, 0);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    close (fds [0]);
+    close (fds [1]);
+
+    test_close (sc);
+    test_close (sb);
+}
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int port;
+    char addr [128];
+
+    port = get_test_port (argc, argv);
+
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    test_stream (addr, NN_PAIR, NN_PAIR);
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 1);
+    test_stream (addr, NN_REP, NN_REQ);
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 2);
+    test_fail (addr);
+    strcpy (addr, "inproc://test_stream");
+    test_fallback (addr);
+#if !defined NN_HAVE_WINDOWS
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 3);
+    test_sendfd (addr);
+#endif
+
+    return 0;
+}
@@ -25,14 +25,91 @@
 #include "../src/nn.h"
 #include "../src/pair.h"
 #include "../src/pubsub.h"
+#include "../src/pipeline.h"
+#include "../src/reqrep.h"
 #include "../src/tcp.h"
 
 #include "testutil.h"
 
+#if defined NN_HAVE_LINUX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 /*  Tests TCP transport. */
 
 int sc;
 
+#if defined NN_HAVE_LINUX
+/*  Address of the UNIX domain socket of NN_TCP_LOCAL endpoint bound to
+    127.0.0.1. */
+static socklen_t test_local_addr (struct sockaddr_un *un, int port)
+{
+    int len;
+
+    memset (un, 0, sizeof (*un));
+    un->sun_family = AF_UNIX;
+    len = snprintf (un->sun_path + 1, sizeof (un->sun_path) - 1,
+        "nanomsg-tcp-127.0.0.1-%d", port);
+    return (socklen_t) (offsetof (struct sockaddr_un, sun_path) + 1 + len);
+}
+
+/*  Number of sockets bearing the name of that socket, i.e. the listener and
+    the connections accepted by it. */
+static int test_local_count (int port)
+{
+    FILE *f;
+    char line [512];
+    char name [64];
+    size_t len;
+    size_t namelen;
+    int n;
+
+    snprintf (name, sizeof (name), " @nanomsg-tcp-127.0.0.1-%d\n", port);
+    namelen = strlen (name);
+    f = fopen ("/proc/net/unix", "r");
+    nn_assert (f);
+    n = 0;
+    while (fgets (line, sizeof (line), f)) {
+        len = strlen (line);
+        if (len >= namelen && strcmp (line + len - namelen, name) == 0)
+            ++n;
+    }
+    fclose (f);
+    return n;
+}
+
+/*  Number of TCP sockets listening on the port. */
+static int test_listen_count (int port)
+{
+    FILE *f;
+    char line [512];
+    unsigned int lport;
+    unsigned int st;
+    int n;
+
+    f = fopen ("/proc/net/tcp", "r");
+    nn_assert (f);
+    n = 0;
+    while (fgets (line, sizeof (line), f)) {
+        if (sscanf (line, " %*d: %*[0-9A-Fa-f]:%x %*s %x", &lport, &st) == 2 &&
+              lport == (unsigned int) port && st == 0x0A)
+            ++n;
+    }
+    fclose (f);
+    return n;
+}
+#endif
+
 int main (int argc, const char *argv[])
 {
     int rc;
@@ -41,9 +118,19 @@ int main (int argc, const char *argv[])
     int opt;
     size_t sz;
     int s1, s2;
+    int subs [10];
     void * dummy_buf;
     char addr[128];
     char socket_address[128];
+    char buf[2048];
+#if defined NN_HAVE_LINUX
+    int fd;
+    int fds [2];
+    pid_t pid;
+    struct sockaddr_un un;
+    struct sockaddr_in sin;
+    socklen_t unlen;
+#endif
 
     int port = get_test_port(argc, argv);
 
@@ -214,6 +301,450 @@ int main (int argc, const char *argv[])
     errno_assert (nn_errno () == EINVAL);
     test_close (sb);
 
+    /*  Check REUSEPORT socket option. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_TCP, NN_TCP_REUSEPORT, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 0);
+    opt = 2;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_REUSEPORT, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_REUSEPORT, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+
+    /*  Check BACKLOG socket option. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_TCP, NN_TCP_BACKLOG, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 100);
+    opt = 0;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_BACKLOG, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 500;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_BACKLOG, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+
+    /*  With a single worker thread, the port is not shared, so nobody else
+        can bind it. */
+    test_bind (sb, socket_address);
+#if defined NN_HAVE_LINUX
+    nn_assert (test_listen_count (port) == 1);
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    opt = 1;
+    rc = setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = bind (fd, (struct sockaddr*) &sin, sizeof (sin));
+    nn_assert (rc < 0 && errno == EADDRINUSE);
+    close (fd);
+#endif
+    s1 = test_socket (AF_SP, NN_PAIR);
+    test_connect (s1, socket_address);
+    nn_sleep (100);
+    test_send (s1, "ABC");
+    test_recv (sb, "ABC");
+    test_send (sb, "DEF");
+    test_recv (s1, "DEF");
+    test_close (s1);
+    test_close (sb);
+
+    /*  Test a burst of connections arriving at the same time. */
+    sb = test_socket (AF_SP, NN_PUB);
+    test_bind (sb, socket_address);
+    for (i = 0; i != 10; ++i) {
+        subs [i] = test_socket (AF_SP, NN_SUB);
+        test_setsockopt (subs [i], NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+        test_connect (subs [i], socket_address);
+    }
+    nn_sleep (200);
+    test_send (sb, "ABC");
+    for (i = 0; i != 10; ++i) {
+        test_recv (subs [i], "ABC");
+        test_close (subs [i]);
+    }
+    test_close (sb);
+
+#if defined NN_HAVE_LINUX
+    /*  Test connections accepted by sharded listeners. The worker threads
+        are created anew once all the sockets are closed. */
+    setenv ("NN_WORKERS", "4", 1);
+    sb = test_socket (AF_SP, NN_PULL);
+    opt = 1;
+    test_setsockopt (sb, NN_TCP, NN_TCP_REUSEPORT, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    nn_assert (test_listen_count (port) == 4);
+    for (i = 0; i != 10; ++i) {
+        subs [i] = test_socket (AF_SP, NN_PUSH);
+        test_connect (subs [i], socket_address);
+    }
+    for (i = 0; i != 10; ++i)
+        test_send (subs [i], "ABC");
+    for (i = 0; i != 10; ++i)
+        test_recv (sb, "ABC");
+    nn_assert (nn_get_statistic (sb, NN_STAT_ACCEPTED_CONNECTIONS) == 10);
+    for (i = 0; i != 10; ++i)
+        test_close (subs [i]);
+    test_close (sb);
+    unsetenv ("NN_WORKERS");
+#endif
+
+    /*  Test connecting by name with IPv6 enabled. The name may resolve to
+        several addresses, only some of which are listening. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, socket_address);
+    s1 = test_socket (AF_SP, NN_PAIR);
+    opt = 0;
+    test_setsockopt (s1, NN_SOL_SOCKET, NN_IPV4ONLY, &opt, sizeof (opt));
+    test_addr_from (addr, "tcp", "localhost", port);
+    test_connect (s1, addr);
+    nn_sleep (100);
+    test_send (s1, "ABC");
+    test_recv (sb, "ABC");
+    nn_assert (nn_get_statistic (s1, NN_STAT_DNS_CACHE_MISSES) == 1);
+
+    /*  The second lookup of the same name is served from the cache. */
+    s2 = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (s2, NN_SOL_SOCKET, NN_IPV4ONLY, &opt, sizeof (opt));
+    test_connect (s2, addr);
+    nn_sleep (100);
+    nn_assert (nn_get_statistic (s2, NN_STAT_DNS_CACHE_HITS) >= 1);
+    nn_assert (nn_get_statistic (s2, NN_STAT_DNS_CACHE_MISSES) == 0);
+    test_close (s2);
+    test_close (s1);
+    test_close (sb);
+
+    /*  Test NN_TCP_CONNECTIONS option. */
+    sc = test_socket (AF_SP, NN_PUSH);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 1);
+    opt = 0;
+    rc = nn_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 65;
+    rc = nn_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 4;
+    test_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+
+    /*  Test that the messages are spread among multiple connections. The
+        error is reported until all of them are established. */
+    test_connect (sc, socket_address);
+    nn_sleep (100);
+    nn_assert (nn_get_statistic (sc, NN_STAT_CURRENT_EP_ERRORS) == 1);
+    sb = test_socket (AF_SP, NN_PULL);
+    test_bind (sb, socket_address);
+    nn_sleep (300);
+    nn_assert (nn_get_statistic (sc, NN_STAT_CURRENT_CONNECTIONS) == 4);
+    nn_assert (nn_get_statistic (sc, NN_STAT_CURRENT_EP_ERRORS) == 0);
+    nn_assert (nn_get_statistic (sb, NN_STAT_ACCEPTED_CONNECTIONS) == 4);
+    for (i = 0; i != 8; ++i)
+        test_send (sc, "ABC");
+    for (i = 0; i != 8; ++i)
+        test_recv (sb, "ABC");
+    test_close (sc);
+    test_close (sb);
+
+    /*  PAIR would refuse all connections but one. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 2;
+    test_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    rc = nn_connect (sc, socket_address);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_close (sc);
+
+    /*  Test pipelined handshake. Messages are sent right behind the protocol
+        header and compressed only once the peer's header arrives. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 2;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_PIPELINED_HANDSHAKE, &opt,
+        sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_PIPELINED_HANDSHAKE, &opt,
+        sizeof (opt));
+    opt = NN_COMPRESSION_LZ;
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    for (i = 0; i != sizeof (buf) - 1; ++i)
+        buf [i] = 'a' + i % 4;
+    buf [sizeof (buf) - 1] = 0;
+    test_send (sc, buf);
+    test_recv (sb, buf);
+    for (i = 0; i != 10; ++i) {
+        test_send (sb, buf);
+        test_recv (sc, buf);
+        test_send (sc, buf);
+        test_recv (sb, buf);
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  Messages pipelined to a peer of a wrong type are never delivered. */
+    sb = test_socket (AF_SP, NN_PULL);
+    opt = 100;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 1;
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_PIPELINED_HANDSHAKE, &opt,
+        sizeof (opt));
+    opt = 100;
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_SNDTIMEO, &opt, sizeof (opt));
+    test_connect (sc, socket_address);
+
+    /*  The send may fail if the peer's header arrives before it. */
+    rc = nn_send (sc, "ABC", 3, 0);
+    nn_assert (rc == 3 || nn_errno () == ETIMEDOUT);
+    test_drop (sb, ETIMEDOUT);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test NN_TCP_LOCAL option. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_TCP, NN_TCP_LOCAL, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 0);
+    opt = 2;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_LOCAL, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    test_setsockopt (sb, NN_TCP, NN_TCP_LOCAL, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+
+#if defined NN_HAVE_LINUX
+    /*  The bound endpoint listens on the UNIX domain socket named after its
+        address as well. */
+    unlen = test_local_addr (&un, port);
+    fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    rc = bind (fd, (struct sockaddr*) &un, unlen);
+    nn_assert (rc < 0 && errno == EADDRINUSE);
+    close (fd);
+#endif
+
+    /*  Local peer connects transparently, via the UNIX domain socket. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (sc, NN_TCP, NN_TCP_LOCAL, &opt, sizeof (opt));
+    test_connect (sc, socket_address);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    test_send (sb, "DEF");
+    test_recv (sc, "DEF");
+    nn_assert (nn_get_statistic (sc, NN_STAT_CONNECT_ERRORS) == 0);
+#if defined NN_HAVE_LINUX
+    nn_assert (test_local_count (port) == 2);
+#endif
+    test_close (sc);
+    test_close (sb);
+
+    /*  If the peer doesn't support the shortcut, plain TCP is used. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (sc, NN_TCP, NN_TCP_LOCAL, &opt, sizeof (opt));
+    test_connect (sc, socket_address);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    nn_assert (nn_get_statistic (sc, NN_STAT_CONNECT_ERRORS) == 0);
+#if defined NN_HAVE_LINUX
+    nn_assert (test_local_count (port) == 0);
+#endif
+    test_close (sc);
+    test_close (sb);
+
+#if defined NN_HAVE_LINUX
+    /*  Anybody can take the name of the UNIX domain socket. It's not used
+        unless there's a TCP listener it's named after. */
+    unlen = test_local_addr (&un, port);
+    fd = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    errno_assert (fd >= 0);
+    rc = bind (fd, (struct sockaddr*) &un, unlen);
+    errno_assert (rc == 0);
+    rc = listen (fd, 10);
+    errno_assert (rc == 0);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (sc, NN_TCP, NN_TCP_LOCAL, &opt, sizeof (opt));
+    test_connect (sc, socket_address);
+    nn_sleep (100);
+    rc = accept (fd, NULL, NULL);
+    nn_assert (rc < 0 && errno == EAGAIN);
+    test_close (sc);
+    close (fd);
+
+    /*  Nor if it is run by a different user than the TCP listener. */
+    if (geteuid () == 0) {
+        rc = pipe (fds);
+        errno_assert (rc == 0);
+        pid = fork ();
+        errno_assert (pid >= 0);
+        if (pid == 0) {
+            rc = setuid (65534);
+            errno_assert (rc == 0);
+            prctl (PR_SET_PDEATHSIG, SIGKILL);
+            fd = socket (AF_UNIX, SOCK_STREAM, 0);
+            errno_assert (fd >= 0);
+            rc = bind (fd, (struct sockaddr*) &un, unlen);
+            errno_assert (rc == 0);
+            rc = listen (fd, 10);
+            errno_assert (rc == 0);
+            rc = (int) write (fds [1], "", 1);
+            nn_assert (rc == 1);
+
+            /*  Report any data sent to it. */
+            while (1) {
+                s1 = accept (fd, NULL, NULL);
+                errno_assert (s1 >= 0);
+                if (read (s1, buf, 1) == 1)
+                    rc = (int) write (fds [1], "X", 1);
+                close (s1);
+            }
+        }
+        rc = (int) read (fds [0], buf, 1);
+        nn_assert (rc == 1);
+        sb = test_socket (AF_SP, NN_PAIR);
+        test_setsockopt (sb, NN_TCP, NN_TCP_LOCAL, &opt, sizeof (opt));
+        opt = 1000;
+        test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+        opt = 1;
+        test_bind (sb, socket_address);
+        sc = test_socket (AF_SP, NN_PAIR);
+        test_setsockopt (sc, NN_TCP, NN_TCP_LOCAL, &opt, sizeof (opt));
+        opt = 1000;
+        test_setsockopt (sc, NN_SOL_SOCKET, NN_SNDTIMEO, &opt, sizeof (opt));
+        opt = 1;
+        test_connect (sc, socket_address);
+        test_send (sc, "ABC");
+        test_recv (sb, "ABC");
+        test_close (sc);
+        test_close (sb);
+        rc = fcntl (fds [0], F_SETFL, O_NONBLOCK);
+        errno_assert (rc == 0);
+        rc = (int) read (fds [0], buf, 1);
+        nn_assert (rc < 0 && errno == EAGAIN);
+        kill (pid, SIGKILL);
+        waitpid (pid, NULL, 0);
+        close (fds [0]);
+        close (fds [1]);
+    }
+#endif
+
+    /*  Test NN_TCP_FRAGMENT option. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_TCP, NN_TCP_FRAGMENT, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 0);
+    opt = -1;
+    rc = nn_setsockopt (sc, NN_TCP, NN_TCP_FRAGMENT, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 65536;
+    test_setsockopt (sc, NN_TCP, NN_TCP_FRAGMENT, &opt, sizeof (opt));
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = -1;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    opt = 65536;
+    test_setsockopt (sb, NN_TCP, NN_TCP_FRAGMENT, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+
+    /*  Small message sent behind a large one overtakes it. */
+    sz = 32 * 1024 * 1024 + 1;
+    dummy_buf = nn_allocmsg (sz, 0);
+    alloc_assert (dummy_buf);
+    for (i = 0; i != (int) sz; ++i)
+        ((char*) dummy_buf) [i] = (char) (i % 251);
+    rc = nn_send (sc, &dummy_buf, NN_MSG, 0);
+    errno_assert (rc == (int) sz);
+    test_send (sc, "DEF");
+    test_recv (sb, "DEF");
+    rc = nn_recv (sb, &dummy_buf, NN_MSG, 0);
+    errno_assert (rc == (int) sz);
+    for (i = 0; i != (int) sz; ++i)
+        nn_assert (((char*) dummy_buf) [i] == (char) (i % 251));
+    nn_freemsg (dummy_buf);
+
+    /*  Messages that fit into a fragment are sent as usual. */
+    test_send (sc, "GHI");
+    test_recv (sb, "GHI");
+    test_close (sc);
+    test_close (sb);
+
+    /*  Fragments may split the protocol header and carry compressed data. */
+    sc = test_socket (AF_SP, NN_REQ);
+    opt = 3;
+    test_setsockopt (sc, NN_TCP, NN_TCP_FRAGMENT, &opt, sizeof (opt));
+    opt = NN_COMPRESSION_LZ;
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    sb = test_socket (AF_SP, NN_REP);
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    opt = 1;
+    test_setsockopt (sb, NN_TCP, NN_TCP_FRAGMENT, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    for (i = 0; i != sizeof (buf) - 1; ++i)
+        buf [i] = 'a' + i % 4;
+    buf [sizeof (buf) - 1] = 0;
+    for (i = 0; i != 10; ++i) {
+        test_send (sc, buf);
+        test_recv (sb, buf);
+        test_send (sb, "OK");
+        test_recv (sc, "OK");
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  If the peer doesn't ask for fragmenting, messages are sent whole. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 3;
+    test_setsockopt (sc, NN_TCP, NN_TCP_FRAGMENT, &opt, sizeof (opt));
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    test_send (sc, "ABCDEFGHIJ");
+    test_recv (sb, "ABCDEFGHIJ");
+    test_close (sc);
+    test_close (sb);
+
+#if defined NN_HAVE_LINUX
+    /*  By default the protocol header carries no optional features. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, socket_address);
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = connect (fd, (struct sockaddr*) &sin, sizeof (sin));
+    errno_assert (rc == 0);
+    rc = (int) send (fd, "\0SP\0\0\x10\0\0", 8, 0);
+    errno_assert (rc == 8);
+    rc = (int) recv (fd, buf, 8, MSG_WAITALL);
+    errno_assert (rc == 8);
+    nn_assert (memcmp (buf, "\0SP\0\0\x10\0\0", 8) == 0);
+    close (fd);
+    test_close (sb);
+#endif
+
     /*  Test closing a socket that is waiting to connect. */
     sc = test_socket (AF_SP, NN_PAIR);
     test_connect (sc, socket_address);
@@ -0,0 +1,272 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/ws.h"
+
+#include "testutil.h"
+#include "../src/utils/thread.c"
+
+#if !defined NN_HAVE_WINDOWS
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+/*  Tests writing of frames queued while the peer doesn't keep up, which are
+    batched together, and of the closing handshake following frames being
+    written. */
+
+#define TEST_MSGCOUNT 2000
+#define TEST_OPCODE_PING 0x09
+
+/*  Every 50th message is a ping, every 7th one is too large to be batched
+    and every 97th one is large enough to fill the socket buffers on its own
+    in the middle of the batched ones. */
+static size_t test_msgsize (int i)
+{
+    if (i % 50 == 0)
+        return 100;
+    if (i % 97 == 0)
+        return 20000;
+    if (i % 7 == 0)
+        return 1500;
+    return i % 200;
+}
+
+static void test_fill (char *buf, size_t len, int i)
+{
+    size_t j;
+
+    for (j = 0; j != len; ++j)
+        buf [j] = (char) (i + j);
+}
+
+static void test_sender (void *arg)
+{
+    int rc;
+    int i;
+    size_t len;
+    char buf [20000];
+    char ctrl [256];
+    uint8_t opcode;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    int sender;
+
+    sender = *(int*) arg;
+    for (i = 0; i != TEST_MSGCOUNT; ++i) {
+        len = test_msgsize (i);
+        test_fill (buf, len, i);
+        iov.iov_base = buf;
+        iov.iov_len = len;
+        memset (&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        if (i % 50 == 0) {
+            cmsg = (struct nn_cmsghdr*) ctrl;
+            cmsg->cmsg_level = NN_WS;
+            cmsg->cmsg_type = NN_WS_MSG_TYPE;
+            cmsg->cmsg_len = NN_CMSG_SPACE (sizeof (opcode));
+            opcode = TEST_OPCODE_PING;
+            memcpy (NN_CMSG_DATA (cmsg), &opcode, sizeof (opcode));
+            hdr.msg_control = ctrl;
+            hdr.msg_controllen = cmsg->cmsg_len;
+        }
+        rc = nn_sendmsg (sender, &hdr, 0);
+        errno_assert (rc == (int) len);
+    }
+}
+
+static void test_batch (int sender, int receiver)
+{
+    int rc;
+    int i;
+    size_t len;
+    char buf [20000];
+    char ctrl [256];
+    uint8_t opcode;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    struct nn_thread thread;
+
+    /*  The messages pile up in the socket buffers and the send queue until
+        the receiver starts reading. */
+    nn_thread_init (&thread, test_sender, &sender);
+    nn_sleep (100);
+
+    /*  Frames arrive whole and in order, pings included. */
+    for (i = 0; i != TEST_MSGCOUNT; ++i) {
+        iov.iov_base = buf;
+        iov.iov_len = sizeof (buf);
+        memset (&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = ctrl;
+        hdr.msg_controllen = sizeof (ctrl);
+        rc = nn_recvmsg (receiver, &hdr, 0);
+        errno_assert (rc == (int) test_msgsize (i));
+        for (len = 0; len != (size_t) rc; ++len)
+            nn_assert (buf [len] == (char) (i + len));
+        cmsg = NN_CMSG_FIRSTHDR (&hdr);
+        while (1) {
+            nn_assert (cmsg);
+            if (cmsg->cmsg_level == NN_WS && cmsg->cmsg_type == NN_WS_MSG_TYPE)
+                break;
+            cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+        }
+        opcode = *(uint8_t*) NN_CMSG_DATA (cmsg);
+        nn_assert (opcode == (i % 50 == 0 ? TEST_OPCODE_PING :
+            NN_WS_MSG_TYPE_BINARY));
+    }
+    nn_thread_term (&thread);
+}
+
+#if !defined NN_HAVE_WINDOWS
+static void test_read (int fd, void *buf, size_t len)
+{
+    ssize_t nbytes;
+
+    nbytes = recv (fd, buf, len, MSG_WAITALL);
+    nn_assert (nbytes == (ssize_t) len);
+}
+
+static int test_connect_raw (int port)
+{
+    int rc;
+    int fd;
+    ssize_t nbytes;
+    struct sockaddr_in sin;
+    char response [1024];
+    size_t pos;
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = connect (fd, (struct sockaddr*) &sin, sizeof (sin));
+    errno_assert (rc == 0);
+
+    strcpy (response,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pair.sp.nanomsg.org\r\n"
+        "\r\n");
+    nbytes = send (fd, response, strlen (response), 0);
+    nn_assert (nbytes == (ssize_t) strlen (response));
+    for (pos = 0; pos < 4 ||
+          memcmp (response + pos - 4, "\r\n\r\n", 4) != 0; ++pos) {
+        nn_assert (pos < sizeof (response) - 1);
+        test_read (fd, response + pos, 1);
+    }
+    nn_assert (memcmp (response, "HTTP/1.1 101", 12) == 0);
+
+    return fd;
+}
+
+/*  Peer closes the connection while a large message is being written to it.
+    The closing handshake follows the message instead of being dropped. */
+static void test_close_after_write (char *addr, int port)
+{
+    int sb;
+    int fd;
+    char *buf;
+    uint8_t hdr [10];
+    ssize_t nbytes;
+    size_t len;
+
+    len = 4 * 1024 * 1024;
+    buf = malloc (len);
+    nn_assert (buf);
+    memset (buf, 'A', len);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, addr);
+    fd = test_connect_raw (port);
+    nn_assert (nn_send (sb, buf, len, 0) == (int) len);
+
+    /*  Masked close frame with status code 1000. */
+    memcpy (hdr, "\x88\x82\x00\x00\x00\x00\x03\xe8", 8);
+    nbytes = send (fd, hdr, 8, MSG_NOSIGNAL);
+    nn_assert (nbytes == 8);
+
+    test_read (fd, hdr, 10);
+    nn_assert (hdr [0] == 0x82 && hdr [1] == 127);
+    test_read (fd, buf, len);
+    nn_assert (buf [0] == 'A' && buf [len - 1] == 'A');
+    test_read (fd, hdr, 2);
+    nn_assert (hdr [0] == 0x88);
+
+    close (fd);
+    test_close (sb);
+    free (buf);
+}
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int sb;
+    int sc;
+    int opt;
+    int port;
+    char addr [128];
+
+    port = get_test_port (argc, argv);
+
+    /*  Frames are batched only if there's a send queue. */
+    test_addr_from (addr, "ws", "127.0.0.1", port);
+    sb = test_socket (AF_SP, NN_PAIR);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 1000;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_SNDHWM, &opt, sizeof (opt));
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_SNDHWM, &opt, sizeof (opt));
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+
+    /*  Connection is established once the first message gets through. */
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+
+    /*  Masked frames sent by the client, unmasked ones sent by the server. */
+    test_batch (sc, sb);
+    test_batch (sb, sc);
+
+    test_close (sc);
+    test_close (sb);
+
+#if !defined NN_HAVE_WINDOWS
+    test_addr_from (addr, "ws", "127.0.0.1", port + 1);
+    test_close_after_write (addr, port + 1);
+#endif
+
+    return 0;
+}
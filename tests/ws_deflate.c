@@ -0,0 +1,306 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/ws.h"
+
+#include "testutil.h"
+
+#if !defined NN_HAVE_WINDOWS
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+/*  Tests RFC 7692 permessage-deflate compression of WebSocket messages. */
+
+#define TEST_BIGSZ 65536
+
+static void test_setdeflate (int s, int enable, int takeover, int bits)
+{
+    test_setsockopt (s, NN_WS, NN_WS_DEFLATE, &enable, sizeof (enable));
+    test_setsockopt (s, NN_WS, NN_WS_DEFLATE_TAKEOVER,
+        &takeover, sizeof (takeover));
+    test_setsockopt (s, NN_WS, NN_WS_DEFLATE_WINDOW_BITS, &bits, sizeof (bits));
+}
+
+static void test_deflate_transfer (char *addr, int takeover, int bits,
+    int compressed)
+{
+    int sb;
+    int sc;
+    int rc;
+    int i;
+    int j;
+    int opt;
+    char *buf;
+    void *rbuf;
+    uint64_t in;
+    uint64_t out;
+
+    buf = malloc (TEST_BIGSZ);
+    nn_assert (buf);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_setdeflate (sb, 1, takeover, bits);
+    test_setdeflate (sc, compressed, takeover, bits);
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+
+    /*  Messages below the threshold are passed through untouched. */
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+
+    /*  Compressible messages, in both directions, several times so that
+        the contexts carry over from one message to the next. */
+    for (i = 0; i != TEST_BIGSZ; ++i)
+        buf [i] = (char) ('a' + (i % 16));
+    for (j = 0; j != 3; ++j) {
+        buf [j] = 'X';
+        rc = nn_send (sc, buf, TEST_BIGSZ, 0);
+        errno_assert (rc == TEST_BIGSZ);
+        rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+        errno_assert (rc == TEST_BIGSZ);
+        nn_assert (memcmp (rbuf, buf, TEST_BIGSZ) == 0);
+        rc = nn_send (sb, &rbuf, NN_MSG, 0);
+        errno_assert (rc == TEST_BIGSZ);
+        rc = nn_recv (sc, &rbuf, NN_MSG, 0);
+        errno_assert (rc == TEST_BIGSZ);
+        nn_assert (memcmp (rbuf, buf, TEST_BIGSZ) == 0);
+        nn_freemsg (rbuf);
+    }
+
+    /*  Text messages are compressed as well. */
+    opt = NN_WS_MSG_TYPE_TEXT;
+    test_setsockopt (sc, NN_WS, NN_WS_MSG_TYPE, &opt, sizeof (opt));
+    rc = nn_send (sc, buf, 1024, 0);
+    errno_assert (rc == 1024);
+    rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+    errno_assert (rc == 1024);
+    nn_assert (memcmp (rbuf, buf, 1024) == 0);
+    nn_freemsg (rbuf);
+
+    in = nn_get_statistic (sc, NN_STAT_COMPRESSION_BYTES_IN);
+    out = nn_get_statistic (sc, NN_STAT_COMPRESSION_BYTES_OUT);
+    if (compressed) {
+        nn_assert (nn_get_statistic (sc, NN_STAT_COMPRESSION_MESSAGES) == 4);
+        nn_assert (nn_get_statistic (sb, NN_STAT_DECOMPRESSION_MESSAGES) == 4);
+        nn_assert (in == 3 * TEST_BIGSZ + 1024);
+        nn_assert (out < in / 10);
+    }
+    else {
+        nn_assert (in == 0 && out == 0);
+        nn_assert (nn_get_statistic (sb, NN_STAT_COMPRESSION_MESSAGES) == 0);
+        nn_assert (nn_get_statistic (sb,
+            NN_STAT_DECOMPRESSION_MESSAGES) == 0);
+    }
+
+    test_close (sc);
+    test_close (sb);
+    free (buf);
+}
+
+#if !defined NN_HAVE_WINDOWS
+static void test_read (int fd, void *buf, size_t len)
+{
+    ssize_t nbytes;
+
+    nbytes = recv (fd, buf, len, MSG_WAITALL);
+    nn_assert (nbytes == (ssize_t) len);
+}
+
+/*  Sends a masked frame as a browser would. */
+static void test_send_frame (int fd, uint8_t hdr, const void *data,
+    size_t len)
+{
+    ssize_t nbytes;
+    size_t i;
+    uint8_t frame [6 + 125];
+
+    nn_assert (len <= 125);
+    frame [0] = hdr;
+    frame [1] = 0x80 | (uint8_t) len;
+    memcpy (frame + 2, "\x11\x22\x33\x44", 4);
+    for (i = 0; i != len; ++i)
+        frame [6 + i] = ((const uint8_t*) data) [i] ^ frame [2 + i % 4];
+    nbytes = send (fd, frame, 6 + len, 0);
+    nn_assert (nbytes == (ssize_t) (6 + len));
+}
+
+/*  Talks to a nanomsg socket the way a browser does. Frames compressed by
+    the socket are echoed back to it, the ones made up here use stored
+    (uncompressed) deflate blocks. */
+static void test_browser (char *addr, int port)
+{
+    int rc;
+    int sb;
+    int fd;
+    int i;
+    ssize_t nbytes;
+    struct sockaddr_in sin;
+    char response [1024];
+    size_t pos;
+    char buf [1000];
+    uint8_t hdr [2];
+    uint8_t payload [125];
+    size_t len;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_setdeflate (sb, 1, 1, 15);
+    test_bind (sb, addr);
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = connect (fd, (struct sockaddr*) &sin, sizeof (sin));
+    errno_assert (rc == 0);
+
+    /*  The server picks the browser's offer. */
+    strcpy (response,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pair.sp.nanomsg.org\r\n"
+        "Sec-WebSocket-Extensions: permessage-deflate; "
+            "client_max_window_bits\r\n"
+        "\r\n");
+    nbytes = send (fd, response, strlen (response), 0);
+    nn_assert (nbytes == (ssize_t) strlen (response));
+    for (pos = 0; pos < 4 ||
+          memcmp (response + pos - 4, "\r\n\r\n", 4) != 0; ++pos) {
+        nn_assert (pos < sizeof (response) - 1);
+        test_read (fd, response + pos, 1);
+    }
+    response [pos] = 0;
+    nn_assert (strstr (response, "HTTP/1.1 101") == response);
+    nn_assert (strstr (response,
+        "Sec-WebSocket-Extensions: permessage-deflate\r\n"));
+
+    /*  Compressed message from the socket is marked by RSV1. */
+    for (i = 0; i != sizeof (buf); ++i)
+        buf [i] = (char) ('a' + (i % 16));
+    rc = nn_send (sb, buf, sizeof (buf), 0);
+    errno_assert (rc == sizeof (buf));
+    test_read (fd, hdr, 2);
+    nn_assert (hdr [0] == 0xc2);
+    len = hdr [1];
+    nn_assert (len < 125);
+    test_read (fd, payload, len);
+
+    /*  It's the first message of the stream and thus self-contained. */
+    test_send_frame (fd, 0xc2, payload, len);
+    rc = nn_recv (sb, buf, sizeof (buf), 0);
+    errno_assert (rc == sizeof (buf));
+    for (i = 0; i != sizeof (buf); ++i)
+        nn_assert (buf [i] == (char) ('a' + (i % 16)));
+
+    /*  Fragmented compressed text message. */
+    test_send_frame (fd, 0x41, "\x00\x05\x00\xfa\xff" "He", 7);
+    test_send_frame (fd, 0x80, "llo", 3);
+    test_recv (sb, "Hello");
+
+    /*  Uncompressed messages may be interleaved. */
+    test_send_frame (fd, 0x82, "ABC", 3);
+    test_recv (sb, "ABC");
+
+    /*  Text is validated once decompressed. */
+    test_send_frame (fd, 0xc1, "\x00\x02\x00\xfd\xff" "\xc3\x28", 7);
+    test_read (fd, hdr, 2);
+    nn_assert (hdr [0] == 0x88);
+    len = hdr [1];
+    test_read (fd, payload, len);
+    nn_assert (len >= 2 && payload [0] * 256 + payload [1] == 1007);
+
+    close (fd);
+    test_close (sb);
+}
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int sb;
+    int rc;
+    int opt;
+    size_t sz;
+    int port;
+    char addr [128];
+
+    port = get_test_port (argc, argv);
+
+    /*  Option validation. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_WS, NN_WS_DEFLATE, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt) && opt == 0);
+    rc = nn_getsockopt (sb, NN_WS, NN_WS_DEFLATE_TAKEOVER, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 1);
+    rc = nn_getsockopt (sb, NN_WS, NN_WS_DEFLATE_WINDOW_BITS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 15);
+    opt = 8;
+    rc = nn_setsockopt (sb, NN_WS, NN_WS_DEFLATE_WINDOW_BITS,
+        &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 16;
+    rc = nn_setsockopt (sb, NN_WS, NN_WS_DEFLATE_WINDOW_BITS,
+        &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    rc = nn_setsockopt (sb, NN_WS, NN_WS_DEFLATE, &opt, sizeof (opt));
+    test_close (sb);
+
+    /*  The build has no zlib; nothing more to test. */
+    if (rc < 0) {
+        nn_assert (nn_errno () == EINVAL);
+        return 0;
+    }
+
+    /*  Both peers agree on the extension. */
+    test_addr_from (addr, "ws", "127.0.0.1", port);
+    test_deflate_transfer (addr, 1, 15, 1);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 1);
+    test_deflate_transfer (addr, 0, 15, 1);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 2);
+    test_deflate_transfer (addr, 1, 9, 1);
+
+    /*  Only one peer enables it; nothing gets compressed. */
+    test_addr_from (addr, "ws", "127.0.0.1", port + 3);
+    test_deflate_transfer (addr, 1, 15, 0);
+
+#if !defined NN_HAVE_WINDOWS
+    test_addr_from (addr, "ws", "127.0.0.1", port + 4);
+    test_browser (addr, port + 4);
+#endif
+
+    return 0;
+}
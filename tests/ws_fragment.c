@@ -0,0 +1,275 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/ws.h"
+
+#include "testutil.h"
+
+#if !defined NN_HAVE_WINDOWS
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+/*  Tests reassembly of messages fragmented into many WebSocket frames, as
+    other implementations and proxies may send them. */
+
+#define TEST_MSGSZ (1024 * 1024)
+#define TEST_FRAGSZ 4096
+
+#if !defined NN_HAVE_WINDOWS
+static void test_read (int fd, void *buf, size_t len)
+{
+    ssize_t nbytes;
+
+    nbytes = recv (fd, buf, len, MSG_WAITALL);
+    nn_assert (nbytes == (ssize_t) len);
+}
+
+/*  Sends a masked frame as a client would. */
+static void test_send_frame (int fd, uint8_t hdr, const void *data,
+    size_t len)
+{
+    ssize_t nbytes;
+    size_t hdrlen;
+    size_t i;
+    uint8_t frame [8 + TEST_FRAGSZ];
+
+    nn_assert (len <= TEST_FRAGSZ);
+    frame [0] = hdr;
+    if (len < 126) {
+        frame [1] = 0x80 | (uint8_t) len;
+        hdrlen = 2;
+    }
+    else {
+        frame [1] = 0x80 | 126;
+        frame [2] = (uint8_t) (len >> 8);
+        frame [3] = (uint8_t) len;
+        hdrlen = 4;
+    }
+    memcpy (frame + hdrlen, "\x11\x22\x33\x44", 4);
+    for (i = 0; i != len; ++i)
+        frame [hdrlen + 4 + i] = ((const uint8_t*) data) [i] ^
+            frame [hdrlen + i % 4];
+    nbytes = send (fd, frame, hdrlen + 4 + len, MSG_NOSIGNAL);
+    nn_assert (nbytes == (ssize_t) (hdrlen + 4 + len));
+}
+
+/*  Sends a message split into frames of 'fragsz' bytes, with a ping in the
+    middle of it. */
+static void test_send_fragmented (int fd, const char *buf, size_t len,
+    size_t fragsz)
+{
+    size_t pos;
+    size_t n;
+    uint8_t opcode;
+
+    opcode = 0x02;
+    for (pos = 0; pos < len; pos += n) {
+        n = len - pos < fragsz ? len - pos : fragsz;
+        test_send_frame (fd, opcode | (pos + n == len ? 0x80 : 0),
+            buf + pos, n);
+        if (pos == 0)
+            test_send_frame (fd, 0x89, "ping", 4);
+        opcode = 0x00;
+    }
+}
+
+static int test_connect_raw (int port)
+{
+    int rc;
+    int fd;
+    ssize_t nbytes;
+    struct sockaddr_in sin;
+    char response [1024];
+    size_t pos;
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = connect (fd, (struct sockaddr*) &sin, sizeof (sin));
+    errno_assert (rc == 0);
+
+    strcpy (response,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pair.sp.nanomsg.org\r\n"
+        "\r\n");
+    nbytes = send (fd, response, strlen (response), 0);
+    nn_assert (nbytes == (ssize_t) strlen (response));
+    for (pos = 0; pos < 4 ||
+          memcmp (response + pos - 4, "\r\n\r\n", 4) != 0; ++pos) {
+        nn_assert (pos < sizeof (response) - 1);
+        test_read (fd, response + pos, 1);
+    }
+    nn_assert (memcmp (response, "HTTP/1.1 101", 12) == 0);
+
+    return fd;
+}
+
+static void test_fragments (char *addr, int port)
+{
+    int rc;
+    int sb;
+    int fd;
+    int i;
+    char *buf;
+    void *rbuf;
+
+    buf = malloc (TEST_MSGSZ);
+    nn_assert (buf);
+    for (i = 0; i != TEST_MSGSZ; ++i)
+        buf [i] = (char) (i % 251);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, addr);
+    fd = test_connect_raw (port);
+
+    /*  Large messages, the second one sized after the first. Pings in the
+        middle of them are passed to the user ahead of them. */
+    for (i = 0; i != 2; ++i) {
+        test_send_fragmented (fd, buf, TEST_MSGSZ, TEST_FRAGSZ);
+        test_recv (sb, "ping");
+        rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+        errno_assert (rc == TEST_MSGSZ);
+        nn_assert (memcmp (rbuf, buf, TEST_MSGSZ) == 0);
+        nn_freemsg (rbuf);
+    }
+
+    /*  Small messages after large ones, fragmented or not. */
+    test_send_fragmented (fd, buf, 1000, 100);
+    test_recv (sb, "ping");
+    rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+    errno_assert (rc == 1000);
+    nn_assert (memcmp (rbuf, buf, 1000) == 0);
+    nn_freemsg (rbuf);
+    test_send_frame (fd, 0x82, "ABC", 3);
+    test_recv (sb, "ABC");
+
+    /*  Empty fragments. */
+    test_send_frame (fd, 0x02, "", 0);
+    test_send_frame (fd, 0x00, "AB", 2);
+    test_send_frame (fd, 0x80, "", 0);
+    test_recv (sb, "AB");
+    test_send_frame (fd, 0x02, "", 0);
+    test_send_frame (fd, 0x80, "", 0);
+    rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+    errno_assert (rc == 0);
+    nn_freemsg (rbuf);
+
+    /*  Text messages with code points split between fragments, followed
+        by more text in the same fragment. */
+    test_send_frame (fd, 0x01, "a\xf0\x9f\x98", 4);
+    test_send_frame (fd, 0x80, "\x80", 1);
+    test_recv (sb, "a\xf0\x9f\x98\x80");
+    test_send_frame (fd, 0x01, "\xf0", 1);
+    test_send_frame (fd, 0x00, "\x9f\x98", 2);
+    test_send_frame (fd, 0x80, "\x80\xc3\xa9" "b", 4);
+    test_recv (sb, "\xf0\x9f\x98\x80\xc3\xa9" "b");
+    test_send_frame (fd, 0x01, "\xc3", 1);
+    test_send_frame (fd, 0x00, "", 0);
+    test_send_frame (fd, 0x80, "\xa9", 1);
+    test_recv (sb, "\xc3\xa9");
+
+    close (fd);
+    test_close (sb);
+    free (buf);
+}
+
+/*  Message growing over NN_RCVMAXSIZE fails the connection. */
+static void test_rcvmaxsize (char *addr, int port)
+{
+    int sb;
+    int fd;
+    int opt;
+    char buf [TEST_FRAGSZ];
+    uint8_t hdr [2];
+
+    memset (buf, 'a', sizeof (buf));
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 3 * TEST_FRAGSZ;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    test_bind (sb, addr);
+    fd = test_connect_raw (port);
+    test_send_frame (fd, 0x02, buf, TEST_FRAGSZ);
+    test_send_frame (fd, 0x00, buf, TEST_FRAGSZ);
+    test_send_frame (fd, 0x00, buf, TEST_FRAGSZ);
+    test_send_frame (fd, 0x80, buf, 1);
+    test_read (fd, hdr, 2);
+    nn_assert (hdr [0] == 0x88);
+    close (fd);
+    test_close (sb);
+}
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int sb;
+    int sc;
+    int rc;
+    int i;
+    int port;
+    char addr [128];
+    char *buf;
+    void *rbuf;
+
+    port = get_test_port (argc, argv);
+
+    /*  nanomsg peers send each message in a single frame. */
+    test_addr_from (addr, "ws", "127.0.0.1", port);
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, addr);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, addr);
+    buf = malloc (TEST_MSGSZ);
+    nn_assert (buf);
+    for (i = 0; i != TEST_MSGSZ; ++i)
+        buf [i] = (char) (i % 253);
+    rc = nn_send (sc, buf, TEST_MSGSZ, 0);
+    errno_assert (rc == TEST_MSGSZ);
+    rc = nn_recv (sb, &rbuf, NN_MSG, 0);
+    errno_assert (rc == TEST_MSGSZ);
+    nn_assert (memcmp (rbuf, buf, TEST_MSGSZ) == 0);
+    nn_freemsg (rbuf);
+    free (buf);
+    test_close (sc);
+    test_close (sb);
+
+#if !defined NN_HAVE_WINDOWS
+    test_addr_from (addr, "ws", "127.0.0.1", port + 1);
+    test_fragments (addr, port + 1);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 2);
+    test_rcvmaxsize (addr, port + 2);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/ws.h"
+
+#include "testutil.h"
+
+#if !defined NN_HAVE_WINDOWS
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+/*  Tests parsing of opening handshakes sent by other implementations. */
+
+#if !defined NN_HAVE_WINDOWS
+
+/*  Masked binary frame containing "ABC". */
+static const char test_frame [] = "\x82\x83\x11\x22\x33\x44\x50\x60\x70";
+
+/*  Sends the request split into pieces of 'piecesz' bytes, each of them in
+    a separate TCP segment, and receives the status line of the response. */
+static int test_handshake (int port, const char *request, size_t piecesz,
+    char *status, size_t statussz)
+{
+    int rc;
+    int fd;
+    ssize_t nbytes;
+    struct sockaddr_in sin;
+    size_t len;
+    size_t pos;
+    size_t n;
+
+    fd = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (fd >= 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = connect (fd, (struct sockaddr*) &sin, sizeof (sin));
+    errno_assert (rc == 0);
+
+    len = strlen (request);
+    for (pos = 0; pos < len; pos += n) {
+        n = len - pos < piecesz ? len - pos : piecesz;
+        nbytes = send (fd, request + pos, n, 0);
+        errno_assert (nbytes == (ssize_t) n);
+        if (pos + n < len)
+            nn_sleep (1);
+    }
+
+    /*  Error responses are followed by closing the connection. */
+    for (pos = 0; pos < statussz - 1; ++pos) {
+        nbytes = recv (fd, status + pos, 1, 0);
+        errno_assert (nbytes >= 0);
+        if (nbytes == 0 || status [pos] == '\r')
+            break;
+    }
+    status [pos] = 0;
+
+    return fd;
+}
+
+/*  Receives the rest of the response. Returns 1 if it contains 'str'. */
+static int test_read_response (int fd, const char *str)
+{
+    ssize_t nbytes;
+    char response [512];
+    size_t pos;
+
+    for (pos = 0; pos < 3 ||
+          memcmp (response + pos - 3, "\n\r\n", 3) != 0; ++pos) {
+        nn_assert (pos < sizeof (response) - 1);
+        nbytes = recv (fd, response + pos, 1, 0);
+        nn_assert (nbytes == 1);
+    }
+    response [pos] = 0;
+    return str && strstr (response, str) != NULL;
+}
+
+static void test_requests (char *addr, int port)
+{
+    int sb;
+    int fd;
+    char status [64];
+    char request [512];
+    ssize_t nbytes;
+    size_t len;
+
+    sb = test_socket (AF_SP, NN_PULL);
+    test_bind (sb, addr);
+
+    /*  Handshake trickling in a few bytes at a time. */
+    fd = test_handshake (port,
+        "GET /chat?x=y HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Origin: http://127.0.0.1\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pull.sp.nanomsg.org\r\n"
+        "\r\n", 7, status, sizeof (status));
+    nn_assert (strcmp (status, "HTTP/1.1 101 Switching Protocols") == 0);
+    test_read_response (fd, NULL);
+    nbytes = send (fd, test_frame, sizeof (test_frame) - 1, 0);
+    errno_assert (nbytes == sizeof (test_frame) - 1);
+    test_recv (sb, "ABC");
+    close (fd);
+
+    /*  Data sent along with the handshake is not taken for a part of it.
+        Names of header fields are case insensitive and Connection header
+        may list multiple options. */
+    strcpy (request,
+        "GET / HTTP/1.1\r\n"
+        "host: 127.0.0.1\r\n"
+        "UPGRADE: websocket\r\n"
+        "connection:keep-alive, upgrade  \r\n"
+        "sec-websocket-key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version:   13\r\n"
+        "Sec-WebSocket-Protocol: pull.sp.nanomsg.org\r\n"
+        "\r\n");
+    strcat (request, test_frame);
+    fd = test_handshake (port, request, sizeof (request), status,
+        sizeof (status));
+    nn_assert (strcmp (status, "HTTP/1.1 101 Switching Protocols") == 0);
+    test_read_response (fd, NULL);
+    test_recv (sb, "ABC");
+    close (fd);
+
+    /*  Upgrade must be listed in Connection header, not anywhere else. */
+    fd = test_handshake (port,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Connection: keep-alive\r\n"
+        "Upgrade: websocket\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pull.sp.nanomsg.org\r\n"
+        "\r\n", 512, status, sizeof (status));
+    nn_assert (strncmp (status, "HTTP/1.1 400", 12) == 0);
+    close (fd);
+
+    /*  Malformed header line. */
+    fd = test_handshake (port,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pull.sp.nanomsg.org\r\n"
+        "\r\n", 512, status, sizeof (status));
+    nn_assert (strncmp (status, "HTTP/1.1 400", 12) == 0);
+    close (fd);
+
+    /*  Garbage after an early blank line, received along with it. */
+    strcpy (request, "GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+    len = strlen (request);
+    memset (request + len, 'X', 300);
+    strcpy (request + len + 300, "\r\n\r\n");
+    fd = test_handshake (port, request, sizeof (request), status,
+        sizeof (status));
+    nn_assert (strncmp (status, "HTTP/1.1 400", 12) == 0);
+    close (fd);
+
+    test_close (sb);
+}
+
+static void test_compression (char *addr, int port)
+{
+    int sb;
+    int fd;
+    int opt;
+    char status [64];
+
+    sb = test_socket (AF_SP, NN_PULL);
+    opt = NN_COMPRESSION_LZ;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_COMPRESSION, &opt, sizeof (opt));
+    test_bind (sb, addr);
+
+    /*  The extension is recognised by its name as a whole. */
+    fd = test_handshake (port,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pull.sp.nanomsg.org\r\n"
+        "Sec-WebSocket-Extensions: x-foo; p=\"a, x-nanomsg-compress\", "
+        "X-Nanomsg-Compress; codecs=1\r\n"
+        "\r\n", 512, status, sizeof (status));
+    nn_assert (strcmp (status, "HTTP/1.1 101 Switching Protocols") == 0);
+    nn_assert (test_read_response (fd, "x-nanomsg-compress; codec=1"));
+    close (fd);
+
+    /*  Nor as a part of another extension's name or parameter. */
+    fd = test_handshake (port,
+        "GET / HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Protocol: pull.sp.nanomsg.org\r\n"
+        "Sec-WebSocket-Extensions: x-nanomsg-compressor; codecs=1, "
+        "x-foo; p=\"x-nanomsg-compress; codecs=1\"\r\n"
+        "\r\n", 512, status, sizeof (status));
+    nn_assert (strcmp (status, "HTTP/1.1 101 Switching Protocols") == 0);
+    nn_assert (!test_read_response (fd, "x-nanomsg-compress"));
+    close (fd);
+
+    test_close (sb);
+}
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int sb;
+    int sc;
+    int port;
+    char addr [128];
+
+    port = get_test_port (argc, argv);
+
+    /*  Handshake between nanomsg peers. */
+    test_addr_from (addr, "ws", "127.0.0.1", port);
+    sb = test_socket (AF_SP, NN_PULL);
+    test_bind (sb, addr);
+    sc = test_socket (AF_SP, NN_PUSH);
+    test_connect (sc, addr);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    test_close (sc);
+    test_close (sb);
+
+#if !defined NN_HAVE_WINDOWS
+    test_addr_from (addr, "ws", "127.0.0.1", port + 1);
+    test_requests (addr, port + 1);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 2);
+    test_compression (addr, port + 2);
+#endif
+
+    return 0;
+}
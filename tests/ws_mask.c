@@ -0,0 +1,95 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/err.c"
+#include "../src/transports/ws/ws_mask.c"
+
+#include <string.h>
+
+/*  Checks the vectorised masking routines against the byte-by-byte one
+    for all combinations of buffer alignment, length and key offset. */
+
+#define BUF_SIZE 600
+
+static uint8_t orig [BUF_SIZE + 64];
+static uint8_t ref [BUF_SIZE + 64];
+static uint8_t buf [BUF_SIZE + 64];
+static const uint8_t mask [NN_WS_MASK_SIZE] = {0x12, 0x34, 0xab, 0xcd};
+
+static void check (nn_ws_mask_fn fn)
+{
+    size_t align;
+    size_t len;
+    size_t pos;
+    size_t rc1;
+    size_t rc2;
+
+    for (align = 0; align != 33; ++align) {
+        for (len = 0; len != BUF_SIZE; ++len) {
+            for (pos = 0; pos != NN_WS_MASK_SIZE; ++pos) {
+                memcpy (ref, orig, sizeof (orig));
+                memcpy (buf, orig, sizeof (orig));
+                rc1 = nn_ws_mask_bytes (ref + align, len, mask, pos);
+                rc2 = fn (buf + align, len, mask, pos);
+                nn_assert (rc1 == rc2);
+                nn_assert (memcmp (ref, buf, sizeof (buf)) == 0);
+            }
+        }
+    }
+}
+
+int main ()
+{
+    size_t i;
+    size_t pos;
+
+    for (i = 0; i != sizeof (orig); ++i)
+        orig [i] = (uint8_t) (i * 7 + 3);
+
+    check (nn_ws_mask_word);
+#if defined NN_WS_MASK_SSE2
+    check (nn_ws_mask_sse2);
+#endif
+#if defined NN_WS_MASK_AVX2
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        check (nn_ws_mask_avx2);
+#endif
+    nn_ws_mask_init ();
+    check (nn_ws_mask);
+
+    /*  Masking a payload in several pieces must give the same result as
+        masking it at once. */
+    memcpy (ref, orig, sizeof (orig));
+    memcpy (buf, orig, sizeof (orig));
+    nn_ws_mask_bytes (ref, BUF_SIZE, mask, 0);
+    pos = nn_ws_mask (buf, 3, mask, 0);
+    pos = nn_ws_mask (buf + 3, 101, mask, pos);
+    nn_ws_mask (buf + 104, BUF_SIZE - 104, mask, pos);
+    nn_assert (memcmp (ref, buf, sizeof (buf)) == 0);
+
+    /*  Unmasking restores the original data. */
+    nn_ws_mask (buf, BUF_SIZE, mask, 0);
+    nn_assert (memcmp (orig, buf, sizeof (buf)) == 0);
+
+    return 0;
+}
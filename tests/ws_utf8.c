@@ -0,0 +1,154 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/err.c"
+#include "../src/transports/ws/ws_utf8.c"
+
+#include <string.h>
+
+/*  Checks the fast UTF-8 validators against the code point by code point
+    one on random text with random errors injected. */
+
+#define BUF_SIZE 300
+
+static uint32_t seed = 1;
+
+/*  Shape of the text being generated: the weight of ASCII characters and
+    the odds of an invalid sequence, zero meaning none. */
+static uint32_t ascii_weight;
+static uint32_t bad_odds;
+
+static uint32_t rnd (uint32_t range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+/*  Appends a random, mostly valid, code point. Returns its length. */
+static size_t put_code_point (uint8_t *buf)
+{
+    static const uint8_t bad [][4] = {
+        {0xC0, 0x80}, {0xC1, 0xBF}, {0xE0, 0x80, 0x80}, {0xE0, 0x9F, 0xBF},
+        {0xED, 0xA0, 0x80}, {0xED, 0xBF, 0xBF}, {0xF0, 0x80, 0x80, 0x80},
+        {0xF0, 0x8F, 0xBF, 0xBF}, {0xF4, 0x90, 0x80, 0x80}, {0xF5, 0x80},
+        {0xFF}, {0x80}, {0xBF}, {0xC2, 0x41}, {0xE1, 0x80, 0x41},
+        {0xF1, 0x80, 0x80, 0x41}, {0xC2, 0xC2}, {0xE1, 0xE1}
+    };
+    uint32_t cp;
+    size_t n;
+
+    switch (rnd (3 + ascii_weight)) {
+    case 0:
+        buf [0] = (uint8_t) (0xC2 + rnd (0xE0 - 0xC2));
+        buf [1] = (uint8_t) (0x80 + rnd (0x40));
+        return 2;
+    case 1:
+        do {
+            cp = 0x800 + rnd (0x10000 - 0x800);
+        } while (cp >= 0xD800 && cp <= 0xDFFF);
+        buf [0] = (uint8_t) (0xE0 | (cp >> 12));
+        buf [1] = (uint8_t) (0x80 | ((cp >> 6) & 0x3F));
+        buf [2] = (uint8_t) (0x80 | (cp & 0x3F));
+        return 3;
+    case 2:
+        cp = 0x10000 + rnd (0x110000 - 0x10000);
+        buf [0] = (uint8_t) (0xF0 | (cp >> 18));
+        buf [1] = (uint8_t) (0x80 | ((cp >> 12) & 0x3F));
+        buf [2] = (uint8_t) (0x80 | ((cp >> 6) & 0x3F));
+        buf [3] = (uint8_t) (0x80 | (cp & 0x3F));
+        return 4;
+    default:
+        if (bad_odds && rnd (bad_odds) == 0) {
+            cp = rnd (sizeof (bad) / sizeof (bad [0]));
+            for (n = 0; n != 4 && (n == 0 || bad [cp][n]); ++n)
+                buf [n] = bad [cp][n];
+            return n;
+        }
+        buf [0] = (uint8_t) (0x20 + rnd (0x5F));
+        return 1;
+    }
+}
+
+/*  Reference implementation, one code point at a time. */
+static size_t valid_ref (const uint8_t *buf, size_t len)
+{
+    size_t i;
+    int rc;
+
+    for (i = 0; i != len; i += rc) {
+        rc = nn_ws_utf8_code_point (buf + i, len - i);
+        if (rc < 0)
+            break;
+    }
+    return i;
+}
+
+static void check (nn_ws_utf8_fn fn, const uint8_t *buf, size_t len)
+{
+    size_t off;
+
+    for (off = 0; off != 4 && off <= len; ++off)
+        nn_assert (fn (buf + off, len - off) ==
+            valid_ref (buf + off, len - off));
+}
+
+int main ()
+{
+    static const uint8_t text [] = "{\"name\":\"caf\xC3\xA9\","
+        "\"city\":\"\xE6\x9D\xB1\xE4\xBA\xAC\",\"mood\":\"\xF0\x9F\x98\x80\"}"
+        "{\"name\":\"plain ascii text\",\"value\":12345}";
+    uint8_t buf [BUF_SIZE + 4];
+    size_t len;
+    size_t n;
+    int i;
+
+    /*  Well-formed text is accepted as a whole; a prefix cut inside a code
+        point is accepted up to the code point. */
+    nn_ws_utf8_init ();
+    len = sizeof (text) - 1;
+    nn_assert (nn_ws_utf8_valid (text, len) == len);
+    nn_assert (nn_ws_utf8_valid (text, 13) == 12);
+    nn_assert (nn_ws_utf8_code_point (text + 12, 1) == NN_WS_UTF8_FRAGMENT);
+
+    for (i = 0; i != 20000; ++i) {
+        ascii_weight = 1 + rnd (100);
+        bad_odds = rnd (2) ? 0 : 1 + rnd (1000);
+        len = 0;
+        while (len < BUF_SIZE) {
+            n = put_code_point (buf + len);
+            len += n;
+        }
+        len = rnd ((uint32_t) len + 1);
+
+        check (nn_ws_utf8_valid_word, buf, len);
+#if defined NN_WS_UTF8_SIMD
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("ssse3"))
+            check (nn_ws_utf8_valid_ssse3, buf, len);
+        if (__builtin_cpu_supports ("avx2"))
+            check (nn_ws_utf8_valid_avx2, buf, len);
+#endif
+        check (nn_ws_utf8_valid, buf, len);
+    }
+
+    return 0;
+}